@@ -0,0 +1,78 @@
+#pragma once
+
+// minimal benchmark helpers, each benchmark is its own executable.
+// data is generated from a fixed seed and every run is repeated, so that
+// numbers can be compared between changes on the same machine.
+
+#include <switch.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace sphaira::bench {
+
+// number of times each benchmark is run, the median is reported.
+// can be overridden with SPHAIRA_BENCH_ITERATIONS.
+inline auto GetIterations() -> int {
+    if (const auto env = std::getenv("SPHAIRA_BENCH_ITERATIONS")) {
+        return std::max(1, std::atoi(env));
+    }
+    return 5;
+}
+
+inline auto GetTimeNs() -> u64 {
+    return armTicksToNs(armGetSystemTick());
+}
+
+// returns size bytes of data, ratio is roughly how much of it is compressible (0-100).
+// nca's are mostly encrypted / already compressed, 25 is close to a typical game.
+inline auto MakeData(u64 size, u32 ratio = 25, u64 seed = 0x5EED) -> std::vector<u8> {
+    std::vector<u8> data(size);
+    u64 x = seed;
+    const auto next = [&x]() {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return x;
+    };
+
+    for (u64 off = 0; off < size; ) {
+        const auto run = std::min<u64>(size - off, 64 + next() % 4096);
+        if (next() % 100 < ratio) {
+            std::memset(data.data() + off, next() & 0xFF, run);
+        } else {
+            for (u64 i = 0; i < run; i++) {
+                data[off + i] = next();
+            }
+        }
+        off += run;
+    }
+
+    return data;
+}
+
+// runs func GetIterations() times and prints the median and best speed.
+// func returns the number of bytes processed, or -1 on error.
+inline auto Run(const char* name, const std::function<s64()>& func) -> bool {
+    std::vector<double> speeds;
+    for (int i = 0; i < GetIterations(); i++) {
+        const auto start = GetTimeNs();
+        const auto size = func();
+        const auto elapsed = std::max<u64>(1, GetTimeNs() - start);
+        if (size < 0) {
+            std::printf("%-40s failed\n", name);
+            return false;
+        }
+
+        speeds.emplace_back(size / (elapsed / 1e+9) / 1024.0 / 1024.0);
+    }
+
+    std::ranges::sort(speeds);
+    std::printf("%-40s median: %9.2f MiB/s best: %9.2f MiB/s\n", name, speeds[speeds.size() / 2], speeds.back());
+    return true;
+}
+
+} // namespace sphaira::bench
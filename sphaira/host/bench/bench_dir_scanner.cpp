@@ -0,0 +1,138 @@
+#include "bench.hpp"
+#include "utils/dir_scanner.hpp"
+#include "fs.hpp"
+#include <filesystem>
+
+// listing and stat'ing a large directory, either on the calling thread as the
+// filebrowser used to, or with utils::DirScanner in the background.
+// the time that matters is how long until the first entries can be drawn.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u32 FILE_COUNT = 1024 * 20;
+constexpr u32 DIR_COUNT = 64;
+
+struct Times {
+    double first_ms;
+    double listed_ms;
+    double stat_ms;
+};
+
+auto ToMs(u64 start) -> double {
+    return (bench::GetTimeNs() - start) / 1e+6;
+}
+
+// reads the whole directory, then stats every entry.
+auto ReadSync(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path) -> Times {
+    const auto start = bench::GetTimeNs();
+
+    fs::Dir d;
+    std::vector<FsDirectoryEntry> entries;
+    if (R_FAILED(fs->OpenDirectory(path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &d)) || R_FAILED(d.ReadAll(entries))) {
+        return {-1, -1, -1};
+    }
+
+    const auto listed_ms = ToMs(start);
+    for (const auto& e : entries) {
+        const auto file_path = fs::AppendPath(path, e.name);
+        if (e.type == FsDirEntryType_Dir) {
+            s64 file_count, dir_count;
+            fs->DirGetEntryCount(file_path, &file_count, &dir_count);
+        } else {
+            FsTimeStampRaw ts;
+            s64 size;
+            fs->FileGetSizeAndTimestamp(file_path, &ts, &size);
+        }
+    }
+
+    // nothing can be drawn until the entries are sorted, which needs the stats.
+    const auto stat_ms = ToMs(start);
+    return {stat_ms, listed_ms, stat_ms};
+}
+
+// polls the scanner, as the filebrowser does each frame.
+auto ReadScanner(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path) -> Times {
+    Times times{-1, -1, -1};
+    const auto start = bench::GetTimeNs();
+
+    utils::DirScanner scanner;
+    if (R_FAILED(scanner.Start(fs, path, true))) {
+        return times;
+    }
+
+    std::vector<FsDirectoryEntry> entries;
+    std::vector<utils::DirScanner::Stat> stats;
+    u32 entry_count{}, stat_count{};
+    for (bool done = false; !done || stat_count < FILE_COUNT; ) {
+        if (!done) {
+            done = scanner.PopEntries(entries);
+            entry_count += entries.size();
+            if (!entries.empty() && times.first_ms < 0) {
+                times.first_ms = ToMs(start);
+            }
+            if (done) {
+                if (R_FAILED(scanner.GetResult()) || entry_count != FILE_COUNT + DIR_COUNT) {
+                    return {-1, -1, -1};
+                }
+                times.listed_ms = ToMs(start);
+            }
+        }
+
+        scanner.PopStats(stats);
+        stat_count += stats.size();
+        svcSleepThread(1'000'000);
+    }
+
+    times.stat_ms = ToMs(start);
+    return times;
+}
+
+void Run(const char* name, const std::function<Times()>& func) {
+    std::vector<Times> runs;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        runs.emplace_back(func());
+        if (runs.back().first_ms < 0) {
+            std::printf("%-40s failed\n", name);
+            return;
+        }
+    }
+
+    const auto median = [&runs](double Times::*field) {
+        std::vector<double> v;
+        for (const auto& t : runs) {
+            v.emplace_back(t.*field);
+        }
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+
+    std::printf("%-40s first: %9.2f ms listed: %9.2f ms stat: %9.2f ms\n", name, median(&Times::first_ms), median(&Times::listed_ms), median(&Times::stat_ms));
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/sphaira_bench_dir_scanner_XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    ON_SCOPE_EXIT(std::filesystem::remove_all(dir));
+
+    for (u32 i = 0; i < FILE_COUNT; i++) {
+        char path[PATH_MAX];
+        std::snprintf(path, sizeof(path), "%s/file_%05u.nsp", dir, i);
+        if (auto f = std::fopen(path, "wb")) {
+            std::fclose(f);
+        }
+    }
+
+    for (u32 i = 0; i < DIR_COUNT; i++) {
+        std::filesystem::create_directory(std::filesystem::path{dir} / ("dir_" + std::to_string(i)));
+    }
+
+    const auto fs = std::make_shared<fs::FsStdio>();
+    Run("dir read + stat on caller", [&]() { return ReadSync(fs, dir); });
+    Run("dir scanner", [&]() { return ReadScanner(fs, dir); });
+}
@@ -0,0 +1,161 @@
+#include "bench.hpp"
+#include "../tests/http_server.hpp"
+#include "../tests/curl_session.hpp"
+#include <atomic>
+#include <curl/curl.h>
+#include <mutex>
+#include <thread>
+
+// 500 small objects fetched at once, as the appstore and themezer do for their
+// icons. the server waits 40ms before each response, as a remote server would.
+// "pool" is the fixed pool of 4 threads each blocking in curl_easy_perform that
+// async transfers used before, "multi" is the TransferQueue.
+// latency is from queueing every request to each callback being called.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u32 OBJECT_COUNT = 500;
+constexpr u64 OBJECT_SIZE = 1024 * 8;
+constexpr u64 LATENCY_MS = 40;
+constexpr u32 POOL_THREADS = 4;
+
+struct Stats {
+    double req_per_sec;
+    double p50_ms;
+    double p99_ms;
+};
+
+auto MakeStats(std::vector<u64>& done_ns, u64 start, u64 end) -> Stats {
+    std::ranges::sort(done_ns);
+    const auto ms = [&](double p) { return (done_ns[u64(p * (done_ns.size() - 1))] - start) / 1e+6; };
+    return {done_ns.size() / ((end - start) / 1e+9), ms(0.50), ms(0.99)};
+}
+
+auto DiscardCallback(char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
+    *static_cast<u64*>(userdata) += size * nmemb;
+    return size * nmemb;
+}
+
+auto RunPool(const std::vector<std::string>& urls) -> Stats {
+    std::mutex mutex;
+    u32 next{};
+    std::vector<u64> done_ns;
+    std::atomic<u32> failed{};
+
+    const auto start = bench::GetTimeNs();
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < POOL_THREADS; t++) {
+        threads.emplace_back([&]() {
+            auto curl = curl_easy_init();
+            for (;;) {
+                std::string url;
+                {
+                    std::scoped_lock lock{mutex};
+                    if (next == urls.size()) {
+                        break;
+                    }
+                    url = urls[next++];
+                }
+
+                u64 size{};
+                curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardCallback);
+                curl_easy_setopt(curl, CURLOPT_WRITEDATA, &size);
+                if (curl_easy_perform(curl) != CURLE_OK || size != OBJECT_SIZE) {
+                    failed++;
+                }
+
+                std::scoped_lock lock{mutex};
+                done_ns.emplace_back(bench::GetTimeNs());
+            }
+            curl_easy_cleanup(curl);
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        return {};
+    }
+    return MakeStats(done_ns, start, bench::GetTimeNs());
+}
+
+auto RunMulti(const std::vector<std::string>& urls) -> Stats {
+    test::CurlSession session;
+    std::vector<u64> done_ns;
+    u32 failed{};
+
+    const auto start = bench::GetTimeNs();
+    for (const auto& url : urls) {
+        curl::Api().ToMemoryAsync(
+            curl::Url{url},
+            curl::Priority::Normal,
+            curl::StopToken{},
+            curl::OnComplete{[&](auto& result) {
+                failed += !result.success || result.data.size() != OBJECT_SIZE;
+                done_ns.emplace_back(bench::GetTimeNs());
+            }}
+        );
+    }
+
+    // the app calls the callbacks once a frame, this pumps every 1ms so that
+    // the frame time isn't counted.
+    if (!session.PumpUntil([&]() { return done_ns.size() == urls.size(); }, 60000) || failed) {
+        return {};
+    }
+    return MakeStats(done_ns, start, bench::GetTimeNs());
+}
+
+void Run(const char* name, const std::vector<std::string>& urls, const std::function<Stats(const std::vector<std::string>&)>& func) {
+    std::vector<Stats> stats;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        stats.emplace_back(func(urls));
+    }
+
+    // median of each field.
+    const auto median = [&stats](double Stats::*field) {
+        std::vector<double> v;
+        for (const auto& e : stats) {
+            v.emplace_back(e.*field);
+        }
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+
+    std::printf("%-24s %7.1f req/s p50: %7.1f ms p99: %7.1f ms\n",
+        name, median(&Stats::req_per_sec), median(&Stats::p50_ms), median(&Stats::p99_ms));
+}
+
+} // namespace
+
+int main() {
+    // icons usually come from a single host, themezer also fetches from a cdn.
+    test::http::Server servers[3];
+    for (auto& server : servers) {
+        server.SetOptions({.latency_ms = LATENCY_MS});
+        for (u32 i = 0; i < OBJECT_COUNT; i++) {
+            server.AddFile("/" + std::to_string(i), bench::MakeData(OBJECT_SIZE, 25, i));
+        }
+        if (!server.Start()) {
+            return 1;
+        }
+    }
+
+    std::vector<std::string> one_host, three_hosts;
+    for (u32 i = 0; i < OBJECT_COUNT; i++) {
+        one_host.emplace_back(servers[0].Url("/" + std::to_string(i)));
+        three_hosts.emplace_back(servers[i % std::size(servers)].Url("/" + std::to_string(i)));
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    std::printf("%u x %llu KiB, %llums latency\n", OBJECT_COUNT, (unsigned long long)OBJECT_SIZE / 1024, (unsigned long long)LATENCY_MS);
+    Run("pool, 1 host", one_host, RunPool);
+    Run("multi, 1 host", one_host, RunMulti);
+    Run("pool, 3 hosts", three_hosts, RunPool);
+    Run("multi, 3 hosts", three_hosts, RunMulti);
+    curl_global_cleanup();
+}
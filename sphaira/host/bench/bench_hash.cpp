@@ -0,0 +1,123 @@
+#include "bench.hpp"
+#include "hasher.hpp"
+#include "hash_kernel.hpp"
+#include <cstring>
+#include <string>
+
+// hash::Hash throughput for each type, over a memory source so that only
+// the hashing and the transfer threads are measured.
+// also hashing every type at once (the file browser's "hash all") against
+// hashing the file once per type.
+// then each crc32c / sha256 kernel on its own, the shim uses the last supported one.
+
+using namespace sphaira;
+
+namespace {
+
+struct MemSource final : hash::BaseSource {
+    MemSource(std::span<const u8> data) : m_data{data} {}
+
+    Result Size(s64* out) override {
+        *out = m_data.size();
+        R_SUCCEED();
+    }
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        size = std::min<s64>(size, m_data.size() - off);
+        std::memcpy(buf, m_data.data() + off, size);
+        *bytes_read = size;
+        R_SUCCEED();
+    }
+
+private:
+    const std::span<const u8> m_data;
+};
+
+} // namespace
+
+int main() {
+    const auto data = bench::MakeData(1024ULL * 1024 * 256);
+
+    const std::pair<hash::Type, const char*> types[]{
+        {hash::Type::Crc32, "hash crc32"},
+        {hash::Type::Md5, "hash md5"},
+        {hash::Type::Sha1, "hash sha1"},
+        {hash::Type::Sha256, "hash sha256"},
+        {hash::Type::Null, "hash null (transfer only)"},
+    };
+
+    for (const auto& [type, name] : types) {
+        bench::Run(name, [&]() -> s64 {
+            ui::ProgressBox pbox{0, "", "", nullptr};
+            std::string out;
+            if (R_FAILED(hash::Hash(&pbox, type, data, out))) {
+                return -1;
+            }
+            return data.size();
+        });
+    }
+
+    const hash::Type all_types[]{
+        hash::Type::Crc32,
+        hash::Type::Md5,
+        hash::Type::Sha1,
+        hash::Type::Sha256,
+    };
+
+    // reported as the file size, so the two are directly comparable.
+    bench::Run("hash all (single pass, multi thread)", [&]() -> s64 {
+        ui::ProgressBox pbox{0, "", "", nullptr};
+        MemSource source{data};
+        std::vector<std::string> out;
+        if (R_FAILED(hash::Hash(&pbox, all_types, &source, out))) {
+            return -1;
+        }
+        return data.size();
+    });
+
+    bench::Run("hash all (one pass per type)", [&]() -> s64 {
+        ui::ProgressBox pbox{0, "", "", nullptr};
+        MemSource source{data};
+        for (const auto type : all_types) {
+            std::string out;
+            if (R_FAILED(hash::Hash(&pbox, type, &source, out))) {
+                return -1;
+            }
+        }
+        return data.size();
+    });
+
+    const auto kernel_data = std::span{data}.subspan(0, 1024 * 1024 * 64);
+
+    bench::Run("kernel crc32 zlib", [&]() -> s64 {
+        volatile auto crc = crc32Calculate(kernel_data.data(), kernel_data.size());
+        (void)crc;
+        return kernel_data.size();
+    });
+
+    for (const auto& kernel : host::kernel::GetCrc32cKernels()) {
+        if (!kernel.supported()) {
+            continue;
+        }
+
+        const auto name = std::string{"kernel crc32c "} + kernel.name;
+        bench::Run(name.c_str(), [&]() -> s64 {
+            volatile auto crc = kernel.update(~0U, kernel_data.data(), kernel_data.size());
+            (void)crc;
+            return kernel_data.size();
+        });
+    }
+
+    for (const auto& kernel : host::kernel::GetSha256Kernels()) {
+        if (!kernel.supported()) {
+            continue;
+        }
+
+        const auto name = std::string{"kernel sha256 "} + kernel.name;
+        bench::Run(name.c_str(), [&]() -> s64 {
+            u32 h[8]{};
+            kernel.blocks(h, kernel_data.data(), kernel_data.size() / 64);
+            return kernel_data.size();
+        });
+    }
+}
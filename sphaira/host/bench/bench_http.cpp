@@ -0,0 +1,38 @@
+#include "bench.hpp"
+#include "../tests/http_server.hpp"
+#include "../tests/net_mount.hpp"
+
+// sequential reads from the http mount, the server throttles each connection
+// as a slow remote server would, so that a single stream is bound by the rate
+// and range requests over several connections add up.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u64 FILE_SIZE = 1024 * 1024 * 8;
+// per connection.
+constexpr u64 RATE = 1024 * 1024 * 2;
+
+} // namespace
+
+int main() {
+    test::http::Server server;
+    server.SetOptions({.rate = RATE});
+    server.AddFile("/file.bin", bench::MakeData(FILE_SIZE));
+    if (!server.Start()) {
+        return 1;
+    }
+
+    test::net::SdCard sd;
+    for (const auto connections : {1, 2, 4, 8}) {
+        test::net::Device device{test::net::Mount(sd, "HTTP", devoptab::MountHttpAll, server.Url(), {{"connections", std::to_string(connections)}})};
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "http read %d MiB/s x %d connections", int(RATE / 1024 / 1024), connections);
+        bench::Run(name, [&]() -> s64 {
+            std::vector<u8> out(FILE_SIZE);
+            return device.Read("/file.bin", 0, out, 1024 * 512) ? out.size() : -1;
+        });
+    }
+}
@@ -0,0 +1,170 @@
+#include "bench.hpp"
+#include "utils/id_queue.hpp"
+#include <memory>
+#include <unordered_map>
+
+// the title_info queue and result store with 5k titles, against the vectors
+// title_info used before, which were searched linearly.
+// "jump to end" pushes every title, then shows the last page and counts the
+// frames until it's loaded, with 8 titles loaded per frame.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u32 TITLE_COUNT = 5000;
+constexpr u32 VISIBLE = 30;
+constexpr u32 LOADS_PER_FRAME = 8;
+
+struct Title {
+    u64 id;
+    u8 data[0x300];
+};
+
+auto MakeIds() -> std::vector<u64> {
+    std::vector<u64> ids;
+    for (u32 i = 0; i < TITLE_COUNT; i++) {
+        ids.emplace_back(0x0100000000010000ULL + i * 0x2000ULL);
+    }
+    return ids;
+}
+
+// the old queue, a vector searched on every push.
+struct OldQueue {
+    void Push(u64 id) {
+        const auto it_id = std::ranges::find(ids, id);
+        const auto it_result = std::ranges::find_if(results, [id](auto& e) {
+            return id == e->id;
+        });
+
+        if (it_id == ids.end() && it_result == results.end()) {
+            ids.emplace_back(id);
+        }
+    }
+
+    auto Get(u64 id) -> Title* {
+        for (auto& e : results) {
+            if (e->id == id) {
+                return e.get();
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<u64> ids;
+    std::vector<std::unique_ptr<Title>> results;
+};
+
+struct NewQueue {
+    void Push(u64 id) {
+        if (!results.contains(id)) {
+            ids.Push(id);
+        }
+    }
+
+    auto Get(u64 id) -> Title* {
+        const auto it = results.find(id);
+        return it == results.end() ? nullptr : it->second.get();
+    }
+
+    utils::IdQueue ids;
+    std::unordered_map<u64, std::unique_ptr<Title>> results;
+};
+
+template<typename T>
+auto Median(const std::function<T()>& func) -> T {
+    std::vector<T> v;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        v.emplace_back(func());
+    }
+    std::ranges::sort(v);
+    return v[v.size() / 2];
+}
+
+auto ToMs(u64 start) -> double {
+    return (bench::GetTimeNs() - start) / 1e+6;
+}
+
+template<typename Queue>
+auto PushAll(const std::vector<u64>& ids) -> double {
+    Queue queue;
+    const auto start = bench::GetTimeNs();
+    for (const auto id : ids) {
+        queue.Push(id);
+    }
+    return ToMs(start);
+}
+
+// the time taken by the lookups of one frame, with every title loaded.
+template<typename Queue>
+auto GetFrame(const std::vector<u64>& ids) -> double {
+    Queue queue;
+    for (const auto id : ids) {
+        auto result = std::make_unique<Title>();
+        result->id = id;
+        if constexpr (std::is_same_v<Queue, OldQueue>) {
+            queue.results.emplace_back(std::move(result));
+        } else {
+            queue.results.emplace(id, std::move(result));
+        }
+    }
+
+    constexpr u32 FRAMES = 100;
+    u32 found{};
+    const auto start = bench::GetTimeNs();
+    for (u32 frame = 0; frame < FRAMES; frame++) {
+        // the visible rows are at the end, as the list is sorted by last played.
+        for (u32 i = 0; i < VISIBLE; i++) {
+            found += queue.Get(ids[ids.size() - 1 - (i + frame) % (VISIBLE * 2)]) != nullptr;
+        }
+    }
+    const auto ms = ToMs(start) / FRAMES;
+    return found == FRAMES * VISIBLE ? ms : -1;
+}
+
+// frames until the last page is loaded after jumping to it.
+auto JumpToEnd(const std::vector<u64>& ids, bool prioritise) -> u32 {
+    utils::IdQueue queue;
+    for (const auto id : ids) {
+        queue.Push(id);
+    }
+
+    const std::span visible{ids.end() - VISIBLE, ids.end()};
+    u32 remaining = VISIBLE;
+
+    for (u32 frame = 1;; frame++) {
+        if (prioritise) {
+            queue.Prioritise(visible);
+        }
+
+        for (u32 i = 0; i < LOADS_PER_FRAME; i++) {
+            u64 id;
+            bool priority;
+            if (!queue.Pop(id, priority)) {
+                return frame;
+            }
+
+            if (std::ranges::find(visible, id) != visible.end() && !--remaining) {
+                return frame;
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    const auto ids = MakeIds();
+    std::printf("titles: %u visible: %u loads per frame: %u\n", TITLE_COUNT, VISIBLE, LOADS_PER_FRAME);
+
+    std::printf("%-28s old: %8.3f ms new: %8.3f ms\n", "push all",
+        Median<double>([&]() { return PushAll<OldQueue>(ids); }),
+        Median<double>([&]() { return PushAll<NewQueue>(ids); }));
+
+    std::printf("%-28s old: %8.4f ms new: %8.4f ms\n", "lookups per frame",
+        Median<double>([&]() { return GetFrame<OldQueue>(ids); }),
+        Median<double>([&]() { return GetFrame<NewQueue>(ids); }));
+
+    std::printf("%-28s fifo: %5u frames prioritised: %3u frames\n", "jump to end",
+        JumpToEnd(ids, false), JumpToEnd(ids, true));
+}
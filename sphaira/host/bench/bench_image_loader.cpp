@@ -0,0 +1,178 @@
+#include "bench.hpp"
+#include "utils/image_loader.hpp"
+#include <chrono>
+#include <thread>
+
+// loads 256x256 jpeg icons, as read from nro's and the nacp, through the
+// image loader with 1 to 4 workers.
+// each load waits for a simulated sd read, then decodes the jpeg.
+// reports the decode throughput, and how many frames it takes to fill a page
+// of 24 icons along with the most time the ui spent on icons in a frame.
+// "inline" is the old behaviour, 2 icons read and decoded per frame in Draw().
+
+using namespace sphaira;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr u32 ICON_SIZE = 256;
+constexpr u32 ICON_COUNT = 96;
+constexpr u32 PAGE_SIZE = 24;
+constexpr auto READ_LATENCY = 2ms;
+constexpr auto FRAME_TIME = std::chrono::microseconds(16666);
+
+struct Times {
+    double images_per_sec;
+    double page_ms;
+    u32 page_frames;
+    double max_ui_ms;
+};
+
+auto MakeIcons() -> std::vector<std::vector<u8>> {
+    std::vector<std::vector<u8>> icons;
+    const auto noise = bench::MakeData(ICON_SIZE * ICON_SIZE * 4, 80);
+
+    for (u32 i = 0; i < ICON_COUNT; i++) {
+        std::vector<u8> rgba(ICON_SIZE * ICON_SIZE * 4);
+        for (u32 p = 0; p < ICON_SIZE * ICON_SIZE; p++) {
+            const auto x = p % ICON_SIZE, y = p / ICON_SIZE;
+            // gradients with some detail, so the jpeg is close to a real icon in size.
+            rgba[p * 4 + 0] = x + i * 8 + (noise[p * 4 + 0] & 0x1F);
+            rgba[p * 4 + 1] = y + i * 3 + (noise[p * 4 + 1] & 0x1F);
+            rgba[p * 4 + 2] = (x ^ y) + (noise[p * 4 + 2] & 0x1F);
+            rgba[p * 4 + 3] = 255;
+        }
+        icons.emplace_back(ImageConvertToJpg(rgba, ICON_SIZE, ICON_SIZE).data);
+    }
+
+    return icons;
+}
+
+auto LoadIcon(const std::vector<u8>& jpg) -> ImageResult {
+    std::this_thread::sleep_for(READ_LATENCY);
+    return ImageLoadFromMemory(jpg, ImageFlag_JPEG);
+}
+
+// stands in for nvgCreateImageRGBA(), which copies the data to the gpu.
+void CreateTexture(const ImageResult& image, std::vector<u8>& texture) {
+    std::memcpy(texture.data(), image.data.data(), std::min(texture.size(), image.data.size()));
+}
+
+auto ToMs(u64 ns) -> double {
+    return ns / 1e+6;
+}
+
+auto Throughput(const std::vector<std::vector<u8>>& icons, u32 workers) -> double {
+    utils::ImageLoader loader{std::max(1u, workers)};
+    std::vector<u8> texture(ICON_SIZE * ICON_SIZE * 4);
+    const auto start = bench::GetTimeNs();
+
+    if (!workers) {
+        for (const auto& icon : icons) {
+            CreateTexture(LoadIcon(icon), texture);
+        }
+        return icons.size() / ((bench::GetTimeNs() - start) / 1e+9);
+    }
+
+    for (u32 i = 0; i < icons.size(); i++) {
+        loader.Request(i, [&icons, i]() { return LoadIcon(icons[i]); });
+    }
+
+    u32 count{};
+    while (count < icons.size()) {
+        count += loader.Upload([&](u64 key, const ImageResult& image) {
+            CreateTexture(image, texture);
+        });
+        std::this_thread::sleep_for(100us);
+    }
+
+    return icons.size() / ((bench::GetTimeNs() - start) / 1e+9);
+}
+
+// draws frames until every icon on the page is uploaded, as the menus do.
+// workers is 0 for the old inline loading, for this and Throughput().
+void FillPage(const std::vector<std::vector<u8>>& icons, u32 workers, Times& times) {
+    utils::ImageLoader loader{std::max(1u, workers)};
+    std::vector<u8> texture(ICON_SIZE * ICON_SIZE * 4);
+    std::vector<bool> loaded(PAGE_SIZE);
+    u32 count{};
+
+    const auto start = bench::GetTimeNs();
+    times.max_ui_ms = 0;
+    times.page_frames = 0;
+
+    while (count < PAGE_SIZE) {
+        const auto frame_start = bench::GetTimeNs();
+        times.page_frames++;
+
+        if (!workers) {
+            for (u32 i = 0, per_frame = 0; i < PAGE_SIZE && per_frame < 2; i++) {
+                if (!loaded[i]) {
+                    CreateTexture(LoadIcon(icons[i]), texture);
+                    loaded[i] = true;
+                    count++;
+                    per_frame++;
+                }
+            }
+        } else {
+            count += loader.Upload([&](u64 key, const ImageResult& image) {
+                CreateTexture(image, texture);
+                loaded[key] = true;
+            });
+
+            for (u32 i = 0; i < PAGE_SIZE; i++) {
+                if (!loaded[i] && !loader.Touch(i)) {
+                    loader.Request(i, [&icons, i]() { return LoadIcon(icons[i]); });
+                }
+            }
+            loader.Sweep();
+        }
+
+        const auto ui_ns = bench::GetTimeNs() - frame_start;
+        times.max_ui_ms = std::max(times.max_ui_ms, ToMs(ui_ns));
+        if (count < PAGE_SIZE && ui_ns < (u64)std::chrono::nanoseconds(FRAME_TIME).count()) {
+            std::this_thread::sleep_for(FRAME_TIME - std::chrono::nanoseconds(ui_ns));
+        }
+    }
+
+    times.page_ms = ToMs(bench::GetTimeNs() - start);
+}
+
+void Run(const char* name, const std::vector<std::vector<u8>>& icons, u32 workers) {
+    std::vector<Times> runs;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        auto& times = runs.emplace_back();
+        times.images_per_sec = Throughput(icons, workers);
+        FillPage(icons, workers, times);
+    }
+
+    const auto median = [&runs](auto Times::*field) {
+        std::vector<double> v;
+        for (const auto& t : runs) {
+            v.emplace_back(t.*field);
+        }
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+
+    std::printf("%-12s %6.0f images/s page: %6.1f ms %3.0f frames max ui: %5.2f ms/frame\n",
+        name, median(&Times::images_per_sec), median(&Times::page_ms), median(&Times::page_frames), median(&Times::max_ui_ms));
+}
+
+} // namespace
+
+int main() {
+    const auto icons = MakeIcons();
+    u64 total{};
+    for (const auto& icon : icons) {
+        total += icon.size();
+    }
+    std::printf("icons: %u avg jpeg: %llu KiB sd read: %lld ms\n", ICON_COUNT, (unsigned long long)total / icons.size() / 1024, (long long)READ_LATENCY.count());
+
+    Run("inline", icons, 0);
+    for (u32 workers = 1; workers <= utils::ImageLoader::MAX_WORKERS; workers++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%u workers", workers);
+        Run(name, icons, workers);
+    }
+}
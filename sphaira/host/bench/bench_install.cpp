@@ -0,0 +1,74 @@
+#include "bench.hpp"
+#include "threaded_file_transfer.hpp"
+#include <zstd.h>
+#include <cstring>
+
+// the install data path: read -> decompress + sha256 -> write, using the
+// same thread::Transfer pipeline and 4MiB buffers as the switch.
+// the source is a zstd stream (like ncz), the write is a memcpy into a placeholder.
+
+using namespace sphaira;
+
+int main() {
+    const auto data = bench::MakeData(1024ULL * 1024 * 256);
+
+    std::vector<u8> compressed(ZSTD_compressBound(data.size()));
+    const auto compressed_size = ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 3);
+    if (ZSTD_isError(compressed_size)) {
+        std::printf("failed to compress input\n");
+        return 1;
+    }
+    compressed.resize(compressed_size);
+
+    std::vector<u8> placeholder(data.size());
+
+    const auto install = [&](bool decompress) -> s64 {
+        ui::ProgressBox pbox{0, "", "", nullptr};
+        const auto& src = decompress ? compressed : data;
+
+        auto dctx = ZSTD_createDCtx();
+        ON_SCOPE_EXIT(ZSTD_freeDCtx(dctx));
+        std::vector<u8> out_buf(ZSTD_DStreamOutSize());
+
+        Sha256Context sha256;
+        sha256ContextCreate(&sha256);
+
+        const auto rc = thread::Transfer(&pbox, src.size(),
+            [&](void* buf, s64 off, s64 size, u64* bytes_read) -> Result {
+                size = std::min<s64>(size, src.size() - off);
+                std::memcpy(buf, src.data() + off, size);
+                *bytes_read = size;
+                R_SUCCEED();
+            },
+            [&](void* buf, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
+                if (!decompress) {
+                    sha256ContextUpdate(&sha256, buf, size);
+                    return callback(buf, size);
+                }
+
+                ZSTD_inBuffer input{buf, (size_t)size, 0};
+                while (input.pos < input.size) {
+                    ZSTD_outBuffer output{out_buf.data(), out_buf.size(), 0};
+                    const auto res = ZSTD_decompressStream(dctx, &output, &input);
+                    R_UNLESS(!ZSTD_isError(res), 0x1);
+
+                    sha256ContextUpdate(&sha256, out_buf.data(), output.pos);
+                    R_TRY(callback(out_buf.data(), output.pos));
+                }
+                R_SUCCEED();
+            },
+            [&](const void* buf, s64 off, s64 size) -> Result {
+                R_UNLESS(off + size <= (s64)placeholder.size(), 0x1);
+                std::memcpy(placeholder.data() + off, buf, size);
+                R_SUCCEED();
+            }
+        );
+
+        u8 hash[SHA256_HASH_SIZE];
+        sha256ContextGetHash(&sha256, hash);
+        return R_SUCCEEDED(rc) ? data.size() : -1;
+    };
+
+    bench::Run("install nca (sha256)", [&]() { return install(false); });
+    bench::Run("install ncz stream (zstd + sha256)", [&]() { return install(true); });
+}
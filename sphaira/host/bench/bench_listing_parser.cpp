@@ -0,0 +1,160 @@
+#include "bench.hpp"
+#include "utils/devoptab_listing.hpp"
+#include <malloc.h>
+#include <new>
+
+// parses large synthetic autoindex and PROPFIND listings, delivered in the
+// pieces curl would hand to the write callback.
+// buffered collects the whole response first, as the listings used to,
+// streaming feeds each piece to the parser as it arrives.
+// the heap is tracked so that the peak memory of each can be compared.
+
+using namespace sphaira;
+using namespace sphaira::devoptab::common;
+
+namespace {
+
+constexpr u32 ENTRY_COUNT = 1024 * 20;
+constexpr u64 PIECE_SIZE = 1024 * 16;
+
+u64 g_heap_used{};
+u64 g_heap_peak{};
+
+struct Times {
+    double first_ms;
+    double total_ms;
+    u64 peak_heap;
+};
+
+auto MakeAutoindex() -> std::string {
+    std::string out = "<html>\r\n<head><title>Index of /games/</title></head>\r\n<body>\r\n<h1>Index of /games/</h1><hr><pre><a href=\"../\">../</a>\r\n";
+    for (u32 i = 0; i < ENTRY_COUNT; i++) {
+        const auto name = "Some Game Title " + std::to_string(i) + " [0100000000010000][v0].nsp";
+        std::string href;
+        for (const auto c : name) {
+            href += c == ' ' ? "%20" : c == '[' ? "%5B" : c == ']' ? "%5D" : std::string(1, c);
+        }
+        out += "<a href=\"" + href + "\">" + name.substr(0, 50) + "..&gt;</a>                02-Jan-2024 10:00          1288490188\r\n";
+    }
+    out += "</pre><hr></body>\r\n</html>\r\n";
+    return out;
+}
+
+auto MakePropfind() -> std::string {
+    std::string out = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<D:multistatus xmlns:D=\"DAV:\">\n";
+    for (u32 i = 0; i < ENTRY_COUNT; i++) {
+        out += "<D:response xmlns:lp1=\"DAV:\"><D:href>/dav/games/Some%20Game%20Title%20" + std::to_string(i) + "%20%5B0100000000010000%5D%5Bv0%5D.nsp</D:href>"
+            "<D:propstat><D:prop><lp1:resourcetype/><lp1:getcontentlength>1288490188</lp1:getcontentlength>"
+            "<lp1:getlastmodified>Tue, 02 Jan 2024 10:00:00 GMT</lp1:getlastmodified></D:prop>"
+            "<D:status>HTTP/1.1 200 OK</D:status></D:propstat></D:response>\n";
+    }
+    out += "</D:multistatus>\n";
+    return out;
+}
+
+auto ToMs(u64 start) -> double {
+    return (bench::GetTimeNs() - start) / 1e+6;
+}
+
+template<typename Parser, typename... Args>
+auto Parse(const std::string& body, bool streaming, Args&&... args) -> Times {
+    Times times{-1, -1, 0};
+    const auto heap_start = g_heap_used;
+    g_heap_peak = g_heap_used;
+    const auto start = bench::GetTimeNs();
+
+    DirEntries entries;
+    Parser parser{entries, std::forward<Args>(args)...};
+    std::vector<char> buffer;
+
+    for (u64 off = 0; off < body.size(); off += PIECE_SIZE) {
+        const auto piece = std::string_view{body}.substr(off, PIECE_SIZE);
+        if (streaming) {
+            if (!parser.Feed(piece)) {
+                return times;
+            }
+            if (!entries.empty() && times.first_ms < 0) {
+                times.first_ms = ToMs(start);
+            }
+        } else {
+            // same growth as write_memory_callback().
+            if (buffer.capacity() < buffer.size() + piece.size()) {
+                buffer.reserve(std::max(piece.size(), buffer.size() + 1024 * 1024));
+            }
+            buffer.insert(buffer.end(), piece.begin(), piece.end());
+        }
+    }
+
+    if (!streaming) {
+        if (!parser.Feed({buffer.data(), buffer.size()})) {
+            return times;
+        }
+        times.first_ms = ToMs(start);
+    }
+
+    if (!parser.Finish() || entries.size() != ENTRY_COUNT) {
+        times.first_ms = -1;
+        return times;
+    }
+
+    times.total_ms = ToMs(start);
+    times.peak_heap = g_heap_peak - heap_start;
+    return times;
+}
+
+void Run(const char* name, const std::function<Times()>& func) {
+    std::vector<Times> runs;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        runs.emplace_back(func());
+        if (runs.back().first_ms < 0) {
+            std::printf("%-40s failed\n", name);
+            return;
+        }
+    }
+
+    const auto median = [&runs](double Times::*field) {
+        std::vector<double> v;
+        for (const auto& t : runs) {
+            v.emplace_back(t.*field);
+        }
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+
+    std::printf("%-40s first: %7.2f ms total: %7.2f ms peak heap: %6zu KiB\n", name, median(&Times::first_ms), median(&Times::total_ms), (size_t)runs.back().peak_heap / 1024);
+}
+
+} // namespace
+
+// tracks the heap, the size is read back from malloc so that delete doesn't need it.
+void* operator new(size_t size) {
+    auto p = std::malloc(size);
+    if (!p) {
+        std::abort();
+    }
+    g_heap_used += malloc_usable_size(p);
+    g_heap_peak = std::max(g_heap_peak, g_heap_used);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p) {
+        g_heap_used -= malloc_usable_size(p);
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+int main() {
+    const auto autoindex = MakeAutoindex();
+    const auto propfind = MakePropfind();
+    std::printf("autoindex: %zu KiB propfind: %zu KiB entries: %u\n", autoindex.size() / 1024, propfind.size() / 1024, ENTRY_COUNT);
+
+    Run("autoindex buffered", [&]() { return Parse<HtmlListingParser>(autoindex, false); });
+    Run("autoindex streaming", [&]() { return Parse<HtmlListingParser>(autoindex, true); });
+    Run("propfind buffered", [&]() { return Parse<PropfindListingParser>(propfind, false, std::string{"/dav/games"}); });
+    Run("propfind streaming", [&]() { return Parse<PropfindListingParser>(propfind, true, std::string{"/dav/games"}); });
+}
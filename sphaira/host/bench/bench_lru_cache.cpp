@@ -0,0 +1,209 @@
+#include "bench.hpp"
+#include "../tests/slow_source.hpp"
+#include "utils/devoptab_common.hpp"
+
+// replays the reads that the fatfs and zip mounts make against the block
+// cache, from a source with the latency and speed of an sd card.
+// after each read the reader spends time on the data, as it would writing it
+// out or inflating it, which is the time readahead can overlap with.
+// each trace is replayed uncached, cached without readahead, and cached with
+// readahead at a few block sizes.
+// the time, the source reads and the cache stats are printed for each.
+
+using namespace sphaira;
+using devoptab::common::LruBufferedData;
+
+namespace {
+
+constexpr u64 IMAGE_SIZE = 1024 * 1024 * 96;
+// roughly an sd card.
+const test::source::Link LINK{std::chrono::microseconds(100), 1000 * 1000 * 90};
+
+struct Access {
+    u64 off;
+    u64 size;
+};
+
+using Trace = std::vector<Access>;
+
+struct ReplayResult {
+    double ms;
+    u64 source_reads;
+    u64 source_bytes;
+    LruBufferedData::Stats stats;
+};
+
+struct Rng {
+    u64 x;
+
+    auto operator()(u64 max) -> u64 {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (x >> 16) % max;
+    }
+};
+
+// copying files off a fat32 image, such as a usb drive.
+// fatfs reads the fat a sector at a time whilst following the cluster chain,
+// reads a directory sector per file, then reads the clusters in 16KiB reads.
+auto MakeFatfsTrace() -> Trace {
+    constexpr u64 SECTOR = 512;
+    constexpr u64 CLUSTER = 1024 * 32;
+    constexpr u64 FAT_OFF = 1024 * 16;
+    constexpr u64 FAT_SIZE = 1024 * 512;
+    constexpr u64 DIR_OFF = FAT_OFF + FAT_SIZE * 2;
+    constexpr u64 DATA_OFF = DIR_OFF + 1024 * 256;
+    // fat32 entries are 4 bytes.
+    constexpr u64 CLUSTERS_PER_FAT_SECTOR = SECTOR / 4;
+
+    Rng rng{1};
+    Trace trace;
+
+    for (u32 file = 0; file < 24; file++) {
+        trace.emplace_back(DIR_OFF + rng(1024 * 256 / SECTOR) * SECTOR, SECTOR);
+
+        // files are up to 2MiB, split into a few fragments.
+        u64 remaining = 1024 * 256 + rng(1024 * 1024 * 2);
+        while (remaining) {
+            const auto cluster = rng((IMAGE_SIZE - DATA_OFF) / CLUSTER - 64);
+            const auto run = std::min<u64>(remaining, (1 + rng(64)) * CLUSTER);
+
+            for (u64 off = 0; off < run; off += 1024 * 16) {
+                if (off % (CLUSTER * CLUSTERS_PER_FAT_SECTOR) == 0 || (off % CLUSTER == 0 && !rng(8))) {
+                    trace.emplace_back(FAT_OFF + (cluster + off / CLUSTER) * 4 / SECTOR * SECTOR, SECTOR);
+                }
+                trace.emplace_back(DATA_OFF + cluster * CLUSTER + off, std::min<u64>(1024 * 16, run - off));
+            }
+
+            remaining -= run;
+        }
+    }
+
+    return trace;
+}
+
+// browsing a zip, such as a folder of images.
+// the central directory is read once, then each entry is opened by reading
+// its local header and inflated in 64KiB reads. some entries are only
+// partly read, and a few seeks jump to an access point within an entry.
+auto MakeZipTrace() -> Trace {
+    constexpr u64 LOCAL_HEADER = 30;
+    constexpr u64 INFLATE_SIZE = 1024 * 64;
+    constexpr u64 CDIR_SIZE = 1024 * 160;
+
+    Rng rng{2};
+    Trace trace;
+
+    // end record, then the central directory.
+    trace.emplace_back(IMAGE_SIZE - 22, 22);
+    trace.emplace_back(IMAGE_SIZE - 22 - CDIR_SIZE, CDIR_SIZE);
+
+    for (u32 entry = 0; entry < 160; entry++) {
+        const auto size = 1024 * 4 + rng(entry % 8 ? 1024 * 512 : 1024 * 1024 * 8);
+        const auto off = rng(IMAGE_SIZE - CDIR_SIZE - size - 1024);
+
+        trace.emplace_back(off, LOCAL_HEADER);
+        trace.emplace_back(off + LOCAL_HEADER, 40);
+        const auto data_off = off + LOCAL_HEADER + 40;
+
+        // seek to an access point, which rereads the byte before it.
+        u64 start = 0;
+        if (size > 1024 * 1024 && rng(2)) {
+            start = rng(size / 2);
+            trace.emplace_back(data_off + start - 1, 1);
+        }
+
+        const auto end = rng(4) ? size : start + rng(size - start);
+        for (u64 pos = start; pos < end; pos += INFLATE_SIZE) {
+            trace.emplace_back(data_off + pos, std::min<u64>(INFLATE_SIZE, end - pos));
+        }
+    }
+
+    return trace;
+}
+
+// consume is the speed the reader uses the data at, in bytes per second.
+auto Replay(const std::vector<u8>& image, const Trace& trace, u64 consume, const LruBufferedData::Config* config) -> ReplayResult {
+    ReplayResult result{};
+    auto source = std::make_shared<test::source::SlowSource>(image, LINK);
+    std::unique_ptr<LruBufferedData> cache;
+    if (config) {
+        cache = std::make_unique<LruBufferedData>(source, image.size(), *config);
+    }
+
+    std::vector<u8> buf(1024 * 1024);
+    const auto start = bench::GetTimeNs();
+
+    for (const auto& access : trace) {
+        u64 bytes_read;
+        const auto rc = cache ? cache->Read(buf.data(), access.off, access.size, &bytes_read) : source->Read(buf.data(), access.off, access.size, &bytes_read);
+        if (R_FAILED(rc) || bytes_read != access.size || std::memcmp(buf.data(), image.data() + access.off, access.size)) {
+            result.ms = -1;
+            return result;
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(access.size * 1'000'000ULL / consume));
+    }
+
+    result.ms = (bench::GetTimeNs() - start) / 1e+6;
+    result.source_reads = source->GetReadCount();
+    result.source_bytes = source->GetBytesRead();
+    if (cache) {
+        result.stats = cache->GetStats();
+    }
+
+    return result;
+}
+
+void Run(const char* name, const std::function<ReplayResult()>& func) {
+    std::vector<ReplayResult> runs;
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        runs.emplace_back(func());
+        if (runs.back().ms < 0) {
+            std::printf("%-28s failed\n", name);
+            return;
+        }
+    }
+
+    // the stats depend on how far readahead got, so they're from the median run.
+    std::ranges::sort(runs, {}, &ReplayResult::ms);
+    const auto& r = runs[runs.size() / 2];
+    std::printf("%-28s %8.1f ms reads: %6llu read: %5.1f MiB hits: %6llu misses: %6llu readahead: %6llu waste: %5llu\n",
+        name, r.ms, (unsigned long long)r.source_reads, r.source_bytes / 1024.0 / 1024.0,
+        (unsigned long long)r.stats.hits, (unsigned long long)r.stats.misses,
+        (unsigned long long)r.stats.readahead, (unsigned long long)r.stats.readahead_waste);
+}
+
+void RunTrace(const char* trace_name, const std::vector<u8>& image, const Trace& trace, u64 consume, u32 block_count) {
+    u64 total{};
+    for (const auto& access : trace) {
+        total += access.size;
+    }
+    std::printf("%s: %zu reads, %.1f MiB, used at %.0f MB/s\n", trace_name, trace.size(), total / 1024.0 / 1024.0, consume / 1e+6);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s uncached", trace_name);
+    Run(name, [&]() { return Replay(image, trace, consume, nullptr); });
+
+    for (const auto block_size : {1024 * 4, 1024 * 16, 1024 * 64}) {
+        for (const auto readahead : {0u, LruBufferedData::DEFAULT_READAHEAD}) {
+            LruBufferedData::Config config{};
+            config.block_size = block_size;
+            // the same amount of memory for each block size.
+            config.block_count = (u64)block_count * LruBufferedData::DEFAULT_BLOCK_SIZE / block_size;
+            config.readahead = readahead * LruBufferedData::DEFAULT_BLOCK_SIZE / block_size;
+
+            std::snprintf(name, sizeof(name), "%s %2uK ra %s", trace_name, block_size / 1024, readahead ? "on" : "off");
+            Run(name, [&]() { return Replay(image, trace, consume, &config); });
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    const auto image = bench::MakeData(IMAGE_SIZE);
+
+    // files copied to the sd card, and entries inflated, with the block counts used by the mounts.
+    RunTrace("fatfs", image, MakeFatfsTrace(), 1000 * 1000 * 60, 512);
+    RunTrace("zip", image, MakeZipTrace(), 1000 * 1000 * 150, LruBufferedData::DEFAULT_BLOCK_COUNT);
+}
@@ -0,0 +1,210 @@
+#include "bench.hpp"
+#include "yati/nx/ncz.hpp"
+#include "utils/ordered_worker_pool.hpp"
+#include "utils/buffer_pool.hpp"
+#include <zstd.h>
+#include <memory>
+
+// ncz::NczBlockReader decode speed, sequential reads like the install and
+// small random reads like a mounted ncz (devoptab).
+// also the install's parallel block decode, using the same worker pool as yati.cpp.
+
+using namespace sphaira;
+
+namespace {
+
+struct MemSource final : yati::source::Base {
+    MemSource(std::vector<u8>&& data) : m_data{std::move(data)} {}
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        size = std::min<s64>(size, m_data.size() - off);
+        std::memcpy(buf, m_data.data() + off, size);
+        *bytes_read = size;
+        R_SUCCEED();
+    }
+
+private:
+    const std::vector<u8> m_data;
+};
+
+struct Ncz {
+    ncz::Header header{};
+    ncz::Sections sections{};
+    ncz::BlockHeader block_header{};
+    ncz::Blocks blocks{};
+    std::shared_ptr<MemSource> source{};
+    // compressed blocks, only used by the block pool benchmark.
+    std::vector<u8> raw{};
+};
+
+// mirrors NczBlockJob / NczBlockWorker in yati.cpp.
+struct BlockJob {
+    utils::pool::Lease data{};
+    utils::pool::Lease out{};
+    u64 data_size{};
+    u64 out_size{};
+    u64 decompressed_size{};
+    bool compressed{};
+};
+
+struct BlockWorker {
+    Result Process(BlockJob& job) {
+        if (job.out.size() < job.decompressed_size) {
+            job.out = utils::pool::Acquire(job.decompressed_size);
+        }
+
+        const auto res = ZSTD_decompressDCtx(dctx.get(), job.out.data(), job.decompressed_size, job.data.data(), job.data_size);
+        R_UNLESS(!ZSTD_isError(res) && res == job.decompressed_size, 0x1);
+        job.out_size = res;
+        R_SUCCEED();
+    }
+
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx{ZSTD_createDCtx(), ZSTD_freeDCtx};
+};
+
+// compresses data into independent blocks, same as the nsz block mode.
+auto MakeNcz(std::span<const u8> data, u8 exponent) -> Ncz {
+    Ncz ncz{};
+    const auto block_size = 1ULL << exponent;
+    ncz.block_header.magic = NCZ_BLOCK_MAGIC;
+    ncz.block_header.version = NCZ_BLOCK_VERSION;
+    ncz.block_header.type = NCZ_BLOCK_TYPE;
+    ncz.block_header.block_size_exponent = exponent;
+    ncz.block_header.decompressed_size = data.size();
+
+    std::vector<u8> out;
+    std::vector<u8> temp(ZSTD_compressBound(block_size));
+    for (u64 off = 0; off < data.size(); off += block_size) {
+        const auto size = std::min<u64>(block_size, data.size() - off);
+        const auto res = ZSTD_compress(temp.data(), temp.size(), data.data() + off, size, 3);
+
+        // stored if it didn't compress.
+        if (ZSTD_isError(res) || res >= size) {
+            out.insert(out.end(), data.data() + off, data.data() + off + size);
+            ncz.blocks.emplace_back(size);
+        } else {
+            out.insert(out.end(), temp.data(), temp.data() + res);
+            ncz.blocks.emplace_back(res);
+        }
+    }
+
+    ncz.block_header.total_blocks = ncz.blocks.size();
+    ncz.raw = out;
+    ncz.source = std::make_shared<MemSource>(std::move(out));
+    return ncz;
+}
+
+} // namespace
+
+int main() {
+    const auto data = bench::MakeData(1024ULL * 1024 * 256);
+
+    for (const u8 exponent : {17, 20}) {
+        const auto ncz = MakeNcz(data, exponent);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "ncz decode seq (%u KiB blocks)", 1U << (exponent - 10));
+        bench::Run(name, [&]() -> s64 {
+            ncz::NczBlockReader reader{ncz.header, ncz.sections, ncz.block_header, ncz.blocks, 0, ncz.source};
+            std::vector<u8> buf(1024 * 1024 * 4);
+            for (u64 off = 0; off < data.size(); off += buf.size()) {
+                u64 bytes_read;
+                const auto size = std::min<u64>(buf.size(), data.size() - off);
+                if (R_FAILED(reader.Read(buf.data(), NCZ_NORMAL_SIZE + off, size, &bytes_read))) {
+                    return -1;
+                }
+            }
+            return data.size();
+        });
+
+        std::snprintf(name, sizeof(name), "ncz decode random 64KiB (%u KiB blocks)", 1U << (exponent - 10));
+        bench::Run(name, [&]() -> s64 {
+            ncz::NczBlockReader reader{ncz.header, ncz.sections, ncz.block_header, ncz.blocks, 0, ncz.source};
+            std::vector<u8> buf(1024 * 64);
+            u64 x = 0x1234;
+            const u64 count = 1024 * 2;
+            for (u64 i = 0; i < count; i++) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                const auto off = (x >> 16) % (data.size() - buf.size());
+                u64 bytes_read;
+                if (R_FAILED(reader.Read(buf.data(), NCZ_NORMAL_SIZE + off, buf.size(), &bytes_read))) {
+                    return -1;
+                }
+            }
+            return count * buf.size();
+        });
+
+        // 0 threads decompresses on the calling thread, as the install did before.
+        for (const u32 threads : {0, 1, 3}) {
+            std::snprintf(name, sizeof(name), "ncz decode pool x%u (%u KiB blocks)", threads, 1U << (exponent - 10));
+            bench::Run(name, [&]() -> s64 {
+                const auto block_size = 1ULL << exponent;
+                utils::OrderedWorkerPool<BlockJob, BlockWorker> pool;
+                if (threads && pool.Create(threads, std::max<u64>(threads, 1024 * 1024 * 16 / block_size)) != threads) {
+                    return -1;
+                }
+
+                BlockWorker worker;
+                u64 written{};
+                const auto pop = [&]() -> Result {
+                    BlockJob* job{};
+                    R_TRY(pool.WaitFront(std::addressof(job)));
+                    written += job->out_size;
+                    pool.Pop();
+                    R_SUCCEED();
+                };
+
+                u64 off{};
+                for (u64 i = 0; i < ncz.blocks.size(); i++) {
+                    const auto& block = ncz.blocks[i];
+                    const auto decompressed_size = std::min<u64>(block_size, data.size() - i * block_size);
+
+                    while (threads && pool.IsFull()) {
+                        if (R_FAILED(pop())) {
+                            return -1;
+                        }
+                    }
+
+                    BlockJob local;
+                    auto& job = threads ? pool.GetBack() : local;
+                    if (job.data.size() < block.size) {
+                        job.data = utils::pool::Acquire(block.size);
+                    }
+                    std::memcpy(job.data.data(), ncz.raw.data() + off, block.size);
+                    job.data_size = block.size;
+                    job.decompressed_size = decompressed_size;
+                    job.compressed = block.size < decompressed_size;
+                    off += block.size;
+
+                    if (!threads) {
+                        if (job.compressed && R_FAILED(worker.Process(job))) {
+                            return -1;
+                        }
+                        written += decompressed_size;
+                        continue;
+                    }
+
+                    if (!job.compressed) {
+                        std::swap(job.out, job.data);
+                        job.out_size = job.data_size;
+                    }
+                    pool.Push(!job.compressed);
+
+                    while (pool.IsFrontDone()) {
+                        if (R_FAILED(pop())) {
+                            return -1;
+                        }
+                    }
+                }
+
+                while (!pool.IsEmpty()) {
+                    if (R_FAILED(pop())) {
+                        return -1;
+                    }
+                }
+
+                return written == data.size() ? written : -1;
+            });
+        }
+    }
+}
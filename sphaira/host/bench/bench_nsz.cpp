@@ -0,0 +1,202 @@
+#include "bench.hpp"
+#include "threaded_file_transfer.hpp"
+#include "utils/ordered_worker_pool.hpp"
+#include "utils/buffer_pool.hpp"
+#include <zstd.h>
+#include <zstd_errors.h>
+#include <cstring>
+#include <memory>
+
+// nsz encode, compressing ncz blocks from the decompress stage of thread::Transfer
+// the same way as nsz_dumper.cpp does when no block workers are available,
+// and with block workers, using the same worker pool as nsz_dumper.cpp.
+
+using namespace sphaira;
+
+namespace {
+
+// mirrors NszBlockJob / NszBlockWorker in nsz_dumper.cpp.
+struct BlockJob {
+    utils::pool::Lease data{};
+    u64 data_size{};
+    utils::pool::Lease out{};
+    std::span<const u8> output{};
+};
+
+struct BlockWorker {
+    BlockWorker(int level) {
+        ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level);
+    }
+
+    Result Process(BlockJob& job) {
+        if (job.out.size() < job.data_size) {
+            job.out = utils::pool::Acquire(job.data_size);
+        }
+
+        const auto res = ZSTD_compress2(cctx.get(), job.out.data(), job.data_size, job.data.data(), job.data_size);
+        const auto error_code = ZSTD_getErrorCode(res);
+        R_UNLESS(error_code == ZSTD_error_no_error || error_code == ZSTD_error_dstSize_tooSmall, 0x1);
+
+        if (error_code == ZSTD_error_dstSize_tooSmall || res >= job.data_size) {
+            job.output = std::span{job.data.data(), job.data_size};
+        } else {
+            job.output = std::span{job.out.data(), res};
+        }
+        R_SUCCEED();
+    }
+
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx{ZSTD_createCCtx(), ZSTD_freeCCtx};
+};
+
+} // namespace
+
+int main() {
+    const auto data = bench::MakeData(1024ULL * 1024 * 64);
+
+    for (const int level : {3, 18}) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "nsz encode block 1MiB (level %d)", level);
+
+        bench::Run(name, [&]() -> s64 {
+            ui::ProgressBox pbox{0, "", "", nullptr};
+            const u64 block_size = 1024 * 1024;
+
+            auto cctx = ZSTD_createCCtx();
+            ON_SCOPE_EXIT(ZSTD_freeCCtx(cctx));
+            ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+
+            std::vector<u8> in_buf;
+            std::vector<u8> out_buf(block_size);
+            s64 written{};
+
+            const auto flush = [&](const thread::DecompressWriteCallback& callback) -> Result {
+                const auto res = ZSTD_compress2(cctx, out_buf.data(), out_buf.size(), in_buf.data(), in_buf.size());
+                const auto error_code = ZSTD_getErrorCode(res);
+                R_UNLESS(error_code == ZSTD_error_no_error || error_code == ZSTD_error_dstSize_tooSmall, 0x1);
+
+                if (error_code == ZSTD_error_dstSize_tooSmall || res >= in_buf.size()) {
+                    R_TRY(callback(in_buf.data(), in_buf.size()));
+                } else {
+                    R_TRY(callback(out_buf.data(), res));
+                }
+
+                in_buf.resize(0);
+                R_SUCCEED();
+            };
+
+            const auto rc = thread::Transfer(&pbox, data.size(),
+                [&](void* buf, s64 off, s64 size, u64* bytes_read) -> Result {
+                    size = std::min<s64>(size, data.size() - off);
+                    std::memcpy(buf, data.data() + off, size);
+                    *bytes_read = size;
+                    R_SUCCEED();
+                },
+                [&](void* _buf, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
+                    auto buf = static_cast<const u8*>(_buf);
+                    const auto last_chunk = off + size >= (s64)data.size();
+
+                    while (size) {
+                        const auto rsize = std::min<s64>(size, block_size - in_buf.size());
+                        in_buf.insert(in_buf.end(), buf, buf + rsize);
+                        if (in_buf.size() == block_size) {
+                            R_TRY(flush(callback));
+                        }
+                        size -= rsize;
+                        buf += rsize;
+                    }
+
+                    if (last_chunk && !in_buf.empty()) {
+                        R_TRY(flush(callback));
+                    }
+                    R_SUCCEED();
+                },
+                [&](const void* buf, s64 off, s64 size) -> Result {
+                    written += size;
+                    R_SUCCEED();
+                }
+            );
+
+            return R_SUCCEEDED(rc) ? data.size() : -1;
+        });
+
+        for (const u32 threads : {1, 3}) {
+            std::snprintf(name, sizeof(name), "nsz encode block 1MiB pool x%u (level %d)", threads, level);
+
+            bench::Run(name, [&]() -> s64 {
+                ui::ProgressBox pbox{0, "", "", nullptr};
+                const u64 block_size = 1024 * 1024;
+
+                utils::OrderedWorkerPool<BlockJob, BlockWorker> pool{[level]{ return BlockWorker{level}; }};
+                if (pool.Create(threads, std::max<u32>(threads, 16)) != threads) {
+                    return -1;
+                }
+
+                s64 written{};
+                const auto rc = thread::Transfer(&pbox, data.size(),
+                    [&](void* buf, s64 off, s64 size, u64* bytes_read) -> Result {
+                        size = std::min<s64>(size, data.size() - off);
+                        std::memcpy(buf, data.data() + off, size);
+                        *bytes_read = size;
+                        R_SUCCEED();
+                    },
+                    [&](void* _buf, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
+                        auto buf = static_cast<const u8*>(_buf);
+                        const auto last_chunk = off + size >= (s64)data.size();
+
+                        const auto pop = [&]() -> Result {
+                            BlockJob* job{};
+                            R_TRY(pool.WaitFront(std::addressof(job)));
+                            ON_SCOPE_EXIT(job->data_size = 0; pool.Pop());
+                            auto& lease = job->output.data() == job->out.data() ? job->out : job->data;
+                            return callback.Swap(lease, job->output.size());
+                        };
+
+                        const auto push = [&]() -> Result {
+                            pool.Push();
+                            while (pool.IsFrontDone()) {
+                                R_TRY(pop());
+                            }
+                            R_SUCCEED();
+                        };
+
+                        while (size) {
+                            while (pool.IsFull()) {
+                                R_TRY(pop());
+                            }
+
+                            auto& job = pool.GetBack();
+                            if (job.data.size() < block_size) {
+                                job.data = utils::pool::Acquire(block_size);
+                            }
+
+                            const auto rsize = std::min<s64>(size, block_size - job.data_size);
+                            std::memcpy(job.data.data() + job.data_size, buf, rsize);
+                            job.data_size += rsize;
+                            if (job.data_size == block_size) {
+                                R_TRY(push());
+                            }
+                            size -= rsize;
+                            buf += rsize;
+                        }
+
+                        if (last_chunk) {
+                            if (!pool.IsFull() && pool.GetBack().data_size) {
+                                R_TRY(push());
+                            }
+                            while (!pool.IsEmpty()) {
+                                R_TRY(pop());
+                            }
+                        }
+                        R_SUCCEED();
+                    },
+                    [&](const void* buf, s64 off, s64 size) -> Result {
+                        written += size;
+                        R_SUCCEED();
+                    }
+                );
+
+                return R_SUCCEEDED(rc) ? data.size() : -1;
+            });
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "../tests/fake_remote.hpp"
+
+// sequential reads through the pipelined reader used by nfs and smb2, from
+// a fake connection with a round trip time and a link rate.
+// with one read in flight the speed is capped at block / rtt, more reads in
+// flight fill the link.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u64 FILE_SIZE = 1024 * 1024 * 32;
+// a typical smb2 / nfs max read size.
+constexpr u64 BLOCK_SIZE = 1024 * 128;
+constexpr u64 READ_SIZE = 1024 * 512;
+
+} // namespace
+
+int main() {
+    const auto file = bench::MakeData(FILE_SIZE);
+
+    for (const auto rtt_ms : {1, 5}) {
+        // roughly gigabit.
+        const test::remote::Link link{std::chrono::milliseconds(rtt_ms), 1024 * 1024 * 100};
+
+        for (const auto depth : {1, 2, 4, 8, 16, 32}) {
+            char name[64];
+            std::snprintf(name, sizeof(name), "pipelined read rtt %dms depth %d", rtt_ms, depth);
+
+            bench::Run(name, [&]() -> s64 {
+                test::remote::FakeRemote reader{file, link, BLOCK_SIZE, (u32)depth};
+                if (R_FAILED(reader.Create())) {
+                    return -1;
+                }
+
+                std::vector<u8> out(READ_SIZE);
+                for (u64 off = 0; off < file.size(); ) {
+                    const auto ret = reader.Read((char*)out.data(), off, out.size());
+                    if (ret <= 0) {
+                        return -1;
+                    }
+                    off += ret;
+                }
+
+                return file.size();
+            });
+        }
+    }
+}
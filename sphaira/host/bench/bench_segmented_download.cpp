@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "../tests/http_server.hpp"
+#include "../tests/curl_session.hpp"
+#include "../tests/sd_card.hpp"
+
+// a large file downloaded with curl::ToFile, the server throttles each
+// connection as a lossy wifi link would, so that a single stream is bound by
+// the rate and segments over several connections add up.
+// "slow" throttles 1 in 4 connections to 1/8 of the rate, so that the idle
+// connections have to split the slow one's segment to finish early.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u64 FILE_SIZE = 1024 * 1024 * 16;
+// per connection.
+constexpr u64 RATE = 1024 * 1024 * 2;
+
+} // namespace
+
+int main() {
+    test::http::Server server;
+    server.AddFile("/file.bin", bench::MakeData(FILE_SIZE), "v1");
+    if (!server.Start()) {
+        return 1;
+    }
+
+    test::SdCard sd;
+    test::CurlSession session;
+
+    const auto run = [&](const char* name, const test::http::Options& options, u32 flags) {
+        server.SetOptions(options);
+        server.ResetCounts();
+        bench::Run(name, [&]() -> s64 {
+            const auto result = curl::Api().ToFile(
+                curl::Url{server.Url("/file.bin")},
+                fs::FsPath{"/switch/sphaira/file.bin"},
+                curl::Flags{flags}
+            );
+            return result.success ? FILE_SIZE : -1;
+        });
+    };
+
+    std::printf("%llu MiB, %llu MiB/s per connection\n", (unsigned long long)FILE_SIZE / 1024 / 1024, (unsigned long long)RATE / 1024 / 1024);
+    run("single connection", {.rate = RATE}, curl::Flag_None);
+    run("segmented", {.rate = RATE}, curl::Flag_Segmented);
+    run("segmented, 1 in 4 slow", {.rate = RATE, .slow_every = 4}, curl::Flag_Segmented);
+    run("segmented, no range support", {.rate = RATE, .ranges = false}, curl::Flag_Segmented);
+}
@@ -0,0 +1,125 @@
+#include "bench.hpp"
+#include "../tests/sd_card.hpp"
+#include "utils/thumb_cache.hpp"
+
+// fills a grid of 500 icons, as the homebrew and games menus do.
+// "memory" decodes every jpeg from memory, as game icons are already loaded.
+// "sd" reads every jpeg from the sd card then decodes it, as homebrew does.
+// "cold" decodes, then scales, compresses and writes the thumbnail.
+// "warm" reopens the cache and reads the thumbnails.
+// game icons are 256x256, some nro's carry 1024x1024 icons.
+//
+// each is run on the host disk, and again with every read and write slowed
+// down to SD_LINK, as reading from the sd card is what the cache pays for.
+
+using namespace sphaira;
+using utils::ThumbCache;
+
+namespace {
+
+constexpr u32 ICON_COUNT = 500;
+// roughly a uhs-i card through fsp-srv, small reads are latency bound.
+constexpr test::SdLink SD_LINK{500, 1024 * 1024 * 40};
+
+auto MakeIcons(u32 size, u32 count) -> std::vector<std::vector<u8>> {
+    std::vector<std::vector<u8>> icons;
+    const auto noise = bench::MakeData(size * size * 4, 80);
+
+    for (u32 i = 0; i < count; i++) {
+        std::vector<u8> rgba(size * size * 4);
+        for (u32 p = 0; p < size * size; p++) {
+            const auto x = p % size * 256 / size, y = p / size * 256 / size;
+            // gradients with some detail, so the jpeg is close to a real icon in size.
+            rgba[p * 4 + 0] = x + i * 8 + (noise[p * 4 + 0] & 0x1F);
+            rgba[p * 4 + 1] = y + i * 3 + (noise[p * 4 + 1] & 0x1F);
+            rgba[p * 4 + 2] = (x ^ y) + (noise[p * 4 + 2] & 0x1F);
+            rgba[p * 4 + 3] = 255;
+        }
+        icons.emplace_back(ImageConvertToJpg(rgba, size, size).data);
+    }
+
+    return icons;
+}
+
+auto IconPath(u32 i) -> fs::FsPath {
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "/icons/%u.jpg", i);
+    return path;
+}
+
+auto Fill(const std::vector<std::vector<u8>>& icons, ThumbCache* cache) -> bool {
+    for (u32 i = 0; i < icons.size(); i++) {
+        const auto load = [&icons, i]() { return ImageLoadFromMemory(icons[i], ImageFlag_JPEG); };
+        const auto image = cache ? cache->Load(i, ThumbCache::Hash(icons[i]), load) : load();
+        if (image.data.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto FillFromSd(u32 count) -> bool {
+    fs::FsNativeSd fs;
+    for (u32 i = 0; i < count; i++) {
+        std::vector<u8> data;
+        if (R_FAILED(fs.read_entire_file(IconPath(i), data)) || ImageLoadFromMemory(data, ImageFlag_JPEG).data.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto Time(const std::function<bool()>& func) -> double {
+    const auto start = bench::GetTimeNs();
+    if (!func()) {
+        return -1;
+    }
+    return (bench::GetTimeNs() - start) / 1e+6;
+}
+
+void Run(const char* name, const std::vector<std::vector<u8>>& icons, const test::SdLink& link) {
+    std::vector<double> memory, sd_read, cold, warm;
+    u64 file_size{};
+
+    for (int i = 0; i < bench::GetIterations(); i++) {
+        test::SdCard sd{link};
+        {
+            fs::FsNativeSd fs;
+            fs.CreateDirectory("/icons");
+            for (u32 j = 0; j < icons.size(); j++) {
+                fs.write_entire_file(IconPath(j), icons[j]);
+            }
+        }
+
+        memory.emplace_back(Time([&]() { return Fill(icons, nullptr); }));
+        sd_read.emplace_back(Time([&]() { return FillFromSd(icons.size()); }));
+        cold.emplace_back(Time([&]() { ThumbCache cache{"bench"}; return Fill(icons, &cache); }));
+        warm.emplace_back(Time([&]() { ThumbCache cache{"bench"}; return Fill(icons, &cache); }));
+        file_size = std::filesystem::file_size(sd.Path("/switch/sphaira/cache/thumbs/bench.bin"));
+    }
+
+    const auto median = [](std::vector<double>& v) {
+        std::ranges::sort(v);
+        return v[v.size() / 2];
+    };
+
+    std::printf("%-10s %-4s memory: %7.1f ms sd: %7.1f ms cold: %7.1f ms warm: %7.1f ms (%.3f ms/icon) cache file: %.1f MiB\n",
+        name, link.latency_us ? "sd" : "host", median(memory), median(sd_read), median(cold), median(warm), median(warm) / icons.size(), file_size / 1024.0 / 1024.0);
+}
+
+} // namespace
+
+int main() {
+    const auto small = MakeIcons(256, ICON_COUNT);
+    Run("256x256", small, {});
+    Run("256x256", small, SD_LINK);
+
+    // only a few are encoded, as it takes a while, the icons reuse them.
+    const auto large = MakeIcons(1024, 8);
+    std::vector<std::vector<u8>> large_icons;
+    for (u32 i = 0; i < ICON_COUNT; i++) {
+        large_icons.emplace_back(large[i % large.size()]);
+    }
+    Run("1024x1024", large_icons, {});
+    Run("1024x1024", large_icons, SD_LINK);
+}
@@ -0,0 +1,51 @@
+#include "bench.hpp"
+#include "threaded_file_transfer.hpp"
+#include "app.hpp"
+#include <cstring>
+
+// thread::Transfer buffer handoff with bursty read and write speeds, such as
+// usb / network reads and sd card writes, for each transfer ring depth.
+// the stalls are simulated with sleeps, so the numbers are stable between runs.
+
+using namespace sphaira;
+
+namespace {
+
+// every few buffers stalls for much longer than the rest,
+// read and write stall at different times, so a deeper ring can absorb them.
+auto GetStallNs(s64 off, u64 phase) -> u64 {
+    const auto index = off / (1024 * 1024 * 4);
+    return (index + phase) % 4 == 0 ? 12'000'000 : 2'000'000;
+}
+
+} // namespace
+
+int main() {
+    const auto data = bench::MakeData(1024ULL * 1024 * 128);
+
+    for (const u32 depth : {2, 3, 4}) {
+        App::transfer_ring_depth = depth;
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "transfer bursty read/write (depth %u)", depth);
+        bench::Run(name, [&]() -> s64 {
+            ui::ProgressBox pbox{0, "", "", nullptr};
+
+            const auto rc = thread::Transfer(&pbox, data.size(),
+                [&](void* buf, s64 off, s64 size, u64* bytes_read) -> Result {
+                    svcSleepThread(GetStallNs(off, 0));
+                    size = std::min<s64>(size, data.size() - off);
+                    std::memcpy(buf, data.data() + off, size);
+                    *bytes_read = size;
+                    R_SUCCEED();
+                },
+                [&](const void* buf, s64 off, s64 size) -> Result {
+                    svcSleepThread(GetStallNs(off, 2));
+                    R_SUCCEED();
+                }
+            );
+
+            return R_SUCCEEDED(rc) ? data.size() : -1;
+        });
+    }
+}
@@ -0,0 +1,41 @@
+#include "bench.hpp"
+#include "../tests/http_server.hpp"
+#include "../tests/net_mount.hpp"
+
+// uploads to the webdav mount, the server throttles each connection as a
+// slow nas would. a single PUT is bound by the rate, parallel partial
+// updates add up.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u64 FILE_SIZE = 1024 * 1024 * 16;
+// per connection.
+constexpr u64 RATE = 1024 * 1024 * 4;
+
+void Run(const char* name, bool partial_update, int connections) {
+    test::http::Server server;
+    server.SetOptions({.rate = RATE, .partial_update = partial_update});
+    server.AddFile("/dir/.keep", {});
+    if (!server.Start()) {
+        return;
+    }
+
+    test::net::SdCard sd;
+    test::net::Device device{test::net::Mount(sd, "WEBDAV", devoptab::MountWebdavAll, server.Url(), {{"connections", std::to_string(connections)}})};
+
+    const auto data = bench::MakeData(FILE_SIZE);
+    bench::Run(name, [&]() -> s64 {
+        return device.Write("/dir/file.bin", data, 1024 * 512) ? data.size() : -1;
+    });
+}
+
+} // namespace
+
+int main() {
+    Run("webdav upload single PUT", false, 4);
+    Run("webdav upload PATCH x 2 connections", true, 2);
+    Run("webdav upload PATCH x 4 connections", true, 4);
+    Run("webdav upload PATCH x 8 connections", true, 8);
+}
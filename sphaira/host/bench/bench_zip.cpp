@@ -0,0 +1,78 @@
+#include "bench.hpp"
+#include "../tests/zip_builder.hpp"
+#include "fs.hpp"
+#include "app.hpp"
+#include <filesystem>
+
+// random reads from a large deflate entry of a mounted zip, each read seeks
+// to a random offset, which is a restart from the nearest access point.
+// a fresh mount only has the points found so far, whereas a saved index
+// has every point as soon as the zip is mounted.
+
+using namespace sphaira;
+
+namespace {
+
+constexpr u64 READ_SIZE = 1024 * 64;
+constexpr u32 READ_COUNT = 64;
+
+// indexes are only saved for zips on the sd card.
+struct SdFs final : fs::FsStdio {
+    bool IsSd() const override { return true; }
+};
+
+SdFs g_fs{};
+
+auto ReadRandom(const fs::FsPath& path, const std::vector<u8>& data) -> s64 {
+    fs::FsPath mount;
+    if (R_FAILED(devoptab::MountZip(&g_fs, path, mount))) {
+        return -1;
+    }
+    ON_SCOPE_EXIT(devoptab::UmountNeworkDevice(mount));
+
+    u64 seed = 0x1234;
+    std::vector<u8> out(READ_SIZE);
+    for (u32 i = 0; i < READ_COUNT; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const auto off = (seed >> 16) % (data.size() - READ_SIZE);
+        if (!test::zip::ReadFile(mount, "big.bin", off, out) || std::memcmp(out.data(), data.data() + off, out.size())) {
+            return -1;
+        }
+    }
+
+    return READ_SIZE * READ_COUNT;
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/sphaira_bench_zip_XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    ON_SCOPE_EXIT(std::filesystem::remove_all(dir));
+
+    const auto data = bench::MakeData(1024ULL * 1024 * 128, 50);
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/big.zip", dir);
+    test::zip::WriteFile(path, test::zip::Build({{"big.bin", data, true}}));
+
+    App::zip_seek_index = false;
+    bench::Run("zip random seek (no saved index)", [&]() -> s64 {
+        return ReadRandom(path, data);
+    });
+
+    // a full read of the entry saves the index.
+    App::zip_seek_index = true;
+    {
+        fs::FsPath mount;
+        devoptab::MountZip(&g_fs, path, mount);
+        std::vector<u8> out(data.size());
+        test::zip::ReadFile(mount, "big.bin", 0, out);
+        devoptab::UmountNeworkDevice(mount);
+    }
+
+    bench::Run("zip random seek (saved index)", [&]() -> s64 {
+        return ReadRandom(path, data);
+    });
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// host stand-in for app.hpp, the real header pulls in the ui.
+// only the static helpers used by the host build are provided.
+
+#include <switch.h>
+
+namespace sphaira {
+
+struct App {
+    static void SetAutoSleepDisabled(bool enable) {}
+    static auto IsFileBaseEmummc() -> bool { return false; }
+
+    // the options are set directly by the tests and benchmarks.
+    static inline u32 transfer_ring_depth = 2;
+    static auto GetTransferRingDepth() -> u32 { return transfer_ring_depth; }
+
+    static inline bool zip_seek_index = false;
+    static auto GetZipSeekIndexEnable() -> bool { return zip_seek_index; }
+};
+
+} // namespace sphaira
@@ -0,0 +1,252 @@
+#include <switch.h>
+#include <mbedtls/md5.h>
+#include "hash_kernel.hpp"
+#include <cstring>
+#include <algorithm>
+
+// reference implementations of the hashes that libnx / mbedtls provide on the switch.
+// sha1 and md5 are not optimised, sha256 uses the kernel picked for the cpu, see hash_kernel.hpp.
+
+namespace {
+
+constexpr u32 rol(u32 x, u32 n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+constexpr u32 ror(u32 x, u32 n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+auto load_be32(const u8* p) -> u32 {
+    return (u32)p[0] << 24 | (u32)p[1] << 16 | (u32)p[2] << 8 | p[3];
+}
+
+auto load_le32(const u8* p) -> u32 {
+    return (u32)p[3] << 24 | (u32)p[2] << 16 | (u32)p[1] << 8 | p[0];
+}
+
+void store_be32(u8* p, u32 v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+void store_le32(u8* p, u32 v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+void sha1_block(u32* h, const u8* p) {
+    u32 w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_be32(p + i * 4);
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    u32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        u32 f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d); k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d; k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d; k = 0xCA62C1D6;
+        }
+
+        const u32 t = rol(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = rol(b, 30); b = a; a = t;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+constexpr u32 MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr u32 MD5_R[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+void md5_block(u32* h, const u8* p) {
+    u32 w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = load_le32(p + i * 4);
+    }
+
+    u32 a = h[0], b = h[1], c = h[2], d = h[3];
+    for (int i = 0; i < 64; i++) {
+        u32 f, g;
+        if (i < 16) {
+            f = (b & c) | (~b & d); g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c); g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d; g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d); g = (7 * i) % 16;
+        }
+
+        const u32 t = d;
+        d = c; c = b;
+        b = b + rol(a + f + MD5_K[i] + w[g], MD5_R[i]);
+        a = t;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+}
+
+// hashes count 64 byte blocks, one at a time.
+template<void (*Block)(u32*, const u8*)>
+void blocks(u32* h, const u8* p, size_t count) {
+    for (; count--; p += 64) {
+        Block(h, p);
+    }
+}
+
+void sha256_blocks(u32* h, const u8* p, size_t count) {
+    sphaira::host::kernel::GetSha256().blocks(h, p, count);
+}
+
+// shared merkle-damgard buffering, all three hashes use 64 byte blocks.
+// as many whole blocks as possible are passed to the kernel at once.
+template<typename F>
+void update(u32* h, u8* buffer, u64* bits, size_t* num_buffered, const void* src, size_t size, const F& block) {
+    auto p = static_cast<const u8*>(src);
+    *bits += (u64)size * 8;
+
+    if (*num_buffered) {
+        const auto n = std::min<size_t>(size, 64 - *num_buffered);
+        std::memcpy(buffer + *num_buffered, p, n);
+        *num_buffered += n;
+        p += n;
+        size -= n;
+
+        if (*num_buffered == 64) {
+            block(h, buffer, 1);
+            *num_buffered = 0;
+        }
+    }
+
+    if (size >= 64) {
+        block(h, p, size / 64);
+        p += size & ~size_t(63);
+        size &= 63;
+    }
+
+    if (size) {
+        std::memcpy(buffer, p, size);
+        *num_buffered = size;
+    }
+}
+
+template<typename F>
+void finish(u32* h, u8* buffer, u64 bits, size_t num_buffered, bool big_endian, const F& block) {
+    buffer[num_buffered++] = 0x80;
+    if (num_buffered > 56) {
+        std::memset(buffer + num_buffered, 0, 64 - num_buffered);
+        block(h, buffer, 1);
+        num_buffered = 0;
+    }
+
+    std::memset(buffer + num_buffered, 0, 56 - num_buffered);
+    for (int i = 0; i < 8; i++) {
+        buffer[56 + i] = big_endian ? bits >> (56 - i * 8) : bits >> (i * 8);
+    }
+    block(h, buffer, 1);
+}
+
+} // namespace
+
+extern "C" {
+
+void sha1ContextCreate(Sha1Context* out) {
+    static constexpr u32 init[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    *out = {};
+    std::memcpy(out->intermediate_hash, init, sizeof(init));
+}
+
+void sha1ContextUpdate(Sha1Context* ctx, const void* src, size_t size) {
+    update(ctx->intermediate_hash, ctx->buffer, &ctx->bits_consumed, &ctx->num_buffered, src, size, blocks<sha1_block>);
+}
+
+void sha1ContextGetHash(Sha1Context* ctx, void* dst) {
+    finish(ctx->intermediate_hash, ctx->buffer, ctx->bits_consumed, ctx->num_buffered, true, blocks<sha1_block>);
+    for (int i = 0; i < 5; i++) {
+        store_be32(static_cast<u8*>(dst) + i * 4, ctx->intermediate_hash[i]);
+    }
+}
+
+void sha1CalculateHash(void* dst, const void* src, size_t size) {
+    Sha1Context ctx;
+    sha1ContextCreate(&ctx);
+    sha1ContextUpdate(&ctx, src, size);
+    sha1ContextGetHash(&ctx, dst);
+}
+
+void sha256ContextCreate(Sha256Context* out) {
+    static constexpr u32 init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    *out = {};
+    std::memcpy(out->intermediate_hash, init, sizeof(init));
+}
+
+void sha256ContextUpdate(Sha256Context* ctx, const void* src, size_t size) {
+    update(ctx->intermediate_hash, ctx->buffer, &ctx->bits_consumed, &ctx->num_buffered, src, size, sha256_blocks);
+}
+
+void sha256ContextGetHash(Sha256Context* ctx, void* dst) {
+    finish(ctx->intermediate_hash, ctx->buffer, ctx->bits_consumed, ctx->num_buffered, true, sha256_blocks);
+    for (int i = 0; i < 8; i++) {
+        store_be32(static_cast<u8*>(dst) + i * 4, ctx->intermediate_hash[i]);
+    }
+}
+
+void sha256CalculateHash(void* dst, const void* src, size_t size) {
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
+    sha256ContextUpdate(&ctx, src, size);
+    sha256ContextGetHash(&ctx, dst);
+}
+
+void mbedtls_md5_init(mbedtls_md5_context* ctx) {
+    *ctx = {};
+}
+
+void mbedtls_md5_free(mbedtls_md5_context* ctx) {
+}
+
+int mbedtls_md5_starts_ret(mbedtls_md5_context* ctx) {
+    static constexpr u32 init[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    *ctx = {};
+    std::memcpy(ctx->state, init, sizeof(init));
+    return 0;
+}
+
+int mbedtls_md5_update_ret(mbedtls_md5_context* ctx, const unsigned char* input, size_t ilen) {
+    update(ctx->state, ctx->buffer, &ctx->bits, &ctx->num_buffered, input, ilen, blocks<md5_block>);
+    return 0;
+}
+
+int mbedtls_md5_finish_ret(mbedtls_md5_context* ctx, unsigned char output[16]) {
+    finish(ctx->state, ctx->buffer, ctx->bits, ctx->num_buffered, false, blocks<md5_block>);
+    for (int i = 0; i < 4; i++) {
+        store_le32(output + i * 4, ctx->state[i]);
+    }
+    return 0;
+}
+
+} // extern "C"
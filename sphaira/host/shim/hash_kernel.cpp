@@ -0,0 +1,242 @@
+#include "hash_kernel.hpp"
+#include "log.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SPHAIRA_HASH_X86 1
+#endif
+
+namespace sphaira::host::kernel {
+namespace {
+
+// reflected castagnoli polynomial.
+auto make_crc32c_table() {
+    struct Table { u32 v[8][256]; } table{};
+    for (u32 i = 0; i < 256; i++) {
+        u32 crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+        table.v[0][i] = crc;
+    }
+    for (u32 i = 0; i < 256; i++) {
+        for (int j = 1; j < 8; j++) {
+            table.v[j][i] = (table.v[j - 1][i] >> 8) ^ table.v[0][table.v[j - 1][i] & 0xFF];
+        }
+    }
+    return table;
+}
+
+const auto g_crc32c_table = make_crc32c_table();
+
+constexpr u32 SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr u32 ror(u32 x, u32 n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+auto load_be32(const u8* p) -> u32 {
+    return (u32)p[0] << 24 | (u32)p[1] << 16 | (u32)p[2] << 8 | p[3];
+}
+
+bool always_supported() {
+    return true;
+}
+
+// slicing by 8.
+u32 crc32c_portable(u32 crc, const u8* p, size_t size) {
+    const auto& t = g_crc32c_table.v;
+
+    while (size >= 8) {
+        const u32 lo = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        size -= 8;
+    }
+
+    while (size--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return crc;
+}
+
+void sha256_portable(u32* h, const u8* p, size_t count) {
+    for (; count--; p += 64) {
+        u32 w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(p + i * 4);
+        }
+        for (int i = 16; i < 64; i++) {
+            const u32 s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const u32 s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        u32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; i++) {
+            const u32 s1 = ror(e, 6) ^ ror(e, 11) ^ ror(e, 25);
+            const u32 ch = (e & f) ^ (~e & g);
+            const u32 t1 = hh + s1 + ch + SHA256_K[i] + w[i];
+            const u32 s0 = ror(a, 2) ^ ror(a, 13) ^ ror(a, 22);
+            const u32 maj = (a & b) ^ (a & c) ^ (b & c);
+            const u32 t2 = s0 + maj;
+            hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+}
+
+#if SPHAIRA_HASH_X86
+bool has_sse42() {
+    unsigned a, b, c, d;
+    return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_SSE4_2);
+}
+
+bool has_sha() {
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1) || !(c & bit_SSSE3)) {
+        return false;
+    }
+    return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA);
+}
+
+__attribute__((target("sse4.2")))
+u32 crc32c_sse42(u32 crc, const u8* p, size_t size) {
+    u64 c = crc;
+
+    while (size >= 8) {
+        u64 v;
+        std::memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        size -= 8;
+    }
+
+    while (size--) {
+        c = _mm_crc32_u8(c, *p++);
+    }
+
+    return c;
+}
+
+// see the intel sha extensions paper, each rnds2 does 2 rounds.
+__attribute__((target("sha,sse4.1")))
+void sha256_shani(u32* h, const u8* p, size_t count) {
+    const auto bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // the state is kept as ABEF and CDGH.
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);
+    auto state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; count--; p += 64) {
+        const auto abef = state0;
+        const auto cdgh = state1;
+
+        __m128i w[4];
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + i * 16)), bswap);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            auto msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&SHA256_K[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+            // w[i + 4] replaces w[i], which is no longer needed.
+            if (i < 12) {
+                auto next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+            }
+
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)&h[0], state0);
+    _mm_storeu_si128((__m128i*)&h[4], state1);
+}
+#endif
+
+constexpr Crc32c CRC32C_KERNELS[] = {
+    {"portable", always_supported, crc32c_portable},
+#if SPHAIRA_HASH_X86
+    {"sse4.2", has_sse42, crc32c_sse42},
+#endif
+};
+
+constexpr Sha256 SHA256_KERNELS[] = {
+    {"portable", always_supported, sha256_portable},
+#if SPHAIRA_HASH_X86
+    {"sha-ni", has_sha, sha256_shani},
+#endif
+};
+
+template<typename T>
+auto Select(std::span<const T> kernels, const char* type) -> const T& {
+    const auto forced = std::getenv("SPHAIRA_HASH_KERNEL");
+
+    const T* out = &kernels[0];
+    for (const auto& kernel : kernels) {
+        if (!kernel.supported()) {
+            continue;
+        }
+
+        if (forced && !std::strcmp(forced, kernel.name)) {
+            out = &kernel;
+            break;
+        } else if (!forced) {
+            out = &kernel;
+        }
+    }
+
+    log_write("[HASH] %s kernel: %s\n", type, out->name);
+    return *out;
+}
+
+} // namespace
+
+auto GetCrc32cKernels() -> std::span<const Crc32c> {
+    return CRC32C_KERNELS;
+}
+
+auto GetSha256Kernels() -> std::span<const Sha256> {
+    return SHA256_KERNELS;
+}
+
+auto GetCrc32c() -> const Crc32c& {
+    static const auto& kernel = Select(GetCrc32cKernels(), "crc32c");
+    return kernel;
+}
+
+auto GetSha256() -> const Sha256& {
+    static const auto& kernel = Select(GetSha256Kernels(), "sha256");
+    return kernel;
+}
+
+} // namespace sphaira::host::kernel
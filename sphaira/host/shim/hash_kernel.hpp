@@ -0,0 +1,37 @@
+#pragma once
+
+// kernels behind the crc32c and sha256 functions of the shim.
+// on the switch, libnx uses the armv8 crc32 and sha2 instructions. here the
+// fastest kernel that the cpu supports is picked at runtime, falling back to
+// a portable one, so that the data path isn't measured against a slow hash.
+// SPHAIRA_HASH_KERNEL=<name> forces a kernel, eg "portable".
+
+#include <switch.h>
+#include <span>
+
+namespace sphaira::host::kernel {
+
+struct Crc32c {
+    const char* name;
+    bool (*supported)();
+    // crc is not inverted before or after, that's done by the caller.
+    u32 (*update)(u32 crc, const u8* p, size_t size);
+};
+
+struct Sha256 {
+    const char* name;
+    bool (*supported)();
+    // hashes count 64 byte blocks into h.
+    void (*blocks)(u32* h, const u8* p, size_t count);
+};
+
+// every kernel, including those that the cpu doesn't support.
+// the portable kernel is first, the fastest is last.
+auto GetCrc32cKernels() -> std::span<const Crc32c>;
+auto GetSha256Kernels() -> std::span<const Sha256>;
+
+// kernels used by the shim, picked on first use.
+auto GetCrc32c() -> const Crc32c&;
+auto GetSha256() -> const Sha256&;
+
+} // namespace sphaira::host::kernel
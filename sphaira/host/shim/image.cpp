@@ -0,0 +1,148 @@
+#include "image.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <csetjmp>
+#include <jpeglib.h>
+
+// stb is fetched by the switch build only, so images are decoded and encoded
+// with libjpeg on the host, and resized with a bilinear filter.
+// only jpegs are supported, which is what the icons are.
+
+namespace sphaira {
+namespace {
+
+constexpr int BPP = 4;
+
+struct ErrorMgr {
+    jpeg_error_mgr mgr;
+    std::jmp_buf jmp;
+};
+
+void OnError(j_common_ptr cinfo) {
+    std::longjmp(reinterpret_cast<ErrorMgr*>(cinfo->err)->jmp, 1);
+}
+
+} // namespace
+
+auto ImageLoadFromMemory(std::span<const u8> data, u32 flags) -> ImageResult {
+    ImageResult result{};
+    jpeg_decompress_struct cinfo{};
+    ErrorMgr err{};
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = OnError;
+
+    if (setjmp(err.jmp)) {
+        jpeg_destroy_decompress(&cinfo);
+        log_write("failed image load\n");
+        return {};
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data.data(), data.size());
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_EXT_RGBA;
+    jpeg_start_decompress(&cinfo);
+
+    result.w = cinfo.output_width;
+    result.h = cinfo.output_height;
+    result.data.resize(result.w * result.h * BPP);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = result.data.data() + cinfo.output_scanline * result.w * BPP;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return result;
+}
+
+auto ImageLoadFromFile(const fs::FsPath& file, u32 flags) -> ImageResult {
+    auto f = std::fopen(file, "rb");
+    if (!f) {
+        return {};
+    }
+
+    std::vector<u8> data;
+    u8 buf[1024 * 16];
+    size_t size;
+    while ((size = std::fread(buf, 1, sizeof(buf), f))) {
+        data.insert(data.end(), buf, buf + size);
+    }
+    std::fclose(f);
+
+    return ImageLoadFromMemory(data, flags);
+}
+
+auto ImageResize(std::span<const u8> data, int inx, int iny, int outx, int outy) -> ImageResult {
+    if (inx <= 0 || iny <= 0 || outx <= 0 || outy <= 0 || data.size() < (u64)inx * iny * BPP) {
+        return {};
+    }
+
+    std::vector<u8> out(outx * outy * BPP);
+    for (int y = 0; y < outy; y++) {
+        const auto fy = std::max(0.f, (y + 0.5f) * iny / outy - 0.5f);
+        const auto y0 = std::min<int>(fy, iny - 1);
+        const auto y1 = std::min(y0 + 1, iny - 1);
+        const auto wy = fy - y0;
+
+        for (int x = 0; x < outx; x++) {
+            const auto fx = std::max(0.f, (x + 0.5f) * inx / outx - 0.5f);
+            const auto x0 = std::min<int>(fx, inx - 1);
+            const auto x1 = std::min(x0 + 1, inx - 1);
+            const auto wx = fx - x0;
+
+            for (int c = 0; c < BPP; c++) {
+                const auto p = [&](int px, int py) -> float { return data[(py * inx + px) * BPP + c]; };
+                const auto top = p(x0, y0) + (p(x1, y0) - p(x0, y0)) * wx;
+                const auto bottom = p(x0, y1) + (p(x1, y1) - p(x0, y1)) * wx;
+                out[(y * outx + x) * BPP + c] = top + (bottom - top) * wy + 0.5f;
+            }
+        }
+    }
+
+    return { out, outx, outy };
+}
+
+auto ImageConvertToJpg(std::span<const u8> data, int x, int y) -> ImageResult {
+    jpeg_compress_struct cinfo{};
+    ErrorMgr err{};
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = OnError;
+
+    unsigned char* out{};
+    unsigned long out_size{};
+
+    if (setjmp(err.jmp)) {
+        jpeg_destroy_compress(&cinfo);
+        std::free(out);
+        log_write("failed jpg convert\n");
+        return {};
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &out, &out_size);
+    cinfo.image_width = x;
+    cinfo.image_height = y;
+    cinfo.input_components = BPP;
+    cinfo.in_color_space = JCS_EXT_RGBA;
+    jpeg_set_defaults(&cinfo);
+    // same quality as the switch build.
+    jpeg_set_quality(&cinfo, 93, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<u8*>(data.data()) + cinfo.next_scanline * x * BPP;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    ImageResult result{std::vector<u8>(out, out + out_size), x, y};
+    std::free(out);
+    return result;
+}
+
+} // namespace sphaira
@@ -0,0 +1,75 @@
+#include <sys/iosupport.h>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+std::mutex g_mutex;
+
+auto name_length(const char* name) -> size_t {
+    const auto colon = std::strchr(name, ':');
+    return colon ? colon - name : std::strlen(name);
+}
+
+} // namespace
+
+extern "C" {
+
+const devoptab_t dotab_stdnull = { "stdnull" };
+const devoptab_t* devoptab_list[STD_MAX]{};
+
+int AddDevice(const devoptab_t* device) {
+    std::scoped_lock lock{g_mutex};
+
+    // the first 3 slots are stdin, stdout and stderr.
+    int free_slot = -1;
+    for (int i = 3; i < STD_MAX; i++) {
+        const auto dev = devoptab_list[i];
+        if (dev && dev != &dotab_stdnull && !std::strcmp(dev->name, device->name)) {
+            devoptab_list[i] = device;
+            return i;
+        }
+        if (free_slot < 0 && (!dev || dev == &dotab_stdnull)) {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot >= 0) {
+        devoptab_list[free_slot] = device;
+    }
+    return free_slot;
+}
+
+int FindDevice(const char* name) {
+    std::scoped_lock lock{g_mutex};
+
+    const auto len = name_length(name);
+    for (int i = 3; i < STD_MAX; i++) {
+        const auto dev = devoptab_list[i];
+        if (dev && dev != &dotab_stdnull && std::strlen(dev->name) == len && !std::strncmp(dev->name, name, len)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int RemoveDevice(const char* name) {
+    const auto index = FindDevice(name);
+    if (index < 0) {
+        return -1;
+    }
+
+    std::scoped_lock lock{g_mutex};
+    devoptab_list[index] = &dotab_stdnull;
+    return 0;
+}
+
+const devoptab_t* GetDeviceOpTab(const char* name) {
+    const auto index = FindDevice(name);
+    if (index < 0) {
+        return nullptr;
+    }
+    return devoptab_list[index];
+}
+
+} // extern "C"
@@ -0,0 +1,40 @@
+#pragma once
+
+// host stand-in for location.hpp, the real header pulls in the ui.
+// keep in sync with location.hpp and ui/menus/filebrowser.hpp.
+
+#include <string>
+#include <vector>
+#include <switch.h>
+
+namespace sphaira::ui::menu::filebrowser {
+
+enum FsEntryFlag {
+    FsEntryFlag_None,
+    FsEntryFlag_ReadOnly = 1 << 0,
+    FsEntryFlag_Assoc = 1 << 1,
+    FsEntryFlag_IsSd = 1 << 2,
+    FsEntryFlag_NoStatFile = 1 << 3,
+    FsEntryFlag_NoStatDir = 1 << 4,
+    FsEntryFlag_NoRandomReads = 1 << 5,
+    FsEntryFlag_NoRandomWrites = 1 << 6,
+};
+
+} // namespace sphaira::ui::menu::filebrowser
+
+namespace sphaira::location {
+
+using FsEntryFlag = ui::menu::filebrowser::FsEntryFlag;
+
+struct StdioEntry {
+    std::string mount{};
+    std::string name{};
+    u32 flags{};
+    std::string dump_path{};
+    bool fs_hidden{};
+    bool dump_hidden{};
+};
+
+using StdioEntries = std::vector<StdioEntry>;
+
+} // namespace sphaira::location
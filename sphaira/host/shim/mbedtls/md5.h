@@ -0,0 +1,27 @@
+#pragma once
+
+// host stand-in for the subset of mbedtls md5 used by the host build, see crypto.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t state[4];
+    unsigned char buffer[64];
+    uint64_t bits;
+    size_t num_buffered;
+} mbedtls_md5_context;
+
+void mbedtls_md5_init(mbedtls_md5_context* ctx);
+void mbedtls_md5_free(mbedtls_md5_context* ctx);
+int mbedtls_md5_starts_ret(mbedtls_md5_context* ctx);
+int mbedtls_md5_update_ret(mbedtls_md5_context* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_md5_finish_ret(mbedtls_md5_context* ctx, unsigned char output[16]);
+
+#ifdef __cplusplus
+}
+#endif
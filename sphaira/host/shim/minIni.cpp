@@ -0,0 +1,84 @@
+#include <minIni.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <strings.h>
+
+namespace {
+
+auto trim(std::string s) -> std::string {
+    const auto start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return {};
+    }
+    const auto end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+} // namespace
+
+int ini_browse(INI_CALLBACK Callback, void* UserData, const mTCHAR* Filename) {
+    // on the switch, stdio paths are on the sd card, see SPHAIRA_SD in switch.cpp.
+    std::string path{Filename};
+    if (const auto root = std::getenv("SPHAIRA_SD"); root && root[0] && Filename[0] == '/') {
+        path = root + path;
+    }
+
+    auto f = std::fopen(path.c_str(), "r");
+    if (!f) {
+        return 0;
+    }
+
+    std::string section;
+    char line[1024];
+    while (std::fgets(line, sizeof(line), f)) {
+        const auto str = trim(line);
+        if (str.empty() || str[0] == ';' || str[0] == '#') {
+            continue;
+        }
+
+        if (str[0] == '[') {
+            const auto end = str.find(']');
+            section = trim(str.substr(1, end == std::string::npos ? std::string::npos : end - 1));
+            continue;
+        }
+
+        const auto eq = str.find_first_of("=:");
+        if (eq == std::string::npos) {
+            continue;
+        }
+
+        const auto key = trim(str.substr(0, eq));
+        const auto value = trim(str.substr(eq + 1));
+        if (!Callback(section.c_str(), key.c_str(), value.c_str(), UserData)) {
+            break;
+        }
+    }
+
+    std::fclose(f);
+    return 1;
+}
+
+long ini_parse_getl(const mTCHAR* Value, long DefValue) {
+    if (!Value || !*Value) {
+        return DefValue;
+    }
+    return std::strtol(Value, nullptr, 0);
+}
+
+int ini_parse_getbool(const mTCHAR* Value, int DefValue) {
+    if (!Value || !*Value) {
+        return DefValue;
+    }
+
+    const auto c = std::toupper(Value[0]);
+    if (c == '1' || c == 'Y' || c == 'T') {
+        return 1;
+    }
+    if (c == '0' || c == 'N' || c == 'F') {
+        return 0;
+    }
+    return DefValue;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// host stand-in for the subset of minIni used by the host build.
+
+#define mTCHAR char
+
+typedef int (*INI_CALLBACK)(const mTCHAR* Section, const mTCHAR* Key, const mTCHAR* Value, void* UserData);
+
+int ini_browse(INI_CALLBACK Callback, void* UserData, const mTCHAR* Filename);
+long ini_parse_getl(const mTCHAR* Value, long DefValue);
+int ini_parse_getbool(const mTCHAR* Value, int DefValue);
@@ -0,0 +1,28 @@
+#include <minizip/unzip.h>
+#include <minizip/zip.h>
+#include "minizip_helper.hpp"
+
+// zip support is not part of the host build, see minizip/ioapi.h.
+
+extern "C" {
+
+unzFile unzOpen2_64(const void* path, zlib_filefunc64_def* pzlib_filefunc_def) { return nullptr; }
+int unzClose(unzFile file) { return UNZ_ERRNO; }
+int unzGetGlobalInfo64(unzFile file, unz_global_info64* pglobal_info) { return UNZ_ERRNO; }
+int unzGoToFirstFile(unzFile file) { return UNZ_ERRNO; }
+int unzGoToNextFile(unzFile file) { return UNZ_ERRNO; }
+int unzOpenCurrentFile(unzFile file) { return UNZ_ERRNO; }
+int unzCloseCurrentFile(unzFile file) { return UNZ_ERRNO; }
+int unzReadCurrentFile(unzFile file, void* buf, unsigned len) { return UNZ_ERRNO; }
+int unzGetCurrentFileInfo64(unzFile file, unz_file_info64* pfile_info, char* szFileName, unsigned long fileNameBufferSize, void* extraField, unsigned long extraFieldBufferSize, char* szComment, unsigned long commentBufferSize) { return UNZ_ERRNO; }
+int zipWriteInFileInZip(zipFile file, const void* buf, unsigned len) { return ZIP_ERRNO; }
+
+} // extern "C"
+
+namespace sphaira::mz {
+
+void FileFuncStdio(zlib_filefunc64_def* funcs) {
+    *funcs = {};
+}
+
+} // namespace sphaira::mz
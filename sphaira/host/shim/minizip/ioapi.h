@@ -0,0 +1,10 @@
+#pragma once
+
+// host stand-in for minizip, zip support is not part of the host build.
+// the declarations exist so that threaded_file_transfer.cpp builds, every call fails.
+
+#include <stdint.h>
+
+typedef struct {
+    void* opaque;
+} zlib_filefunc64_def;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ioapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNZ_OK (0)
+#define UNZ_ERRNO (-1)
+
+typedef void* unzFile;
+
+typedef struct {
+    uint64_t number_entry;
+    unsigned long size_comment;
+} unz_global_info64;
+
+typedef struct {
+    unsigned long crc;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+} unz_file_info64;
+
+unzFile unzOpen2_64(const void* path, zlib_filefunc64_def* pzlib_filefunc_def);
+int unzClose(unzFile file);
+int unzGetGlobalInfo64(unzFile file, unz_global_info64* pglobal_info);
+int unzGoToFirstFile(unzFile file);
+int unzGoToNextFile(unzFile file);
+int unzOpenCurrentFile(unzFile file);
+int unzCloseCurrentFile(unzFile file);
+int unzReadCurrentFile(unzFile file, void* buf, unsigned len);
+int unzGetCurrentFileInfo64(unzFile file, unz_file_info64* pfile_info, char* szFileName, unsigned long fileNameBufferSize, void* extraField, unsigned long extraFieldBufferSize, char* szComment, unsigned long commentBufferSize);
+
+#ifdef __cplusplus
+}
+#endif
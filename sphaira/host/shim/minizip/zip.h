@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ioapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ZIP_OK (0)
+#define ZIP_ERRNO (-1)
+
+typedef void* zipFile;
+
+int zipWriteInFileInZip(zipFile file, const void* buf, unsigned len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+// host stand-in for nanovg, only the types used by the ui headers are provided.
+
+typedef struct NVGcontext NVGcontext;
+
+typedef struct NVGcolor {
+    union {
+        float rgba[4];
+        struct {
+            float r, g, b, a;
+        };
+    };
+} NVGcolor;
@@ -0,0 +1,159 @@
+#include "ui/progress_box.hpp"
+#include "utils/thread.hpp"
+#include "defines.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+// host version of progress_box.cpp, nothing is drawn or pushed to the app.
+// the callback (if any) is run on a thread, same as on the switch.
+
+namespace sphaira::ui {
+namespace {
+
+void threadFunc(void* arg) {
+    auto d = static_cast<ProgressBox::ThreadData*>(arg);
+    d->result = d->callback(d->pbox);
+    d->pbox->RequestExit();
+}
+
+} // namespace
+
+void Widget::Update(Controller* controller, TouchInfo* touch) {
+}
+
+void Widget::Draw(NVGcontext* vg, Theme* theme) {
+}
+
+ProgressBox::ProgressBox(int image, const std::string& action, const std::string& title, const ProgressBoxCallback& callback, const ProgressBoxDoneCallback& done)
+: m_done{done}
+, m_action{action}
+, m_title{title}
+, m_image{image} {
+    mutexInit(&m_mutex);
+    ueventCreate(&m_uevent, false);
+
+    m_thread_data.pbox = this;
+    m_thread_data.callback = callback;
+    if (callback) {
+        if (R_SUCCEEDED(utils::CreateThread(&m_thread, threadFunc, &m_thread_data))) {
+            threadStart(&m_thread);
+        }
+    }
+}
+
+ProgressBox::~ProgressBox() {
+    ueventSignal(GetCancelEvent());
+    m_stop_source.request_stop();
+
+    threadWaitForExit(&m_thread);
+    threadClose(&m_thread);
+
+    if (m_done) {
+        m_done(m_thread_data.result);
+    }
+}
+
+auto ProgressBox::Update(Controller* controller, TouchInfo* touch) -> void {
+}
+
+auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
+}
+
+auto ProgressBox::SetActionName(const std::string& action) -> ProgressBox& {
+    SCOPED_MUTEX(&m_mutex);
+    m_action = action;
+    return *this;
+}
+
+auto ProgressBox::SetTitle(const std::string& title) -> ProgressBox& {
+    SCOPED_MUTEX(&m_mutex);
+    m_title = title;
+    return *this;
+}
+
+auto ProgressBox::NewTransfer(const std::string& transfer) -> ProgressBox& {
+    SCOPED_MUTEX(&m_mutex);
+    m_transfer = transfer;
+    m_size = 0;
+    m_offset = 0;
+    m_last_offset = 0;
+    return *this;
+}
+
+auto ProgressBox::ResetTranfser() -> ProgressBox& {
+    SCOPED_MUTEX(&m_mutex);
+    m_size = 0;
+    m_offset = 0;
+    m_last_offset = 0;
+    return *this;
+}
+
+auto ProgressBox::UpdateTransfer(s64 offset, s64 size) -> ProgressBox& {
+    SCOPED_MUTEX(&m_mutex);
+    m_size = size;
+    m_offset = offset;
+    return *this;
+}
+
+auto ProgressBox::SetImage(int image) -> ProgressBox& {
+    return *this;
+}
+
+auto ProgressBox::SetImageData(std::vector<u8>& data) -> ProgressBox& {
+    return *this;
+}
+
+auto ProgressBox::SetImageDataConst(std::span<const u8> data) -> ProgressBox& {
+    return *this;
+}
+
+void ProgressBox::RequestExit() {
+    SCOPED_MUTEX(&m_mutex);
+    m_stop_source.request_stop();
+    ueventSignal(GetCancelEvent());
+
+    for (auto& e : m_cancel_events) {
+        ueventSignal(e);
+    }
+}
+
+auto ProgressBox::ShouldExit() -> bool {
+    return m_stop_source.stop_requested();
+}
+
+auto ProgressBox::ShouldExitResult() -> Result {
+    if (ShouldExit()) {
+        R_THROW(Result_TransferCancelled);
+    }
+    R_SUCCEED();
+}
+
+void ProgressBox::AddCancelEvent(UEvent* event) {
+    if (!event) {
+        return;
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+    if (std::ranges::find(m_cancel_events, event) == m_cancel_events.end()) {
+        m_cancel_events.emplace_back(event);
+    }
+}
+
+void ProgressBox::RemoveCancelEvent(const UEvent* event) {
+    if (!event) {
+        return;
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+    std::erase(m_cancel_events, event);
+}
+
+void ProgressBox::Yield() {
+    svcSleepThread(1e+6);
+}
+
+void ProgressBox::FreeImage() {
+}
+
+} // namespace sphaira::ui
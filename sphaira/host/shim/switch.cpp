@@ -0,0 +1,610 @@
+#include <switch.h>
+#include "defines.hpp"
+#include "log.hpp"
+#include "hash_kernel.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <mutex>
+#include <filesystem>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <zlib.h>
+
+namespace {
+
+// every uevent shares this lock, see waitObjects().
+pthread_mutex_t g_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_event_cond = PTHREAD_COND_INITIALIZER;
+
+const Result Result_NotAvailable = MAKERESULT(Module_Libnx, LibnxError_NotFound);
+
+auto make_deadline(u64 timeout) -> timespec {
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000000000ULL;
+    ts.tv_nsec += timeout % 1000000000ULL;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+void* thread_entry(void* arg) {
+    auto t = static_cast<Thread*>(arg);
+    t->entry(t->arg);
+    return nullptr;
+}
+
+// the sd card is a directory on the host, set with SPHAIRA_SD.
+// without it, the sd card fails to open, same as every other native fs.
+constexpr Handle SD_SESSION = 1;
+constexpr Result FS_ERROR_PATH_NOT_FOUND = 0x202;
+constexpr Result FS_ERROR_PATH_ALREADY_EXISTS = 0x402;
+constexpr Result FS_ERROR_DIRECTORY_NOT_EMPTY = 0xB02;
+constexpr Result FS_ERROR_NOT_ENOUGH_SPACE = 0x4E02;
+const Result Result_IoError = MAKERESULT(Module_Libnx, LibnxError_IoError);
+
+struct HostDir {
+    DIR* d;
+    std::string path;
+    u32 mode;
+};
+
+std::mutex g_dir_mutex;
+std::unordered_map<u32, HostDir> g_dirs;
+u32 g_dir_id{};
+
+auto get_sd_root() -> const char* {
+    const auto root = std::getenv("SPHAIRA_SD");
+    return root && root[0] ? root : nullptr;
+}
+
+// file reads and writes can be slowed down to those of a real sd card, with
+// SPHAIRA_SD_LATENCY_US per access and SPHAIRA_SD_RATE bytes per second.
+// only the sd card is a native fs here, so every file is on the sd card.
+void sd_delay(u64 size) {
+    const auto latency = std::getenv("SPHAIRA_SD_LATENCY_US");
+    const auto rate = std::getenv("SPHAIRA_SD_RATE");
+
+    s64 ns = 0;
+    if (latency) {
+        ns += std::strtoull(latency, nullptr, 10) * 1000;
+    }
+    if (rate && std::strtoull(rate, nullptr, 10)) {
+        ns += size * 1000000000ULL / std::strtoull(rate, nullptr, 10);
+    }
+
+    if (ns) {
+        svcSleepThread(ns);
+    }
+}
+
+auto get_sd_path(const FsFileSystem* fs, const char* path, std::string& out) -> Result {
+    const auto root = get_sd_root();
+    if (!root || fs->s.session != SD_SESSION) {
+        return Result_NotAvailable;
+    }
+
+    out = root;
+    if (path[0] != '/') {
+        out += '/';
+    }
+    out += path;
+    return 0;
+}
+
+auto errno_to_result() -> Result {
+    switch (errno) {
+        case ENOENT: case ENOTDIR: return FS_ERROR_PATH_NOT_FOUND;
+        case EEXIST: return FS_ERROR_PATH_ALREADY_EXISTS;
+        case ENOTEMPTY: return FS_ERROR_DIRECTORY_NOT_EMPTY;
+        case ENOSPC: return FS_ERROR_NOT_ENOUGH_SPACE;
+        default: return Result_IoError;
+    }
+}
+
+// returns false once there are no more entries.
+bool read_dir_entry(HostDir& dir, FsDirectoryEntry& out) {
+    while (const auto e = readdir(dir.d)) {
+        if (!std::strcmp(e->d_name, ".") || !std::strcmp(e->d_name, "..")) {
+            continue;
+        }
+
+        struct stat st;
+        if (stat((dir.path + "/" + e->d_name).c_str(), &st)) {
+            continue;
+        }
+
+        const auto is_dir = S_ISDIR(st.st_mode);
+        if ((is_dir && !(dir.mode & FsDirOpenMode_ReadDirs)) || (!is_dir && !(dir.mode & FsDirOpenMode_ReadFiles))) {
+            continue;
+        }
+
+        out = {};
+        std::snprintf(out.name, sizeof(out.name), "%s", e->d_name);
+        out.type = is_dir ? FsDirEntryType_Dir : FsDirEntryType_File;
+        out.file_size = is_dir ? 0 : st.st_size;
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+extern "C" {
+
+void rmutexLock(RMutex* m) {
+    if (m->counter && pthread_equal(m->owner, pthread_self())) {
+        m->counter++;
+        return;
+    }
+
+    mutexLock(&m->lock);
+    m->owner = pthread_self();
+    m->counter = 1;
+}
+
+void rmutexUnlock(RMutex* m) {
+    if (!--m->counter) {
+        mutexUnlock(&m->lock);
+    }
+}
+
+Result condvarWaitTimeout(CondVar* c, Mutex* m, u64 timeout) {
+    const auto ts = make_deadline(timeout);
+    if (pthread_cond_timedwait(c, m, &ts) == ETIMEDOUT) {
+        return KERNELRESULT(TimedOut);
+    }
+    return 0;
+}
+
+void ueventCreate(UEvent* e, bool auto_clear) {
+    pthread_mutex_lock(&g_event_mutex);
+    e->signaled = false;
+    e->auto_clear = auto_clear;
+    pthread_mutex_unlock(&g_event_mutex);
+}
+
+void ueventSignal(UEvent* e) {
+    pthread_mutex_lock(&g_event_mutex);
+    e->signaled = true;
+    pthread_cond_broadcast(&g_event_cond);
+    pthread_mutex_unlock(&g_event_mutex);
+}
+
+void ueventClear(UEvent* e) {
+    pthread_mutex_lock(&g_event_mutex);
+    e->signaled = false;
+    pthread_mutex_unlock(&g_event_mutex);
+}
+
+Result waitObjects(s32* idx_out, const Waiter* objects, s32 num_objects, u64 timeout) {
+    const auto ts = make_deadline(timeout);
+
+    pthread_mutex_lock(&g_event_mutex);
+    Result rc = 0;
+    for (;;) {
+        s32 idx = -1;
+        for (s32 i = 0; i < num_objects; i++) {
+            if (objects[i].event->signaled) {
+                idx = i;
+                break;
+            }
+        }
+
+        if (idx >= 0) {
+            if (objects[idx].event->auto_clear) {
+                objects[idx].event->signaled = false;
+            }
+            if (idx_out) {
+                *idx_out = idx;
+            }
+            break;
+        }
+
+        if (!timeout) {
+            rc = KERNELRESULT(TimedOut);
+            break;
+        }
+
+        if (timeout == UINT64_MAX) {
+            pthread_cond_wait(&g_event_cond, &g_event_mutex);
+        } else if (pthread_cond_timedwait(&g_event_cond, &g_event_mutex, &ts) == ETIMEDOUT) {
+            rc = KERNELRESULT(TimedOut);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_event_mutex);
+
+    return rc;
+}
+
+Result waitSingle(Waiter w, u64 timeout) {
+    return waitObjects(nullptr, &w, 1, timeout);
+}
+
+Result threadCreate(Thread* t, ThreadFunc entry, void* arg, void* stack_mem, size_t stack_sz, int prio, int cpuid) {
+    *t = {};
+    t->handle = 1;
+    t->entry = entry;
+    t->arg = arg;
+    return 0;
+}
+
+Result threadStart(Thread* t) {
+    if (pthread_create(&t->pthread, nullptr, thread_entry, t)) {
+        return MAKERESULT(Module_Libnx, LibnxError_OutOfMemory);
+    }
+    t->started = true;
+    return 0;
+}
+
+Result threadWaitForExit(Thread* t) {
+    if (t->started) {
+        pthread_join(t->pthread, nullptr);
+        t->started = false;
+    }
+    return 0;
+}
+
+Result threadClose(Thread* t) {
+    if (t->started) {
+        pthread_detach(t->pthread);
+        t->started = false;
+    }
+    t->handle = 0;
+    return 0;
+}
+
+void svcSleepThread(s64 nano) {
+    if (nano <= 0) {
+        sched_yield();
+        return;
+    }
+
+    timespec ts{};
+    ts.tv_sec = nano / 1000000000LL;
+    ts.tv_nsec = nano % 1000000000LL;
+    while (nanosleep(&ts, &ts) && errno == EINTR) {
+    }
+}
+
+u64 armGetSystemTick(void) {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return armNsToTicks((u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+u32 crc32Calculate(const void* src, size_t size) {
+    return crc32CalculateWithSeed(0, src, size);
+}
+
+u32 crc32CalculateWithSeed(u32 seed, const void* src, size_t size) {
+    return ::crc32_z(seed, static_cast<const Bytef*>(src), size);
+}
+
+u32 crc32cCalculate(const void* src, size_t size) {
+    return crc32cCalculateWithSeed(0, src, size);
+}
+
+u32 crc32cCalculateWithSeed(u32 seed, const void* src, size_t size) {
+    return ~sphaira::host::kernel::GetCrc32c().update(~seed, static_cast<const u8*>(src), size);
+}
+
+AppletType appletGetAppletType(void) {
+    // set SPHAIRA_APPLET to test the applet mode limits.
+    return std::getenv("SPHAIRA_APPLET") ? AppletType_LibraryApplet : AppletType_Application;
+}
+
+FsFileSystem* fsdevGetDeviceFileSystem(const char* name) {
+    static FsFileSystem fs{};
+    fs.s.session = get_sd_root() ? SD_SESSION : 0;
+    return &fs;
+}
+
+Result fsOpenSdCardFileSystem(FsFileSystem* out) {
+    *out = *fsdevGetDeviceFileSystem("sdmc:");
+    return serviceIsActive(&out->s) ? 0 : Result_NotAvailable;
+}
+
+Result fsOpenBisFileSystem(FsFileSystem* out, FsBisPartitionId id, const char* string) { return Result_NotAvailable; }
+Result fsOpenImageDirectoryFileSystem(FsFileSystem* out, FsImageDirectoryId id) { return Result_NotAvailable; }
+Result fsOpenContentStorageFileSystem(FsFileSystem* out, FsContentStorageId id) { return Result_NotAvailable; }
+Result fsOpenGameCardFileSystem(FsFileSystem* out, const FsGameCardHandle* handle, FsGameCardPartition partition) { return Result_NotAvailable; }
+Result fsOpenSaveDataFileSystem(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr) { return Result_NotAvailable; }
+Result fsOpenReadOnlySaveDataFileSystem(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr) { return Result_NotAvailable; }
+Result fsOpenSaveDataFileSystemBySystemSaveDataId(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr) { return Result_NotAvailable; }
+Result fsOpenFileSystemWithId(FsFileSystem* out, u64 id, FsFileSystemType fsType, const char* contentPath, FsContentAttributes attr) { return Result_NotAvailable; }
+
+Result fsFsCreateFile(FsFileSystem* fs, const char* path, s64 size, u32 option) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    const auto fd = open(real.c_str(), O_WRONLY | O_CREAT | O_EXCL, DEFFILEMODE);
+    if (fd < 0) {
+        return errno_to_result();
+    }
+
+    const auto ret = ftruncate(fd, size);
+    close(fd);
+    return ret ? errno_to_result() : 0;
+}
+
+Result fsFsDeleteFile(FsFileSystem* fs, const char* path) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+    return unlink(real.c_str()) ? errno_to_result() : 0;
+}
+
+Result fsFsCreateDirectory(FsFileSystem* fs, const char* path) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+    return mkdir(real.c_str(), ACCESSPERMS) ? errno_to_result() : 0;
+}
+
+Result fsFsDeleteDirectory(FsFileSystem* fs, const char* path) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+    return rmdir(real.c_str()) ? errno_to_result() : 0;
+}
+
+Result fsFsDeleteDirectoryRecursively(FsFileSystem* fs, const char* path) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(real, ec)) {
+        return FS_ERROR_PATH_NOT_FOUND;
+    }
+
+    std::filesystem::remove_all(real, ec);
+    return ec ? Result_IoError : 0;
+}
+
+Result fsFsRenameFile(FsFileSystem* fs, const char* cur_path, const char* new_path) {
+    std::string cur, dst;
+    R_TRY(get_sd_path(fs, cur_path, cur));
+    R_TRY(get_sd_path(fs, new_path, dst));
+
+    // unlike posix, the destination must not exist.
+    if (!access(dst.c_str(), F_OK)) {
+        return FS_ERROR_PATH_ALREADY_EXISTS;
+    }
+
+    return rename(cur.c_str(), dst.c_str()) ? errno_to_result() : 0;
+}
+
+Result fsFsRenameDirectory(FsFileSystem* fs, const char* cur_path, const char* new_path) {
+    return fsFsRenameFile(fs, cur_path, new_path);
+}
+
+Result fsFsGetEntryType(FsFileSystem* fs, const char* path, FsDirEntryType* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    struct stat st;
+    if (stat(real.c_str(), &st)) {
+        return errno_to_result();
+    }
+
+    *out = S_ISDIR(st.st_mode) ? FsDirEntryType_Dir : FsDirEntryType_File;
+    return 0;
+}
+
+Result fsFsOpenFile(FsFileSystem* fs, const char* path, u32 mode, FsFile* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    const auto flags = (mode & (FsOpenMode_Write | FsOpenMode_Append)) ? O_RDWR : O_RDONLY;
+    const auto fd = open(real.c_str(), flags);
+    if (fd < 0) {
+        return errno_to_result();
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || S_ISDIR(st.st_mode)) {
+        close(fd);
+        return FS_ERROR_PATH_NOT_FOUND;
+    }
+
+    *out = {};
+    out->s.session = SD_SESSION;
+    out->s.object_id = fd;
+    return 0;
+}
+
+Result fsFsOpenDirectory(FsFileSystem* fs, const char* path, u32 mode, FsDir* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    const auto d = opendir(real.c_str());
+    if (!d) {
+        return errno_to_result();
+    }
+
+    std::scoped_lock lock{g_dir_mutex};
+    const auto id = ++g_dir_id;
+    g_dirs.emplace(id, HostDir{d, real, mode});
+
+    *out = {};
+    out->s.session = SD_SESSION;
+    out->s.object_id = id;
+    return 0;
+}
+
+Result fsFsCommit(FsFileSystem* fs) {
+    return serviceIsActive(&fs->s) ? 0 : Result_NotAvailable;
+}
+
+Result fsFsGetFreeSpace(FsFileSystem* fs, const char* path, s64* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    struct statvfs st;
+    if (statvfs(real.c_str(), &st)) {
+        return errno_to_result();
+    }
+
+    *out = s64(st.f_bavail) * st.f_frsize;
+    return 0;
+}
+
+Result fsFsGetTotalSpace(FsFileSystem* fs, const char* path, s64* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    struct statvfs st;
+    if (statvfs(real.c_str(), &st)) {
+        return errno_to_result();
+    }
+
+    *out = s64(st.f_blocks) * st.f_frsize;
+    return 0;
+}
+
+Result fsFsGetFileTimeStampRaw(FsFileSystem* fs, const char* path, FsTimeStampRaw* out) {
+    std::string real;
+    R_TRY(get_sd_path(fs, path, real));
+
+    struct stat st;
+    if (stat(real.c_str(), &st)) {
+        return errno_to_result();
+    }
+
+    *out = {};
+    out->is_valid = true;
+    out->created = st.st_ctim.tv_sec;
+    out->modified = st.st_mtim.tv_sec;
+    out->accessed = st.st_atim.tv_sec;
+    return 0;
+}
+
+void fsFsClose(FsFileSystem* fs) { }
+
+Result fsFileRead(FsFile* f, s64 off, void* buf, u64 read_size, u32 option, u64* bytes_read) {
+    R_UNLESS(serviceIsActive(&f->s), Result_NotAvailable);
+
+    sd_delay(read_size);
+    const auto ret = pread(f->s.object_id, buf, read_size, off);
+    if (ret < 0) {
+        return errno_to_result();
+    }
+
+    *bytes_read = ret;
+    return 0;
+}
+
+Result fsFileWrite(FsFile* f, s64 off, const void* buf, u64 write_size, u32 option) {
+    R_UNLESS(serviceIsActive(&f->s), Result_NotAvailable);
+
+    sd_delay(write_size);
+    for (u64 done = 0; done < write_size; ) {
+        const auto ret = pwrite(f->s.object_id, (const u8*)buf + done, write_size - done, off + done);
+        if (ret <= 0) {
+            return ret ? errno_to_result() : Result_IoError;
+        }
+        done += ret;
+    }
+
+    return 0;
+}
+
+Result fsFileSetSize(FsFile* f, s64 sz) {
+    R_UNLESS(serviceIsActive(&f->s), Result_NotAvailable);
+    return ftruncate(f->s.object_id, sz) ? errno_to_result() : 0;
+}
+
+Result fsFileGetSize(FsFile* f, s64* out) {
+    R_UNLESS(serviceIsActive(&f->s), Result_NotAvailable);
+
+    struct stat st;
+    if (fstat(f->s.object_id, &st)) {
+        return errno_to_result();
+    }
+
+    *out = st.st_size;
+    return 0;
+}
+
+void fsFileClose(FsFile* f) {
+    if (serviceIsActive(&f->s)) {
+        close(f->s.object_id);
+        *f = {};
+    }
+}
+
+Result fsDirRead(FsDir* d, s64* total_entries, size_t max_entries, FsDirectoryEntry* buf) {
+    std::scoped_lock lock{g_dir_mutex};
+    const auto it = g_dirs.find(d->s.object_id);
+    R_UNLESS(it != g_dirs.end(), Result_NotAvailable);
+
+    *total_entries = 0;
+    while (*total_entries < s64(max_entries)) {
+        FsDirectoryEntry entry;
+        if (!read_dir_entry(it->second, entry)) {
+            break;
+        }
+        buf[(*total_entries)++] = entry;
+    }
+
+    return 0;
+}
+
+Result fsDirGetEntryCount(FsDir* d, s64* count) {
+    std::scoped_lock lock{g_dir_mutex};
+    const auto it = g_dirs.find(d->s.object_id);
+    R_UNLESS(it != g_dirs.end(), Result_NotAvailable);
+
+    // counted from the start, without moving the read position.
+    HostDir dir{opendir(it->second.path.c_str()), it->second.path, it->second.mode};
+    R_UNLESS(dir.d, errno_to_result());
+    ON_SCOPE_EXIT(closedir(dir.d));
+
+    *count = 0;
+    FsDirectoryEntry entry;
+    while (read_dir_entry(dir, entry)) {
+        (*count)++;
+    }
+
+    return 0;
+}
+
+void fsDirClose(FsDir* d) {
+    std::scoped_lock lock{g_dir_mutex};
+    if (const auto it = g_dirs.find(d->s.object_id); it != g_dirs.end()) {
+        closedir(it->second.d);
+        g_dirs.erase(it);
+    }
+    *d = {};
+}
+
+// set SPHAIRA_LOG to see the log output.
+void log_write(const char* s, ...) {
+    static const bool enabled = std::getenv("SPHAIRA_LOG");
+    if (enabled) {
+        va_list v;
+        va_start(v, s);
+        std::vfprintf(stderr, s, v);
+        va_end(v);
+    }
+}
+
+void log_write_arg(const char* s, va_list* v) {
+    static const bool enabled = std::getenv("SPHAIRA_LOG");
+    if (enabled) {
+        std::vfprintf(stderr, s, *v);
+    }
+}
+
+} // extern "C"
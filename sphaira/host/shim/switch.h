@@ -0,0 +1,459 @@
+#pragma once
+
+// minimal stand-in for libnx, so that the platform independent parts of
+// sphaira can be built and tested on the host.
+// only what the host build uses is provided, sync primitives are backed by pthreads.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef __uint128_t u128;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+typedef u32 Handle;
+typedef void (*ThreadFunc)(void*);
+
+#define BIT(n) (1U<<(n))
+#define NX_PACKED __attribute__((packed))
+#define NX_INLINE __attribute__((always_inline)) static inline
+#define UINT64_MAX_NS UINT64_MAX
+
+#define R_SUCCEEDED(res) ((res)==0)
+#define R_FAILED(res) ((res)!=0)
+#define R_VALUE(res) ((res)&0x3FFFFF)
+#define R_MODULE(res) ((res)&0x1FF)
+#define R_DESCRIPTION(res) (((res)>>9)&0x1FFF)
+#define MAKERESULT(module,description) \
+    ((((module)&0x1FF)) | ((description)&0x1FFF)<<9)
+
+enum {
+    Module_Kernel = 1,
+    Module_Libnx = 345,
+};
+
+enum {
+    KernelError_InvalidHandle = 114,
+    KernelError_TimedOut = 117,
+    KernelError_Cancelled = 118,
+};
+
+#define KERNELRESULT(desc) MAKERESULT(Module_Kernel, KernelError_##desc)
+
+enum {
+    LibnxError_BadInput = 2,
+    LibnxError_OutOfMemory = 5,
+    LibnxError_NotFound = 7,
+    LibnxError_IoError = 8,
+};
+
+// sync.
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+
+typedef struct {
+    Mutex lock;
+    pthread_t owner;
+    u32 counter;
+} RMutex;
+
+typedef pthread_rwlock_t RwLock;
+
+static inline void mutexInit(Mutex* m) { pthread_mutex_init(m, NULL); }
+static inline void mutexLock(Mutex* m) { pthread_mutex_lock(m); }
+static inline bool mutexTryLock(Mutex* m) { return !pthread_mutex_trylock(m); }
+static inline void mutexUnlock(Mutex* m) { pthread_mutex_unlock(m); }
+
+void rmutexLock(RMutex* m);
+void rmutexUnlock(RMutex* m);
+
+static inline void rwlockInit(RwLock* r) { pthread_rwlock_init(r, NULL); }
+static inline void rwlockReadLock(RwLock* r) { pthread_rwlock_rdlock(r); }
+static inline void rwlockReadUnlock(RwLock* r) { pthread_rwlock_unlock(r); }
+static inline void rwlockWriteLock(RwLock* r) { pthread_rwlock_wrlock(r); }
+static inline void rwlockWriteUnlock(RwLock* r) { pthread_rwlock_unlock(r); }
+
+static inline void condvarInit(CondVar* c) { pthread_cond_init(c, NULL); }
+static inline Result condvarWait(CondVar* c, Mutex* m) { pthread_cond_wait(c, m); return 0; }
+Result condvarWaitTimeout(CondVar* c, Mutex* m, u64 timeout);
+static inline Result condvarWakeOne(CondVar* c) { pthread_cond_signal(c); return 0; }
+static inline Result condvarWakeAll(CondVar* c) { pthread_cond_broadcast(c); return 0; }
+
+// events, all waits share a single lock so that multiple events can be waited on.
+typedef struct {
+    bool signaled;
+    bool auto_clear;
+} UEvent;
+
+typedef struct {
+    Handle revent;
+    Handle wevent;
+    bool autoclear;
+} Event;
+
+typedef struct {
+    UEvent* event;
+} Waiter;
+
+void ueventCreate(UEvent* e, bool auto_clear);
+void ueventSignal(UEvent* e);
+void ueventClear(UEvent* e);
+
+static inline Waiter waiterForUEvent(UEvent* e) { Waiter w = { e }; return w; }
+Result waitObjects(s32* idx_out, const Waiter* objects, s32 num_objects, u64 timeout);
+Result waitSingle(Waiter w, u64 timeout);
+// threads are joined on close, so waiting on their handle always succeeds.
+static inline Result waitSingleHandle(Handle handle, u64 timeout) { (void)handle; (void)timeout; return 0; }
+
+#define waitMulti(idx_out, timeout, ...) ({ \
+    Waiter __objects[] = { __VA_ARGS__ }; \
+    waitObjects((idx_out), __objects, sizeof(__objects) / sizeof(Waiter), (timeout)); \
+})
+
+// threads.
+typedef struct {
+    Handle handle;
+    pthread_t pthread;
+    ThreadFunc entry;
+    void* arg;
+    bool started;
+} Thread;
+
+Result threadCreate(Thread* t, ThreadFunc entry, void* arg, void* stack_mem, size_t stack_sz, int prio, int cpuid);
+Result threadStart(Thread* t);
+Result threadWaitForExit(Thread* t);
+Result threadClose(Thread* t);
+
+#define CUR_PROCESS_HANDLE 0xFFFF8001
+#define CUR_THREAD_HANDLE 0xFFFF8000
+
+typedef enum {
+    InfoType_CoreMask = 0,
+} InfoType;
+
+static inline Result svcGetInfo(u64* out, u32 id0, Handle handle, u64 id1) { (void)id0; (void)handle; (void)id1; *out = 0xF; return 0; }
+static inline Result svcSetThreadCoreMask(Handle handle, s32 preferred_core, u32 affinity_mask) { (void)handle; (void)preferred_core; (void)affinity_mask; return 0; }
+// negative values yield, same as libnx.
+enum YieldType {
+    YieldType_WithoutCoreMigration = 0,
+    YieldType_WithCoreMigration = -1,
+    YieldType_ToAnyThread = -2,
+};
+
+void svcSleepThread(s64 nano);
+
+// time, ticks are 19.2MHz.
+u64 armGetSystemTick(void);
+static inline u64 armGetSystemTickFreq(void) { return 19200000; }
+static inline u64 armTicksToNs(u64 tick) { return (tick * 625) / 12; }
+static inline u64 armNsToTicks(u64 ns) { return (ns * 12) / 625; }
+
+// hashing.
+u32 crc32Calculate(const void* src, size_t size);
+u32 crc32CalculateWithSeed(u32 seed, const void* src, size_t size);
+u32 crc32cCalculate(const void* src, size_t size);
+u32 crc32cCalculateWithSeed(u32 seed, const void* src, size_t size);
+
+// crypto, portable implementations in crypto.cpp.
+#define SHA1_HASH_SIZE 0x14
+#define SHA256_HASH_SIZE 0x20
+
+typedef struct {
+    u32 intermediate_hash[5];
+    u8 buffer[0x40];
+    u64 bits_consumed;
+    size_t num_buffered;
+} Sha1Context;
+
+typedef struct {
+    u32 intermediate_hash[8];
+    u8 buffer[0x40];
+    u64 bits_consumed;
+    size_t num_buffered;
+} Sha256Context;
+
+void sha1ContextCreate(Sha1Context* out);
+void sha1ContextUpdate(Sha1Context* ctx, const void* src, size_t size);
+void sha1ContextGetHash(Sha1Context* ctx, void* dst);
+void sha1CalculateHash(void* dst, const void* src, size_t size);
+
+void sha256ContextCreate(Sha256Context* out);
+void sha256ContextUpdate(Sha256Context* ctx, const void* src, size_t size);
+void sha256ContextGetHash(Sha256Context* ctx, void* dst);
+void sha256CalculateHash(void* dst, const void* src, size_t size);
+
+// hid, only the types used by the ui headers, there is no input on the host.
+typedef enum {
+    HidNpadButton_A = BIT(0),
+    HidNpadButton_B = BIT(1),
+    HidNpadButton_X = BIT(2),
+    HidNpadButton_Y = BIT(3),
+    HidNpadButton_StickL = BIT(4),
+    HidNpadButton_StickR = BIT(5),
+    HidNpadButton_L = BIT(6),
+    HidNpadButton_R = BIT(7),
+    HidNpadButton_ZL = BIT(8),
+    HidNpadButton_ZR = BIT(9),
+    HidNpadButton_Plus = BIT(10),
+    HidNpadButton_Minus = BIT(11),
+    HidNpadButton_Left = BIT(12),
+    HidNpadButton_Up = BIT(13),
+    HidNpadButton_Right = BIT(14),
+    HidNpadButton_Down = BIT(15),
+    HidNpadButton_StickLLeft = BIT(16),
+    HidNpadButton_StickLUp = BIT(17),
+    HidNpadButton_StickLRight = BIT(18),
+    HidNpadButton_StickLDown = BIT(19),
+    HidNpadButton_StickRLeft = BIT(20),
+    HidNpadButton_StickRUp = BIT(21),
+    HidNpadButton_StickRRight = BIT(22),
+    HidNpadButton_StickRDown = BIT(23),
+    HidNpadButton_LeftSL = BIT(24),
+    HidNpadButton_LeftSR = BIT(25),
+    HidNpadButton_RightSL = BIT(26),
+    HidNpadButton_RightSR = BIT(27),
+
+    HidNpadButton_AnyLeft = HidNpadButton_Left | HidNpadButton_StickLLeft | HidNpadButton_StickRLeft,
+    HidNpadButton_AnyUp = HidNpadButton_Up | HidNpadButton_StickLUp | HidNpadButton_StickRUp,
+    HidNpadButton_AnyRight = HidNpadButton_Right | HidNpadButton_StickLRight | HidNpadButton_StickRRight,
+    HidNpadButton_AnyDown = HidNpadButton_Down | HidNpadButton_StickLDown | HidNpadButton_StickRDown,
+} HidNpadButton;
+
+typedef struct {
+    u64 delta_time;
+    u32 attributes;
+    u32 finger_id;
+    u32 x;
+    u32 y;
+    u32 diameter_x;
+    u32 diameter_y;
+    u32 rotation_angle;
+    u32 reserved;
+} HidTouchState;
+
+typedef enum {
+    HidKeyboardKey_None = 0,
+} HidKeyboardKey;
+
+typedef enum {
+    HidKeyboardModifier_Control = BIT(0),
+    HidKeyboardModifier_Shift = BIT(1),
+} HidKeyboardModifier;
+
+typedef struct {
+    u64 sampling_number;
+    u64 modifiers;
+    u64 keys[4];
+} HidKeyboardState;
+
+static inline size_t hidGetKeyboardStates(HidKeyboardState* states, size_t count) { (void)states; (void)count; return 0; }
+static inline bool hidKeyboardStateGetKey(const HidKeyboardState* state, HidKeyboardKey key) { (void)state; (void)key; return false; }
+
+// applet.
+typedef enum {
+    AppletType_None = -2,
+    AppletType_Default = -1,
+    AppletType_Application = 0,
+    AppletType_SystemApplet = 1,
+    AppletType_LibraryApplet = 2,
+    AppletType_OverlayApplet = 3,
+    AppletType_SystemApplication = 4,
+} AppletType;
+
+AppletType appletGetAppletType(void);
+
+// service.
+typedef struct {
+    Handle session;
+    u32 own_handle;
+    u32 object_id;
+    u16 pointer_buffer_size;
+} Service;
+
+static inline bool serviceIsActive(const Service* s) { return s->session != 0; }
+
+// fs, the sd card is a directory set with SPHAIRA_SD, see switch.cpp.
+// every other native fs doesn't exist on the host, so every call fails.
+#define FS_MAX_PATH 0x301
+
+typedef struct { Service s; } FsFileSystem;
+typedef struct { Service s; } FsFile;
+typedef struct { Service s; } FsDir;
+
+typedef enum {
+    FsDirEntryType_Dir = 0,
+    FsDirEntryType_File = 1,
+} FsDirEntryType;
+
+typedef struct {
+    char name[FS_MAX_PATH];
+    u8 pad[3];
+    s8 type;
+    u8 pad2[3];
+    s64 file_size;
+} FsDirectoryEntry;
+
+typedef struct {
+    u64 created;
+    u64 modified;
+    u64 accessed;
+    u8 is_valid;
+    u8 padding[7];
+} FsTimeStampRaw;
+
+typedef enum {
+    FsOpenMode_Read = BIT(0),
+    FsOpenMode_Write = BIT(1),
+    FsOpenMode_Append = BIT(2),
+} FsOpenMode;
+
+typedef enum {
+    FsDirOpenMode_ReadDirs = BIT(0),
+    FsDirOpenMode_ReadFiles = BIT(1),
+    FsDirOpenMode_NoFileSize = BIT(31),
+} FsDirOpenMode;
+
+typedef enum {
+    FsCreateOption_BigFile = BIT(0),
+} FsCreateOption;
+
+typedef enum {
+    FsReadOption_None = 0,
+} FsReadOption;
+
+typedef enum {
+    FsWriteOption_None = 0,
+    FsWriteOption_Flush = BIT(0),
+} FsWriteOption;
+
+typedef enum {
+    FsBisPartitionId_User = 30,
+} FsBisPartitionId;
+
+typedef enum {
+    FsImageDirectoryId_Nand = 0,
+    FsImageDirectoryId_Sd = 1,
+} FsImageDirectoryId;
+
+typedef enum {
+    FsContentStorageId_System = 0,
+    FsContentStorageId_User = 1,
+    FsContentStorageId_SdCard = 2,
+} FsContentStorageId;
+
+typedef struct {
+    u32 value;
+} FsGameCardHandle;
+
+typedef enum {
+    FsGameCardPartition_Update = 0,
+    FsGameCardPartition_Normal = 1,
+    FsGameCardPartition_Secure = 2,
+    FsGameCardPartition_Logo = 3,
+} FsGameCardPartition;
+
+typedef enum {
+    FsSaveDataSpaceId_System = 0,
+    FsSaveDataSpaceId_User = 1,
+} FsSaveDataSpaceId;
+
+typedef enum {
+    FsSaveDataType_System = 0,
+    FsSaveDataType_Account = 1,
+    FsSaveDataType_Bcat = 2,
+    FsSaveDataType_Device = 3,
+    FsSaveDataType_Temporary = 4,
+    FsSaveDataType_Cache = 5,
+    FsSaveDataType_SystemBcat = 6,
+} FsSaveDataType;
+
+typedef struct {
+    u64 application_id;
+    u128 uid;
+    u64 system_save_data_id;
+    u8 save_data_type;
+    u8 save_data_rank;
+    u16 save_data_index;
+    u32 pad_x24;
+    u64 unk_x28;
+    u64 unk_x30;
+    u64 unk_x38;
+} FsSaveDataAttribute;
+
+typedef enum {
+    FsFileSystemType_ContentControl = 3,
+    FsFileSystemType_ContentManual = 4,
+    FsFileSystemType_ContentMeta = 5,
+    FsFileSystemType_ContentData = 6,
+} FsFileSystemType;
+
+typedef enum {
+    FsContentAttributes_None = 0,
+    FsContentAttributes_All = 0xF,
+} FsContentAttributes;
+
+// ncm, only the types are needed.
+typedef struct { Service s; } NcmContentStorage;
+
+typedef struct {
+    u8 c[0x10];
+} NcmContentId;
+
+FsFileSystem* fsdevGetDeviceFileSystem(const char* name);
+// always 0 as the host doesn't track the result of stdio calls.
+static inline Result fsdevGetLastResult(void) { return 0; }
+
+Result fsOpenSdCardFileSystem(FsFileSystem* out);
+Result fsOpenBisFileSystem(FsFileSystem* out, FsBisPartitionId id, const char* string);
+Result fsOpenImageDirectoryFileSystem(FsFileSystem* out, FsImageDirectoryId id);
+Result fsOpenContentStorageFileSystem(FsFileSystem* out, FsContentStorageId id);
+Result fsOpenGameCardFileSystem(FsFileSystem* out, const FsGameCardHandle* handle, FsGameCardPartition partition);
+Result fsOpenSaveDataFileSystem(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr);
+Result fsOpenReadOnlySaveDataFileSystem(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr);
+Result fsOpenSaveDataFileSystemBySystemSaveDataId(FsFileSystem* out, FsSaveDataSpaceId save_data_space_id, const FsSaveDataAttribute* attr);
+Result fsOpenFileSystemWithId(FsFileSystem* out, u64 id, FsFileSystemType fsType, const char* contentPath, FsContentAttributes attr);
+
+Result fsFsCreateFile(FsFileSystem* fs, const char* path, s64 size, u32 option);
+Result fsFsDeleteFile(FsFileSystem* fs, const char* path);
+Result fsFsCreateDirectory(FsFileSystem* fs, const char* path);
+Result fsFsDeleteDirectory(FsFileSystem* fs, const char* path);
+Result fsFsDeleteDirectoryRecursively(FsFileSystem* fs, const char* path);
+Result fsFsRenameFile(FsFileSystem* fs, const char* cur_path, const char* new_path);
+Result fsFsRenameDirectory(FsFileSystem* fs, const char* cur_path, const char* new_path);
+Result fsFsGetEntryType(FsFileSystem* fs, const char* path, FsDirEntryType* out);
+Result fsFsOpenFile(FsFileSystem* fs, const char* path, u32 mode, FsFile* out);
+Result fsFsOpenDirectory(FsFileSystem* fs, const char* path, u32 mode, FsDir* out);
+Result fsFsCommit(FsFileSystem* fs);
+Result fsFsGetFreeSpace(FsFileSystem* fs, const char* path, s64* out);
+Result fsFsGetTotalSpace(FsFileSystem* fs, const char* path, s64* out);
+Result fsFsGetFileTimeStampRaw(FsFileSystem* fs, const char* path, FsTimeStampRaw* out);
+void fsFsClose(FsFileSystem* fs);
+
+Result fsFileRead(FsFile* f, s64 off, void* buf, u64 read_size, u32 option, u64* bytes_read);
+Result fsFileWrite(FsFile* f, s64 off, const void* buf, u64 write_size, u32 option);
+Result fsFileSetSize(FsFile* f, s64 sz);
+Result fsFileGetSize(FsFile* f, s64* out);
+void fsFileClose(FsFile* f);
+
+Result fsDirRead(FsDir* d, s64* total_entries, size_t max_entries, FsDirectoryEntry* buf);
+Result fsDirGetEntryCount(FsDir* d, s64* count);
+void fsDirClose(FsDir* d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include <sys/iosupport.h>
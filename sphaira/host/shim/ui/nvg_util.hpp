@@ -0,0 +1,3 @@
+#pragma once
+
+// host stand-in, nothing from the ui is used by the host build.
@@ -0,0 +1,53 @@
+#pragma once
+
+// runs curl::Init() for as long as the CurlSession exists, and calls the
+// callbacks of finished async transfers the same way as App::Loop().
+
+#include "download.hpp"
+#include "evman.hpp"
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace sphaira::test {
+
+struct CurlSession {
+    CurlSession() {
+        curl::Init();
+    }
+
+    ~CurlSession() {
+        curl::Exit();
+    }
+
+    // calls the callbacks of the pending events, returns the number called.
+    static auto Pump() -> u32 {
+        u32 count{};
+        for (auto& event : evman::popall()) {
+            if (auto arg = std::get_if<curl::DownloadEventData>(&event)) {
+                if (arg->callback && !arg->stoken.stop_requested()) {
+                    arg->callback(arg->result);
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    // pumps every millisecond until done() returns true, returns false on timeout.
+    static bool PumpUntil(const std::function<bool()>& done, u64 timeout_ms = 10000) {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;) {
+            Pump();
+            if (done()) {
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= end) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+} // namespace sphaira::test
@@ -0,0 +1,122 @@
+#pragma once
+
+// a PipelinedReadData backend that stands in for an nfs / smb2 connection.
+// each read takes the round trip time plus its size over the link, reads in
+// flight share the link, as they would on a real connection.
+// reads complete in Service(), on the callers thread, as libnfs and libsmb2 do.
+
+#include "utils/devoptab_common.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace sphaira::test::remote {
+
+struct Link {
+    std::chrono::microseconds rtt{};
+    // bytes per second, 0 is unlimited.
+    u64 rate{};
+};
+
+struct FakeRemote final : devoptab::common::PipelinedReadData {
+    using Clock = std::chrono::steady_clock;
+
+    FakeRemote(const std::vector<u8>& file, const Link& link, u64 block_size, u32 depth, u64 timeout_ms = DEFAULT_TIMEOUT_MS)
+    : PipelinedReadData{block_size, depth, orphans, timeout_ms}, m_file{file}, m_link{link} {}
+
+    ~FakeRemote() {
+        Drain();
+        if (inflight_on_free) {
+            *inflight_on_free = m_inflight.size();
+        }
+    }
+
+    // reads starting at or after this offset fail.
+    void FailAt(u64 off, int err = -EIO) {
+        m_fail_off = off;
+        m_fail_err = err;
+    }
+
+    // the connection stops replying, without failing.
+    void Hang(bool hang) { m_hang = hang; }
+    // replies to every read in flight, as a connection would once it recovers.
+    void Flush() {
+        while (!m_inflight.empty()) {
+            Service();
+        }
+    }
+
+    // max number of reads in flight at once.
+    auto GetMaxInflight() const -> u32 { return m_max_inflight; }
+    auto GetInflight() const -> u32 { return m_inflight.size(); }
+    auto GetReadCount() const -> u32 { return m_read_count; }
+
+    // set to the number of reads still in flight once freed.
+    u32* inflight_on_free{};
+    // owned by the device on a real connection.
+    Orphans orphans{};
+
+private:
+    struct Request {
+        Block* block;
+        u64 size;
+        Clock::time_point done;
+    };
+
+    int ReadAsync(Block* block, u64 size) override {
+        const auto now = Clock::now();
+        const auto start = std::max(now + m_link.rtt, m_link_free);
+        const auto tx = m_link.rate ? std::chrono::nanoseconds(size * 1'000'000'000ULL / m_link.rate) : std::chrono::nanoseconds{};
+        m_link_free = start + tx;
+
+        m_inflight.emplace_back(block, size, m_link_free);
+        m_max_inflight = std::max<u32>(m_max_inflight, m_inflight.size());
+        m_read_count++;
+        return 0;
+    }
+
+    int Service() override {
+        if (m_inflight.empty()) {
+            return -EIO;
+        }
+
+        if (m_hang) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return 0;
+        }
+
+        // replies arrive in order.
+        const auto req = m_inflight.front();
+        m_inflight.erase(m_inflight.begin());
+        std::this_thread::sleep_until(req.done);
+
+        const auto off = req.block->off;
+        if (off >= m_fail_off) {
+            Complete(req.block, m_fail_err);
+        } else {
+            u64 size = 0;
+            if (off < m_file.size()) {
+                size = std::min<u64>(req.size, m_file.size() - off);
+                std::memcpy(req.block->lease.data(), m_file.data() + off, size);
+            }
+            Complete(req.block, size);
+        }
+
+        return 0;
+    }
+
+private:
+    const std::vector<u8>& m_file;
+    const Link m_link;
+    std::vector<Request> m_inflight{};
+    Clock::time_point m_link_free{};
+    u64 m_fail_off{UINT64_MAX};
+    int m_fail_err{};
+    u32 m_max_inflight{};
+    u32 m_read_count{};
+    bool m_hang{};
+};
+
+} // namespace sphaira::test::remote
@@ -0,0 +1,670 @@
+#pragma once
+
+// minimal http/1.1 server on localhost for the network tests and benchmarks.
+// serves files from memory with range requests, autoindex and PROPFIND listings,
+// and accepts PUT / PATCH (sabre/dav partial update) uploads.
+// each connection can be throttled, and faults can be injected, see Options.
+
+#include <switch.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace sphaira::test::http {
+
+struct Options {
+    // bytes per second for each connection, in either direction, 0 is unlimited.
+    u64 rate{};
+    // every nth response is throttled to 1/8 of the rate, as a congested route would be, 0 never.
+    u32 slow_every{};
+    // delay before each response is sent.
+    u64 latency_ms{};
+    // if false, the range header is ignored and the whole file is sent.
+    bool ranges{true};
+    // range requests after this many are ignored, 0 never ignores them.
+    u32 ignore_range_after{};
+    // the connection is closed after this many bytes of each response body, 0 never closes.
+    u64 drop_after{};
+    // only this many responses are dropped, 0 drops every one.
+    u32 drop_count{};
+    // advertises and accepts sabre/dav partial updates.
+    bool partial_update{};
+};
+
+struct File {
+    std::vector<u8> data{};
+    std::string etag{};
+};
+
+class Server {
+public:
+    Server() = default;
+    ~Server() { Stop(); }
+
+    // binds to an unused port on localhost.
+    bool Start() {
+        m_listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listen < 0) {
+            return false;
+        }
+
+        const int one = 1;
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(m_listen, (sockaddr*)&addr, sizeof(addr)) || listen(m_listen, 64) || getsockname(m_listen, (sockaddr*)&addr, &len)) {
+            close(m_listen);
+            m_listen = -1;
+            return false;
+        }
+
+        m_port = ntohs(addr.sin_port);
+        m_accept_thread = std::thread{[this]() { AcceptLoop(); }};
+        return true;
+    }
+
+    void Stop() {
+        if (m_listen < 0) {
+            return;
+        }
+
+        shutdown(m_listen, SHUT_RDWR);
+        close(m_listen);
+        m_listen = -1;
+        m_accept_thread.join();
+
+        std::vector<std::thread> threads;
+        {
+            std::scoped_lock lock{m_mutex};
+            for (const auto fd : m_clients) {
+                shutdown(fd, SHUT_RDWR);
+            }
+            threads.swap(m_threads);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    auto Url(const std::string& path = "/") const -> std::string {
+        return "http://127.0.0.1:" + std::to_string(m_port) + path;
+    }
+
+    void SetOptions(const Options& options) {
+        std::scoped_lock lock{m_mutex};
+        m_options = options;
+    }
+
+    void AddFile(const std::string& path, std::vector<u8> data, const std::string& etag = {}) {
+        std::scoped_lock lock{m_mutex};
+        m_files[path] = File{std::move(data), etag};
+    }
+
+    void RemoveFile(const std::string& path) {
+        std::scoped_lock lock{m_mutex};
+        m_files.erase(path);
+    }
+
+    bool GetFile(const std::string& path, std::vector<u8>& out) {
+        std::scoped_lock lock{m_mutex};
+        const auto it = m_files.find(path);
+        if (it == m_files.end()) {
+            return false;
+        }
+        out = it->second.data;
+        return true;
+    }
+
+    // number of requests with the method, or every request if empty.
+    auto GetRequestCount(const std::string& method = {}) -> u32 {
+        std::scoped_lock lock{m_mutex};
+        if (method.empty()) {
+            return m_request_count;
+        }
+        const auto it = m_method_count.find(method);
+        return it == m_method_count.end() ? 0 : it->second;
+    }
+
+    // number of responses with the status code.
+    auto GetResponseCount(int code) -> u32 {
+        std::scoped_lock lock{m_status_mutex};
+        const auto it = m_status_count.find(code);
+        return it == m_status_count.end() ? 0 : it->second;
+    }
+
+    auto GetBytesSent() const -> u64 {
+        return m_bytes_sent;
+    }
+
+    // max number of connections open at once.
+    auto GetMaxConnections() const -> u32 {
+        return m_max_connections;
+    }
+
+    void ResetCounts() {
+        std::scoped_lock lock{m_mutex};
+        m_request_count = 0;
+        m_range_count = 0;
+        m_slow_count = 0;
+        m_method_count.clear();
+        std::scoped_lock status_lock{m_status_mutex};
+        m_status_count.clear();
+        m_bytes_sent = 0;
+        m_max_connections = m_connections.load();
+    }
+
+private:
+    struct Request {
+        std::string method{};
+        std::string path{};
+        std::unordered_map<std::string, std::string> headers{};
+        std::vector<u8> body{};
+
+        auto Get(const char* key) const -> std::string {
+            const auto it = headers.find(key);
+            return it == headers.end() ? std::string{} : it->second;
+        }
+    };
+
+    struct Connection {
+        int fd;
+        // the buffered data of the next request.
+        std::string buf{};
+        std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+        u64 transferred{};
+        u64 rate{};
+    };
+
+    void AcceptLoop() {
+        for (;;) {
+            const auto fd = accept(m_listen, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+
+            const int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            std::scoped_lock lock{m_mutex};
+            m_clients.emplace_back(fd);
+            m_threads.emplace_back([this, fd]() { ClientLoop(fd); });
+        }
+    }
+
+    void ClientLoop(int fd) {
+        const auto count = ++m_connections;
+        for (auto max = m_max_connections.load(); count > max && !m_max_connections.compare_exchange_weak(max, count); ) {
+        }
+
+        Connection c{fd};
+        {
+            std::scoped_lock lock{m_mutex};
+            c.rate = m_options.rate;
+        }
+
+        Request req;
+        while (ReadRequest(c, req) && HandleRequest(c, req)) {
+        }
+
+        m_connections--;
+        std::scoped_lock lock{m_mutex};
+        std::erase(m_clients, fd);
+        close(fd);
+    }
+
+    // sleeps until the connection is back under its rate.
+    void Throttle(Connection& c, u64 size) {
+        c.transferred += size;
+        if (c.rate) {
+            const auto due = c.start + std::chrono::nanoseconds(c.transferred * 1000000000ULL / c.rate);
+            std::this_thread::sleep_until(due);
+        }
+    }
+
+    bool Recv(Connection& c) {
+        char buf[1024 * 16];
+        const auto ret = recv(c.fd, buf, sizeof(buf), 0);
+        if (ret <= 0) {
+            return false;
+        }
+
+        c.buf.append(buf, ret);
+        Throttle(c, ret);
+        return true;
+    }
+
+    bool Send(Connection& c, const void* data, u64 size) {
+        // sent in small pieces so that throttling is smooth.
+        constexpr u64 PIECE_SIZE = 1024 * 16;
+        for (u64 off = 0; off < size; ) {
+            const auto ret = send(c.fd, (const u8*)data + off, std::min(size - off, PIECE_SIZE), MSG_NOSIGNAL);
+            if (ret <= 0) {
+                return false;
+            }
+
+            off += ret;
+            m_bytes_sent += ret;
+            Throttle(c, ret);
+        }
+        return true;
+    }
+
+    bool ReadLine(Connection& c, std::string& out) {
+        size_t pos;
+        while ((pos = c.buf.find("\r\n")) == std::string::npos) {
+            if (!Recv(c)) {
+                return false;
+            }
+        }
+
+        out = c.buf.substr(0, pos);
+        c.buf.erase(0, pos + 2);
+        return true;
+    }
+
+    bool ReadBody(Connection& c, u64 size, std::vector<u8>& out) {
+        while (c.buf.size() < size) {
+            if (!Recv(c)) {
+                return false;
+            }
+        }
+
+        out.insert(out.end(), c.buf.begin(), c.buf.begin() + size);
+        c.buf.erase(0, size);
+        return true;
+    }
+
+    bool ReadRequest(Connection& c, Request& req) {
+        req = {};
+
+        std::string line;
+        if (!ReadLine(c, line)) {
+            return false;
+        }
+
+        const auto sp1 = line.find(' ');
+        const auto sp2 = line.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) {
+            return false;
+        }
+        req.method = line.substr(0, sp1);
+        req.path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+        while (ReadLine(c, line) && !line.empty()) {
+            const auto colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+
+            auto key = line.substr(0, colon);
+            for (auto& ch : key) {
+                ch = std::tolower(ch);
+            }
+
+            const auto value = line.find_first_not_of(' ', colon + 1);
+            req.headers[key] = value == std::string::npos ? std::string{} : line.substr(value);
+        }
+
+        if (!line.empty()) {
+            return false;
+        }
+
+        if (req.Get("expect") == "100-continue") {
+            constexpr std::string_view reply = "HTTP/1.1 100 Continue\r\n\r\n";
+            Send(c, reply.data(), reply.size());
+        }
+
+        if (!strcasecmp(req.Get("transfer-encoding").c_str(), "chunked")) {
+            for (;;) {
+                if (!ReadLine(c, line)) {
+                    return false;
+                }
+
+                const auto size = std::strtoull(line.c_str(), nullptr, 16);
+                if (!size) {
+                    // trailers.
+                    while (ReadLine(c, line) && !line.empty()) {
+                    }
+                    return true;
+                }
+
+                if (!ReadBody(c, size, req.body) || !ReadLine(c, line)) {
+                    return false;
+                }
+            }
+        }
+
+        return ReadBody(c, std::strtoull(req.Get("content-length").c_str(), nullptr, 10), req.body);
+    }
+
+    // may be called with m_mutex locked.
+    void CountResponse(int code) {
+        std::scoped_lock lock{m_status_mutex};
+        m_status_count[code]++;
+    }
+
+    bool SendResponse(Connection& c, int code, const char* status, const std::string& headers, const std::string& body = {}, bool head = false) {
+        CountResponse(code);
+        std::string out = "HTTP/1.1 " + std::to_string(code) + " " + status + "\r\n" + headers;
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+        if (!head) {
+            out += body;
+        }
+        return Send(c, out.data(), out.size());
+    }
+
+    static auto DecodePath(const std::string& path) -> std::string {
+        std::string out;
+        for (size_t i = 0; i < path.size(); i++) {
+            if (path[i] == '?') {
+                break;
+            } else if (path[i] == '/' && out.ends_with('/')) {
+                // the mounts send "//path" if the url ends with a slash, as most servers accept it.
+                continue;
+            } else if (path[i] == '%' && i + 2 < path.size()) {
+                out += (char)std::strtol(path.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            } else {
+                out += path[i];
+            }
+        }
+        return out;
+    }
+
+    // returns the names of the entries directly under the directory, dirs end with a slash.
+    // must be called with the mutex locked.
+    auto ListDir(const std::string& dir) -> std::vector<std::string> {
+        std::vector<std::string> out;
+        for (const auto& [path, file] : m_files) {
+            if (!path.starts_with(dir) || path.size() == dir.size()) {
+                continue;
+            }
+
+            const auto name = path.substr(dir.size());
+            const auto slash = name.find('/');
+            const auto entry = slash == std::string::npos ? name : name.substr(0, slash + 1);
+            if (out.empty() || out.back() != entry) {
+                out.emplace_back(entry);
+            }
+        }
+        return out;
+    }
+
+    // must be called with the mutex locked.
+    bool IsDir(const std::string& path) {
+        const auto dir = path.ends_with('/') ? path : path + "/";
+        return dir == "/" || !ListDir(dir).empty();
+    }
+
+    bool HandleRequest(Connection& c, const Request& req) {
+        Options options;
+        u64 rate;
+        {
+            std::scoped_lock lock{m_mutex};
+            options = m_options;
+            m_request_count++;
+            m_method_count[req.method]++;
+
+            rate = options.rate;
+            if (options.slow_every && ++m_slow_count % options.slow_every == 0) {
+                rate /= 8;
+            }
+        }
+
+        if (options.latency_ms) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.latency_ms));
+        }
+
+        // the rate applies from the start of each response, so that a
+        // connection that was idle doesn't build up credit.
+        c.start = std::chrono::steady_clock::now();
+        c.transferred = 0;
+        c.rate = rate;
+
+        const auto path = DecodePath(req.path);
+        const auto keep_alive = strcasecmp(req.Get("connection").c_str(), "close");
+
+        bool ok;
+        if (req.method == "GET" || req.method == "HEAD") {
+            ok = HandleGet(c, req, path, options);
+        } else if (req.method == "PROPFIND") {
+            ok = HandlePropfind(c, req, path);
+        } else if (req.method == "OPTIONS") {
+            ok = SendResponse(c, 200, "OK", std::string{"DAV: 1, 2"} + (options.partial_update ? ", sabredav-partialupdate" : "") + "\r\nAllow: GET, HEAD, PUT, PATCH, PROPFIND, MKCOL, DELETE, MOVE\r\n");
+        } else if (req.method == "PUT") {
+            std::scoped_lock lock{m_mutex};
+            const auto created = !m_files.contains(path);
+            m_files[path] = File{req.body};
+            ok = SendResponse(c, created ? 201 : 204, created ? "Created" : "No Content", "");
+        } else if (req.method == "PATCH") {
+            ok = HandlePatch(c, req, path, options);
+        } else if (req.method == "MKCOL") {
+            std::scoped_lock lock{m_mutex};
+            m_files[path.ends_with('/') ? path + ".keep" : path + "/.keep"] = {};
+            ok = SendResponse(c, 201, "Created", "");
+        } else if (req.method == "DELETE") {
+            std::scoped_lock lock{m_mutex};
+            const auto dir = path.ends_with('/') ? path : path + "/";
+            const auto count = std::erase_if(m_files, [&](const auto& e) { return e.first == path || e.first.starts_with(dir); });
+            ok = count ? SendResponse(c, 204, "No Content", "") : SendResponse(c, 404, "Not Found", "");
+        } else if (req.method == "MOVE") {
+            ok = HandleMove(c, req, path);
+        } else {
+            ok = SendResponse(c, 405, "Method Not Allowed", "");
+        }
+
+        return ok && keep_alive;
+    }
+
+    bool HandleGet(Connection& c, const Request& req, const std::string& path, const Options& options) {
+        const auto head = req.method == "HEAD";
+        std::shared_ptr<const File> file;
+        std::string listing;
+        {
+            std::scoped_lock lock{m_mutex};
+            if (const auto it = m_files.find(path); it != m_files.end() && !path.ends_with('/')) {
+                file = std::make_shared<File>(it->second);
+            } else if (IsDir(path)) {
+                if (!path.ends_with('/')) {
+                    return SendResponse(c, 301, "Moved Permanently", "Location: " + path + "/\r\n", {}, head);
+                }
+
+                // nginx style autoindex.
+                listing = "<html>\r\n<head><title>Index of " + path + "</title></head>\r\n<body>\r\n<h1>Index of " + path + "</h1><hr><pre><a href=\"../\">../</a>\r\n";
+                for (const auto& name : ListDir(path)) {
+                    listing += "<a href=\"" + name + "\">" + name + "</a>                                   21-Oct-2015 07:28                   -\r\n";
+                }
+                listing += "</pre><hr></body>\r\n</html>\r\n";
+            }
+        }
+
+        if (!file && listing.empty()) {
+            return SendResponse(c, 404, "Not Found", "", {}, head);
+        }
+
+        if (!file) {
+            // the listing is its own etag, so that it changes whenever a file is added or removed.
+            char etag[32];
+            std::snprintf(etag, sizeof(etag), "\"%zx\"", std::hash<std::string>{}(listing));
+            if (req.Get("if-none-match") == etag) {
+                return SendResponse(c, 304, "Not Modified", std::string{"ETag: "} + etag + "\r\n", {}, true);
+            }
+            return SendResponse(c, 200, "OK", std::string{"Content-Type: text/html\r\nETag: "} + etag + "\r\n", listing, head);
+        }
+
+        std::string headers = "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nLast-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n";
+        if (!file->etag.empty()) {
+            headers += "ETag: \"" + file->etag + "\"\r\n";
+        }
+
+        const u64 size = file->data.size();
+        u64 start = 0, end = size;
+        auto range = req.Get("range");
+        bool ignore_range = !options.ranges;
+        if (!range.empty() && options.ignore_range_after) {
+            ignore_range |= ++m_range_count > options.ignore_range_after;
+        }
+
+        int code = 200;
+        if (!range.empty() && !ignore_range && range.starts_with("bytes=")) {
+            range = range.substr(6);
+            const auto dash = range.find('-');
+            start = std::strtoull(range.c_str(), nullptr, 10);
+            if (dash + 1 < range.size()) {
+                end = std::min<u64>(size, std::strtoull(range.c_str() + dash + 1, nullptr, 10) + 1);
+            }
+
+            if (start >= size || start >= end) {
+                return SendResponse(c, 416, "Range Not Satisfiable", "Content-Range: bytes */" + std::to_string(size) + "\r\n", {}, head);
+            }
+
+            code = 206;
+            headers += "Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end - 1) + "/" + std::to_string(size) + "\r\n";
+        }
+
+        CountResponse(code);
+        std::string out = "HTTP/1.1 " + std::to_string(code) + (code == 206 ? " Partial Content\r\n" : " OK\r\n") + headers;
+        out += "Content-Length: " + std::to_string(end - start) + "\r\n\r\n";
+        if (!Send(c, out.data(), out.size())) {
+            return false;
+        }
+
+        if (head) {
+            return true;
+        }
+
+        if (options.drop_after && end - start > options.drop_after && (!options.drop_count || m_drop_count++ < options.drop_count)) {
+            Send(c, file->data.data() + start, options.drop_after);
+            return false;
+        }
+
+        return Send(c, file->data.data() + start, end - start);
+    }
+
+    bool HandlePropfind(Connection& c, const Request& req, const std::string& path) {
+        std::string body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<d:multistatus xmlns:d=\"DAV:\">\n";
+        const auto add = [&body](const std::string& href, bool is_dir, u64 size) {
+            body += "<d:response><d:href>" + href + "</d:href><d:propstat><d:prop>";
+            if (is_dir) {
+                body += "<d:resourcetype><d:collection/></d:resourcetype>";
+            } else {
+                body += "<d:resourcetype/><d:getcontentlength>" + std::to_string(size) + "</d:getcontentlength>";
+            }
+            body += "<d:getlastmodified>Wed, 21 Oct 2015 07:28:00 GMT</d:getlastmodified></d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat></d:response>\n";
+        };
+
+        {
+            std::scoped_lock lock{m_mutex};
+            if (const auto it = m_files.find(path); it != m_files.end() && !path.ends_with('/')) {
+                add(path, false, it->second.data.size());
+            } else if (IsDir(path)) {
+                const auto dir = path.ends_with('/') ? path : path + "/";
+                add(dir, true, 0);
+                if (req.Get("depth") != "0") {
+                    for (const auto& name : ListDir(dir)) {
+                        if (name.ends_with('/')) {
+                            add(dir + name, true, 0);
+                        } else if (name != ".keep") {
+                            add(dir + name, false, m_files[dir + name].data.size());
+                        }
+                    }
+                }
+            } else {
+                return SendResponse(c, 404, "Not Found", "");
+            }
+        }
+
+        body += "</d:multistatus>\n";
+        return SendResponse(c, 207, "Multi-Status", "Content-Type: application/xml; charset=utf-8\r\n", body);
+    }
+
+    bool HandlePatch(Connection& c, const Request& req, const std::string& path, const Options& options) {
+        auto range = req.Get("x-update-range");
+        if (!options.partial_update || !range.starts_with("bytes=")) {
+            return SendResponse(c, 405, "Method Not Allowed", "");
+        }
+
+        range = range.substr(6);
+        const auto start = std::strtoull(range.c_str(), nullptr, 10);
+        const auto end = std::strtoull(range.c_str() + range.find('-') + 1, nullptr, 10) + 1;
+        if (end - start != req.body.size()) {
+            return SendResponse(c, 400, "Bad Request", "");
+        }
+
+        std::scoped_lock lock{m_mutex};
+        const auto it = m_files.find(path);
+        if (it == m_files.end()) {
+            return SendResponse(c, 404, "Not Found", "");
+        }
+
+        auto& data = it->second.data;
+        if (data.size() < end) {
+            data.resize(end);
+        }
+        std::memcpy(data.data() + start, req.body.data(), req.body.size());
+        return SendResponse(c, 204, "No Content", "");
+    }
+
+    bool HandleMove(Connection& c, const Request& req, const std::string& path) {
+        auto dst = req.Get("destination");
+        if (const auto host = dst.find("://"); host != std::string::npos) {
+            dst = dst.substr(dst.find('/', host + 3));
+        }
+        dst = DecodePath(dst);
+
+        std::scoped_lock lock{m_mutex};
+        const auto it = m_files.find(path);
+        if (it == m_files.end()) {
+            return SendResponse(c, 404, "Not Found", "");
+        }
+
+        const auto created = !m_files.contains(dst);
+        auto file = std::move(it->second);
+        m_files.erase(it);
+        m_files[dst] = std::move(file);
+        return SendResponse(c, created ? 201 : 204, created ? "Created" : "No Content", "");
+    }
+
+private:
+    int m_listen{-1};
+    u16 m_port{};
+    std::thread m_accept_thread{};
+
+    std::mutex m_mutex{};
+    // ordered, so that listings are sorted.
+    std::map<std::string, File> m_files{};
+    std::vector<int> m_clients{};
+    std::vector<std::thread> m_threads{};
+    Options m_options{};
+
+    u32 m_request_count{};
+    u32 m_range_count{};
+    u32 m_slow_count{};
+    std::atomic<u32> m_drop_count{};
+    std::unordered_map<std::string, u32> m_method_count{};
+    std::mutex m_status_mutex{};
+    std::unordered_map<int, u32> m_status_count{};
+    std::atomic<u64> m_bytes_sent{};
+    std::atomic<u32> m_connections{};
+    std::atomic<u32> m_max_connections{};
+};
+
+} // namespace sphaira::test::http
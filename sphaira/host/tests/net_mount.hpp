@@ -0,0 +1,129 @@
+#pragma once
+
+// mounts the network devices for the tests and benchmarks.
+// the mount configs are read from the sd card, see sd_card.hpp.
+
+#include "sd_card.hpp"
+#include "utils/devoptab.hpp"
+#include <sys/iosupport.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sphaira::test::net {
+
+using test::SdCard;
+
+using Extra = std::map<std::string, std::string>;
+
+// writes the config, then mounts every device of the type, eg "HTTP" or "WEBDAV".
+// returns the mount path of the config, eg "[HTTP] test:/".
+inline auto Mount(const SdCard& sd, const char* type, Result(*mount_all)(), const std::string& url, const Extra& extra = {}) -> fs::FsPath {
+    const auto dir = sd.Path("/config/sphaira/mount");
+    std::filesystem::create_directories(dir);
+
+    const auto ini_path = dir + "/" + type + ".ini";
+    if (auto f = std::fopen(ini_path.c_str(), "w")) {
+        std::fprintf(f, "[test]\nurl=%s\n", url.c_str());
+        for (const auto& [key, value] : extra) {
+            std::fprintf(f, "%s=%s\n", key.c_str(), value.c_str());
+        }
+        std::fclose(f);
+    }
+
+    fs::FsPath mount{};
+    if (R_SUCCEEDED(mount_all())) {
+        std::snprintf(mount, sizeof(mount), "[%s] test:/", type);
+    }
+    return mount;
+}
+
+// calls into the devoptab of the mount, as newlib would.
+struct Device {
+    explicit Device(const fs::FsPath& _mount) : mount{_mount}, devoptab{GetDeviceOpTab(_mount)} {
+        if (devoptab) {
+            r.deviceData = devoptab->deviceData;
+        }
+    }
+
+    ~Device() {
+        devoptab::UmountNeworkDevice(mount);
+    }
+
+    auto Path(const std::string& path) const -> std::string {
+        // the mount ends with a slash.
+        return mount.s + (path.starts_with('/') ? path.substr(1) : path);
+    }
+
+    // reads size bytes at off, returns false on error or a short read.
+    bool Read(const std::string& path, s64 off, std::vector<u8>& out, u64 chunk_size = 1024 * 64) {
+        std::vector<u8> file(devoptab->structSize);
+        if (devoptab->open_r(&r, file.data(), Path(path).c_str(), O_RDONLY, 0)) {
+            return false;
+        }
+
+        bool ok = devoptab->seek_r(&r, file.data(), off, SEEK_SET) == off;
+        for (u64 done = 0; ok && done < out.size(); ) {
+            const auto ret = devoptab->read_r(&r, file.data(), (char*)out.data() + done, std::min(chunk_size, out.size() - done));
+            ok = ret > 0;
+            done += ok ? ret : 0;
+        }
+
+        devoptab->close_r(&r, file.data());
+        return ok;
+    }
+
+    bool Write(const std::string& path, const std::vector<u8>& data, u64 chunk_size = 1024 * 64) {
+        std::vector<u8> file(devoptab->structSize);
+        if (devoptab->open_r(&r, file.data(), Path(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0)) {
+            return false;
+        }
+
+        bool ok = true;
+        for (u64 done = 0; ok && done < data.size(); ) {
+            const auto ret = devoptab->write_r(&r, file.data(), (const char*)data.data() + done, std::min(chunk_size, data.size() - done));
+            ok = ret > 0;
+            done += ok ? ret : 0;
+        }
+
+        return !devoptab->close_r(&r, file.data()) && ok;
+    }
+
+    bool Stat(const std::string& path, struct stat& st) {
+        return !devoptab->stat_r(&r, Path(path).c_str(), &st);
+    }
+
+    // returns the names of the entries in the dir, false on error.
+    bool List(const std::string& path, std::vector<std::string>& out) {
+        out.clear();
+        std::vector<u8> dir(devoptab->dirStateSize);
+        DIR_ITER iter{.device = 0, .dirStruct = dir.data()};
+        if (!devoptab->diropen_r(&r, &iter, Path(path).c_str())) {
+            return false;
+        }
+
+        char name[NAME_MAX];
+        struct stat st;
+        while (!devoptab->dirnext_r(&r, &iter, name, &st)) {
+            out.emplace_back(name);
+        }
+
+        devoptab->dirclose_r(&r, &iter);
+        return true;
+    }
+
+    bool Unlink(const std::string& path) {
+        return !devoptab->unlink_r(&r, Path(path).c_str());
+    }
+
+    fs::FsPath mount;
+    const devoptab_t* devoptab;
+    struct _reent r{};
+};
+
+} // namespace sphaira::test::net
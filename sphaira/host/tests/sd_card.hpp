@@ -0,0 +1,45 @@
+#pragma once
+
+// the sd card is a temp dir, set as SPHAIRA_SD for as long as the SdCard
+// exists, see shim/switch.cpp.
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+namespace sphaira::test {
+
+// the host disk is much faster than a real sd card, so file access can be
+// slowed down to a latency per read / write and a rate in bytes per second.
+struct SdLink {
+    unsigned latency_us{};
+    unsigned long long rate{};
+};
+
+struct SdCard {
+    SdCard(const SdLink& link = {}) {
+        std::snprintf(path, sizeof(path), "/tmp/sphaira_test_sd_XXXXXX");
+        mkdtemp(path);
+        setenv("SPHAIRA_SD", path, 1);
+        setenv("SPHAIRA_SD_LATENCY_US", std::to_string(link.latency_us).c_str(), 1);
+        setenv("SPHAIRA_SD_RATE", std::to_string(link.rate).c_str(), 1);
+    }
+
+    ~SdCard() {
+        unsetenv("SPHAIRA_SD");
+        unsetenv("SPHAIRA_SD_LATENCY_US");
+        unsetenv("SPHAIRA_SD_RATE");
+        std::filesystem::remove_all(path);
+    }
+
+    // host path of a path on the sd card.
+    auto Path(const std::string& sd_path) const -> std::string {
+        return path + sd_path;
+    }
+
+    char path[PATH_MAX];
+};
+
+} // namespace sphaira::test
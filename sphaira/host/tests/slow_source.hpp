@@ -0,0 +1,75 @@
+#pragma once
+
+// a yati source that serves a buffer in memory, standing in for a file on
+// the sd card or a usb drive.
+// each read costs a fixed latency plus its size over the link, so that the
+// number and size of reads made by a cache show up in the time taken.
+
+#include "yati/source/base.hpp"
+#include "defines.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace sphaira::test::source {
+
+struct Link {
+    std::chrono::microseconds latency{};
+    // bytes per second, 0 is unlimited.
+    u64 rate{};
+};
+
+struct SlowSource final : yati::source::Base {
+    SlowSource(const std::vector<u8>& data, const Link& link = {})
+    : m_data{data}, m_link{link} {}
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        m_read_count++;
+        // not thread safe, the same as most sources.
+        if (m_busy.exchange(true)) {
+            m_overlapped = true;
+        }
+
+        if ((u64)(off + size) > m_fail_off) {
+            m_busy = false;
+            R_THROW(0x1);
+        }
+
+        size = std::clamp<s64>((s64)m_data.size() - off, 0, size);
+        auto wait = m_link.latency;
+        if (m_link.rate) {
+            wait += std::chrono::microseconds(size * 1'000'000ULL / m_link.rate);
+        }
+        if (wait.count()) {
+            std::this_thread::sleep_for(wait);
+        }
+
+        std::memcpy(buf, m_data.data() + off, size);
+        m_bytes_read += size;
+        *bytes_read = size;
+        m_busy = false;
+        R_SUCCEED();
+    }
+
+    // reads that reach this offset fail.
+    void FailAt(u64 off) { m_fail_off = off; }
+
+    auto GetReadCount() const -> u64 { return m_read_count; }
+    auto GetBytesRead() const -> u64 { return m_bytes_read; }
+    // set if a read was made whilst another was still running.
+    auto Overlapped() const -> bool { return m_overlapped; }
+
+private:
+    const std::vector<u8>& m_data;
+    const Link m_link;
+    std::atomic<u64> m_fail_off{UINT64_MAX};
+    std::atomic<u64> m_read_count{};
+    std::atomic<u64> m_bytes_read{};
+    std::atomic_bool m_busy{};
+    std::atomic_bool m_overlapped{};
+};
+
+} // namespace sphaira::test::source
@@ -0,0 +1,70 @@
+#pragma once
+
+// minimal test helpers, each test is its own executable registered with ctest.
+// a failed check logs the location and marks the test as failed, the test keeps running.
+
+#include "defines.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <functional>
+
+namespace sphaira::test {
+
+struct Case {
+    const char* name;
+    std::function<void()> func;
+};
+
+inline auto GetCases() -> std::vector<Case>& {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+inline auto GetFailCount() -> int& {
+    static int count;
+    return count;
+}
+
+struct Register {
+    Register(const char* name, std::function<void()> func) {
+        GetCases().emplace_back(name, func);
+    }
+};
+
+// runs every registered case, returns non-zero if any check failed.
+inline auto Run() -> int {
+    for (const auto& e : GetCases()) {
+        const auto failed = GetFailCount();
+        e.func();
+        std::printf("[%s] %s\n", failed == GetFailCount() ? " OK " : "FAIL", e.name);
+    }
+
+    return GetFailCount() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace sphaira::test
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const sphaira::test::Register CONCATENATE(name, _register){#name, name}; \
+    static void name()
+
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+        sphaira::test::GetFailCount()++; \
+    } \
+} while (0)
+
+#define CHECK_RC(r) do { \
+    if (const auto _rc = (r); R_FAILED(_rc)) { \
+        std::printf("%s:%d: %s failed: 0x%X\n", __FILE__, __LINE__, #r, _rc); \
+        sphaira::test::GetFailCount()++; \
+    } \
+} while (0)
+
+#define TEST_MAIN() \
+    int main() { \
+        return sphaira::test::Run(); \
+    }
@@ -0,0 +1,135 @@
+#include "test.hpp"
+#include "utils/buffer_pool.hpp"
+#include <bit>
+
+// utils::pool must reuse returned buffers of the same size class, keep
+// ownership with the lease when moved, and free everything cached on Trim(),
+// or once the last lease is returned without a hold.
+// the pool is global, so every case starts by trimming it.
+
+namespace sphaira {
+namespace {
+
+using namespace utils;
+
+TEST_CASE(SizesAreRoundedAndAligned) {
+    pool::Trim();
+
+    for (const u64 size : {1ULL, 0x1000ULL, 0x1001ULL, 1024ULL * 1024 * 3}) {
+        auto lease = pool::Acquire(size);
+        CHECK(lease);
+        CHECK(lease.size() >= size);
+        CHECK(lease.size() == std::bit_ceil(std::max<u64>(size, pool::ALIGN)));
+        CHECK(((uintptr_t)lease.data() & (pool::ALIGN - 1)) == 0);
+    }
+}
+
+TEST_CASE(ReturnedBuffersAreReused) {
+    pool::Trim();
+    pool::Hold hold{};
+    const auto before = pool::GetStats();
+
+    u8* first{};
+    {
+        auto lease = pool::Acquire(1024 * 1024);
+        first = lease.data();
+    }
+
+    CHECK(pool::GetStats().cached == before.cached + 1024 * 1024);
+
+    // same size class, so it should get the same buffer back.
+    auto lease = pool::Acquire(1024 * 1024 - 100);
+    CHECK(lease.data() == first);
+
+    const auto after = pool::GetStats();
+    CHECK(after.allocs == before.allocs + 1);
+    CHECK(after.reuses == before.reuses + 1);
+    CHECK(after.in_use == before.in_use + 1024 * 1024);
+}
+
+TEST_CASE(MovePassesOwnership) {
+    pool::Trim();
+    pool::Hold hold{};
+    const auto before = pool::GetStats();
+
+    auto a = pool::Acquire(0x2000);
+    const auto data = a.data();
+
+    auto b = std::move(a);
+    CHECK(!a);
+    CHECK(b.data() == data);
+
+    // moving over a lease returns its old buffer to the pool.
+    auto c = pool::Acquire(0x4000);
+    c = std::move(b);
+    CHECK(c.data() == data);
+    CHECK(pool::GetStats().in_use == before.in_use + 0x2000);
+    CHECK(pool::GetStats().cached == before.cached + 0x4000);
+
+    c.Release();
+    CHECK(!c);
+    CHECK(pool::GetStats().in_use == before.in_use);
+}
+
+TEST_CASE(TrimFreesCachedBuffers) {
+    pool::Trim();
+    pool::Hold hold{};
+
+    {
+        auto a = pool::Acquire(1024 * 1024);
+        auto b = pool::Acquire(1024 * 1024 * 2);
+    }
+
+    CHECK(pool::GetStats().cached == 1024 * 1024 * 3);
+
+    // leased buffers are not touched.
+    auto held = pool::Acquire(0x1000);
+    pool::Trim();
+    CHECK(pool::GetStats().cached == 0);
+    CHECK(pool::GetStats().in_use == 0x1000);
+    CHECK(held);
+
+    // the next lease of that size needs a new allocation.
+    const auto allocs = pool::GetStats().allocs;
+    auto lease = pool::Acquire(1024 * 1024);
+    CHECK(pool::GetStats().allocs == allocs + 1);
+}
+
+TEST_CASE(LastReleaseTrimsWithoutHold) {
+    pool::Trim();
+
+    {
+        auto a = pool::Acquire(1024 * 1024);
+        {
+            // other leases are still out, so this is kept for reuse.
+            auto b = pool::Acquire(1024 * 1024 * 2);
+        }
+        CHECK(pool::GetStats().cached == 1024 * 1024 * 2);
+    }
+
+    CHECK(pool::GetStats().in_use == 0);
+    CHECK(pool::GetStats().cached == 0);
+}
+
+TEST_CASE(DroppingTheHoldTrims) {
+    pool::Trim();
+
+    {
+        pool::Hold hold{};
+        pool::Acquire(1024 * 1024);
+        CHECK(pool::GetStats().cached == 1024 * 1024);
+
+        {
+            // nested holds keep the cache.
+            pool::Hold inner{};
+        }
+        CHECK(pool::GetStats().cached == 1024 * 1024);
+    }
+
+    CHECK(pool::GetStats().cached == 0);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,109 @@
+#include "test.hpp"
+#include "utils/devoptab_common.hpp"
+#include "utils/devoptab.hpp"
+#include <sys/iosupport.h>
+#include <fcntl.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// thread safe devices aren't locked for each request, but Mount() must still
+// only ever run on one thread at a time, as the curl devices aren't safe to
+// mount concurrently.
+
+namespace sphaira {
+namespace {
+
+using namespace devoptab;
+
+std::atomic<u32> g_in_mount{};
+std::atomic<u32> g_mount_count{};
+std::atomic<bool> g_overlapped{};
+
+struct FakeDevice final : common::MountDevice {
+    using MountDevice::MountDevice;
+
+    bool IsThreadSafe() const override { return true; }
+
+    // same pattern as the curl devices, a plain flag checked on entry.
+    bool Mount() override {
+        if (m_mounted) {
+            return true;
+        }
+
+        if (++g_in_mount > 1) {
+            g_overlapped = true;
+        }
+
+        // widen the window so that a race is all but certain.
+        svcSleepThread(2'000'000);
+        g_mount_count++;
+        g_in_mount--;
+        return m_mounted = true;
+    }
+
+    int devoptab_open(void *fileStruct, const char *path, int flags, int mode) override {
+        return 0;
+    }
+
+    int devoptab_close(void *fd) override {
+        return 0;
+    }
+
+private:
+    bool m_mounted{};
+};
+
+TEST_CASE(ConcurrentOpensMountOnce) {
+    constexpr u32 THREADS = 8;
+
+    for (u32 i = 0; i < 20; i++) {
+        g_mount_count = 0;
+
+        fs::FsPath mount{};
+        CHECK(common::MountReadOnlyIndexDevice([](const common::MountConfig& config) {
+            return std::make_unique<FakeDevice>(config);
+        }, sizeof(int), sizeof(int), "stress", mount));
+
+        const auto devoptab = GetDeviceOpTab(mount);
+        CHECK(devoptab);
+
+        char path[PATH_MAX]{};
+        std::snprintf(path, sizeof(path), "%sfile", mount.s);
+
+        std::atomic<bool> start{};
+        std::atomic<u32> opened{};
+        std::vector<std::thread> threads;
+        for (u32 t = 0; t < THREADS; t++) {
+            threads.emplace_back([&]() {
+                while (!start) {
+                    std::this_thread::yield();
+                }
+
+                struct _reent r{};
+                r.deviceData = devoptab->deviceData;
+                void* file[2]{};
+                if (!devoptab->open_r(&r, file, path, O_RDONLY, 0)) {
+                    opened++;
+                    devoptab->close_r(&r, file);
+                }
+            });
+        }
+
+        start = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        CHECK(opened == THREADS);
+        CHECK(g_mount_count == 1);
+        UmountNeworkDevice(mount);
+    }
+
+    CHECK(!g_overlapped);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,248 @@
+#include "test.hpp"
+#include "http_server.hpp"
+#include "curl_session.hpp"
+#include "sd_card.hpp"
+#include <deque>
+#include <fstream>
+
+// async transfers run on a single curl multi handle, see TransferQueue.
+// every transfer must complete with its own data, a host must never get more
+// than 6 connections, high priority transfers are started first, and a
+// cancelled transfer must free its slot without its callback being called.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+auto FilePath(u32 i) -> std::string {
+    return "/icons/" + std::to_string(i) + ".jpg";
+}
+
+// adds count files to the server, each a different size.
+auto AddFiles(http::Server& server, u32 count, u64 size = 1024 * 8) -> std::vector<std::vector<u8>> {
+    std::vector<std::vector<u8>> files;
+    for (u32 i = 0; i < count; i++) {
+        files.emplace_back(MakeInput(size + i * 13, i));
+        server.AddFile(FilePath(i), files.back());
+    }
+    return files;
+}
+
+// queues a download to memory, done is set once its callback has been called.
+void Get(http::Server& server, u32 i, bool& done, std::vector<u8>* out = nullptr, curl::Priority prio = curl::Priority::Normal, curl::StopToken token = {}) {
+    curl::Api().ToMemoryAsync(
+        curl::Url{server.Url(FilePath(i))},
+        curl::Priority{prio},
+        curl::StopToken{token},
+        curl::OnComplete{[&done, out](auto& result) {
+            if (out && result.success && result.code == 200) {
+                *out = result.data;
+            }
+            done = true;
+        }}
+    );
+}
+
+bool AllDone(const std::deque<bool>& done) {
+    return std::ranges::all_of(done, [](auto e) { return e; });
+}
+
+TEST_CASE(CompletesEveryTransfer) {
+    http::Server server;
+    CHECK(server.Start());
+    const auto files = AddFiles(server, 200);
+
+    CurlSession session;
+    std::vector<std::vector<u8>> out(files.size());
+    std::deque<bool> done(files.size());
+    for (u32 i = 0; i < files.size(); i++) {
+        Get(server, i, done[i], &out[i]);
+    }
+
+    CHECK(session.PumpUntil([&]() { return AllDone(done); }));
+    CHECK(out == files);
+}
+
+TEST_CASE(DownloadsToFile) {
+    SdCard sd;
+    http::Server server;
+    CHECK(server.Start());
+    const auto files = AddFiles(server, 20, 1024 * 200);
+
+    CurlSession session;
+    u32 done{}, ok{};
+    for (u32 i = 0; i < files.size(); i++) {
+        curl::Api().ToFileAsync(
+            curl::Url{server.Url(FilePath(i))},
+            fs::FsPath{"/switch/sphaira/cache/test/" + std::to_string(i)},
+            curl::StopToken{},
+            curl::OnComplete{[&done, &ok](auto& result) {
+                ok += result.success && result.code == 200;
+                done++;
+            }}
+        );
+    }
+
+    CHECK(session.PumpUntil([&]() { return done == files.size(); }));
+    CHECK(ok == files.size());
+    for (u32 i = 0; i < files.size(); i++) {
+        std::ifstream f{sd.Path("/switch/sphaira/cache/test/" + std::to_string(i)), std::ios::binary};
+        const std::vector<u8> data{std::istreambuf_iterator<char>{f}, {}};
+        CHECK(data == files[i]);
+    }
+}
+
+TEST_CASE(LimitsConnectionsPerHost) {
+    http::Server server;
+    server.SetOptions({.latency_ms = 20});
+    CHECK(server.Start());
+    const auto files = AddFiles(server, 60);
+
+    CurlSession session;
+    std::deque<bool> done(files.size());
+    for (u32 i = 0; i < files.size(); i++) {
+        Get(server, i, done[i]);
+    }
+
+    CHECK(session.PumpUntil([&]() { return AllDone(done); }));
+    CHECK(server.GetMaxConnections() > 1);
+    CHECK(server.GetMaxConnections() <= 6);
+    // connections are reused, rather than opened per transfer.
+    CHECK(server.GetRequestCount() == files.size());
+}
+
+TEST_CASE(HostsAreLimitedSeparately) {
+    http::Server servers[3];
+    for (auto& server : servers) {
+        server.SetOptions({.latency_ms = 50});
+        CHECK(server.Start());
+        AddFiles(server, 20);
+    }
+
+    CurlSession session;
+    std::deque<bool> done(20 * std::size(servers));
+    for (u32 i = 0; i < 20; i++) {
+        for (u32 s = 0; s < std::size(servers); s++) {
+            Get(servers[s], i, done[i * std::size(servers) + s]);
+        }
+    }
+
+    CHECK(session.PumpUntil([&]() { return AllDone(done); }));
+    u32 total{};
+    for (auto& server : servers) {
+        CHECK(server.GetMaxConnections() <= 6);
+        total += server.GetMaxConnections();
+    }
+    // a busy host doesn't stop the others from being used.
+    CHECK(total > 6);
+}
+
+TEST_CASE(HighPriorityStartsFirst) {
+    http::Server server;
+    server.SetOptions({.latency_ms = 100});
+    CHECK(server.Start());
+    AddFiles(server, 13);
+
+    CurlSession session;
+    std::deque<bool> done(13);
+    std::vector<u32> order;
+    const auto get = [&](u32 i, curl::Priority prio) {
+        curl::Api().ToMemoryAsync(
+            curl::Url{server.Url(FilePath(i))},
+            curl::Priority{prio},
+            curl::StopToken{},
+            curl::OnComplete{[&, i](auto& result) {
+                order.emplace_back(i);
+                done[i] = true;
+            }}
+        );
+    };
+
+    // fills the host's connections, the rest are queued behind them.
+    for (u32 i = 0; i < 6; i++) {
+        get(i, curl::Priority::Normal);
+    }
+    CHECK(session.PumpUntil([&]() { return server.GetRequestCount() == 6; }));
+
+    for (u32 i = 6; i < 12; i++) {
+        get(i, curl::Priority::Normal);
+    }
+    get(12, curl::Priority::High);
+
+    CHECK(session.PumpUntil([&]() { return AllDone(done); }));
+    // 12 takes the place of 11, which is started once a connection is free.
+    CHECK(order.size() == 13);
+    CHECK(order.back() == 11);
+    CHECK(std::ranges::find(order, 12) < std::ranges::find(order, 11));
+}
+
+TEST_CASE(CancelFreesActiveTransfers) {
+    http::Server server;
+    // each file takes 16 seconds at this rate.
+    server.SetOptions({.rate = 1024 * 64});
+    CHECK(server.Start());
+    AddFiles(server, 6, 1024 * 1024);
+    server.AddFile("/small", MakeInput(100, 1));
+
+    CurlSession session;
+    std::stop_source stop;
+    bool cancelled_done[6]{};
+    for (u32 i = 0; i < 6; i++) {
+        Get(server, i, cancelled_done[i], nullptr, curl::Priority::Normal, stop.get_token());
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop.request_stop();
+
+    bool done{};
+    const auto start = std::chrono::steady_clock::now();
+    curl::Api().ToMemoryAsync(
+        curl::Url{server.Url("/small")},
+        curl::StopToken{},
+        curl::OnComplete{[&done](auto& result) { done = result.success; }}
+    );
+
+    CHECK(session.PumpUntil([&]() { return done; }, 5000));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+
+    session.PumpUntil([]() { return false; }, 100);
+    CHECK(std::ranges::none_of(cancelled_done, [](auto e) { return e; }));
+}
+
+TEST_CASE(CancelledWhilePendingIsNotSent) {
+    http::Server server;
+    server.SetOptions({.latency_ms = 100});
+    CHECK(server.Start());
+    AddFiles(server, 12);
+
+    CurlSession session;
+    std::deque<bool> done(12);
+    std::stop_source stop;
+    for (u32 i = 0; i < 6; i++) {
+        Get(server, i, done[i]);
+    }
+    for (u32 i = 6; i < 11; i++) {
+        Get(server, i, done[i], nullptr, curl::Priority::Normal, stop.get_token());
+    }
+    Get(server, 11, done[11]);
+    stop.request_stop();
+
+    CHECK(session.PumpUntil([&]() { return done[11] && std::all_of(done.begin(), done.begin() + 6, [](auto e) { return e; }); }));
+    CHECK(std::none_of(done.begin() + 6, done.begin() + 11, [](auto e) { return e; }));
+    CHECK(server.GetRequestCount() == 7);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
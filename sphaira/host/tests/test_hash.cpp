@@ -0,0 +1,176 @@
+#include "test.hpp"
+#include "hasher.hpp"
+#include "hash_kernel.hpp"
+#include <cstring>
+#include <string>
+
+// checks the host crypto shim against known vectors, then hash::Hash on top of it.
+// every crc32c / sha256 kernel that the cpu supports must match the portable one.
+
+namespace sphaira {
+namespace {
+
+constexpr std::string_view ABC = "abc";
+constexpr std::string_view CHECK_STR = "123456789";
+
+auto AsSpan(std::string_view s) {
+    return std::span{reinterpret_cast<const u8*>(s.data()), s.size()};
+}
+
+auto HashStr(hash::Type type, std::span<const u8> data) {
+    ui::ProgressBox pbox{0, "", "", nullptr};
+    std::string out;
+    CHECK_RC(hash::Hash(&pbox, type, data, out));
+    return out;
+}
+
+struct MemSource final : hash::BaseSource {
+    MemSource(std::span<const u8> data) : m_data{data} {}
+
+    Result Size(s64* out) override {
+        *out = m_data.size();
+        R_SUCCEED();
+    }
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        size = std::min<s64>(size, m_data.size() - off);
+        std::memcpy(buf, m_data.data() + off, size);
+        *bytes_read = size;
+        R_SUCCEED();
+    }
+
+private:
+    const std::span<const u8> m_data;
+};
+
+TEST_CASE(KnownVectors) {
+    CHECK(HashStr(hash::Type::Md5, AsSpan(ABC)) == "900150983cd24fb0d6963f7d28e17f72");
+    CHECK(HashStr(hash::Type::Sha1, AsSpan(ABC)) == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    CHECK(HashStr(hash::Type::Sha256, AsSpan(ABC)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(HashStr(hash::Type::Crc32, AsSpan(CHECK_STR)) == "cbf43926");
+}
+
+TEST_CASE(Crc32c) {
+    CHECK(crc32cCalculate(CHECK_STR.data(), CHECK_STR.size()) == 0xE3069283);
+
+    // split updates must match a single update.
+    const auto whole = crc32cCalculate(CHECK_STR.data(), CHECK_STR.size());
+    const auto part = crc32cCalculateWithSeed(crc32cCalculate(CHECK_STR.data(), 4), CHECK_STR.data() + 4, CHECK_STR.size() - 4);
+    CHECK(whole == part);
+}
+
+TEST_CASE(LargeSplitUpdate) {
+    // larger than the transfer buffer, so that the hash is updated in multiple chunks.
+    std::vector<u8> data(1024 * 1024 * 9 + 123);
+    for (u64 i = 0; i < data.size(); i++) {
+        data[i] = i * 31 + (i >> 11);
+    }
+
+    u8 expected[SHA256_HASH_SIZE];
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
+    for (u64 off = 0; off < data.size(); off += 1000) {
+        sha256ContextUpdate(&ctx, data.data() + off, std::min<u64>(1000, data.size() - off));
+    }
+    sha256ContextGetHash(&ctx, expected);
+
+    u8 single[SHA256_HASH_SIZE];
+    sha256CalculateHash(single, data.data(), data.size());
+    CHECK(!std::memcmp(single, expected, sizeof(single)));
+
+    std::string hex;
+    for (auto c : single) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", c);
+        hex += buf;
+    }
+    CHECK(HashStr(hash::Type::Sha256, data) == hex);
+}
+
+TEST_CASE(MultiMatchesSingle) {
+    std::vector<u8> data(1024 * 1024 * 5 + 7);
+    for (u64 i = 0; i < data.size(); i++) {
+        data[i] = i ^ (i >> 8);
+    }
+
+    const hash::Type types[]{hash::Type::Crc32, hash::Type::Md5, hash::Type::Sha1, hash::Type::Sha256};
+
+    ui::ProgressBox pbox{0, "", "", nullptr};
+    MemSource source{data};
+    std::vector<std::string> out;
+    CHECK_RC(hash::Hash(&pbox, types, &source, out));
+    CHECK(out.size() == std::size(types));
+
+    for (u32 i = 0; i < out.size() && i < std::size(types); i++) {
+        CHECK(out[i] == HashStr(types[i], data));
+    }
+}
+
+auto MakeData(u64 size) {
+    std::vector<u8> data(size);
+    u64 seed = size;
+    for (auto& c : data) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        c = seed >> 56;
+    }
+    return data;
+}
+
+TEST_CASE(Crc32cKernelsMatch) {
+    const auto kernels = host::kernel::GetCrc32cKernels();
+    const auto& portable = kernels[0];
+    CHECK(~portable.update(~0U, (const u8*)CHECK_STR.data(), CHECK_STR.size()) == 0xE3069283);
+
+    const auto data = MakeData(1024 * 1024 + 64);
+    for (const auto& kernel : kernels) {
+        if (!kernel.supported()) {
+            std::printf("skipping unsupported crc32c kernel: %s\n", kernel.name);
+            continue;
+        }
+
+        // every alignment and short sizes, then a large buffer.
+        bool match = true;
+        for (u32 off = 0; off < 16; off++) {
+            for (u32 size = 0; size < 300; size++) {
+                match &= kernel.update(off * size, data.data() + off, size) == portable.update(off * size, data.data() + off, size);
+            }
+        }
+        match &= kernel.update(~0U, data.data() + 3, data.size() - 3) == portable.update(~0U, data.data() + 3, data.size() - 3);
+        CHECK(match);
+    }
+}
+
+TEST_CASE(Sha256KernelsMatch) {
+    const auto kernels = host::kernel::GetSha256Kernels();
+    const auto data = MakeData(64 * 300 + 1);
+
+    for (const auto& kernel : kernels) {
+        if (!kernel.supported()) {
+            std::printf("skipping unsupported sha256 kernel: %s\n", kernel.name);
+            continue;
+        }
+
+        // "abc", padded to a single block.
+        u8 block[64]{'a', 'b', 'c', 0x80};
+        block[63] = 24;
+        u32 h[8]{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        kernel.blocks(h, block, 1);
+        CHECK(h[0] == 0xba7816bf && h[7] == 0xf20015ad);
+
+        // unaligned, and runs of blocks.
+        bool match = true;
+        for (u32 count = 1; count < 300; count += 7) {
+            u32 a[8]{1, 2, 3, 4, 5, 6, 7, 8};
+            u32 b[8]{1, 2, 3, 4, 5, 6, 7, 8};
+            kernel.blocks(a, data.data() + 1, count);
+            kernels[0].blocks(b, data.data() + 1, count);
+            match &= !std::memcmp(a, b, sizeof(a));
+        }
+        CHECK(match);
+    }
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,146 @@
+#include "test.hpp"
+#include "http_server.hpp"
+#include "net_mount.hpp"
+#include "utils/devoptab_common.hpp"
+
+// reads from the http mount are split into range requests over several
+// connections, they must return the same data as a single stream for any
+// access pattern, and fall back to a single stream if ranges aren't supported.
+// failed ranges are requested again, and small files are never split.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+struct Fixture {
+    Fixture(const http::Options& options, const net::Extra& extra) : data{MakeInput(1024 * 1024 * 5 + 123, 1)} {
+        server.SetOptions(options);
+        server.AddFile("/dir/file.bin", data);
+        server.Start();
+        mount = net::Mount(sd, "HTTP", devoptab::MountHttpAll, server.Url(), extra);
+    }
+
+    bool ReadAll(net::Device& device, u64 chunk_size) {
+        std::vector<u8> out(data.size());
+        return device.Read("/dir/file.bin", 0, out, chunk_size) && out == data;
+    }
+
+    bool ReadAt(net::Device& device, u64 off, u64 size) {
+        std::vector<u8> out(size);
+        return device.Read("/dir/file.bin", off, out) && !std::memcmp(out.data(), data.data() + off, size);
+    }
+
+    http::Server server;
+    net::SdCard sd;
+    const std::vector<u8> data;
+    fs::FsPath mount;
+};
+
+TEST_CASE(ReadsMatchWithRanges) {
+    Fixture f{{}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+    CHECK(device.devoptab);
+
+    // odd sizes, so that reads straddle the segments.
+    CHECK(f.ReadAll(device, 1024 * 64));
+    CHECK(f.ReadAll(device, 1000 * 333));
+    CHECK(f.server.GetRequestCount("GET") > 1);
+    CHECK(f.server.GetMaxConnections() > 1);
+}
+
+TEST_CASE(RandomAndBackwardReadsMatch) {
+    Fixture f{{}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    u64 seed = 0x1234;
+    for (u32 i = 0; i < 16; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const auto size = 1 + (seed >> 40) % (1024 * 700);
+        const auto off = (seed >> 16) % (f.data.size() - size);
+        CHECK(f.ReadAt(device, off, size));
+    }
+
+    // from the end to the start.
+    for (u64 off = f.data.size(); off > 1024 * 512; ) {
+        off -= 1024 * 512;
+        CHECK(f.ReadAt(device, off, 1024 * 512));
+    }
+
+    // the last byte.
+    CHECK(f.ReadAt(device, f.data.size() - 1, 1));
+}
+
+TEST_CASE(SingleConnectionMatches) {
+    Fixture f{{}, {{"connections", "1"}}};
+    net::Device device{f.mount};
+
+    // a single stream for the whole file.
+    CHECK(f.ReadAll(device, 1024 * 64));
+    CHECK(f.server.GetRequestCount("GET") == 1);
+    CHECK(f.ReadAt(device, 1024 * 1024 * 3, 1024 * 100));
+}
+
+TEST_CASE(FallsBackWithoutRanges) {
+    Fixture f{{.ranges = false}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    // without ranges, the file can only be streamed from the start.
+    CHECK(f.ReadAll(device, 1024 * 64));
+    CHECK(f.ReadAll(device, 1000 * 333));
+}
+
+TEST_CASE(SmallFilesAreASingleStream) {
+    Fixture f{{}, {{"connections", "4"}}};
+    const auto small = MakeInput(1024 * 100, 2);
+    f.server.AddFile("/dir/small.bin", small);
+    net::Device device{f.mount};
+
+    std::vector<u8> out(small.size());
+    CHECK(device.Read("/dir/small.bin", 0, out, 1024 * 64));
+    CHECK(out == small);
+    CHECK(f.server.GetRequestCount("GET") == 1);
+    CHECK(f.server.GetResponseCount(206) == 0);
+}
+
+TEST_CASE(FailedRangesAreRetried) {
+    Fixture f{{.drop_after = 1024 * 100, .drop_count = 3}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    CHECK(f.ReadAll(device, 1024 * 64));
+    // every GET was a range request, so there was no fallback to a single stream.
+    CHECK(f.server.GetResponseCount(206) == f.server.GetRequestCount("GET"));
+    CHECK(f.server.GetRequestCount("GET") == 11 + 3);
+}
+
+TEST_CASE(RetriesAreBounded) {
+    Fixture f{{.drop_after = 1024 * 100}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    // the single stream is dropped as well.
+    CHECK(!f.ReadAll(device, 1024 * 64));
+    // each segment in the window is tried at most MAX_RETRIES + 1 times.
+    CHECK(f.server.GetResponseCount(206) <= 8 * (devoptab::common::RangeReadData::MAX_RETRIES + 1));
+}
+
+TEST_CASE(MissingFileFails) {
+    Fixture f{{}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    std::vector<u8> out(10);
+    CHECK(!device.Read("/dir/missing.bin", 0, out));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
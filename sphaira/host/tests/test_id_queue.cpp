@@ -0,0 +1,106 @@
+#include "test.hpp"
+#include "utils/id_queue.hpp"
+
+// the queue of titles waiting to be loaded by title_info.
+// each id must be popped once, visible ids first in the order given, then
+// the rest in the order pushed.
+
+namespace sphaira {
+namespace {
+
+using utils::IdQueue;
+
+auto PopAll(IdQueue& queue) -> std::vector<u64> {
+    std::vector<u64> ids;
+    u64 id;
+    bool priority;
+    while (queue.Pop(id, priority)) {
+        ids.emplace_back(id);
+    }
+    return ids;
+}
+
+TEST_CASE(PopsInPushOrder) {
+    IdQueue queue;
+    for (u64 id = 10; id > 0; id--) {
+        CHECK(queue.Push(id * 3));
+    }
+
+    CHECK(queue.Size() == 10);
+    CHECK((PopAll(queue) == std::vector<u64>{30, 27, 24, 21, 18, 15, 12, 9, 6, 3}));
+    CHECK(queue.Size() == 0);
+}
+
+TEST_CASE(IdsAreQueuedOnce) {
+    IdQueue queue;
+    CHECK(queue.Push(1));
+    CHECK(queue.Push(2));
+    CHECK(!queue.Push(1));
+    CHECK((PopAll(queue) == std::vector<u64>{1, 2}));
+
+    // once popped, it can be pushed again.
+    CHECK(queue.Push(1));
+    CHECK(queue.Contains(1));
+}
+
+TEST_CASE(PrioritisedIdsComeFirst) {
+    IdQueue queue;
+    for (u64 id = 0; id < 10; id++) {
+        queue.Push(id);
+    }
+
+    const u64 visible[]{7, 5, 100, 6};
+    CHECK(queue.Prioritise(visible));
+
+    u64 id;
+    bool priority;
+    CHECK(queue.Pop(id, priority) && id == 7 && priority);
+    CHECK(queue.Pop(id, priority) && id == 5 && priority);
+    // 100 isn't queued, so it's skipped.
+    CHECK(queue.Pop(id, priority) && id == 6 && priority);
+    CHECK(queue.Pop(id, priority) && id == 0 && !priority);
+
+    // the prioritised ids are not popped again.
+    CHECK((PopAll(queue) == std::vector<u64>{1, 2, 3, 4, 8, 9}));
+}
+
+TEST_CASE(PrioritiseReplacesThePreviousList) {
+    IdQueue queue;
+    for (u64 id = 0; id < 100; id++) {
+        queue.Push(id);
+    }
+
+    const u64 first[]{50, 51, 52};
+    const u64 second[]{90, 91};
+    queue.Prioritise(first);
+    queue.Prioritise(second);
+
+    const auto ids = PopAll(queue);
+    CHECK(ids.size() == 100);
+    CHECK(ids[0] == 90 && ids[1] == 91 && ids[2] == 0);
+    // the first list is loaded in its normal place.
+    CHECK(ids[52] == 50);
+}
+
+TEST_CASE(PrioritiseSkipsLoadedIds) {
+    IdQueue queue;
+    queue.Push(1);
+    queue.Push(2);
+
+    u64 id;
+    bool priority;
+    CHECK(queue.Pop(id, priority) && id == 1);
+
+    const u64 loaded[]{1};
+    CHECK(!queue.Prioritise(loaded));
+
+    const u64 visible[]{1, 2};
+    CHECK(queue.Prioritise(visible));
+    CHECK(queue.Pop(id, priority) && id == 2 && priority);
+    CHECK(!queue.Pop(id, priority));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
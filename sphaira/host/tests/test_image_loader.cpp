@@ -0,0 +1,254 @@
+#include "test.hpp"
+#include "utils/image_loader.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// the worker pool that loads list icons.
+// images must be uploaded in the order requested, requests that stop being
+// made must be dropped before they're loaded, and nothing loaded before a
+// Clear() may be uploaded after it.
+
+namespace sphaira {
+namespace {
+
+using namespace std::chrono_literals;
+using utils::ImageLoader;
+
+// blocks a worker until opened.
+struct Gate {
+    std::atomic_bool open{};
+    std::atomic_bool entered{};
+
+    auto Job() {
+        return [this]() -> ImageResult {
+            entered = true;
+            while (!open) {
+                std::this_thread::sleep_for(1ms);
+            }
+            return {};
+        };
+    }
+
+    void WaitEntered() {
+        while (!entered) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+};
+
+auto MakeImage(u64 key) -> ImageLoader::LoadCallback {
+    return [key]() -> ImageResult {
+        return { std::vector<u8>(4, key), 1, 1 };
+    };
+}
+
+// uploads until count images have been passed, or the timeout.
+auto UploadAll(ImageLoader& loader, u32 count) -> std::vector<u64> {
+    std::vector<u64> keys;
+    const auto end = std::chrono::steady_clock::now() + 10s;
+    while (keys.size() < count && std::chrono::steady_clock::now() < end) {
+        loader.Upload([&keys](u64 key, const ImageResult& image) {
+            keys.emplace_back(key);
+        });
+        std::this_thread::sleep_for(1ms);
+    }
+    return keys;
+}
+
+TEST_CASE(LoadsInRequestOrder) {
+    ImageLoader loader{1};
+    std::vector<u64> expected;
+    for (u64 key = 0; key < 32; key++) {
+        loader.Request(key * 7, MakeImage(key));
+        expected.emplace_back(key * 7);
+    }
+
+    CHECK(UploadAll(loader, expected.size()) == expected);
+}
+
+TEST_CASE(RequestsAreNotDuplicated) {
+    ImageLoader loader{2};
+    Gate gate;
+    std::atomic<u32> calls{};
+
+    loader.Request(100, gate.Job());
+    loader.Request(100, gate.Job());
+    for (u32 i = 0; i < 5; i++) {
+        loader.Request(1, [&calls]() -> ImageResult {
+            calls++;
+            return { std::vector<u8>(4), 1, 1 };
+        });
+    }
+
+    gate.open = true;
+    const auto keys = UploadAll(loader, 2);
+    CHECK(keys.size() == 2);
+    CHECK(calls == 1);
+
+    // once uploaded, the image can be requested again.
+    CHECK(!loader.Touch(1));
+}
+
+TEST_CASE(SweepDropsImagesNoLongerRequested) {
+    ImageLoader loader{1};
+    Gate gate;
+    std::atomic<u32> calls{};
+
+    loader.Request(100, gate.Job());
+    gate.WaitEntered();
+
+    for (u64 key = 0; key < 10; key++) {
+        loader.Request(key, [&calls, key]() { calls++; return MakeImage(key)(); });
+    }
+
+    // the first frame, everything was requested.
+    loader.Sweep();
+
+    // the next frame, only the first 4 are still visible.
+    for (u64 key = 0; key < 4; key++) {
+        CHECK(loader.Touch(key));
+    }
+    loader.Sweep();
+
+    CHECK(!loader.Touch(4));
+    CHECK(!loader.Touch(9));
+
+    gate.open = true;
+    CHECK((UploadAll(loader, 5) == std::vector<u64>{100, 0, 1, 2, 3}));
+    std::this_thread::sleep_for(20ms);
+    CHECK(calls == 4);
+}
+
+TEST_CASE(SweepKeepsLoadingImages) {
+    ImageLoader loader{1};
+    Gate gate;
+
+    loader.Request(100, gate.Job());
+    gate.WaitEntered();
+
+    // not requested again, but already loading.
+    loader.Sweep();
+    loader.Sweep();
+
+    gate.open = true;
+    CHECK((UploadAll(loader, 1) == std::vector<u64>{100}));
+}
+
+TEST_CASE(ClearDiscardsLoadingImages) {
+    ImageLoader loader{1};
+    Gate gate;
+
+    loader.Request(100, gate.Job());
+    gate.WaitEntered();
+    loader.Request(1, MakeImage(1));
+
+    loader.Clear();
+    gate.open = true;
+    std::this_thread::sleep_for(20ms);
+    CHECK(UploadAll(loader, 0).empty());
+    CHECK(!loader.Upload([](u64, const ImageResult&) {}));
+
+    // the same key can be used again after a clear.
+    loader.Request(100, MakeImage(100));
+    CHECK((UploadAll(loader, 1) == std::vector<u64>{100}));
+}
+
+TEST_CASE(UploadStopsAtTheBudget) {
+    ImageLoader loader{2};
+    std::atomic<u32> loaded{};
+    for (u64 key = 0; key < 10; key++) {
+        loader.Request(key, [&loaded]() -> ImageResult {
+            loaded++;
+            return { std::vector<u8>(4), 1, 1 };
+        });
+    }
+
+    while (loaded != 10) {
+        std::this_thread::sleep_for(1ms);
+    }
+    // the last image is pushed just after its callback returns.
+    std::this_thread::sleep_for(20ms);
+
+    // at least one is always uploaded.
+    CHECK(loader.Upload([](u64, const ImageResult&) {}, 0) == 1);
+
+    const auto count = loader.Upload([](u64, const ImageResult&) {
+        std::this_thread::sleep_for(2ms);
+    }, 1000ULL * 1000ULL * 5ULL);
+    CHECK(count >= 2 && count <= 3);
+
+    CHECK(UploadAll(loader, 10 - 1 - count).size() == 10 - 1 - count);
+}
+
+TEST_CASE(FailedLoadsAreUploadedEmpty) {
+    ImageLoader loader{1};
+    loader.Request(1, []() -> ImageResult { return {}; });
+
+    bool empty = false;
+    const auto end = std::chrono::steady_clock::now() + 10s;
+    while (!loader.Upload([&empty](u64 key, const ImageResult& image) { empty = image.data.empty(); }) && std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(1ms);
+    }
+    CHECK(empty);
+}
+
+TEST_CASE(DecodesOnWorkers) {
+    constexpr int W = 96, H = 64;
+    std::vector<u8> rgba(W * H * 4);
+    for (int i = 0; i < W * H; i++) {
+        rgba[i * 4 + 0] = 200;
+        rgba[i * 4 + 1] = 100;
+        rgba[i * 4 + 2] = 50;
+        rgba[i * 4 + 3] = 255;
+    }
+
+    const auto jpg = ImageConvertToJpg(rgba, W, H);
+    CHECK(!jpg.data.empty());
+
+    ImageLoader loader{4};
+    for (u64 key = 0; key < 16; key++) {
+        loader.Request(key, [&jpg]() { return ImageLoadFromMemory(jpg.data, ImageFlag_JPEG); });
+    }
+
+    u32 count{};
+    const auto end = std::chrono::steady_clock::now() + 10s;
+    while (count < 16 && std::chrono::steady_clock::now() < end) {
+        count += loader.Upload([](u64 key, const ImageResult& image) {
+            CHECK(image.w == W && image.h == H);
+            CHECK(image.data.size() == W * H * 4);
+            CHECK(std::abs(image.data[0] - 200) < 4 && std::abs(image.data[1] - 100) < 4 && std::abs(image.data[2] - 50) < 4);
+        });
+        std::this_thread::sleep_for(1ms);
+    }
+    CHECK(count == 16);
+}
+
+TEST_CASE(FreeWithQueuedImages) {
+    Gate gate;
+    std::atomic<u32> calls{};
+    std::thread opener;
+    {
+        ImageLoader loader{1};
+        loader.Request(100, gate.Job());
+        gate.WaitEntered();
+        for (u64 key = 0; key < 100; key++) {
+            loader.Request(key, [&calls]() -> ImageResult { calls++; return {}; });
+        }
+
+        // opened once the loader is being freed.
+        opener = std::thread{[&gate]() {
+            std::this_thread::sleep_for(50ms);
+            gate.open = true;
+        }};
+    }
+    opener.join();
+
+    // the worker stopped after the job it was on.
+    CHECK(calls == 0);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
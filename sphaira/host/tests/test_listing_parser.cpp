@@ -0,0 +1,295 @@
+#include "test.hpp"
+#include "utils/devoptab_listing.hpp"
+
+// the listing parsers are fed as the response arrives, so every fixture is
+// parsed whole, then fed a byte at a time and in odd pieces, which must all
+// give the same entries.
+// the fixtures are trimmed copies of what common servers send.
+
+namespace sphaira {
+namespace {
+
+using namespace devoptab::common;
+
+struct Expected {
+    std::string name;
+    bool is_dir;
+    // -1 if the size isn't in the listing.
+    s64 size{-1};
+};
+
+enum class Split { None, Bytes, Odd };
+
+template<typename Parser, typename... Args>
+bool Parse(std::string_view body, Split split, DirEntries& out, Args&&... args) {
+    out.clear();
+    Parser parser{out, std::forward<Args>(args)...};
+
+    const size_t step = split == Split::None ? body.size() : split == Split::Bytes ? 1 : 7;
+    for (size_t off = 0; off < body.size(); off += step) {
+        if (!parser.Feed(body.substr(off, step))) {
+            return false;
+        }
+    }
+
+    return parser.Finish();
+}
+
+bool Matches(const DirEntries& entries, const std::vector<Expected>& expected) {
+    if (entries.size() != expected.size()) {
+        std::printf("\tgot %zu entries, expected %zu\n", entries.size(), expected.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const auto& e = entries[i];
+        const auto& x = expected[i];
+        if (e.name != x.name || S_ISDIR(e.st.st_mode) != x.is_dir || (x.size >= 0 && (!e.has_stat || e.st.st_size != x.size))) {
+            std::printf("\tentry %zu: got %s dir: %d size: %zu\n", i, e.name.c_str(), S_ISDIR(e.st.st_mode), (size_t)e.st.st_size);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename Parser, typename... Args>
+bool Check(std::string_view body, const std::vector<Expected>& expected, Args&&... args) {
+    for (const auto split : {Split::None, Split::Bytes, Split::Odd}) {
+        DirEntries entries;
+        if (!Parse<Parser>(body, split, entries, args...) || !Matches(entries, expected)) {
+            std::printf("\tfailed with split: %d\n", (int)split);
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr std::string_view APACHE = R"(<!DOCTYPE HTML PUBLIC "-//W3C//DTD HTML 3.2 Final//EN">
+<html>
+ <head>
+  <title>Index of /games</title>
+ </head>
+ <body>
+<h1>Index of /games</h1>
+  <table>
+   <tr><th valign="top"><img src="/icons/blank.gif" alt="[ICO]"></th><th><a href="?C=N;O=D">Name</a></th><th><a href="?C=M;O=A">Last modified</a></th><th><a href="?C=S;O=A">Size</a></th></tr>
+   <tr><th colspan="4"><hr></th></tr>
+<tr><td valign="top"><img src="/icons/back.gif" alt="[PARENTDIR]"></td><td><a href="/">Parent Directory</a></td><td>&nbsp;</td><td align="right">  - </td></tr>
+<tr><td valign="top"><img src="/icons/folder.gif" alt="[DIR]"></td><td><a href="updates/">updates/</a></td><td align="right">2024-01-02 10:00  </td><td align="right">  - </td></tr>
+<tr><td valign="top"><img src="/icons/unknown.gif" alt="[   ]"></td><td><a href="Game%20One%20%5B0100%5D.nsp">Game One [0100].nsp</a></td><td align="right">2024-01-02 10:00  </td><td align="right">1.2G</td></tr>
+<tr><td valign="top"><img src="/icons/unknown.gif" alt="[   ]"></td><td><a href="a-very-long-file-name-that-apache-truncates.xci">a-very-long-file-name-that-apache-trun..&gt;</a></td><td align="right">2024-01-02 10:00  </td><td align="right">4.0G</td></tr>
+   <tr><th colspan="4"><hr></th></tr>
+</table>
+<address>Apache/2.4.57 (Debian) Server at localhost Port 80</address>
+</body></html>
+)";
+
+constexpr std::string_view NGINX = R"(<html>
+<head><title>Index of /games/</title></head>
+<body>
+<h1>Index of /games/</h1><hr><pre><a href="../">../</a>
+<a href="updates/">updates/</a>                                           02-Jan-2024 10:00                   -
+<a href="Game%20One%20%5B0100%5D.nsp">Game One [0100].nsp</a>                                02-Jan-2024 10:00          1288490188
+<a href="t%C3%A9st.nro">tést.nro</a>                                           02-Jan-2024 10:00               1024
+</pre><hr></body>
+</html>
+)";
+
+// python -m http.server
+constexpr std::string_view PYTHON = R"(<!DOCTYPE HTML>
+<html lang="en">
+<head>
+<meta charset="utf-8">
+<title>Directory listing for /games/</title>
+</head>
+<body>
+<h1>Directory listing for /games/</h1>
+<hr>
+<ul>
+<li><a href="updates/">updates/</a></li>
+<li><a href="Game%20One%20%5B0100%5D.nsp">Game One [0100].nsp</a></li>
+</ul>
+<hr>
+</body>
+</html>
+)";
+
+// links outside of the table, such as a header or footer, are ignored.
+constexpr std::string_view LIGHTTPD = R"(<!DOCTYPE html>
+<html>
+<head><title>Index of /games/</title></head>
+<body>
+<h2>Index of /games/</h2>
+<a href="https://example.com/">home</a>
+<div class="list">
+<table summary="Directory Listing" cellpadding="0" cellspacing="0">
+<thead><tr><th class="n">Name</th><th class="m">Last Modified</th><th class="s">Size</th><th class="t">Type</th></tr></thead>
+<tbody>
+<tr class="d"><td class="n"><a href="../">..</a>/</td><td class="m">&nbsp;</td><td class="s">- &nbsp;</td><td class="t">Directory</td></tr>
+<tr class="d"><td class="n"><a href="updates/">updates</a>/</td><td class="m">2024-Jan-02 10:00:00</td><td class="s">- &nbsp;</td><td class="t">Directory</td></tr>
+<tr><td class="n"><a href="Game%20One%20%5B0100%5D.nsp">Game One [0100].nsp</a></td><td class="m">2024-Jan-02 10:00:00</td><td class="s">1.2G</td><td class="t">application/octet-stream</td></tr>
+</tbody>
+</table>
+</div>
+<div class="foot"><a href="http://www.lighttpd.net/">lighttpd/1.4.69</a></div>
+</body>
+</html>
+)";
+
+// apache mod_dav, with the self entry and a failed propstat.
+constexpr std::string_view PROPFIND_APACHE = R"(<?xml version="1.0" encoding="utf-8"?>
+<D:multistatus xmlns:D="DAV:" xmlns:ns0="DAV:">
+<D:response xmlns:lp1="DAV:" xmlns:lp2="http://apache.org/dav/props/">
+<D:href>/dav/games/</D:href>
+<D:propstat>
+<D:prop>
+<lp1:resourcetype><D:collection/></lp1:resourcetype>
+<lp1:getlastmodified>Tue, 02 Jan 2024 10:00:00 GMT</lp1:getlastmodified>
+</D:prop>
+<D:status>HTTP/1.1 200 OK</D:status>
+</D:propstat>
+<D:propstat>
+<D:prop>
+<D:getcontentlength/>
+</D:prop>
+<D:status>HTTP/1.1 404 Not Found</D:status>
+</D:propstat>
+</D:response>
+<D:response xmlns:lp1="DAV:" xmlns:lp2="http://apache.org/dav/props/">
+<D:href>/dav/games/Game%20One%20%5B0100%5D.nsp</D:href>
+<D:propstat>
+<D:prop>
+<lp1:resourcetype/>
+<lp1:getcontentlength>1288490188</lp1:getcontentlength>
+<lp1:getlastmodified>Tue, 02 Jan 2024 10:00:00 GMT</lp1:getlastmodified>
+</D:prop>
+<D:status>HTTP/1.1 200 OK</D:status>
+</D:propstat>
+</D:response>
+<D:response xmlns:lp1="DAV:" xmlns:lp2="http://apache.org/dav/props/">
+<D:href>/dav/games/updates/</D:href>
+<D:propstat>
+<D:prop>
+<lp1:resourcetype><D:collection/></lp1:resourcetype>
+<lp1:getcontentlength>4096</lp1:getcontentlength>
+</D:prop>
+<D:status>HTTP/1.1 200 OK</D:status>
+</D:propstat>
+</D:response>
+</D:multistatus>
+)";
+
+// nextcloud / sabre, lowercase prefix, comments and cdata.
+constexpr std::string_view PROPFIND_SABRE = R"(<?xml version="1.0"?>
+<!-- generated by sabre/dav -->
+<d:multistatus xmlns:d="DAV:" xmlns:s="http://sabredav.org/ns" xmlns:oc="http://owncloud.org/ns">
+ <d:response>
+  <d:href>/remote.php/dav/files/user/games/</d:href>
+  <d:propstat><d:prop><d:resourcetype><d:collection/></d:resourcetype></d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat>
+ </d:response>
+ <d:response>
+  <d:href><![CDATA[/remote.php/dav/files/user/games/a&b.nsp]]></d:href>
+  <d:propstat><d:prop><d:resourcetype/><d:getcontentlength>12</d:getcontentlength></d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat>
+ </d:response>
+ <d:response>
+  <d:href>/remote.php/dav/files/user/games/big.xci</d:href>
+  <d:propstat><d:prop><d:resourcetype/><d:getcontentlength>8589934592</d:getcontentlength></d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat>
+ </d:response>
+</d:multistatus>
+)";
+
+// iis and some others send absolute urls and no prefix.
+constexpr std::string_view PROPFIND_ABSOLUTE = R"(<?xml version="1.0" encoding="utf-8"?>
+<multistatus xmlns="DAV:">
+<response><href>http://localhost:8080/games/</href><propstat><prop><resourcetype><collection/></resourcetype></prop><status>HTTP/1.1 200 OK</status></propstat></response>
+<response><href>http://localhost:8080/games/file.bin</href><propstat><prop><resourcetype/><getcontentlength>5</getcontentlength></prop><status>HTTP/1.1 200 OK</status></propstat></response>
+</multistatus>
+)";
+
+TEST_CASE(HtmlApache) {
+    CHECK(Check<HtmlListingParser>(APACHE, {
+        {"updates", true},
+        {"Game One [0100].nsp", false},
+        {"a-very-long-file-name-that-apache-truncates.xci", false},
+    }));
+}
+
+TEST_CASE(HtmlNginx) {
+    CHECK(Check<HtmlListingParser>(NGINX, {
+        {"updates", true},
+        {"Game One [0100].nsp", false},
+        {"tést.nro", false},
+    }));
+}
+
+TEST_CASE(HtmlPython) {
+    CHECK(Check<HtmlListingParser>(PYTHON, {
+        {"updates", true},
+        {"Game One [0100].nsp", false},
+    }));
+}
+
+TEST_CASE(HtmlLighttpd) {
+    CHECK(Check<HtmlListingParser>(LIGHTTPD, {
+        {"updates", true},
+        {"Game One [0100].nsp", false},
+    }));
+}
+
+TEST_CASE(HtmlEmpty) {
+    CHECK(Check<HtmlListingParser>("<html><body><h1>Index of /</h1><hr><pre><a href=\"../\">../</a>\n</pre><hr></body></html>", {}));
+    CHECK(Check<HtmlListingParser>("", {}));
+}
+
+TEST_CASE(HtmlTruncated) {
+    // a listing cut off in the middle of an anchor keeps the entries before it.
+    const auto body = NGINX.substr(0, NGINX.find("t%C3%A9st") + 3);
+    CHECK(Check<HtmlListingParser>(body, {
+        {"updates", true},
+        {"Game One [0100].nsp", false},
+    }));
+}
+
+TEST_CASE(PropfindApache) {
+    CHECK(Check<PropfindListingParser>(PROPFIND_APACHE, {
+        {"Game One [0100].nsp", false, 1288490188},
+        // directory sizes aren't used.
+        {"updates", true},
+    }, std::string{"/dav/games"}));
+
+    DirEntries entries;
+    CHECK(Parse<PropfindListingParser>(PROPFIND_APACHE, Split::None, entries, std::string{"/dav/games/"}));
+    CHECK(entries.size() == 2 && entries[0].st.st_mtime == 1704189600);
+}
+
+TEST_CASE(PropfindSabre) {
+    CHECK(Check<PropfindListingParser>(PROPFIND_SABRE, {
+        {"a&b.nsp", false, 12},
+        {"big.xci", false, 8589934592},
+    }, std::string{"/remote.php/dav/files/user/games"}));
+}
+
+TEST_CASE(PropfindAbsoluteHref) {
+    CHECK(Check<PropfindListingParser>(PROPFIND_ABSOLUTE, {
+        {"file.bin", false, 5},
+    }, std::string{"/games"}));
+}
+
+TEST_CASE(PropfindRejectsNonMultistatus) {
+    DirEntries entries;
+    CHECK(!Parse<PropfindListingParser>("<html><body>Forbidden</body></html>", Split::None, entries, std::string{"/"}));
+    CHECK(!Parse<PropfindListingParser>("", Split::None, entries, std::string{"/"}));
+}
+
+TEST_CASE(PropfindRejectsHugeText) {
+    // text is buffered until the next tag, so it must be capped.
+    std::string body = "<d:multistatus xmlns:d=\"DAV:\"><d:response><d:href>" + std::string(1024 * 1024, 'a');
+    DirEntries entries;
+    CHECK(!Parse<PropfindListingParser>(body, Split::Odd, entries, std::string{"/"}));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
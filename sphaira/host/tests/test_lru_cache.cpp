@@ -0,0 +1,212 @@
+#include "test.hpp"
+#include "slow_source.hpp"
+#include "utils/devoptab_common.hpp"
+
+// the block cache used by the fatfs, zip, nsp and xci mounts.
+// reads must return the same data as the source for any access pattern,
+// block size and readahead, and the source must never be read from two
+// threads at once.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+using devoptab::common::LruBufferedData;
+
+constexpr u32 BLOCK_SIZE = 1024 * 4;
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+auto MakeCache(const std::shared_ptr<source::SlowSource>& src, u64 size, u32 block_count, u32 readahead) {
+    LruBufferedData::Config config{};
+    config.block_size = BLOCK_SIZE;
+    config.block_count = block_count;
+    config.readahead = readahead;
+    return std::make_unique<LruBufferedData>(src, size, config);
+}
+
+bool ReadAt(LruBufferedData& cache, const std::vector<u8>& file, u64 off, u64 size) {
+    std::vector<u8> out(size);
+    u64 bytes_read;
+    if (R_FAILED(cache.Read(out.data(), off, size, &bytes_read))) {
+        return false;
+    }
+
+    size = std::min<u64>(size, file.size() - off);
+    return bytes_read == size && !std::memcmp(out.data(), file.data() + off, size);
+}
+
+TEST_CASE(SequentialReadsMatch) {
+    // not a multiple of the block size.
+    const auto file = MakeInput(BLOCK_SIZE * 300 + 123, 1);
+
+    for (const auto readahead : {0, 4, 32}) {
+        for (const u64 chunk_size : {u64{512}, u64{BLOCK_SIZE}, u64{BLOCK_SIZE * 5 + 7}}) {
+            auto src = std::make_shared<source::SlowSource>(file);
+            auto cache = MakeCache(src, file.size(), 16, readahead);
+
+            for (u64 off = 0; off < file.size(); off += chunk_size) {
+                CHECK(ReadAt(*cache, file, off, chunk_size));
+            }
+            CHECK(!src->Overlapped());
+        }
+    }
+}
+
+TEST_CASE(RandomAndBackwardReadsMatch) {
+    const auto file = MakeInput(BLOCK_SIZE * 200 + 5, 2);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 16, 8);
+
+    u64 seed = 0x1234;
+    for (u32 i = 0; i < 500; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const auto size = 1 + (seed >> 40) % (BLOCK_SIZE * 4);
+        const auto off = (seed >> 16) % (file.size() - size);
+        CHECK(ReadAt(*cache, file, off, size));
+
+        // a few sequential reads after each seek, so that readahead runs.
+        if (i % 4 == 0) {
+            for (u64 next = off + size; next + BLOCK_SIZE < file.size() && next < off + BLOCK_SIZE * 20; next += BLOCK_SIZE) {
+                CHECK(ReadAt(*cache, file, next, BLOCK_SIZE));
+            }
+        }
+    }
+
+    for (u64 off = file.size(); off > BLOCK_SIZE; ) {
+        off -= BLOCK_SIZE;
+        CHECK(ReadAt(*cache, file, off, BLOCK_SIZE / 2));
+    }
+
+    CHECK(!src->Overlapped());
+}
+
+TEST_CASE(CachedReadsSkipTheSource) {
+    const auto file = MakeInput(BLOCK_SIZE * 8, 3);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 16, 0);
+
+    // small reads of the same block, such as fatfs reading the fat.
+    for (u32 i = 0; i < 100; i++) {
+        CHECK(ReadAt(*cache, file, BLOCK_SIZE + (i * 37) % BLOCK_SIZE / 2, 100));
+    }
+
+    CHECK(src->GetReadCount() == 1);
+    const auto stats = cache->GetStats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.hits == 99);
+    CHECK(stats.readahead == 0);
+}
+
+TEST_CASE(WholeBlocksAreReadInPlace) {
+    const auto file = MakeInput(BLOCK_SIZE * 64, 4);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 16, 0);
+
+    // a single source read, larger than the cache.
+    CHECK(ReadAt(*cache, file, 0, file.size()));
+    CHECK(src->GetReadCount() == 1);
+
+    // only the last block is kept.
+    CHECK(ReadAt(*cache, file, file.size() - BLOCK_SIZE, BLOCK_SIZE));
+    CHECK(src->GetReadCount() == 1);
+}
+
+TEST_CASE(SequentialReadsAreFetchedAhead) {
+    const auto file = MakeInput(BLOCK_SIZE * 256, 5);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 64, 16);
+
+    // readahead finishes before each read, so only the first block is missed.
+    for (u64 off = 0; off < file.size(); off += 512) {
+        CHECK(ReadAt(*cache, file, off, 512));
+        cache->WaitIdle();
+    }
+
+    const auto stats = cache->GetStats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.readahead == 255);
+    CHECK(stats.readahead_waste == 0);
+    // the window is topped up once half of it has been read, as a single read.
+    CHECK(src->GetReadCount() < 256 / 4);
+    CHECK(!src->Overlapped());
+}
+
+TEST_CASE(RandomReadsDontReadAhead) {
+    const auto file = MakeInput(BLOCK_SIZE * 256, 6);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 64, 16);
+
+    u64 seed = 0x4321;
+    for (u32 i = 0; i < 200; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        CHECK(ReadAt(*cache, file, (seed >> 16) % (file.size() - 512), 512));
+    }
+
+    CHECK(cache->GetStats().readahead == 0);
+}
+
+TEST_CASE(ReadsPastEnd) {
+    const auto file = MakeInput(BLOCK_SIZE * 4 + 10, 7);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 16, 4);
+
+    CHECK(ReadAt(*cache, file, file.size() - 10, BLOCK_SIZE));
+
+    std::vector<u8> out(BLOCK_SIZE);
+    u64 bytes_read;
+    CHECK(R_FAILED(cache->Read(out.data(), file.size(), out.size(), &bytes_read)));
+}
+
+TEST_CASE(ShortSourceStopsTheRead) {
+    // the source is smaller than the size given to the cache.
+    const auto file = MakeInput(BLOCK_SIZE * 10 + 100, 8);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size() + BLOCK_SIZE * 10, 16, 4);
+
+    std::vector<u8> out(BLOCK_SIZE * 4);
+    u64 bytes_read;
+    CHECK_RC(cache->Read(out.data(), BLOCK_SIZE * 8, out.size(), &bytes_read));
+    CHECK(bytes_read == BLOCK_SIZE * 2 + 100);
+    CHECK(!std::memcmp(out.data(), file.data() + BLOCK_SIZE * 8, bytes_read));
+
+    CHECK_RC(cache->Read(out.data(), BLOCK_SIZE * 10 + 50, 100, &bytes_read));
+    CHECK(bytes_read == 50);
+}
+
+TEST_CASE(ErrorsAreReturned) {
+    const auto file = MakeInput(BLOCK_SIZE * 64, 9);
+    auto src = std::make_shared<source::SlowSource>(file);
+    auto cache = MakeCache(src, file.size(), 16, 8);
+    src->FailAt(BLOCK_SIZE * 32);
+
+    std::vector<u8> out(BLOCK_SIZE);
+    u64 bytes_read;
+    Result rc{};
+    u64 off = 0;
+    for (; off < file.size(); off += BLOCK_SIZE / 2) {
+        rc = cache->Read(out.data(), off, BLOCK_SIZE / 2, &bytes_read);
+        if (R_FAILED(rc)) {
+            break;
+        }
+    }
+    CHECK(R_FAILED(rc));
+    CHECK(off == BLOCK_SIZE * 32);
+
+    // failed readahead isn't cached, the read is tried again.
+    src->FailAt(UINT64_MAX);
+    CHECK(ReadAt(*cache, file, BLOCK_SIZE * 32, BLOCK_SIZE * 3));
+    CHECK(ReadAt(*cache, file, 0, BLOCK_SIZE));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
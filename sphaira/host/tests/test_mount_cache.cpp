@@ -0,0 +1,164 @@
+#include "test.hpp"
+#include "http_server.hpp"
+#include "net_mount.hpp"
+#include <algorithm>
+
+// listings and stats of the network mounts are cached, so browsing a dir
+// that was already listed doesn't ask the server again. the requests are
+// counted by the server before and after each step.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+constexpr u32 FILE_COUNT = 500;
+
+auto FileName(u32 i) -> std::string {
+    return "file_" + std::to_string(i) + ".bin";
+}
+
+struct Fixture {
+    Fixture(const char* type, Result(*mount_all)(), const net::Extra& extra = {}) {
+        for (u32 i = 0; i < FILE_COUNT; i++) {
+            server.AddFile("/dir/" + FileName(i), std::vector<u8>(i + 1));
+        }
+        server.AddFile("/dir/sub/a.bin", std::vector<u8>(10));
+        server.Start();
+        mount = net::Mount(sd, type, mount_all, server.Url(), extra);
+    }
+
+    http::Server server;
+    net::SdCard sd;
+    fs::FsPath mount;
+};
+
+// lists the dir, then stats every file in it.
+bool ListAndStat(net::Device& device) {
+    std::vector<std::string> names;
+    if (!device.List("/dir", names) || names.size() != FILE_COUNT + 1) {
+        return false;
+    }
+
+    for (u32 i = 0; i < FILE_COUNT; i++) {
+        struct stat st;
+        if (!device.Stat("/dir/" + FileName(i), st) || st.st_size != i + 1 || !S_ISREG(st.st_mode)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TEST_CASE(WebdavListingIsCached) {
+    Fixture f{"WEBDAV", devoptab::MountWebdavAll};
+    net::Device device{f.mount};
+    CHECK(device.devoptab);
+
+    // a single PROPFIND, every stat is served from it.
+    CHECK(ListAndStat(device));
+    CHECK(f.server.GetRequestCount("PROPFIND") == 1);
+    CHECK(f.server.GetRequestCount("HEAD") == 0);
+
+    // nothing is asked again.
+    const auto count = f.server.GetRequestCount();
+    CHECK(ListAndStat(device));
+    CHECK(f.server.GetRequestCount() == count);
+
+    // the listing is complete, so missing files are known not to exist.
+    struct stat st;
+    CHECK(!device.Stat("/dir/missing.bin", st));
+    CHECK(f.server.GetRequestCount() == count);
+}
+
+TEST_CASE(WebdavWritesInvalidate) {
+    Fixture f{"WEBDAV", devoptab::MountWebdavAll};
+    net::Device device{f.mount};
+
+    std::vector<std::string> names;
+    CHECK(device.List("/dir", names));
+    CHECK(f.server.GetRequestCount("PROPFIND") == 1);
+
+    // deleted files must not be listed or stat'd from the cache.
+    CHECK(device.Unlink("/dir/" + FileName(0)));
+    CHECK(device.List("/dir", names));
+    CHECK(f.server.GetRequestCount("PROPFIND") == 2);
+    CHECK(names.size() == FILE_COUNT);
+    struct stat st;
+    CHECK(!device.Stat("/dir/" + FileName(0), st));
+
+    // nor must new files be missing.
+    CHECK(device.Write("/dir/new.bin", std::vector<u8>(1234)));
+    CHECK(device.Stat("/dir/new.bin", st));
+    CHECK(st.st_size == 1234);
+    CHECK(device.List("/dir", names));
+    CHECK(names.size() == FILE_COUNT + 1);
+
+    // mkdir invalidates the parent.
+    const auto count = f.server.GetRequestCount("PROPFIND");
+    CHECK(!device.devoptab->mkdir_r(&device.r, device.Path("/dir/new_dir").c_str(), 0));
+    CHECK(device.List("/dir", names));
+    CHECK(f.server.GetRequestCount("PROPFIND") > count);
+    CHECK(std::ranges::find(names, "new_dir") != names.end());
+
+    // rename invalidates both sides.
+    CHECK(!device.devoptab->rename_r(&device.r, device.Path("/dir/new.bin").c_str(), device.Path("/dir/sub/moved.bin").c_str()));
+    CHECK(!device.Stat("/dir/new.bin", st));
+    CHECK(device.Stat("/dir/sub/moved.bin", st));
+    CHECK(device.List("/dir/sub", names));
+    CHECK(std::ranges::find(names, "moved.bin") != names.end());
+}
+
+TEST_CASE(WebdavTtlZeroDisablesCache) {
+    Fixture f{"WEBDAV", devoptab::MountWebdavAll, {{"cache_ttl", "0"}}};
+    net::Device device{f.mount};
+
+    std::vector<std::string> names;
+    CHECK(device.List("/dir", names));
+    CHECK(device.List("/dir", names));
+    CHECK(f.server.GetRequestCount("PROPFIND") == 2);
+}
+
+TEST_CASE(HttpListingIsCached) {
+    Fixture f{"HTTP", devoptab::MountHttpAll};
+    net::Device device{f.mount};
+    CHECK(device.devoptab);
+
+    CHECK(ListAndStat(device));
+    // the autoindex has no sizes, so the files are stat'd once each.
+    CHECK(f.server.GetRequestCount("GET") == 1);
+    CHECK(f.server.GetRequestCount("HEAD") == FILE_COUNT);
+
+    const auto count = f.server.GetRequestCount();
+    CHECK(ListAndStat(device));
+    CHECK(f.server.GetRequestCount() == count);
+}
+
+TEST_CASE(HttpListingIsRevalidated) {
+    Fixture f{"HTTP", devoptab::MountHttpAll, {{"cache_ttl", "1"}}};
+    net::Device device{f.mount};
+
+    std::vector<std::string> names;
+    CHECK(device.List("/dir", names));
+    CHECK(names.size() == FILE_COUNT + 1);
+    CHECK(f.server.GetResponseCount(200) == 1);
+
+    // once expired, the listing is revalidated with its etag, rather than sent again.
+    svcSleepThread(1'100'000'000);
+    CHECK(device.List("/dir", names));
+    CHECK(names.size() == FILE_COUNT + 1);
+    CHECK(f.server.GetRequestCount("GET") == 2);
+    CHECK(f.server.GetResponseCount(304) == 1);
+
+    // a changed listing is sent in full.
+    f.server.AddFile("/dir/added.bin", std::vector<u8>(1));
+    svcSleepThread(1'100'000'000);
+    CHECK(device.List("/dir", names));
+    CHECK(names.size() == FILE_COUNT + 2);
+    CHECK(f.server.GetResponseCount(200) == 2);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,107 @@
+#include "test.hpp"
+#include "yati/nx/ncz.hpp"
+#include <zstd.h>
+#include <cstring>
+#include <memory>
+
+// ncz::NczBlockReader must return the original data and clamp the user set
+// block cache size to a sane range.
+
+namespace sphaira {
+namespace {
+
+constexpr u8 BLOCK_EXPONENT = 16;
+constexpr u64 BLOCK_SIZE = 1ULL << BLOCK_EXPONENT;
+
+struct MemSource final : yati::source::Base {
+    MemSource(std::vector<u8>&& data) : m_data{std::move(data)} {}
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        size = std::min<s64>(size, m_data.size() - off);
+        std::memcpy(buf, m_data.data() + off, size);
+        *bytes_read = size;
+        R_SUCCEED();
+    }
+
+private:
+    const std::vector<u8> m_data;
+};
+
+auto MakeInput(u64 size) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        // half of each block compresses, half is noise, so both stored and compressed blocks are used.
+        data[i] = (i / BLOCK_SIZE) & 1 ? (i * 2654435761ULL) >> 13 : i / 512;
+    }
+    return data;
+}
+
+auto MakeReader(std::span<const u8> data, u64 cache_size) {
+    ncz::BlockHeader block_header{};
+    block_header.magic = NCZ_BLOCK_MAGIC;
+    block_header.version = NCZ_BLOCK_VERSION;
+    block_header.type = NCZ_BLOCK_TYPE;
+    block_header.block_size_exponent = BLOCK_EXPONENT;
+    block_header.decompressed_size = data.size();
+
+    ncz::Blocks blocks;
+    std::vector<u8> out;
+    std::vector<u8> temp(ZSTD_compressBound(BLOCK_SIZE));
+    for (u64 off = 0; off < data.size(); off += BLOCK_SIZE) {
+        const auto size = std::min<u64>(BLOCK_SIZE, data.size() - off);
+        const auto res = ZSTD_compress(temp.data(), temp.size(), data.data() + off, size, 1);
+
+        if (ZSTD_isError(res) || res >= size) {
+            out.insert(out.end(), data.data() + off, data.data() + off + size);
+            blocks.emplace_back(size);
+        } else {
+            out.insert(out.end(), temp.data(), temp.data() + res);
+            blocks.emplace_back(res);
+        }
+    }
+
+    block_header.total_blocks = blocks.size();
+    auto source = std::make_shared<MemSource>(std::move(out));
+    return std::make_unique<ncz::NczBlockReader>(ncz::Header{}, ncz::Sections{}, block_header, blocks, 0, source, cache_size);
+}
+
+auto ReadAll(ncz::NczBlockReader& reader, u64 size) {
+    std::vector<u8> out(size);
+    for (u64 off = 0; off < size; off += 1024 * 100) {
+        const auto rsize = std::min<u64>(1024 * 100, size - off);
+        u64 bytes_read{};
+        CHECK_RC(reader.Read(out.data() + off, NCZ_NORMAL_SIZE + off, rsize, &bytes_read));
+        CHECK(bytes_read == rsize);
+    }
+    return out;
+}
+
+TEST_CASE(ReadsOriginalData) {
+    const auto data = MakeInput(BLOCK_SIZE * 20 + 1234);
+    auto reader = MakeReader(data, ncz::NCZ_BLOCK_CACHE_SIZE);
+    CHECK(ReadAll(*reader, data.size()) == data);
+}
+
+TEST_CASE(CacheSizeIsClampedToMin) {
+    // 0 would be a single block, the min holds every block of this file.
+    const auto data = MakeInput(BLOCK_SIZE * 32);
+    auto reader = MakeReader(data, 0);
+    CHECK(ReadAll(*reader, data.size()) == data);
+
+    // a second pass should be served entirely from the cache.
+    const auto misses = reader->GetStats().misses;
+    CHECK(ReadAll(*reader, data.size()) == data);
+    CHECK(reader->GetStats().misses == misses);
+}
+
+TEST_CASE(CacheSizeIsClampedToMax) {
+    // a huge (or negative) option would otherwise allocate an enormous lru.
+    const auto data = MakeInput(BLOCK_SIZE * 4);
+    auto reader = MakeReader(data, ~0ULL);
+    CHECK(ReadAll(*reader, data.size()) == data);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,142 @@
+#include "test.hpp"
+#include "utils/ordered_worker_pool.hpp"
+
+// utils::OrderedWorkerPool must hand jobs back in the order they were pushed,
+// regardless of the order the workers finish them in.
+
+namespace sphaira {
+namespace {
+
+struct Job {
+    u64 value{};
+    u64 result{};
+    bool fail{};
+};
+
+struct Worker {
+    Result Process(Job& job) {
+        // make later jobs finish before earlier ones.
+        svcSleepThread((job.value % 4) * 100'000);
+        R_UNLESS(!job.fail, 0x1234);
+        job.result = job.value * 2;
+        R_SUCCEED();
+    }
+};
+
+using Pool = utils::OrderedWorkerPool<Job, Worker>;
+
+TEST_CASE(PopsInOrder) {
+    for (const u32 threads : {1, 2, 4}) {
+        for (const u32 depth : {1, 3, 8}) {
+            Pool pool;
+            CHECK(pool.Create(threads, depth) == threads);
+
+            u64 pushed{}, popped{};
+            const auto pop = [&]() {
+                Job* job{};
+                CHECK_RC(pool.WaitFront(std::addressof(job)));
+                CHECK(job->result == popped * 2);
+                popped++;
+                pool.Pop();
+            };
+
+            for (; pushed < 200; pushed++) {
+                while (pool.IsFull()) {
+                    pop();
+                }
+
+                auto& job = pool.GetBack();
+                job.value = pushed;
+                job.fail = false;
+                pool.Push();
+
+                while (pool.IsFrontDone()) {
+                    pop();
+                }
+            }
+
+            while (!pool.IsEmpty()) {
+                pop();
+            }
+
+            CHECK(popped == pushed);
+        }
+    }
+}
+
+TEST_CASE(SkippedJobsBypassWorkers) {
+    Pool pool;
+    CHECK(pool.Create(2, 4) == 2);
+
+    for (u64 i = 0; i < 100; i++) {
+        while (pool.IsFull()) {
+            Job* job{};
+            CHECK_RC(pool.WaitFront(std::addressof(job)));
+            pool.Pop();
+        }
+
+        // every other job is done by the owner, workers must not touch it.
+        auto& job = pool.GetBack();
+        job.value = i;
+        job.result = i & 1 ? 0xDEAD : 0;
+        pool.Push(i & 1);
+    }
+
+    u64 count{};
+    while (!pool.IsEmpty()) {
+        Job* job{};
+        CHECK_RC(pool.WaitFront(std::addressof(job)));
+        if (job->value & 1) {
+            CHECK(job->result == 0xDEAD);
+        } else {
+            CHECK(job->result == job->value * 2);
+        }
+        pool.Pop();
+        count++;
+    }
+
+    CHECK(count > 0);
+}
+
+TEST_CASE(ErrorIsReturnedForFailedJob) {
+    Pool pool;
+    CHECK(pool.Create(3, 4) == 3);
+
+    for (u64 i = 0; i < 4; i++) {
+        auto& job = pool.GetBack();
+        job.value = i;
+        job.fail = i == 2;
+        pool.Push();
+    }
+
+    for (u64 i = 0; i < 4; i++) {
+        Job* job{};
+        const auto rc = pool.WaitFront(std::addressof(job));
+        CHECK(job->value == i);
+        CHECK(i == 2 ? rc == 0x1234 : R_SUCCEEDED(rc));
+        pool.Pop();
+    }
+}
+
+TEST_CASE(CreateWorkerPerThread) {
+    std::atomic<u32> created{};
+    {
+        utils::OrderedWorkerPool<Job, Worker> pool{[&created]{ created++; return Worker{}; }};
+        CHECK(pool.Create(3, 3) == 3);
+
+        // workers are created on their own thread, so wait for them to start.
+        auto& job = pool.GetBack();
+        job.value = 1;
+        pool.Push();
+        Job* out{};
+        CHECK_RC(pool.WaitFront(std::addressof(out)));
+        pool.Pop();
+    }
+
+    CHECK(created == 3);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,171 @@
+#include "test.hpp"
+#include "fake_remote.hpp"
+
+// the pipelined reader used by nfs and smb2 keeps several reads in flight.
+// reads must return the same data as the file for any access pattern and
+// depth, errors must be returned, and nothing may be in flight once freed.
+// reads that never finish time out, and their buffers are kept until they do.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+constexpr u64 BLOCK_SIZE = 1024 * 64;
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+// reads the whole file in chunks of chunk_size.
+bool ReadAll(remote::FakeRemote& reader, const std::vector<u8>& file, u64 chunk_size) {
+    std::vector<u8> out(file.size());
+    for (u64 off = 0; off < out.size(); ) {
+        const auto ret = reader.Read((char*)out.data() + off, off, std::min(chunk_size, out.size() - off));
+        if (ret <= 0) {
+            return false;
+        }
+        off += ret;
+    }
+    return out == file;
+}
+
+bool ReadAt(remote::FakeRemote& reader, const std::vector<u8>& file, u64 off, u64 size) {
+    std::vector<u8> out(size);
+    return reader.Read((char*)out.data(), off, size) == (ssize_t)size && !std::memcmp(out.data(), file.data() + off, size);
+}
+
+TEST_CASE(SequentialReadsMatch) {
+    // not a multiple of the block size.
+    const auto file = MakeInput(BLOCK_SIZE * 40 + 123, 1);
+
+    for (const auto depth : {1, 2, 8, 32}) {
+        for (const u64 chunk_size : {u64{1000}, BLOCK_SIZE, BLOCK_SIZE * 3 + 7}) {
+            remote::FakeRemote reader{file, {}, BLOCK_SIZE, (u32)depth};
+            CHECK_RC(reader.Create());
+            CHECK(ReadAll(reader, file, chunk_size));
+            CHECK(reader.GetMaxInflight() <= (u32)depth);
+        }
+    }
+}
+
+TEST_CASE(WindowGrowsToDepth) {
+    const auto file = MakeInput(BLOCK_SIZE * 64, 2);
+    remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8};
+    CHECK_RC(reader.Create());
+    CHECK(ReadAll(reader, file, BLOCK_SIZE));
+    CHECK(reader.GetMaxInflight() == 8);
+
+    // nothing past the end of the file is asked for more than once.
+    CHECK(reader.GetReadCount() <= 64 + 8);
+}
+
+TEST_CASE(RandomAndBackwardReadsMatch) {
+    const auto file = MakeInput(BLOCK_SIZE * 40 + 5, 3);
+    remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8};
+    CHECK_RC(reader.Create());
+
+    u64 seed = 0x1234;
+    for (u32 i = 0; i < 64; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const auto size = 1 + (seed >> 40) % (BLOCK_SIZE * 3);
+        const auto off = (seed >> 16) % (file.size() - size);
+        CHECK(ReadAt(reader, file, off, size));
+    }
+
+    for (u64 off = file.size(); off > BLOCK_SIZE; ) {
+        off -= BLOCK_SIZE;
+        CHECK(ReadAt(reader, file, off, BLOCK_SIZE / 2));
+    }
+
+    // skips forward inside the window.
+    CHECK(ReadAt(reader, file, 0, 100));
+    CHECK(ReadAt(reader, file, BLOCK_SIZE * 2 + 3, 100));
+}
+
+TEST_CASE(ReadsPastEndReturnZero) {
+    const auto file = MakeInput(BLOCK_SIZE * 2 + 10, 4);
+    remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8};
+    CHECK_RC(reader.Create());
+
+    std::vector<u8> out(BLOCK_SIZE);
+    CHECK(reader.Read((char*)out.data(), file.size() - 10, out.size()) == 10);
+    CHECK(reader.Read((char*)out.data(), file.size(), out.size()) == 0);
+    CHECK(reader.Read((char*)out.data(), file.size() + BLOCK_SIZE * 5, out.size()) == 0);
+}
+
+TEST_CASE(ErrorsAreReturned) {
+    const auto file = MakeInput(BLOCK_SIZE * 16, 5);
+    remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8};
+    CHECK_RC(reader.Create());
+    reader.FailAt(BLOCK_SIZE * 10, -ETIMEDOUT);
+
+    std::vector<u8> out(file.size());
+    ssize_t ret = 0;
+    for (u64 off = 0; off < out.size(); off += ret) {
+        ret = reader.Read((char*)out.data() + off, off, BLOCK_SIZE);
+        if (ret <= 0) {
+            CHECK(off == BLOCK_SIZE * 10);
+            break;
+        }
+    }
+    CHECK(ret == -ETIMEDOUT);
+    CHECK(!reader.GetInflight());
+
+    // reads before the error still work.
+    CHECK(ReadAt(reader, file, BLOCK_SIZE, 1000));
+}
+
+TEST_CASE(FreeWaitsForInflightReads) {
+    const auto file = MakeInput(BLOCK_SIZE * 64, 6);
+    u32 inflight_on_free = UINT32_MAX;
+    {
+        remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8};
+        reader.inflight_on_free = &inflight_on_free;
+        CHECK_RC(reader.Create());
+
+        // a few reads, so that the rest of the window is still in flight.
+        for (u32 i = 0; i < 4; i++) {
+            CHECK(ReadAt(reader, file, i * BLOCK_SIZE, BLOCK_SIZE));
+        }
+        CHECK(reader.GetInflight());
+    }
+
+    // the buffers must not be freed while the reads can still write to them.
+    CHECK(inflight_on_free == 0);
+}
+
+TEST_CASE(HungReadsTimeOut) {
+    const auto file = MakeInput(BLOCK_SIZE * 64, 7);
+    remote::FakeRemote reader{file, {}, BLOCK_SIZE, 8, 250};
+    CHECK_RC(reader.Create());
+    CHECK(ReadAt(reader, file, 0, BLOCK_SIZE));
+
+    reader.Hang(true);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<u8> out(BLOCK_SIZE);
+    CHECK(reader.Read((char*)out.data(), BLOCK_SIZE, out.size()) == -ETIMEDOUT);
+    // the reads aren't waited for a second time when the queue is reset.
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(490));
+
+    // the blocks are still in flight, so they're kept rather than freed.
+    CHECK(reader.GetInflight());
+    CHECK(reader.orphans.GetCount() == 1);
+    CHECK(reader.Read((char*)out.data(), BLOCK_SIZE, out.size()) < 0);
+
+    // and freed once the reads have finished.
+    reader.Hang(false);
+    reader.Flush();
+    reader.orphans.Collect();
+    CHECK(reader.orphans.GetCount() == 0);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,259 @@
+#include "test.hpp"
+#include "http_server.hpp"
+#include "curl_session.hpp"
+#include "sd_card.hpp"
+#include <csignal>
+#include <fstream>
+#include <sys/wait.h>
+
+// Flag_Segmented downloads a file over several connections using range
+// requests. the output must match the file whatever happens to the
+// connections, a download that was stopped by the app exiting or being killed
+// must resume where it was, and anything else must leave no resume files.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+constexpr auto CACHE_PATH = "/switch/sphaira/cache/segmented";
+constexpr auto OUT_PATH = "/switch/sphaira/out.bin";
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+struct Fixture {
+    Fixture(const http::Options& options, u64 size = 1024 * 1024 * 9 + 123) : data{MakeInput(size, 1)} {
+        server.SetOptions(options);
+        server.AddFile("/file.bin", data, "v1");
+        server.Start();
+    }
+
+    auto Download(u32 flags = curl::Flag_Segmented, curl::StopToken token = {}) -> curl::ApiResult {
+        return curl::Api().ToFile(
+            curl::Url{server.Url("/file.bin")},
+            fs::FsPath{OUT_PATH},
+            curl::Flags{flags},
+            curl::StopToken{token}
+        );
+    }
+
+    bool OutputMatches() const {
+        std::ifstream f{sd.Path(OUT_PATH), std::ios::binary};
+        const std::vector<u8> out{std::istreambuf_iterator<char>{f}, {}};
+        return out == data;
+    }
+
+    // number of .part and .meta files.
+    auto GetResumeFileCount() const -> u32 {
+        std::error_code ec;
+        u32 count{};
+        for (const auto& e : std::filesystem::directory_iterator{sd.Path(CACHE_PATH), ec}) {
+            count += e.path().extension() == ".part" || e.path().extension() == ".meta";
+        }
+        return count;
+    }
+
+    SdCard sd;
+    http::Server server;
+    std::vector<u8> data;
+};
+
+TEST_CASE(DownloadsWithRanges) {
+    // throttled so that the segments are in progress at the same time.
+    Fixture f{{.rate = 1024 * 1024 * 8}};
+    CurlSession session;
+
+    const auto result = f.Download();
+    CHECK(result.success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetMaxConnections() > 1);
+    CHECK(f.server.GetResponseCount(206) > 2);
+    CHECK(f.server.GetResponseCount(200) == 0);
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+TEST_CASE(FallsBackWithoutRanges) {
+    Fixture f{{.ranges = false}};
+    CurlSession session;
+
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetResponseCount(206) == 0);
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+TEST_CASE(SmallFilesAreNotSegmented) {
+    Fixture f{{}, 1024 * 1024};
+    CurlSession session;
+
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    // only the probe was ranged.
+    CHECK(f.server.GetResponseCount(206) == 1);
+    CHECK(f.server.GetRequestCount("GET") == 2);
+}
+
+TEST_CASE(DroppedConnectionsAreRetried) {
+    // each segment is 2MiB, so each is dropped once halfway through.
+    Fixture f{{.drop_after = 1024 * 1024}};
+    CurlSession session;
+
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetRequestCount("GET") > 5);
+}
+
+TEST_CASE(IgnoredRangeFallsBack) {
+    // the probe gets a 206, eg a signed redirect that expired after it.
+    Fixture f{{.ignore_range_after = 1}};
+    CurlSession session;
+
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetResponseCount(200) > 0);
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+TEST_CASE(CancelRemovesResumeFiles) {
+    Fixture f{{.rate = 1024 * 1024}};
+    CurlSession session;
+
+    std::stop_source stop;
+    std::thread canceller{[&stop]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        stop.request_stop();
+    }};
+
+    CHECK(!f.Download(curl::Flag_Segmented, stop.get_token()).success);
+    canceller.join();
+    CHECK(f.GetResumeFileCount() == 0);
+    CHECK(!std::filesystem::exists(f.sd.Path(OUT_PATH)));
+}
+
+TEST_CASE(ResumesAfterExit) {
+    Fixture f{{.rate = 1024 * 1024}};
+
+    {
+        CurlSession session;
+        std::thread exiter{[]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+            curl::ExitSignal();
+        }};
+
+        CHECK(!f.Download().success);
+        exiter.join();
+    }
+
+    CHECK(f.GetResumeFileCount() == 2);
+
+    f.server.SetOptions({});
+    f.server.ResetCounts();
+    CurlSession session;
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    // about 4MiB was downloaded by the first attempt.
+    CHECK(f.server.GetBytesSent() < f.data.size() * 3 / 4);
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+// the download is run in a child process which is killed with SIGKILL.
+TEST_CASE(ResumesAfterKill) {
+    // slower than the others, so that the child is killed well before it finishes.
+    Fixture f{{.rate = 1024 * 512}};
+
+    const auto pid = fork();
+    if (!pid) {
+        CurlSession session;
+        f.Download();
+        _exit(0);
+    }
+
+    // the resume data is saved every second.
+    std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    CHECK(f.GetResumeFileCount() == 2);
+
+    f.server.SetOptions({});
+    f.server.ResetCounts();
+    CurlSession session;
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetBytesSent() < f.data.size() * 3 / 4);
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+TEST_CASE(ChangedFileRestarts) {
+    Fixture f{{.rate = 1024 * 1024}};
+
+    {
+        CurlSession session;
+        std::thread exiter{[]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+            curl::ExitSignal();
+        }};
+
+        CHECK(!f.Download().success);
+        exiter.join();
+    }
+
+    CHECK(f.GetResumeFileCount() == 2);
+
+    // same size, new etag.
+    f.data = MakeInput(f.data.size(), 2);
+    f.server.AddFile("/file.bin", f.data, "v2");
+    f.server.SetOptions({});
+    f.server.ResetCounts();
+
+    CurlSession session;
+    CHECK(f.Download().success);
+    CHECK(f.OutputMatches());
+    CHECK(f.server.GetBytesSent() >= f.data.size());
+}
+
+TEST_CASE(PrunesOldResumeFiles) {
+    Fixture f{{.rate = 1024 * 1024}};
+    f.server.AddFile("/other.bin", MakeInput(1024 * 1024 * 5, 3));
+
+    {
+        CurlSession session;
+        std::thread exiter{[]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+            curl::ExitSignal();
+        }};
+
+        CHECK(!f.Download().success);
+        exiter.join();
+    }
+
+    CHECK(f.GetResumeFileCount() == 2);
+
+    f.server.SetOptions({});
+    CurlSession session;
+    const auto download_other = [&f]() {
+        return curl::Api().ToFile(curl::Url{f.server.Url("/other.bin")}, fs::FsPath{"/switch/sphaira/other.bin"}, curl::Flags{curl::Flag_Segmented}).success;
+    };
+
+    // recent files of other downloads are kept.
+    CHECK(download_other());
+    CHECK(f.GetResumeFileCount() == 2);
+
+    for (const auto& e : std::filesystem::directory_iterator{f.sd.Path(CACHE_PATH)}) {
+        std::filesystem::last_write_time(e.path(), std::filesystem::file_time_type::clock::now() - std::chrono::hours(24 * 8));
+    }
+
+    CHECK(download_other());
+    CHECK(f.GetResumeFileCount() == 0);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,269 @@
+#include "test.hpp"
+#include "sd_card.hpp"
+#include "utils/thumb_cache.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+// the on disk cache of scaled down icons.
+// a thumbnail must be returned without calling the loader once cached, and
+// survive the cache being reopened. a changed stamp, a failed load or a
+// corrupt file must fall back to the loader. the file must not grow past
+// the data cap, the oldest thumbnails are written over instead.
+// thumbnails are stored as jpeg, so cached images are compared as being close.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+using utils::ThumbCache;
+
+constexpr auto CACHE_FILE = "/switch/sphaira/cache/thumbs/test.bin";
+
+// smooth, so that it survives jpeg, each seed is a different colour.
+auto MakeImage(int w, int h, u8 seed) -> ImageResult {
+    ImageResult image{std::vector<u8>(w * h * 4), w, h};
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            auto px = image.data.data() + (y * w + x) * 4;
+            px[0] = x * 128 / w + seed * 37 % 128;
+            px[1] = y * 128 / h + seed * 59 % 128;
+            px[2] = seed * 97;
+            px[3] = 255;
+        }
+    }
+    return image;
+}
+
+// true if the images are the same, give or take the jpeg loss.
+bool Near(const ImageResult& a, const ImageResult& b) {
+    if (a.w != b.w || a.h != b.h || a.data.size() != b.data.size() || a.data.empty()) {
+        return false;
+    }
+
+    u64 diff{};
+    for (u64 i = 0; i < a.data.size(); i++) {
+        diff += std::abs(a.data[i] - b.data[i]);
+    }
+    return diff < a.data.size() * 4;
+}
+
+// returns image, counting the calls.
+auto Loader(const ImageResult& image, u32& calls) {
+    return [&image, &calls]() {
+        calls++;
+        return image;
+    };
+}
+
+TEST_CASE(CachesScaledImages) {
+    SdCard sd;
+    const auto image = MakeImage(512, 256, 1);
+    u32 calls{};
+
+    ThumbCache cache{"test"};
+    const auto first = cache.Load(1, 100, Loader(image, calls));
+    CHECK(calls == 1);
+    // the aspect ratio is kept.
+    CHECK(first.w == ThumbCache::THUMB_SIZE && first.h == ThumbCache::THUMB_SIZE / 2);
+    CHECK(first.data.size() == u64(first.w) * first.h * 4);
+
+    const auto second = cache.Load(1, 100, Loader(image, calls));
+    CHECK(calls == 1);
+    CHECK(Near(second, first));
+}
+
+TEST_CASE(SmallImagesAreNotScaled) {
+    SdCard sd;
+    const auto image = MakeImage(64, 48, 2);
+    u32 calls{};
+
+    ThumbCache cache{"test"};
+    CHECK(cache.Load(1, 100, Loader(image, calls)).data == image.data);
+    const auto cached = cache.Load(1, 100, Loader(image, calls));
+    CHECK(calls == 1);
+    CHECK(Near(cached, image));
+}
+
+TEST_CASE(StampChangeReloads) {
+    SdCard sd;
+    const auto old_image = MakeImage(64, 64, 3);
+    const auto new_image = MakeImage(64, 64, 4);
+    u32 calls{};
+
+    ThumbCache cache{"test"};
+    cache.Load(1, 100, Loader(old_image, calls));
+    CHECK(cache.Load(1, 101, Loader(new_image, calls)).data == new_image.data);
+    CHECK(calls == 2);
+
+    // the new image replaced the old one.
+    CHECK(!Near(old_image, new_image));
+    CHECK(Near(cache.Load(1, 101, Loader(old_image, calls)), new_image));
+    CHECK(calls == 2);
+}
+
+TEST_CASE(PersistsWhenReopened) {
+    SdCard sd;
+    u32 calls{};
+    std::vector<ImageResult> images;
+    for (u32 i = 0; i < 16; i++) {
+        images.emplace_back(MakeImage(32 + i, 32, i));
+    }
+
+    {
+        ThumbCache cache{"test"};
+        for (u32 i = 0; i < images.size(); i++) {
+            cache.Load(i, i, Loader(images[i], calls));
+        }
+    }
+
+    ThumbCache cache{"test"};
+    for (u32 i = 0; i < images.size(); i++) {
+        CHECK(Near(cache.Load(i, i, Loader(images[i], calls)), images[i]));
+    }
+    CHECK(calls == images.size());
+}
+
+TEST_CASE(FailedLoadsAreNotCached) {
+    SdCard sd;
+    const ImageResult empty{};
+    const auto image = MakeImage(32, 32, 5);
+    u32 calls{};
+
+    ThumbCache cache{"test"};
+    CHECK(cache.Load(1, 100, Loader(empty, calls)).data.empty());
+    CHECK(cache.Load(1, 100, Loader(image, calls)).data == image.data);
+    CHECK(calls == 2);
+}
+
+TEST_CASE(OldestIsReplacedWhenFull) {
+    SdCard sd;
+    const auto image = MakeImage(8, 8, 6);
+    u32 calls{};
+
+    ThumbCache cache{"test"};
+    for (u32 i = 0; i <= ThumbCache::MAX_ENTRIES; i++) {
+        cache.Load(i, 0, Loader(image, calls));
+    }
+    CHECK(calls == ThumbCache::MAX_ENTRIES + 1);
+
+    // the first entry's slot was reused by the last.
+    cache.Load(ThumbCache::MAX_ENTRIES, 0, Loader(image, calls));
+    cache.Load(1, 0, Loader(image, calls));
+    CHECK(calls == ThumbCache::MAX_ENTRIES + 1);
+    cache.Load(0, 0, Loader(image, calls));
+    CHECK(calls == ThumbCache::MAX_ENTRIES + 2);
+}
+
+TEST_CASE(DataIsCapped) {
+    SdCard sd;
+    u32 calls{};
+
+    // noise doesn't compress well, each jpeg is over a byte per pixel.
+    const auto size = ThumbCache::THUMB_SIZE;
+    std::vector<ImageResult> images;
+    u64 seed = 8;
+    for (u32 i = 0; i < ThumbCache::MAX_DATA_SIZE / (size * size) + 8; i++) {
+        auto& image = images.emplace_back(std::vector<u8>(size * size * 4), size, size);
+        for (auto& c : image.data) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            c = seed >> 56;
+        }
+    }
+
+    ThumbCache cache{"test"};
+    for (u32 i = 0; i < images.size(); i++) {
+        cache.Load(i, 0, Loader(images[i], calls));
+    }
+    CHECK(calls == images.size());
+    CHECK(std::filesystem::file_size(sd.Path(CACHE_FILE)) <= ThumbCache::MAX_DATA_SIZE + 1024 * 64);
+
+    // the newest are still cached, the first were written over.
+    for (u32 i = images.size() - 8; i < images.size(); i++) {
+        CHECK(!cache.Load(i, 0, Loader(images[i], calls)).data.empty());
+    }
+    CHECK(calls == images.size());
+    CHECK(cache.Load(0, 0, Loader(images[0], calls)).data == images[0].data);
+    CHECK(calls == images.size() + 1);
+}
+
+TEST_CASE(CorruptFileIsRecreated) {
+    SdCard sd;
+    const auto image = MakeImage(32, 32, 7);
+    u32 calls{};
+
+    {
+        ThumbCache cache{"test"};
+        cache.Load(1, 100, Loader(image, calls));
+    }
+
+    if (auto f = std::fopen(sd.Path(CACHE_FILE).c_str(), "r+b")) {
+        std::fputs("garbage", f);
+        std::fclose(f);
+    }
+
+    ThumbCache cache{"test"};
+    CHECK(cache.Load(1, 100, Loader(image, calls)).data == image.data);
+    CHECK(calls == 2);
+    CHECK(Near(cache.Load(1, 100, Loader(image, calls)), image));
+    CHECK(calls == 2);
+}
+
+TEST_CASE(RemoveDeletesTheFile) {
+    SdCard sd;
+    const auto image = MakeImage(32, 32, 8);
+    u32 calls{};
+
+    {
+        ThumbCache cache{"test"};
+        cache.Load(1, 100, Loader(image, calls));
+    }
+
+    CHECK(std::filesystem::exists(sd.Path(CACHE_FILE)));
+    ThumbCache::Remove("test");
+    CHECK(!std::filesystem::exists(sd.Path(CACHE_FILE)));
+    // nothing to remove.
+    ThumbCache::Remove("test");
+}
+
+TEST_CASE(ConcurrentLoads) {
+    SdCard sd;
+    std::vector<ImageResult> images;
+    for (u32 i = 0; i < 64; i++) {
+        images.emplace_back(MakeImage(200, 200, i));
+    }
+
+    ThumbCache cache{"test"};
+    std::vector<ImageResult> expected;
+    for (u32 i = 0; i < images.size(); i++) {
+        u32 calls{};
+        expected.emplace_back(cache.Load(i, 0, Loader(images[i], calls)));
+    }
+
+    // every other key is replaced with a new stamp whilst the rest are read.
+    std::atomic<u32> mismatches{};
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (u32 i = t; i < images.size() * 4; i++) {
+                const auto key = i % images.size();
+                const auto stamp = key & 1 ? i / images.size() : 0;
+                const auto image = cache.Load(key, stamp, [&images, key]() { return images[key]; });
+                if (!Near(image, expected[key])) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(mismatches == 0);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,177 @@
+#include "test.hpp"
+#include "threaded_file_transfer.hpp"
+#include <cstring>
+#include <set>
+
+// thread::Transfer must produce the same output in every mode, including
+// when the decompress stage changes the size of the data, or hands its
+// buffers to the write thread rather than copying them.
+
+namespace sphaira {
+namespace {
+
+auto MakeInput(u64 size) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        data[i] = i * 7 + (i >> 13);
+    }
+    return data;
+}
+
+auto Copy(const std::vector<u8>& in, thread::Mode mode, std::vector<u8>& out) -> Result {
+    ui::ProgressBox pbox{0, "", "", nullptr};
+    out.resize(in.size());
+
+    return thread::Transfer(&pbox, in.size(),
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            size = std::min<s64>(size, in.size() - off);
+            std::memcpy(data, in.data() + off, size);
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            R_UNLESS(off + size <= (s64)out.size(), 0x1);
+            std::memcpy(out.data() + off, data, size);
+            R_SUCCEED();
+        },
+        mode
+    );
+}
+
+TEST_CASE(CopyAllModes) {
+    // sizes around the buffer size and tiny sizes.
+    for (const auto size : {1ULL, 4096ULL, 1024ULL * 1024 * 4, 1024ULL * 1024 * 4 + 1, 1024ULL * 1024 * 13 + 17}) {
+        const auto in = MakeInput(size);
+        for (const auto mode : {thread::Mode::MultiThreaded, thread::Mode::SingleThreaded, thread::Mode::SingleThreadedIfSmaller}) {
+            std::vector<u8> out;
+            CHECK_RC(Copy(in, mode, out));
+            CHECK(in == out);
+        }
+    }
+}
+
+TEST_CASE(DecompressShrinks) {
+    // every other byte is dropped, like compressing, the output is half the size.
+    const auto in = MakeInput(1024 * 1024 * 9 + 2);
+    std::vector<u8> out;
+    ui::ProgressBox pbox{0, "", "", nullptr};
+
+    const auto rc = thread::Transfer(&pbox, in.size(),
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            size = std::min<s64>(size, in.size() - off);
+            std::memcpy(data, in.data() + off, size);
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [&](void* data, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
+            R_UNLESS(!(off % 2) && !(size % 2), 0x1);
+            std::vector<u8> buf(size / 2);
+            for (s64 i = 0; i < size / 2; i++) {
+                buf[i] = static_cast<const u8*>(data)[i * 2];
+            }
+            return callback(buf.data(), buf.size());
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            R_UNLESS(off == (s64)out.size(), 0x1);
+            out.insert(out.end(), (const u8*)data, (const u8*)data + size);
+            R_SUCCEED();
+        }
+    );
+
+    CHECK_RC(rc);
+    CHECK(out.size() == in.size() / 2);
+    bool match = out.size() == in.size() / 2;
+    for (u64 i = 0; match && i < out.size(); i++) {
+        match = out[i] == in[i * 2];
+    }
+    CHECK(match);
+}
+
+TEST_CASE(DecompressSwapsBuffers) {
+    // the output is written out of leases swapped with the write thread, mixed
+    // with copies, so the copies land in the smaller buffers that were swapped in.
+    const auto in = MakeInput(1024 * 1024 * 9 + 5);
+    std::vector<u8> out;
+    std::set<const u8*> swapped;
+    u32 written_in_place{};
+    ui::ProgressBox pbox{0, "", "", nullptr};
+
+    const auto rc = thread::Transfer(&pbox, in.size(),
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            size = std::min<s64>(size, in.size() - off);
+            std::memcpy(data, in.data() + off, size);
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [&](void* _data, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
+            auto data = (const u8*)_data;
+            while (size) {
+                // a few bytes are copied, the rest is swapped in 100KiB pieces.
+                const auto copy_size = std::min<s64>(size, 33);
+                R_TRY(callback(data, copy_size));
+                data += copy_size;
+                size -= copy_size;
+
+                const auto swap_size = std::min<s64>(size, 1024 * 100);
+                auto lease = utils::pool::Acquire(swap_size);
+                R_UNLESS(lease, 0x1);
+                std::memcpy(lease.data(), data, swap_size);
+                swapped.emplace(lease.data());
+                R_TRY(callback.Swap(lease, swap_size));
+                data += swap_size;
+                size -= swap_size;
+            }
+            R_SUCCEED();
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            R_UNLESS(off == (s64)out.size(), 0x1);
+            if (swapped.contains((const u8*)data)) {
+                written_in_place++;
+            }
+            out.insert(out.end(), (const u8*)data, (const u8*)data + size);
+            R_SUCCEED();
+        }
+    );
+
+    CHECK_RC(rc);
+    CHECK(out == in);
+    CHECK(written_in_place >= in.size() / (1024 * 100 + 33));
+}
+
+TEST_CASE(ReadErrorIsReturned) {
+    ui::ProgressBox pbox{0, "", "", nullptr};
+    const auto rc = thread::Transfer(&pbox, 1024 * 1024 * 16,
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            R_UNLESS(off < 1024 * 1024 * 8, 0x1234);
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            R_SUCCEED();
+        }
+    );
+
+    CHECK(rc == 0x1234);
+}
+
+TEST_CASE(Cancel) {
+    ui::ProgressBox pbox{0, "", "", nullptr};
+    pbox.RequestExit();
+
+    const auto rc = thread::Transfer(&pbox, 1024 * 1024 * 64,
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            R_SUCCEED();
+        }
+    );
+
+    CHECK(R_FAILED(rc));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,160 @@
+#include "test.hpp"
+#include "usb/base.hpp"
+#include <cstring>
+#include <optional>
+
+// usb::Base::TransferAll / ReadAllCrc32c must give the same data and crc32c
+// as a single plain copy, whatever size the host completes each transfer with.
+// the fake only copies the data once a transfer completes, so touching a
+// buffer whilst it is still in flight shows up as a mismatch.
+
+namespace sphaira {
+namespace {
+
+struct FakeUsb final : usb::Base {
+    FakeUsb() : usb::Base{UINT64_MAX} {}
+
+    Result Init() override {
+        R_SUCCEED();
+    }
+
+    Result IsUsbConnected(u64 timeout) override {
+        R_SUCCEED();
+    }
+
+    // data sent by the host for reads.
+    std::vector<u8> host_in{};
+    u64 host_in_off{};
+    // data received by the host for writes.
+    std::vector<u8> host_out{};
+    // if set, each transfer completes with at most this many bytes.
+    u32 max_transfer{};
+    u64 seed{0x1234};
+    u32 transfer_count{};
+
+protected:
+    Event *GetCompletionEvent(UsbSessionEndpoint ep) override {
+        return nullptr;
+    }
+
+    Result TransferAsync(UsbSessionEndpoint ep, void *buffer, u32 remaining, u32 size, u32 *out_xfer_id) override {
+        R_UNLESS(!m_xfer, 0x1);
+        R_UNLESS(!((u64)buffer & 0xFFF), 0x2);
+
+        auto& xfer = m_xfer.emplace(ep, static_cast<u8*>(buffer), size);
+        if (ep == UsbSessionEndpoint_In) {
+            xfer.snapshot.assign(xfer.buffer, xfer.buffer + size);
+        }
+
+        *out_xfer_id = ++transfer_count;
+        R_SUCCEED();
+    }
+
+    Result WaitTransferCompletion(UsbSessionEndpoint ep, u64 timeout) override {
+        R_UNLESS(m_xfer && m_xfer->ep == ep, 0x3);
+        auto& xfer = *m_xfer;
+
+        xfer.transferred = xfer.size;
+        if (max_transfer) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            xfer.transferred = std::min<u32>(xfer.size, 1 + (seed >> 33) % max_transfer);
+        }
+
+        if (ep == UsbSessionEndpoint_Out) {
+            xfer.transferred = std::min<u64>(xfer.transferred, host_in.size() - host_in_off);
+            std::memcpy(xfer.buffer, host_in.data() + host_in_off, xfer.transferred);
+            host_in_off += xfer.transferred;
+        } else {
+            // the buffer must not change whilst in flight.
+            R_UNLESS(!std::memcmp(xfer.snapshot.data(), xfer.buffer, xfer.size), 0x4);
+            host_out.insert(host_out.end(), xfer.buffer, xfer.buffer + xfer.transferred);
+        }
+
+        R_SUCCEED();
+    }
+
+    Result GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_requested_size, u32 *out_transferred_size) override {
+        R_UNLESS(m_xfer && xfer_id == transfer_count, 0x5);
+        *out_transferred_size = m_xfer->transferred;
+        m_xfer.reset();
+        R_SUCCEED();
+    }
+
+private:
+    struct Xfer {
+        UsbSessionEndpoint ep;
+        u8* buffer;
+        u32 size;
+        std::vector<u8> snapshot{};
+        u32 transferred{};
+    };
+
+    std::optional<Xfer> m_xfer{};
+};
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+constexpr u32 SIZES[]{1, 0x1000, 1024 * 1024 - 1, 1024 * 1024, 1024 * 1024 + 1, 1024 * 1024 * 5 + 123, 1024 * 1024 * 16};
+constexpr u32 MAX_TRANSFERS[]{0, 1000, 1024 * 700, 1024 * 1024 * 3};
+
+TEST_CASE(ReadMatchesCopy) {
+    for (const auto size : SIZES) {
+        for (const auto max_transfer : MAX_TRANSFERS) {
+            FakeUsb usb;
+            usb.host_in = MakeInput(size, size);
+            usb.max_transfer = max_transfer;
+
+            std::vector<u8> out(size);
+            u32 crc32c{};
+            CHECK_RC(usb.ReadAllCrc32c(out.data(), out.size(), &crc32c));
+            CHECK(out == usb.host_in);
+            CHECK(crc32c == crc32cCalculate(out.data(), out.size()));
+
+            // plain reads must match too.
+            usb.host_in_off = 0;
+            std::vector<u8> out2(size);
+            CHECK_RC(usb.TransferAll(true, out2.data(), out2.size()));
+            CHECK(out2 == usb.host_in);
+        }
+    }
+}
+
+TEST_CASE(WriteMatchesCopy) {
+    for (const auto size : SIZES) {
+        for (const auto max_transfer : MAX_TRANSFERS) {
+            FakeUsb usb;
+            usb.max_transfer = max_transfer;
+
+            const auto in = MakeInput(size, size + 1);
+            CHECK_RC(usb.TransferAll(false, const_cast<u8*>(in.data()), in.size()));
+            CHECK(usb.host_out == in);
+        }
+    }
+}
+
+TEST_CASE(LargePacketsAreSplit) {
+    FakeUsb usb;
+    usb.host_in = MakeInput(1024 * 1024 * 4, 1);
+
+    std::vector<u8> out(usb.host_in.size());
+    CHECK_RC(usb.TransferAll(true, out.data(), out.size()));
+    CHECK(usb.transfer_count == 4);
+}
+
+TEST_CASE(TooLargeIsRejected) {
+    FakeUsb usb;
+    std::vector<u8> out(1024 * 1024 * 16 + 1);
+    CHECK(usb.TransferAll(true, out.data(), out.size()) == Result_UsbBadTransferSize);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
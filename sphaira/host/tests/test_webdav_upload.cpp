@@ -0,0 +1,100 @@
+#include "test.hpp"
+#include "http_server.hpp"
+#include "net_mount.hpp"
+
+// uploads to a webdav mount are split into parallel PATCH requests if the
+// server supports sabre/dav partial updates, otherwise they're a single PUT.
+// the first chunk is always a PUT, so small files are never patched.
+// either way, the server must end up with the same file.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = seed >> 56;
+    }
+    return data;
+}
+
+struct Fixture {
+    Fixture(const http::Options& options, const net::Extra& extra) {
+        server.SetOptions(options);
+        server.AddFile("/dir/.keep", {});
+        server.Start();
+        mount = net::Mount(sd, "WEBDAV", devoptab::MountWebdavAll, server.Url(), extra);
+    }
+
+    // uploads, then checks what the server received.
+    bool Upload(net::Device& device, const std::vector<u8>& data, u64 chunk_size) {
+        std::vector<u8> out;
+        return device.Write("/dir/file.bin", data, chunk_size) && server.GetFile("/dir/file.bin", out) && out == data;
+    }
+
+    http::Server server;
+    net::SdCard sd;
+    fs::FsPath mount;
+};
+
+TEST_CASE(PartialUpdateUploadsInParallel) {
+    Fixture f{{.partial_update = true}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+    CHECK(device.devoptab);
+
+    // not a multiple of the chunk size, written in odd sizes.
+    const auto data = MakeInput(1024 * 1024 * 9 + 777, 1);
+    CHECK(f.Upload(device, data, 1000 * 333));
+    CHECK(f.server.GetRequestCount("PUT") == 1);
+    CHECK(f.server.GetRequestCount("PATCH") == 4);
+    CHECK(f.server.GetMaxConnections() > 1);
+
+    // overwriting truncates.
+    const auto small = MakeInput(1024 * 100, 2);
+    CHECK(f.Upload(device, small, 1024 * 64));
+}
+
+TEST_CASE(SmallFileIsASinglePut) {
+    Fixture f{{.partial_update = true}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    // exactly one chunk.
+    const auto data = MakeInput(1024 * 1024 * 2, 5);
+    CHECK(f.Upload(device, data, 1024 * 64));
+    CHECK(f.server.GetRequestCount("PUT") == 1);
+    CHECK(f.server.GetRequestCount("PATCH") == 0);
+}
+
+TEST_CASE(SingleStreamWithoutPartialUpdate) {
+    Fixture f{{}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    const auto data = MakeInput(1024 * 1024 * 5 + 3, 3);
+    CHECK(f.Upload(device, data, 1024 * 64));
+    CHECK(f.server.GetRequestCount("PUT") == 1);
+    CHECK(f.server.GetRequestCount("PATCH") == 0);
+}
+
+TEST_CASE(SingleStreamWithOneConnection) {
+    Fixture f{{.partial_update = true}, {{"connections", "1"}, {"upload_buffer", "1024"}}};
+    net::Device device{f.mount};
+
+    const auto data = MakeInput(1024 * 1024 * 5 + 3, 4);
+    CHECK(f.Upload(device, data, 1024 * 64));
+    CHECK(f.server.GetRequestCount("PATCH") == 0);
+}
+
+TEST_CASE(EmptyFileIsCreated) {
+    Fixture f{{.partial_update = true}, {{"connections", "4"}}};
+    net::Device device{f.mount};
+
+    CHECK(f.Upload(device, {}, 1024 * 64));
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,355 @@
+#include "test.hpp"
+#include "zip_builder.hpp"
+#include "fs.hpp"
+#include "app.hpp"
+#include <cstdlib>
+#include <filesystem>
+
+// devoptab::MountZip must read back stored and deflated entries, and reject
+// malformed end records without overflowing or allocating from them.
+// the seek index of large deflate entries is only saved when enabled, the
+// index file is rewritten rather than appended to and bad records are ignored.
+// indexes that aren't open are freed once they take too much memory.
+
+namespace sphaira {
+namespace {
+
+using namespace test;
+
+struct TempDir {
+    TempDir() {
+        std::snprintf(path, sizeof(path), "/tmp/sphaira_test_zip_XXXXXX");
+        mkdtemp(path);
+    }
+
+    ~TempDir() {
+        // stdio DeleteDirectoryRecursively() isn't implemented.
+        std::filesystem::remove_all(path);
+    }
+
+    auto File(const char* name) const -> fs::FsPath {
+        fs::FsPath out;
+        std::snprintf(out, sizeof(out), "%s/%s", path, name);
+        return out;
+    }
+
+    char path[PATH_MAX];
+};
+
+auto MakeInput(u64 size, u64 seed) {
+    std::vector<u8> data(size);
+    for (u64 i = 0; i < size; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        // compressible, but not trivially so.
+        data[i] = 'a' + ((seed >> 60) & 7);
+    }
+    return data;
+}
+
+// the zip is read through the fs for as long as it's mounted.
+fs::FsStdio g_fs{};
+
+auto Mount(const fs::FsPath& path, fs::FsPath& mount) -> Result {
+    return devoptab::MountZip(&g_fs, path, mount);
+}
+
+// stands in for the sd card, indexes are only saved for zips on the sd card.
+struct SdFs final : fs::FsStdio {
+    bool IsSd() const override { return true; }
+};
+
+SdFs g_sd_fs{};
+
+// must match devoptab_zip.cpp.
+constexpr u64 SEEK_PERSIST_MIN_SIZE = 1024 * 1024 * 64;
+constexpr u64 SEEK_INDEX_MAX_SIZE = 1024 * 1024 * 32;
+constexpr u64 SEEK_CACHE_MAX_SIZE = 1024 * 1024 * 8;
+// offsets of fields in the index record header.
+constexpr u64 RECORD_SIZE_OFF = 8;
+constexpr u64 RECORD_LOCAL_HDR_OFF = 16;
+constexpr u64 RECORD_COUNT_OFF = 36;
+constexpr u64 RECORD_FIRST_POINT_IN_OFF = 56;
+
+// a deflate entry large enough for its index to be saved.
+struct BigZip {
+    BigZip() : data{MakeInput(SEEK_PERSIST_MIN_SIZE + 1024 * 1024, 6)} {
+        path = dir.File("big.zip");
+        index_path = path + ".sidx";
+        zip::WriteFile(path, zip::Build({{"big.bin", data, true}}));
+    }
+
+    auto Mount(fs::FsPath& mount) -> Result {
+        return devoptab::MountZip(&g_sd_fs, path, mount);
+    }
+
+    // reads the whole entry so that the index is complete.
+    bool ReadAll(const fs::FsPath& mount) {
+        std::vector<u8> out(data.size());
+        return zip::ReadFile(mount, "big.bin", 0, out) && out == data;
+    }
+
+    // reads from random offsets, which uses the index to seek backwards.
+    bool ReadRandom(const fs::FsPath& mount) {
+        u64 seed = 0x1234;
+        for (u32 i = 0; i < 16; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            const auto off = (seed >> 16) % (data.size() - 1000);
+            std::vector<u8> out(1000);
+            if (!zip::ReadFile(mount, "big.bin", off, out) || std::memcmp(out.data(), data.data() + off, out.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto ReadIndex() -> std::vector<u8> {
+        std::vector<u8> out;
+        g_sd_fs.read_entire_file(index_path, out);
+        return out;
+    }
+
+    TempDir dir;
+    const std::vector<u8> data;
+    fs::FsPath path;
+    fs::FsPath index_path;
+};
+
+template<typename T>
+auto Get(const std::vector<u8>& data, u64 off) -> T {
+    T value{};
+    std::memcpy(&value, data.data() + off, sizeof(value));
+    return value;
+}
+
+template<typename T>
+void Set(std::vector<u8>& data, u64 off, T value) {
+    std::memcpy(data.data() + off, &value, sizeof(value));
+}
+
+TEST_CASE(ReadsStoredAndDeflated) {
+    TempDir dir;
+    const std::vector<zip::Entry> entries{
+        {"stored.bin", MakeInput(1024 * 100, 1), false},
+        {"deflate.bin", MakeInput(1024 * 1024 * 3, 2), true},
+    };
+
+    const auto path = dir.File("test.zip");
+    CHECK(zip::WriteFile(path, zip::Build(entries)));
+
+    fs::FsPath mount;
+    CHECK_RC(Mount(path, mount));
+
+    for (const auto& e : entries) {
+        std::vector<u8> out(e.data.size());
+        CHECK(zip::ReadFile(mount, e.name.c_str(), 0, out));
+        CHECK(out == e.data);
+
+        // seek into the middle.
+        std::vector<u8> part(1234);
+        CHECK(zip::ReadFile(mount, e.name.c_str(), e.data.size() / 2, part));
+        CHECK(!std::memcmp(part.data(), e.data.data() + e.data.size() / 2, part.size()));
+    }
+
+    devoptab::UmountNeworkDevice(mount);
+}
+
+TEST_CASE(WrappingCentralDirectoryIsRejected) {
+    TempDir dir;
+    zip::EndRecord end;
+    auto data = zip::Build({{"a.bin", MakeInput(100, 3), false}}, &end, false);
+
+    // offset + size wraps around to a small value.
+    end.central_directory_size = UINT64_MAX - 100;
+    end.file_hdr_off = 200;
+    zip::AppendEndRecord(data, end, true);
+
+    const auto path = dir.File("wrap.zip");
+    CHECK(zip::WriteFile(path, data));
+
+    fs::FsPath mount;
+    CHECK(R_FAILED(Mount(path, mount)));
+}
+
+TEST_CASE(HugeEntryCountIsRejected) {
+    TempDir dir;
+    zip::EndRecord end;
+    auto data = zip::Build({{"a.bin", MakeInput(100, 4), false}}, &end, false);
+
+    // the central directory is valid, but claims far more entries than it holds.
+    end.total_entries = 1ULL << 60;
+    zip::AppendEndRecord(data, end, true);
+
+    const auto path = dir.File("count.zip");
+    CHECK(zip::WriteFile(path, data));
+
+    fs::FsPath mount;
+    CHECK(R_FAILED(Mount(path, mount)));
+}
+
+TEST_CASE(Zip64EndRecordIsRead) {
+    TempDir dir;
+    zip::EndRecord end;
+    const auto input = MakeInput(1000, 5);
+    auto data = zip::Build({{"a.bin", input, true}}, &end, false);
+    zip::AppendEndRecord(data, end, true);
+
+    const auto path = dir.File("zip64.zip");
+    CHECK(zip::WriteFile(path, data));
+
+    fs::FsPath mount;
+    CHECK_RC(Mount(path, mount));
+
+    std::vector<u8> out(input.size());
+    CHECK(zip::ReadFile(mount, "a.bin", 0, out));
+    CHECK(out == input);
+    devoptab::UmountNeworkDevice(mount);
+}
+
+TEST_CASE(SeekIndexIsOptional) {
+    App::zip_seek_index = false;
+    BigZip zip;
+
+    fs::FsPath mount;
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+
+    CHECK(!g_sd_fs.FileExists(zip.index_path));
+}
+
+TEST_CASE(SeekIndexIsSavedOnce) {
+    App::zip_seek_index = true;
+    BigZip zip;
+
+    fs::FsPath mount;
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+
+    const auto index = zip.ReadIndex();
+    CHECK(!index.empty());
+    CHECK(Get<u64>(index, RECORD_SIZE_OFF) == index.size());
+
+    // loaded on the next mount, so it's not saved again.
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadRandom(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+
+    CHECK(zip.ReadIndex() == index);
+    CHECK(!g_sd_fs.FileExists(zip.index_path + ".tmp"));
+}
+
+TEST_CASE(BadSeekIndexIsReplaced) {
+    App::zip_seek_index = true;
+    BigZip zip;
+
+    fs::FsPath mount;
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+    const auto index = zip.ReadIndex();
+
+    // more points than the record has room for.
+    auto bad = index;
+    Set<u32>(bad, RECORD_COUNT_OFF, UINT32_MAX);
+    CHECK_RC(g_sd_fs.write_entire_file(zip.index_path, bad));
+
+    // the bad record is ignored, then replaced once the index is rebuilt.
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadRandom(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+
+    CHECK(zip.ReadIndex() == index);
+}
+
+TEST_CASE(SeekIndexIsCompacted) {
+    App::zip_seek_index = true;
+    BigZip zip;
+
+    fs::FsPath mount;
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+    const auto index = zip.ReadIndex();
+
+    // a stale record of this entry, which is too small for its points.
+    auto stale = std::vector<u8>(index.begin(), index.begin() + RECORD_FIRST_POINT_IN_OFF);
+    Set<u64>(stale, RECORD_SIZE_OFF, stale.size());
+
+    // fill the file with records of other entries, up to the max size.
+    std::vector<u8> file;
+    const auto count = (SEEK_INDEX_MAX_SIZE - stale.size()) / index.size();
+    CHECK(count * index.size() + index.size() > SEEK_INDEX_MAX_SIZE);
+    for (u64 i = 0; i < count; i++) {
+        auto record = index;
+        Set<u64>(record, RECORD_LOCAL_HDR_OFF, 1000 + i);
+        file.insert(file.end(), record.begin(), record.end());
+    }
+
+    file.insert(file.end(), stale.begin(), stale.end());
+    CHECK_RC(g_sd_fs.write_entire_file(zip.index_path, file));
+
+    CHECK_RC(zip.Mount(mount));
+    CHECK(zip.ReadAll(mount));
+    devoptab::UmountNeworkDevice(mount);
+
+    // the stale record is dropped, the new one is added at the end.
+    // the oldest record is dropped so that the file stays under the max size.
+    const auto out = zip.ReadIndex();
+    CHECK(out.size() <= SEEK_INDEX_MAX_SIZE);
+    CHECK(out.size() == count * index.size());
+    CHECK(Get<u64>(out, RECORD_LOCAL_HDR_OFF) == 1001);
+    CHECK(!std::memcmp(out.data() + out.size() - index.size(), index.data(), index.size()));
+}
+
+TEST_CASE(SeekIndexesAreEvicted) {
+    App::zip_seek_index = true;
+    TempDir dir;
+    const auto path = dir.File("many.zip");
+    const auto index_path = path + ".sidx";
+
+    // an access point every 1MiB, each with a 32KiB window, so each index is 2MiB
+    // and all of them don't fit in memory.
+    const auto data = MakeInput(SEEK_PERSIST_MIN_SIZE, 7);
+    const char* names[] = {"0.bin", "1.bin", "2.bin", "3.bin", "4.bin"};
+    static_assert(5 * 1024 * 1024 * 2 > SEEK_CACHE_MAX_SIZE);
+
+    std::vector<zip::Entry> entries;
+    for (const auto name : names) {
+        entries.push_back({name, data, true});
+    }
+    zip::WriteFile(path, zip::Build(entries));
+
+    fs::FsPath mount;
+    CHECK_RC(devoptab::MountZip(&g_sd_fs, path, mount));
+
+    std::vector<u8> out(data.size());
+    for (const auto name : names) {
+        CHECK(zip::ReadFile(mount, name, 0, out));
+        CHECK(out == data);
+    }
+
+    // indexes are only saved once built, so the index file is saved again only
+    // for entries whose index had to be rebuilt.
+    CHECK(g_sd_fs.FileExists(index_path));
+    CHECK_RC(g_sd_fs.DeleteFile(index_path));
+
+    // the most recent index is still in memory.
+    CHECK(zip::ReadFile(mount, names[4], 0, out));
+    CHECK(out == data);
+    CHECK(!g_sd_fs.FileExists(index_path));
+
+    // the first was evicted.
+    CHECK(zip::ReadFile(mount, names[0], 0, out));
+    CHECK(out == data);
+    CHECK(g_sd_fs.FileExists(index_path));
+
+    devoptab::UmountNeworkDevice(mount);
+}
+
+} // namespace
+} // namespace sphaira
+
+TEST_MAIN()
@@ -0,0 +1,178 @@
+#pragma once
+
+// writes small zips for the zip devoptab tests and benchmarks.
+// entries are either stored or raw deflate, optionally with a zip64 end record.
+
+#include "utils/devoptab.hpp"
+#include <sys/iosupport.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace sphaira::test::zip {
+
+struct Entry {
+    std::string name;
+    std::vector<u8> data;
+    bool deflate;
+};
+
+struct EndRecord {
+    u64 total_entries;
+    u64 central_directory_size;
+    u64 file_hdr_off;
+};
+
+template<typename T>
+inline void Append(std::vector<u8>& out, T value) {
+    const auto off = out.size();
+    out.resize(off + sizeof(value));
+    std::memcpy(out.data() + off, &value, sizeof(value));
+}
+
+inline auto Deflate(const std::vector<u8>& data, int level = 1) -> std::vector<u8> {
+    z_stream z{};
+    deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+    std::vector<u8> out(deflateBound(&z, data.size()));
+    z.next_in = const_cast<Bytef*>(data.data());
+    z.avail_in = data.size();
+    z.next_out = out.data();
+    z.avail_out = out.size();
+    deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+// writes the end record, zip64 adds the zip64 end record and locator before it.
+inline void AppendEndRecord(std::vector<u8>& out, const EndRecord& end, bool zip64) {
+    if (zip64) {
+        const u64 end_record_off = out.size();
+        Append<u32>(out, 0x6064B50);
+        Append<u64>(out, 56 - 12);
+        Append<u16>(out, 45);
+        Append<u16>(out, 45);
+        Append<u32>(out, 0);
+        Append<u32>(out, 0);
+        Append<u64>(out, end.total_entries);
+        Append<u64>(out, end.total_entries);
+        Append<u64>(out, end.central_directory_size);
+        Append<u64>(out, end.file_hdr_off);
+
+        Append<u32>(out, 0x7064B50);
+        Append<u32>(out, 0);
+        Append<u64>(out, end_record_off);
+        Append<u32>(out, 1);
+    }
+
+    Append<u32>(out, 0x6054B50);
+    Append<u16>(out, 0);
+    Append<u16>(out, 0);
+    Append<u16>(out, zip64 ? UINT16_MAX : end.total_entries);
+    Append<u16>(out, zip64 ? UINT16_MAX : end.total_entries);
+    Append<u32>(out, zip64 ? UINT32_MAX : end.central_directory_size);
+    Append<u32>(out, zip64 ? UINT32_MAX : end.file_hdr_off);
+    Append<u16>(out, 0);
+}
+
+// returns the zip, end is filled with the values of the end record.
+inline auto Build(const std::vector<Entry>& entries, EndRecord* out_end = nullptr, bool write_end = true) -> std::vector<u8> {
+    std::vector<u8> out;
+    std::vector<u8> central;
+
+    for (const auto& e : entries) {
+        const auto data = e.deflate ? Deflate(e.data) : e.data;
+        const u32 crc = crc32(0, e.data.data(), e.data.size());
+        const u32 local_hdr_off = out.size();
+
+        Append<u32>(out, 0x4034B50);
+        Append<u16>(out, 20);
+        Append<u16>(out, 0);
+        Append<u16>(out, e.deflate ? 8 : 0);
+        Append<u16>(out, 0);
+        Append<u16>(out, 0x21);
+        Append<u32>(out, crc);
+        Append<u32>(out, data.size());
+        Append<u32>(out, e.data.size());
+        Append<u16>(out, e.name.size());
+        Append<u16>(out, 0);
+        out.insert(out.end(), e.name.begin(), e.name.end());
+        out.insert(out.end(), data.begin(), data.end());
+
+        Append<u32>(central, 0x2014B50);
+        Append<u16>(central, 20);
+        Append<u16>(central, 20);
+        Append<u16>(central, 0);
+        Append<u16>(central, e.deflate ? 8 : 0);
+        Append<u16>(central, 0);
+        Append<u16>(central, 0x21);
+        Append<u32>(central, crc);
+        Append<u32>(central, data.size());
+        Append<u32>(central, e.data.size());
+        Append<u16>(central, e.name.size());
+        Append<u16>(central, 0);
+        Append<u16>(central, 0);
+        Append<u16>(central, 0);
+        Append<u16>(central, 0);
+        Append<u32>(central, 0);
+        Append<u32>(central, local_hdr_off);
+        central.insert(central.end(), e.name.begin(), e.name.end());
+    }
+
+    const EndRecord end{entries.size(), central.size(), out.size()};
+    out.insert(out.end(), central.begin(), central.end());
+
+    if (out_end) {
+        *out_end = end;
+    }
+
+    if (write_end) {
+        AppendEndRecord(out, end, false);
+    }
+
+    return out;
+}
+
+inline bool WriteFile(const char* path, const std::vector<u8>& data) {
+    auto f = std::fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    const auto written = std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+    return written == data.size();
+}
+
+// reads size bytes at off from a file of a mounted zip, returns false on error.
+inline bool ReadFile(const fs::FsPath& mount, const char* name, s64 off, std::vector<u8>& out) {
+    const auto devoptab = GetDeviceOpTab(mount);
+    if (!devoptab) {
+        return false;
+    }
+
+    char path[PATH_MAX];
+    std::snprintf(path, sizeof(path), "%s%s", mount.s, name);
+
+    struct _reent r{};
+    r.deviceData = devoptab->deviceData;
+    void* file[2]{};
+    if (devoptab->open_r(&r, file, path, O_RDONLY, 0)) {
+        return false;
+    }
+
+    bool ok = devoptab->seek_r(&r, file, off, SEEK_SET) == off;
+    for (u64 done = 0; ok && done < out.size(); ) {
+        const auto ret = devoptab->read_r(&r, file, (char*)out.data() + done, out.size() - done);
+        ok = ret > 0;
+        done += ok ? ret : 0;
+    }
+
+    devoptab->close_r(&r, file);
+    return ok;
+}
+
+} // namespace sphaira::test::zip
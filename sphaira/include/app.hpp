@@ -101,6 +101,9 @@ public:
     static auto GetNszCompressLevel() -> u8;
     static auto GetNszThreadCount() -> u8;
     static auto GetNszBlockExponent() -> u8;
+    static auto GetTransferRingDepth() -> u32;
+    static auto GetNczBlockCacheSize() -> u64;
+    static auto GetZipSeekIndexEnable() -> bool;
 
     static void SetMtpEnable(bool enable);
     static void SetFtpEnable(bool enable);
@@ -308,6 +311,8 @@ public:
     option::OptionString m_left_menu{INI_SECTION, "left_side_menu", "FileBrowser"};
     option::OptionString m_right_menu{INI_SECTION, "right_side_menu", "Appstore"};
     option::OptionBool m_progress_boost_mode{INI_SECTION, "progress_boost_mode", true};
+    // number of buffers in each transfer ring, more smooths out uneven read / write speeds (hidden from ui).
+    option::OptionLong m_transfer_ring_depth{INI_SECTION, "transfer_ring_depth", 2};
 
     // install options
     option::OptionBool m_install_sysmmc{INI_SECTION, "install_sysmmc", false};
@@ -330,6 +335,11 @@ public:
     option::OptionBool m_lower_master_key{INI_SECTION, "lower_master_key", false};
     option::OptionBool m_lower_system_version{INI_SECTION, "lower_system_version", true};
 
+    // size in MiB of the decompressed block cache used when mounting ncz (hidden from ui).
+    option::OptionLong m_ncz_block_cache_size{INI_SECTION, "ncz_block_cache_size", 32};
+    // saves the seek index of large compressed entries next to the zip (hidden from ui).
+    option::OptionBool m_zip_seek_index{INI_SECTION, "zip_seek_index", false};
+
     // dump options
     option::OptionBool m_dump_app_folder{"dump", "app_folder", true};
     option::OptionBool m_dump_append_folder_with_xci{"dump", "append_folder_with_xci", true};
@@ -619,6 +619,7 @@ enum class SphairaResult : Result {
     UsbEmptyTransferSize,
     UsbOverflowTransferSize,
     UsbBadTotalSize,
+    UsbBadCrc32c,
 
     UsbUploadBadMagic,
     UsbUploadExit,
@@ -675,6 +676,13 @@ enum class SphairaResult : Result {
     NszTooManyBlocks,
     // set when nca finished but not all blocks were handled.
     NszMissingBlocks,
+    // failed to allocate the buffers for a thread ring.
+    ThreadRingAllocFailed,
+    // the nca being resumed does not match the data that was previously installed.
+    YatiInvalidResume,
+    CurlFailedMultiInit,
+    // failed to lease a buffer from the buffer pool.
+    PoolLeaseFailed,
 };
 
 #define MAKE_SPHAIRA_RESULT_ENUM(x) Result_##x =  MAKERESULT(Module_Sphaira, (Result)SphairaResult::x)
@@ -783,6 +791,7 @@ enum : Result {
     MAKE_SPHAIRA_RESULT_ENUM(UsbBadTransferSize),
     MAKE_SPHAIRA_RESULT_ENUM(UsbEmptyTransferSize),
     MAKE_SPHAIRA_RESULT_ENUM(UsbOverflowTransferSize),
+    MAKE_SPHAIRA_RESULT_ENUM(UsbBadCrc32c),
     MAKE_SPHAIRA_RESULT_ENUM(UsbUploadBadMagic),
     MAKE_SPHAIRA_RESULT_ENUM(UsbUploadExit),
     MAKE_SPHAIRA_RESULT_ENUM(UsbUploadBadCount),
@@ -821,6 +830,10 @@ enum : Result {
     MAKE_SPHAIRA_RESULT_ENUM(NszFailedCompressStream2),
     MAKE_SPHAIRA_RESULT_ENUM(NszTooManyBlocks),
     MAKE_SPHAIRA_RESULT_ENUM(NszMissingBlocks),
+    MAKE_SPHAIRA_RESULT_ENUM(ThreadRingAllocFailed),
+    MAKE_SPHAIRA_RESULT_ENUM(YatiInvalidResume),
+    MAKE_SPHAIRA_RESULT_ENUM(CurlFailedMultiInit),
+    MAKE_SPHAIRA_RESULT_ENUM(PoolLeaseFailed),
 };
 
 #undef MAKE_SPHAIRA_RESULT_ENUM
@@ -21,6 +21,12 @@ enum {
 
     // sets CURLOPT_NOBODY.
     Flag_NoBody = 1 << 1,
+
+    // downloads the file over several connections using range requests.
+    // an interrupted download is continued on the next attempt.
+    // falls back to a normal download if the server doesn't support ranges.
+    // this api is only available on the blocking download to file, without Flag_Cache.
+    Flag_Segmented = 1 << 2,
 };
 
 enum class Priority {
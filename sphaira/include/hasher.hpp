@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <span>
+#include <vector>
 #include <switch.h>
 
 namespace sphaira::hash {
@@ -30,4 +31,9 @@ Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& o
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out);
 Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::string& out);
 
+// hashes the source once, each type is calculated on its own thread.
+// out[i] is the hash string for types[i].
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out);
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out);
+
 } // namespace sphaira::hash
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ui/progress_box.hpp"
+#include "utils/buffer_pool.hpp"
 #include <functional>
 #include <switch.h>
 
@@ -15,7 +16,25 @@ enum class Mode {
     SingleThreadedIfSmaller,
 };
 
-using DecompressWriteCallback = std::function<Result(const void* data, s64 size)>;
+// passed to the decompress callback, outputs data to the write thread.
+struct DecompressWriteCallback {
+    using WriteFunc = std::function<Result(const void* data, s64 size)>;
+    using SwapFunc = std::function<Result(utils::pool::Lease& lease, s64 size)>;
+
+    // copies the data into the write buffers.
+    Result operator()(const void* data, s64 size) const {
+        return write(data, size);
+    }
+
+    // hands the first size bytes of the lease to the write thread without copying.
+    // the lease is swapped for a free one, which may be of a different size.
+    Result Swap(utils::pool::Lease& lease, s64 size) const {
+        return swap(lease, size);
+    }
+
+    WriteFunc write;
+    SwapFunc swap;
+};
 
 using ReadCallback = std::function<Result(void* data, s64 off, s64 size, u64* bytes_read)>;
 using DecompressCallback = std::function<Result(void* data, s64 off, s64 size, const DecompressWriteCallback& callback)>;
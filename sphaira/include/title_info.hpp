@@ -60,6 +60,9 @@ void Clear();
 // adds new entry to queue.
 void PushAsync(u64 app_id);
 void PushAsync(const std::span<const NsApplicationRecord> app_ids);
+// loads these queued entries before any others, in the order given.
+// call this with the entries that are visible, it replaces the previous call.
+void Prioritise(const std::span<const u64> app_ids);
 // gets entry without removing it from the queue.
 auto GetAsync(u64 app_id) -> ThreadResultData*;
 // single threaded title info fetch.
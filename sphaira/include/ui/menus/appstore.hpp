@@ -6,6 +6,7 @@
 #include "ui/list.hpp"
 #include "fs.hpp"
 #include "option.hpp"
+#include "utils/image_loader.hpp"
 #include <span>
 
 namespace sphaira::ui::menu::appstore {
@@ -197,6 +198,8 @@ private:
     LazyImage m_installed{};
     ImageDownloadState m_repo_download_state{ImageDownloadState::None};
     std::unique_ptr<List> m_list{};
+    // keyed by the index into m_entries, see IconKey().
+    utils::ImageLoader m_image_loader{};
 
     std::string m_search_term{};
     std::string m_author_term{};
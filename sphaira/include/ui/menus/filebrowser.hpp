@@ -8,6 +8,7 @@
 #include "option.hpp"
 #include "hasher.hpp"
 #include "nro.hpp"
+#include "utils/dir_scanner.hpp"
 #include <span>
 
 namespace sphaira::ui::menu::filebrowser {
@@ -254,6 +255,9 @@ struct FsView final : Widget {
     void UploadFiles();
 
     auto Scan(fs::FsPath new_path, bool is_walk_up = false) -> Result;
+    // adds entries and stat results from the background scan.
+    void UpdateScan();
+    void StopScan();
 
     auto GetNewPath(const FileEntry& entry) const -> fs::FsPath {
         return GetNewPath(m_path, entry.name);
@@ -304,6 +308,8 @@ struct FsView final : Widget {
     }
 
     void Sort();
+    // sorts the entries after sorted_count and merges them into the already sorted entries.
+    void SortEntries(std::vector<u32>& entries, size_t sorted_count);
     void SortAndFindLastFile(bool scan = false);
     void SetIndexFromLastFile(const LastFile& last_file);
 
@@ -322,6 +328,7 @@ struct FsView final : Widget {
     }
 
     void DisplayHash(hash::Type type);
+    void DisplayHashAll();
 
     void DisplayOptions();
     void DisplayAdvancedOptions();
@@ -358,6 +365,13 @@ struct FsView final : Widget {
     ScrollingText m_scroll_name{};
 
     bool m_is_update_folder{};
+
+    utils::DirScanner m_scanner{};
+    std::vector<FsDirectoryEntry> m_scan_entries{};
+    std::vector<utils::DirScanner::Stat> m_scan_stats{};
+    // selected once the scan has finished, unless the selection was moved.
+    std::optional<LastFile> m_scan_last_file{};
+    bool m_scan_done{true};
 };
 
 // contains all selected files for a command, such as copy, delete, cut etc.
@@ -9,6 +9,7 @@
 #include "title_info.hpp"
 #include "fs.hpp"
 #include "option.hpp"
+#include "utils/image_loader.hpp"
 #include <memory>
 #include <vector>
 #include <span>
@@ -20,6 +21,7 @@ struct Entry {
     u8 last_event{};
     NacpLanguageEntry lang{};
     int image{};
+    bool image_failed{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
 
@@ -98,6 +100,10 @@ private:
     s64 m_index{}; // where i am in the array
     s64 m_selected_count{};
     std::unique_ptr<List> m_list{};
+    // keyed by the app_id.
+    utils::ImageLoader m_image_loader{};
+    // visible entries whose title info is still loading, see title::Prioritise().
+    std::vector<u64> m_visible_pending{};
     bool m_is_reversed{};
     bool m_dirty{};
 
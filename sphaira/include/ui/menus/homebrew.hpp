@@ -5,6 +5,8 @@
 #include "nro.hpp"
 #include "fs.hpp"
 #include "option.hpp"
+#include "utils/image_loader.hpp"
+#include "utils/thumb_cache.hpp"
 
 namespace sphaira::ui::menu::homebrew {
 
@@ -82,6 +84,10 @@ private:
 
     s64 m_index{}; // where i am in the array
     std::unique_ptr<List> m_list{};
+    // keyed by the nro path, declared before the loader as it's used by the workers.
+    utils::ThumbCache m_thumb_cache{"homebrew"};
+    // keyed by the index into m_entries.
+    utils::ImageLoader m_image_loader{};
     bool m_dirty{};
 
     option::OptionLong m_sort{INI_SECTION, "sort", SortType::SortType_AlphabeticalStar};
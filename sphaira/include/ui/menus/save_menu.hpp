@@ -6,6 +6,7 @@
 #include "fs.hpp"
 #include "option.hpp"
 #include "dumper.hpp"
+#include "utils/image_loader.hpp"
 #include <memory>
 #include <vector>
 #include <span>
@@ -23,6 +24,7 @@ enum BackupFlag {
 struct Entry final : FsSaveDataInfo {
     NacpLanguageEntry lang{};
     int image{};
+    bool image_failed{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
 
@@ -107,6 +109,10 @@ private:
     s64 m_index{}; // where i am in the array
     s64 m_selected_count{};
     std::unique_ptr<List> m_list{};
+    // keyed by the application_id, saves of the same app share the request.
+    utils::ImageLoader m_image_loader{};
+    // visible entries whose title info is still loading, see title::Prioritise().
+    std::vector<u64> m_visible_pending{};
     bool m_is_reversed{};
     bool m_dirty{};
 
@@ -30,6 +30,9 @@ struct Menu final : MenuBase {
 
     void ThreadFunction();
 
+private:
+    void StartConnectionThread();
+
 private:
     std::unique_ptr<yati::source::Usb> m_usb_source{};
     bool m_was_mtp_enabled{};
@@ -37,6 +40,9 @@ private:
     Thread m_thread{};
     std::atomic<State> m_state{State::None};
     std::vector<std::string> m_names{};
+    // index of the first file not yet installed, used to resume after a
+    // failed transfer if the host sends the same file list.
+    u32 m_install_index{};
 };
 
 } // namespace sphaira::ui::menu::usb
@@ -356,7 +356,7 @@ struct Action final {
             } else if constexpr(std::is_same_v<T, CallbackWithBool>) {
                 arg(down);
             } else {
-                static_assert(false, "non-exhaustive visitor!");
+                static_assert(!sizeof(T), "non-exhaustive visitor!");
             }
         }, m_callback);
     }
@@ -29,6 +29,13 @@ struct Base {
         return TransferAll(read, data, size, m_transfer_timeout);
     }
 
+    // reads all data and calculates the crc32c of it.
+    // each packet is hashed whilst the next one is being transferred.
+    Result ReadAllCrc32c(void *data, u32 size, u32 *out_crc32c, u64 timeout);
+    Result ReadAllCrc32c(void *data, u32 size, u32 *out_crc32c) {
+        return ReadAllCrc32c(data, size, out_crc32c, m_transfer_timeout);
+    }
+
     // returns the cancel event.
     auto GetCancelEvent() {
         return &m_uevent;
@@ -39,6 +46,11 @@ struct Base {
         ueventSignal(GetCancelEvent());
     }
 
+    // allows for transfers again after Cancel().
+    void ClearCancel() {
+        ueventClear(GetCancelEvent());
+    }
+
     auto GetTransferTimeout() const {
         return m_transfer_timeout;
     }
@@ -54,6 +66,14 @@ protected:
     virtual Result TransferAsync(UsbSessionEndpoint ep, void *buffer, u32 remaining, u32 size, u32 *out_xfer_id) = 0;
     virtual Result GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_requested_size, u32 *out_transferred_size) = 0;
 
+private:
+    // starts a transfer of a single packet, must be followed by WaitPacket().
+    Result BeginPacket(bool read, void *page, u32 remaining, u32 size, u32 *out_xfer_id, u64 timeout);
+    // waits for the packet started by BeginPacket() and returns the size transferred.
+    Result WaitPacket(bool read, u32 xfer_id, u32 *out_size_transferred, u64 timeout);
+    // transfers in packets, copying / hashing one whilst the next is in flight.
+    Result TransferAllInternal(bool read, void *data, u32 size, u64 timeout, u32 *out_crc32c);
+
 private:
     u64 m_transfer_timeout{};
     UEvent m_uevent{};
@@ -26,6 +26,25 @@ enum : u32 {
     FLAG_STREAM = 1 << 0,
 };
 
+// sent in arg3 of the connection handshake, the host replies with the
+// window size it accepts in arg4 of the result, 0 if unsupported (old host).
+enum : u32 {
+    CAP_NONE = 0,
+    // allows for multiple SendDataPacket to be in flight, the host replies in order.
+    CAP_PIPELINE = 1 << 0,
+};
+
+enum : u32 {
+    // max number of SendDataPacket in flight.
+    PIPELINE_WINDOW_MAX = 8,
+};
+
+// sent in arg5 of the connection handshake, so that the host can tell it apart
+// from a SendDataPacket if the handshake is sent again to resume an install.
+enum : u32 {
+    HANDSHAKE_TAG = 0x48534B30, // HSK0
+};
+
 struct UsbPacket {
     u32 magic{};
     u32 arg2{};
@@ -51,8 +70,8 @@ protected:
 };
 
 struct SendPacket : UsbPacket {
-    static SendPacket Build(u32 cmd, u32 arg3 = 0, u32 arg4 = 0) {
-        SendPacket packet{MAGIC, cmd, arg3, arg4};
+    static SendPacket Build(u32 cmd, u32 arg3 = 0, u32 arg4 = 0, u32 arg5 = 0) {
+        SendPacket packet{MAGIC, cmd, arg3, arg4, arg5};
         packet.GenerateCrc32c();
         return packet;
     }
@@ -5,11 +5,16 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <memory>
 #include <switch.h>
 
 namespace sphaira::usb::install {
 
+// true if the transfer itself failed (timeout, disconnect, corrupt packet),
+// rather than the data, so the install can be resumed once reconnected.
+auto IsTransportError(Result rc) -> bool;
+
 struct Usb {
     Usb(u64 transfer_timeout);
     ~Usb();
@@ -17,6 +22,7 @@ struct Usb {
     Result Read(void* buf, u64 off, u32 size, u64* bytes_read);
     u32 GetFlags() const;
     void SignalCancel();
+    void ClearCancel();
 
     // waits for connection and then sends file list.
     Result IsUsbConnected(u64 timeout);
@@ -33,15 +39,43 @@ struct Usb {
         return m_usb->GetCancelEvent();
     }
 
+private:
+    struct PendingRead {
+        u64 off;
+        u32 size;
+    };
+
 private:
     Result SendAndVerify(const void* data, u32 size, u64 timeout, api::ResultPacket* out = nullptr);
     Result SendAndVerify(const void* data, u32 size, api::ResultPacket* out = nullptr);
 
+    Result ReadPipelined(void* buf, u64 off, u32 size, u64* bytes_read);
+    // replaces the pipeline buffer with the next chunk, empty at the end of the file.
+    Result RefillPipeline(u32 size);
+    // receives the data for the oldest in flight read.
+    Result ReceivePending(std::vector<u8>& buf);
+    // receives and discards all in flight reads.
+    Result DrainPending();
+    void ResetPipeline(u64 off);
+
 private:
     std::unique_ptr<usb::UsbDs> m_usb{};
     Result m_open_result{};
     bool m_was_connected{};
     u32 m_flags{};
+    s64 m_file_size{};
+
+    // number of reads allowed in flight, 0 if the host doesn't support pipelining.
+    u32 m_window{};
+    // reads that have been sent but not yet received.
+    std::deque<PendingRead> m_pending{};
+    // offset of the next read to be sent.
+    u64 m_request_off{};
+    // data received from the host, not yet returned to the caller.
+    std::vector<u8> m_pipeline_buf{};
+    u64 m_pipeline_buf_off{};
+    // offset of the next byte expected to be read by the caller.
+    u64 m_pipeline_off{};
 };
 
 } // namespace sphaira::usb::install
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "defines.hpp"
+#include <switch.h>
+#include <utility>
+
+namespace sphaira::utils::pool {
+
+// buffers are page aligned so they can be passed directly to fs / usb.
+constexpr u64 ALIGN = 0x1000;
+
+struct Stats {
+    // bytes currently leased out.
+    u64 in_use;
+    // max bytes that were leased out at once.
+    u64 high_water;
+    // bytes held by the pool that are not leased out.
+    u64 cached;
+    // number of leases that needed a new allocation.
+    u64 allocs;
+    // number of leases that reused a cached buffer.
+    u64 reuses;
+};
+
+// owns a buffer leased from the pool, the buffer is returned to the pool on destruction.
+// leases can be moved (passing ownership of the buffer), but not copied.
+struct Lease {
+    Lease() = default;
+
+    ~Lease() {
+        Release();
+    }
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    Lease(Lease&& other) noexcept {
+        swap(other);
+    }
+
+    Lease& operator=(Lease&& other) noexcept {
+        if (this != &other) {
+            Release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(Lease& other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+    }
+
+    auto data() const -> u8* {
+        return m_data;
+    }
+
+    // size of the buffer, this may be larger than the size requested.
+    auto size() const -> u64 {
+        return m_size;
+    }
+
+    explicit operator bool() const {
+        return m_data != nullptr;
+    }
+
+    // returns the buffer to the pool early.
+    void Release();
+
+private:
+    friend auto Acquire(u64 size) -> Lease;
+
+    u8* m_data{};
+    u64 m_size{};
+};
+
+// returns a buffer of at least size bytes, check the lease as it's empty on failure.
+// sizes are rounded up to a power of 2 so buffers can be reused between transfers.
+auto Acquire(u64 size) -> Lease;
+
+// keeps returned buffers cached while held, so that they can be reused between transfers.
+// without a hold, the cache is freed once the last lease is returned.
+struct Hold {
+    Hold();
+    ~Hold();
+
+    Hold(const Hold&) = delete;
+    Hold& operator=(const Hold&) = delete;
+};
+
+auto GetStats() -> Stats;
+
+// frees all cached buffers.
+void Trim();
+
+} // namespace sphaira::utils::pool
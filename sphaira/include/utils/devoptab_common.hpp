@@ -2,13 +2,17 @@
 
 #include "yati/source/file.hpp"
 #include "utils/lru.hpp"
+#include "utils/buffer_pool.hpp"
 #include "location.hpp"
 #include <memory>
+#include <string>
+#include <vector>
 #include <optional>
 #include <span>
 #include <functional>
 #include <unordered_map>
 #include <curl/curl.h>
+#include <sys/stat.h>
 
 namespace sphaira::devoptab::common {
 
@@ -48,42 +52,105 @@ private:
     std::vector<u8> m_data{};
 };
 
-struct BufferedFileData {
-    u8* data{};
-    u64 off{};
-    u64 size{};
+// caches data from the source in fixed size, aligned blocks, evicting the least recently used.
+// sequential reads are detected and the blocks after the read are fetched in the background.
+// reads of a block or more that miss are read in place, only the last whole block is cached.
+struct LruBufferedData : BufferedDataBase {
+    static constexpr u32 DEFAULT_BLOCK_SIZE = 1024 * 16;
+    static constexpr u32 DEFAULT_BLOCK_COUNT = 256;
+    static constexpr u32 DEFAULT_READAHEAD = 32;
+
+    struct Config {
+        // must be a power of 2.
+        u32 block_size{DEFAULT_BLOCK_SIZE};
+        u32 block_count{DEFAULT_BLOCK_COUNT};
+        // number of blocks fetched ahead of a sequential read, 0 disables readahead.
+        u32 readahead{DEFAULT_READAHEAD};
+    };
+
+    struct Stats {
+        // blocks that were cached, or being fetched by readahead.
+        u64 hits;
+        // blocks that had to be read from the source.
+        u64 misses;
+        // blocks fetched by readahead.
+        u64 readahead;
+        // readahead blocks that were evicted without being read.
+        u64 readahead_waste;
+    };
+
+    LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size)
+    : LruBufferedData{_source, _size, Config{}} {
 
-    ~BufferedFileData() {
-        if (data) {
-            free(data);
-        }
     }
 
-    void Allocate(u64 new_size) {
-        data = (u8*)realloc(data, new_size * sizeof(*data));
-        off = 0;
-        size = 0;
-    }
-};
+    LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, const Config& config);
+    ~LruBufferedData();
 
-constexpr u64 CACHE_LARGE_ALLOC_SIZE = 1024 * 512;
-constexpr u64 CACHE_LARGE_SIZE = 1024 * 16;
+    virtual Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
 
-struct LruBufferedData : BufferedDataBase {
-    LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, u32 small = 1024, u32 large = 2)
-    : BufferedDataBase{_source, _size} {
-        buffered_small.resize(small);
-        buffered_large.resize(large);
-        lru_cache[0].Init(buffered_small);
-        lru_cache[1].Init(buffered_large);
-    }
+    auto GetStats() -> Stats;
+    // waits until readahead has nothing pending or loading.
+    void WaitIdle();
 
-    virtual Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+private:
+    struct Block {
+        // index of the block in the source.
+        u64 index{};
+        u64 size{};
+        bool valid{};
+        // set whilst readahead is filling the block.
+        bool loading{};
+        // set if fetched by readahead and not read yet.
+        bool readahead{};
+    };
+
+    using ListEntry = utils::LinkedList<Block>;
+
+    static void thread_func(void* arg);
+
+    auto GetBlockData(const Block* block) const -> u8*;
+    auto GetBlockSize(u64 index) const -> u64;
+    auto Find(u64 index) -> ListEntry*;
+    auto Evict() -> ListEntry*;
+    void Insert(ListEntry* entry, u64 index, bool loading);
+    Result Fill(ListEntry* entry, u64 index);
+    void Readahead(u64 index);
 
 private:
-    utils::Lru<BufferedFileData> lru_cache[2]{};
-    std::vector<BufferedFileData> buffered_small{}; // 1MiB (usually).
-    std::vector<BufferedFileData> buffered_large{}; // 1MiB
+    const u32 m_block_size;
+    // cleared if the readahead thread fails to start.
+    u32 m_readahead;
+
+    std::vector<Block> m_blocks{};
+    utils::Lru<Block> m_lru{};
+    std::unordered_map<u64, u32> m_index{};
+    utils::pool::Lease m_data{};
+    Stats m_stats{};
+
+    Mutex m_mutex{};
+    // signalled when readahead finishes loading blocks.
+    CondVar m_can_read{};
+    // signalled when there's readahead to do, or to quit.
+    CondVar m_can_work{};
+    // source reads are serialised as not all sources are thread safe.
+    Mutex m_source_mutex{};
+
+    // end of the last read, used to detect sequential reads.
+    u64 m_last_end{};
+    u32 m_streak{};
+
+    // readahead request, m_ra_count is 0 if there's none pending.
+    u64 m_ra_index{};
+    u64 m_ra_count{};
+    // next block that readahead hasn't requested yet.
+    u64 m_ra_next{};
+    // blocks kept ahead of the reader, doubles up to m_readahead as the stream continues.
+    u64 m_ra_window{};
+    utils::pool::Lease m_ra_buffer{};
+    Thread m_thread{};
+    bool m_thread_started{};
+    bool m_quit{};
 };
 
 bool fix_path(const char* str, char* out, bool strip_leading_slash = false);
@@ -93,7 +160,7 @@ void update_devoptab_for_read_only(devoptab_t* devoptab, bool read_only);
 struct PushPullThreadData {
     static constexpr size_t MAX_BUFFER_SIZE = 1024 * 64; // 64KB max buffer
 
-    explicit PushPullThreadData(CURL* _curl);
+    explicit PushPullThreadData(CURL* _curl, size_t buffer_size = MAX_BUFFER_SIZE);
     virtual ~PushPullThreadData();
 
     Result CreateAndStart();
@@ -109,9 +176,16 @@ struct PushPullThreadData {
 private:
     static void thread_func(void* arg);
 
+    // the buffer is used as a ring, these must be called with the mutex locked.
+    size_t ReadBuffer(char* data, size_t size);
+    size_t WriteBuffer(const char* data, size_t size);
+
 public:
     CURL* const curl{};
     std::vector<char> buffer{};
+    // read position and number of bytes stored in the buffer.
+    size_t buffer_off{};
+    size_t buffered{};
     Mutex mutex{};
     CondVar can_push{};
     CondVar can_pull{};
@@ -162,6 +236,10 @@ struct MountDevice {
     }
 
     virtual bool Mount() = 0;
+    // if true, requests are not serialised by the device lock.
+    // only mounting is locked, the device must handle everything else.
+    virtual bool IsThreadSafe() const { return false; }
+
     virtual int devoptab_open(void *fileStruct, const char *path, int flags, int mode) { return -EIO; }
     virtual int devoptab_close(void *fd) { return -EIO; }
     virtual ssize_t devoptab_read(void *fd, char *ptr, size_t len) { return -EIO; }
@@ -185,10 +263,96 @@ struct MountDevice {
     const MountConfig config;
 };
 
+struct DirEntry {
+    std::string name{};
+    // the type is always set, size and time are only valid if has_stat is set.
+    struct stat st{};
+    bool has_stat{};
+};
+using DirEntries = std::vector<DirEntry>;
+
+// caches directory listings and stat results of a network mount.
+// entries expire after the ttl, writes to the mount invalidate the paths they touch.
+struct MetadataCache {
+    enum class Lookup {
+        // not cached, the server has to be asked.
+        Miss,
+        Found,
+        // the parent listing is cached and complete, but doesn't contain the path.
+        NotFound,
+    };
+
+    static constexpr u64 DEFAULT_TTL = 30;
+
+    MetadataCache();
+    ~MetadataCache();
+
+    // ttl is in seconds, 0 disables the cache.
+    void SetTtl(u64 seconds);
+
+    // returns true if a listing was cached and has not expired.
+    bool GetDir(const std::string& path, DirEntries& out);
+    // returns the etag of the cached listing, even if it has expired.
+    auto GetDirEtag(const std::string& path) -> std::string;
+    // the server reported that the listing is unchanged, resets the ttl.
+    bool Revalidate(const std::string& path, DirEntries& out);
+    // complete should only be set if the listing is known to contain every entry.
+    void SetDir(const std::string& path, const DirEntries& entries, bool complete, const std::string& etag = {});
+
+    // checks the stat cache, followed by the parent listing.
+    auto GetStat(const std::string& path, struct stat* st) -> Lookup;
+    void SetStat(const std::string& path, const struct stat& st);
+
+    // removes the path, everything under it and the parent listing.
+    void Invalidate(const std::string& path);
+    void Clear();
+
+private:
+    struct DirListing {
+        DirEntries entries{};
+        // name to index into entries.
+        std::unordered_map<std::string, u32> lookup{};
+        std::string etag{};
+        u64 timestamp{};
+        bool complete{};
+    };
+
+    struct StatEntry {
+        struct stat st{};
+        u64 timestamp{};
+    };
+
+    bool IsFresh(u64 timestamp) const;
+
+private:
+    Mutex m_mutex{};
+    std::unordered_map<std::string, DirListing> m_dirs{};
+    std::unordered_map<std::string, StatEntry> m_stats{};
+    u64 m_ttl_ns{};
+    u64 m_hits{};
+    u64 m_misses{};
+};
+
 struct MountCurlDevice : MountDevice {
+    // number of concurrent requests used when transferring a file.
+    static constexpr long DEFAULT_CONNECTIONS = 4;
+    static constexpr long MAX_CONNECTIONS = 8;
+    // size of the buffer between the writer and the upload thread.
+    static constexpr long DEFAULT_UPLOAD_BUFFER_SIZE = 1024 * 1024;
+    // number of idle easy handles kept in the pool, any extra are freed on release.
+    static constexpr size_t MAX_IDLE_CURL = 16;
+
     using MountDevice::MountDevice;
     virtual ~MountCurlDevice();
 
+    // every request uses its own easy handle, see AcquireCurl().
+    bool IsThreadSafe() const override { return true; }
+
+    // returns an idle easy handle from the pool, or creates a new one.
+    // all handles use the same share, so connections are kept alive and reused between handles.
+    CURL* AcquireCurl();
+    void ReleaseCurl(CURL* curl);
+
     PushThreadData* CreatePushData(CURL* curl, const std::string& url, size_t offset);
     PullThreadData* CreatePullData(CURL* curl, const std::string& url, bool append = false);
 
@@ -201,19 +365,249 @@ struct MountCurlDevice : MountDevice {
     static std::string url_decode(const std::string& str);
     std::string build_url(const std::string& path, bool is_dir);
 
+    // returns the cached stat if possible, otherwise calls func and caches the result.
+    int stat_cached(const std::string& path, struct stat* st, const std::function<int(struct stat*)>& func);
+
 protected:
-    CURL* curl{};
-    CURL* transfer_curl{};
+    MetadataCache cache{};
+    long connections{DEFAULT_CONNECTIONS};
+    long upload_buffer_size{DEFAULT_UPLOAD_BUFFER_SIZE};
 
 private:
     // path extracted from the url.
     std::string m_url_path{};
     CURLU* curlu{};
+    // curlu is updated when building the url.
+    Mutex m_url_mutex{};
+    std::vector<CURL*> m_curl_pool{};
+    Mutex m_curl_pool_mutex{};
     CURLSH* m_curl_share{};
     RwLock m_rwlocks[CURL_LOCK_DATA_LAST]{};
     bool m_mounted{};
 };
 
+// reads a file as multiple concurrent range requests, which are reassembled
+// in order into a readahead window.
+// forward seeks that land inside the window keep the readahead alive.
+struct RangeReadData {
+    // size of each range request.
+    static constexpr u64 SEGMENT_SIZE = 1024 * 512;
+    // files smaller than this are read with a single stream, as there's
+    // too little to split between connections.
+    static constexpr u64 MIN_FILE_SIZE = SEGMENT_SIZE * 2;
+    // number of times a segment is requested again before the read fails.
+    static constexpr u32 MAX_RETRIES = 3;
+
+    RangeReadData(MountCurlDevice* device, const std::string& url, u64 file_size, u32 connections);
+    ~RangeReadData();
+
+    Result CreateAndStart();
+
+    // blocks until the data is available.
+    // returns the number of bytes read or a negative errno.
+    ssize_t Read(char* data, u64 off, size_t size);
+
+private:
+    enum class State { Empty, Pending, Loading, Done, Failed };
+
+    struct Segment {
+        utils::pool::Lease lease{};
+        // offset of the segment, in SEGMENT_SIZE units.
+        u64 index{};
+        u64 size{};
+        State state{};
+        // number of failed requests for this segment.
+        u32 retries{};
+        // set when the segment is no longer wanted whilst it's loading.
+        bool cancel{};
+    };
+
+    struct Worker {
+        RangeReadData* self{};
+        CURL* curl{};
+        Segment* segment{};
+        u64 expected{};
+        Thread thread{};
+        bool started{};
+    };
+
+    static void thread_func(void* arg);
+    static size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static size_t progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    // returns 0, -EAGAIN if the request can be tried again, or -EIO.
+    int Fetch(Worker* worker, u64 off);
+    auto GetSegment(u64 index) -> Segment&;
+    auto GetPending() -> Segment*;
+    void Release(u64 index);
+    void Seek(u64 index);
+    void Fill();
+
+private:
+    MountCurlDevice* const m_device;
+    const std::string m_url;
+    const u64 m_file_size;
+
+    std::vector<Segment> m_segments{};
+    std::vector<Worker> m_workers{};
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+    CondVar m_can_read{};
+
+    // first segment still wanted by the reader.
+    u64 m_first{};
+    // next segment to be requested.
+    u64 m_next{};
+    bool m_quit{};
+};
+
+// uploads a file as fixed size chunks over multiple connections.
+// the writer fills a chunk whilst the previous chunks are being uploaded.
+// the request for each chunk is made by the callback, see webdav partial updates.
+// the first chunk is uploaded before any other, so that its request can create
+// the file, a file no larger than a chunk is a single request.
+struct ChunkedUploadData {
+    // returns true if the chunk was uploaded.
+    using UploadCallback = std::function<bool(CURL* curl, u64 off, std::span<const u8> data)>;
+
+    static constexpr u64 CHUNK_SIZE = 1024 * 1024 * 2;
+
+    ChunkedUploadData(MountCurlDevice* device, const UploadCallback& callback, u32 connections);
+    ~ChunkedUploadData();
+
+    Result CreateAndStart();
+
+    // returns the number of bytes written or a negative errno.
+    ssize_t Write(const char* data, size_t size);
+    // uploads the remaining data and waits for every chunk to finish.
+    // returns 0 or a negative errno.
+    int Flush();
+
+private:
+    enum class State { Free, Filling, Pending, Uploading };
+
+    struct Chunk {
+        utils::pool::Lease lease{};
+        u64 off{};
+        u64 size{};
+        State state{};
+    };
+
+    struct Worker {
+        ChunkedUploadData* self{};
+        CURL* curl{};
+        Thread thread{};
+        bool started{};
+    };
+
+    static void thread_func(void* arg);
+    auto GetPending() -> Chunk*;
+    auto GetFree() -> Chunk*;
+    void Submit();
+
+private:
+    MountCurlDevice* const m_device;
+    const UploadCallback m_callback;
+    std::vector<Chunk> m_chunks{};
+    std::vector<Worker> m_workers{};
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+    CondVar m_can_write{};
+
+    // chunk currently being filled by the writer.
+    Chunk* m_current{};
+    // offset of the next byte written.
+    u64 m_off{};
+    // set once the first chunk has been uploaded.
+    bool m_created{};
+    bool m_error{};
+    bool m_quit{};
+};
+
+// reads a file sequentially with multiple async reads in flight, on the callers thread.
+// the backend issues the reads and services the connection, see nfs and smb2.
+// the window starts at a single block and doubles every time a block is fully read.
+struct PipelinedReadData {
+    static constexpr u32 DEFAULT_DEPTH = 8;
+    static constexpr u32 MAX_DEPTH = 32;
+    // blocks larger than this are split, servers may allow reads of several MiB.
+    static constexpr u64 MAX_BLOCK_SIZE = 1024 * 1024;
+    // max size of all in flight blocks, which caps the depth.
+    static constexpr u64 MAX_INFLIGHT_SIZE = 1024 * 1024 * 8;
+    // time to wait for a block before the read fails.
+    static constexpr u64 DEFAULT_TIMEOUT_MS = 1000 * 30;
+
+    struct Orphans;
+
+    // orphans must outlive the connection, see Drain().
+    PipelinedReadData(u64 block_size, u32 depth, Orphans& orphans, u64 timeout_ms = DEFAULT_TIMEOUT_MS);
+    virtual ~PipelinedReadData() = default;
+
+    Result Create();
+
+    // returns the number of bytes read or a negative errno.
+    ssize_t Read(char* data, u64 off, size_t size);
+
+protected:
+    struct Block {
+        utils::pool::Lease lease{};
+        u64 off{};
+        // number of bytes read, valid once no longer pending.
+        u64 size{};
+        int result{};
+        bool pending{};
+    };
+
+    // starts an async read into the block, Complete() is called once finished.
+    // returns 0 or a negative errno.
+    virtual int ReadAsync(Block* block, u64 size) = 0;
+    // waits for events on the connection, completing any finished blocks.
+    // returns 0 or a negative errno.
+    virtual int Service() = 0;
+
+    // result is the number of bytes read or a negative errno.
+    static void Complete(Block* block, int result);
+
+    // waits for every in flight read, this must be called by the derived destructor.
+    // if a read fails to finish, the blocks are given to the orphans, as the
+    // connection may still write to them.
+    void Drain();
+
+private:
+    int Wait(Block& block);
+    // gives the blocks to the orphans, used once a read has failed to finish.
+    void Orphan();
+    int Fill();
+    void Reset(u64 off);
+    void Pop();
+
+private:
+    const u64 m_block_size;
+    const u64 m_timeout_ns;
+    Orphans& m_orphans;
+    std::vector<Block> m_blocks{};
+    // index of the oldest block and the number of blocks queued.
+    u32 m_head{};
+    u32 m_count{};
+    // number of blocks allowed in flight.
+    u32 m_window{1};
+    // offset of the next block to be requested.
+    u64 m_next_off{};
+    bool m_eof{};
+};
+
+// blocks that failed to drain, owned by the device so that they're freed
+// once the connection is closed, or once their reads have finished.
+struct PipelinedReadData::Orphans {
+    // frees the blocks that are no longer in flight.
+    void Collect();
+    auto GetCount() const -> size_t { return m_blocks.size(); }
+
+private:
+    friend PipelinedReadData;
+    std::vector<std::vector<Block>> m_blocks{};
+};
+
 void LoadConfigsFromIni(const fs::FsPath& path, MountConfigs& out_configs);
 
 using CreateDeviceCallback = std::function<std::unique_ptr<MountDevice>(const MountConfig& config)>;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "utils/devoptab_common.hpp"
+#include <string>
+#include <string_view>
+
+namespace sphaira::devoptab::common {
+
+// parses a directory listing as it's downloaded, rather than buffering the whole response.
+// data is fed from the curl write callback, only an incomplete tag is kept between calls.
+struct ListingParser {
+    explicit ListingParser(DirEntries& out) : m_out{out} {}
+    virtual ~ListingParser() = default;
+
+    // returns false if the data is malformed, in which case the transfer should be aborted.
+    bool Feed(std::string_view data);
+    // must be called once all the data has been fed.
+    virtual bool Finish();
+
+    // pass the parser as the userdata.
+    static size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+protected:
+    // parses as much of the buffer as possible, returning the number of bytes consumed.
+    virtual size_t Parse(std::string_view data) = 0;
+
+protected:
+    DirEntries& m_out;
+    bool m_error{};
+
+private:
+    // unconsumed data from the previous call.
+    std::string m_buf{};
+};
+
+// parses the html generated by autoindex style listings (apache, nginx, python etc).
+// links are read from the tables, or from the body if there are no tables.
+struct HtmlListingParser final : ListingParser {
+    using ListingParser::ListingParser;
+
+private:
+    size_t Parse(std::string_view data) override;
+    void AddLink(std::string_view href, std::string_view name);
+
+private:
+    bool m_in_body{};
+    bool m_in_table{};
+    bool m_seen_table{};
+};
+
+// minimal sax style xml parser, enough for webdav responses.
+// element names are passed without their namespace prefix.
+// entities are not decoded, comments and processing instructions are skipped.
+struct XmlListingParser : ListingParser {
+    using ListingParser::ListingParser;
+
+protected:
+    virtual void OnStartElement(std::string_view name) = 0;
+    // text is the (trimmed) text since the last start element.
+    virtual void OnEndElement(std::string_view name, std::string_view text) = 0;
+
+private:
+    size_t Parse(std::string_view data) override;
+
+private:
+    std::string m_text{};
+};
+
+// parses a PROPFIND (Depth: 1) multistatus response.
+struct PropfindListingParser final : XmlListingParser {
+    // the requested path is used to skip the entry for the directory itself.
+    PropfindListingParser(DirEntries& out, const std::string& requested_path);
+
+    bool Finish() override;
+
+private:
+    void OnStartElement(std::string_view name) override;
+    void OnEndElement(std::string_view name, std::string_view text) override;
+
+private:
+    std::string m_requested_path{};
+    std::string m_href{};
+    DirEntry m_entry{};
+    bool m_in_response{};
+    bool m_in_resourcetype{};
+    bool m_seen_multistatus{};
+};
+
+} // namespace sphaira::devoptab::common
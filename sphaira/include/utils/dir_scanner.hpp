@@ -0,0 +1,111 @@
+#pragma once
+
+#include "fs.hpp"
+#include <switch.h>
+#include <vector>
+#include <deque>
+#include <array>
+#include <string>
+#include <memory>
+
+namespace sphaira::utils {
+
+// reads a directory on a background thread, so that slow mounts don't block the ui.
+// entries are handed over in batches as they are read.
+// stat (size, timestamp, dir count) is done on a pool of workers.
+struct DirScanner {
+    // max number of entries read at once.
+    static constexpr u32 BATCH_SIZE = 256;
+    static constexpr u32 MAX_STAT_WORKERS = 4;
+    // max number of entries taken per PopEntries() call, so that a fast read
+    // doesn't stall a frame copying and sorting the whole directory.
+    static constexpr u32 MAX_POP_ENTRIES = 1024 * 2;
+
+    struct Stat {
+        // index of the entry, in the order that they were read.
+        u32 index{};
+        FsDirEntryType type{};
+        Result rc{};
+        s64 file_size{-1};
+        FsTimeStampRaw time_stamp{};
+        s64 file_count{-1};
+        s64 dir_count{-1};
+    };
+
+    DirScanner();
+    ~DirScanner();
+
+    // cancels the previous scan (if any) and starts scanning the path.
+    // if stat_files is set, every file is queued for a stat as it's read.
+    Result Start(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path, bool stat_files);
+    // cancels the scan and waits for the threads to exit.
+    void Stop();
+
+    // queues a stat that is handled before any queued by the scan, newest first.
+    // entries that are already queued are moved to the front.
+    void PushStat(u32 index, FsDirEntryType type, const char* name);
+
+    // moves up to max_count entries read since the last call into out.
+    // returns true once the scan has finished and all entries have been taken.
+    bool PopEntries(std::vector<FsDirectoryEntry>& out, u32 max_count = MAX_POP_ENTRIES);
+    // number of entries read so far, including those not yet taken.
+    auto GetReadCount() -> u32;
+    // moves the stat results since the last call into out.
+    void PopStats(std::vector<Stat>& out);
+
+    // result of opening / reading the directory, valid once PopEntries() returns true.
+    auto GetResult() const -> Result {
+        return m_rc;
+    }
+
+private:
+    struct StatRequest {
+        u32 index;
+        FsDirEntryType type;
+        std::string name;
+    };
+
+    enum class StatState : u8 {
+        None,
+        Queued,
+        Done,
+    };
+
+    static void read_thread_func(void* arg);
+    static void stat_thread_func(void* arg);
+    void ReadLoop();
+    void StatLoop();
+    // must be called with the mutex locked.
+    void QueueStat(u32 index, FsDirEntryType type, const char* name, bool priority);
+
+private:
+    std::shared_ptr<fs::Fs> m_fs{};
+    fs::FsPath m_path{};
+    bool m_stat_files{};
+
+    Mutex m_mutex{};
+    CondVar m_can_stat{};
+
+    // entries read, but not yet taken.
+    // a deque so that a large backlog isn't copied as it grows.
+    std::deque<FsDirectoryEntry> m_entries{};
+    // total number of entries read.
+    u32 m_entry_count{};
+    // requested from PushStat(), handled newest first.
+    std::vector<StatRequest> m_priority{};
+    // queued by the scan, handled in order.
+    std::deque<StatRequest> m_queue{};
+    std::vector<StatState> m_stat_state{};
+    std::vector<Stat> m_stats{};
+
+    Result m_rc{};
+    bool m_read_done{};
+    bool m_quit{};
+
+    Thread m_read_thread{};
+    std::array<Thread, MAX_STAT_WORKERS> m_stat_threads{};
+    u32 m_stat_thread_count{};
+    bool m_read_thread_started{};
+};
+
+} // namespace sphaira::utils
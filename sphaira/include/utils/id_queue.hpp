@@ -0,0 +1,83 @@
+#pragma once
+
+#include <switch.h>
+#include <deque>
+#include <ranges>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+namespace sphaira::utils {
+
+// fifo of ids to load, where each id is queued once, along with a list of
+// ids to load first, such as the entries that are visible.
+// this isn't thread safe, the caller must lock.
+struct IdQueue {
+    void Reserve(size_t size) {
+        m_queued.reserve(size);
+    }
+
+    // returns false if the id is already queued.
+    bool Push(u64 id) {
+        if (!m_queued.emplace(id).second) {
+            return false;
+        }
+
+        m_ids.emplace_back(id);
+        return true;
+    }
+
+    // the queued ids are popped before any others, in the order given.
+    // this replaces the previous list, ids that are not in it are popped later on.
+    // returns false if none of the ids are queued.
+    bool Prioritise(std::span<const u64> ids) {
+        m_priority.clear();
+        for (const auto id : std::views::reverse(ids)) {
+            if (m_queued.contains(id)) {
+                m_priority.emplace_back(id);
+            }
+        }
+
+        return !m_priority.empty();
+    }
+
+    // priority is set if the id came from the priority list.
+    bool Pop(u64& id, bool& priority) {
+        // an id in either list that isn't in m_queued has already been popped.
+        while (!m_priority.empty()) {
+            id = m_priority.back();
+            m_priority.pop_back();
+            if (m_queued.erase(id)) {
+                priority = true;
+                return true;
+            }
+        }
+
+        while (!m_ids.empty()) {
+            id = m_ids.front();
+            m_ids.pop_front();
+            if (m_queued.erase(id)) {
+                priority = false;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    auto Contains(u64 id) const -> bool {
+        return m_queued.contains(id);
+    }
+
+    auto Size() const -> size_t {
+        return m_queued.size();
+    }
+
+private:
+    std::deque<u64> m_ids{};
+    std::unordered_set<u64> m_queued{};
+    // stored in reverse order, so the next id is at the back.
+    std::vector<u64> m_priority{};
+};
+
+} // namespace sphaira::utils
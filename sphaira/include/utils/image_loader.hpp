@@ -0,0 +1,84 @@
+#pragma once
+
+#include "image.hpp"
+#include <switch.h>
+#include <functional>
+#include <deque>
+#include <array>
+#include <unordered_map>
+
+namespace sphaira::utils {
+
+// loads and decodes images on a pool of workers, so that drawing a list never
+// waits on file io or decoding. only creating the texture is left to the ui.
+//
+// images are requested every frame whilst they are visible, any that are still
+// queued and weren't requested again by the next Sweep() are dropped.
+struct ImageLoader {
+    static constexpr u32 DEFAULT_WORKERS = 2;
+    static constexpr u32 MAX_WORKERS = 4;
+    // max time spent creating textures per frame, at least one is always created.
+    static constexpr u64 DEFAULT_UPLOAD_BUDGET_NS = 1000ULL * 1000ULL * 4ULL;
+
+    // called on a worker, returns empty data on failure.
+    using LoadCallback = std::function<ImageResult()>;
+    // called on the thread calling Upload(), the data is empty if the load failed.
+    using UploadCallback = std::function<void(u64 key, const ImageResult& image)>;
+
+    explicit ImageLoader(u32 workers = DEFAULT_WORKERS);
+    ~ImageLoader();
+
+    // marks the image as still wanted, returns false if it isn't requested.
+    // use this before Request() to avoid creating the callback every frame.
+    bool Touch(u64 key);
+    // queues the image if it's not already queued or loading.
+    // the key is chosen by the caller, eg the index of the entry.
+    // requests are handled in the order they were first made.
+    void Request(u64 key, LoadCallback&& func);
+    // drops queued requests that weren't requested since the last call.
+    // call this once per frame, after drawing.
+    void Sweep();
+    // drops everything, including images that are loading or waiting to be uploaded.
+    // use this when the keys are no longer valid, eg the list was rebuilt.
+    void Clear();
+
+    // passes loaded images to func until the budget is used up.
+    // returns the number of images passed.
+    u32 Upload(const UploadCallback& func, u64 budget_ns = DEFAULT_UPLOAD_BUDGET_NS);
+
+private:
+    struct Job {
+        u64 key{};
+        LoadCallback func{};
+    };
+
+    struct Loaded {
+        u64 key{};
+        ImageResult image{};
+    };
+
+    static void thread_func(void* arg);
+    void ThreadLoop();
+    void Start();
+
+private:
+    const u32 m_worker_count;
+
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+
+    // every image that is queued, loading or waiting to be uploaded.
+    // set to true when requested since the last sweep.
+    std::unordered_map<u64, bool> m_requests{};
+    std::deque<Job> m_queue{};
+    std::deque<Loaded> m_loaded{};
+    // bumped on Clear(), images loaded before that are discarded.
+    u32 m_generation{};
+
+    std::array<Thread, MAX_WORKERS> m_threads{};
+    u32 m_thread_count{};
+    bool m_started{};
+    bool m_quit{};
+};
+
+} // namespace sphaira::utils
@@ -35,7 +35,7 @@ struct Lru {
             }
         }
 
-        list_tail = list_entry->prev->next;
+        list_tail = list_entry;
     }
 
     // moves entry to the front of the list.
@@ -64,6 +64,11 @@ struct Lru {
         return list_head->data;
     }
 
+    // returns the list entry of the data at index (as passed to Init()).
+    auto GetEntry(size_t index) {
+        return &list_flat_array[index];
+    }
+
     auto begin() const { return list_head; }
     auto end() const { return list_tail; }
 
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "defines.hpp"
+#include "utils/thread.hpp"
+#include <switch.h>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <memory>
+
+namespace sphaira::utils {
+
+// processes jobs on multiple threads, whilst keeping them in submission order.
+// jobs are pushed and popped in order by a single owner thread, whereas
+// the workers complete them in any order (the ring acts as a reorder buffer).
+//
+// each thread creates its own Worker, which must provide Result Process(Job&).
+// this allows for per-thread state, such as a zstd context.
+template<typename Job, typename Worker>
+struct OrderedWorkerPool {
+    using CreateWorker = std::function<Worker()>;
+
+    OrderedWorkerPool(const CreateWorker& create_worker = []{ return Worker{}; }) : m_create_worker{create_worker} {
+        mutexInit(std::addressof(m_mutex));
+        condvarInit(std::addressof(m_can_work));
+        condvarInit(std::addressof(m_can_pop));
+    }
+
+    OrderedWorkerPool(const OrderedWorkerPool&) = delete;
+    OrderedWorkerPool& operator=(const OrderedWorkerPool&) = delete;
+
+    ~OrderedWorkerPool() {
+        Close();
+    }
+
+    // returns the number of workers created, if 0, the caller should do the work itself.
+    auto Create(u32 thread_count, u32 depth) -> u32 {
+        m_slots.resize(depth);
+        // the thread struct must not move once created.
+        m_threads.reserve(thread_count);
+
+        for (u32 i = 0; i < thread_count; i++) {
+            auto& t = m_threads.emplace_back();
+            if (R_FAILED(utils::CreateThread(std::addressof(t), WorkerFunc, this, 1024*64))) {
+                m_threads.pop_back();
+                break;
+            }
+
+            if (R_FAILED(threadStart(std::addressof(t)))) {
+                threadClose(std::addressof(t));
+                m_threads.pop_back();
+                break;
+            }
+        }
+
+        return m_threads.size();
+    }
+
+    void Close() {
+        {
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            m_quit = true;
+            condvarWakeAll(std::addressof(m_can_work));
+        }
+
+        for (auto& t : m_threads) {
+            threadWaitForExit(std::addressof(t));
+            threadClose(std::addressof(t));
+        }
+
+        m_threads.clear();
+    }
+
+    auto IsFull() const -> bool {
+        return m_w_index - m_r_index == m_slots.size();
+    }
+
+    auto IsEmpty() const -> bool {
+        return m_w_index == m_r_index;
+    }
+
+    // returns the next free job, only valid if !IsFull().
+    auto GetBack() -> Job& {
+        return m_slots[m_w_index % m_slots.size()].job;
+    }
+
+    // submits the job returned from GetBack().
+    // if skip is set, the job is marked as done without being handed to a worker.
+    void Push(bool skip = false) {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        auto& slot = m_slots[m_w_index % m_slots.size()];
+        slot.done = skip;
+        slot.rc = 0;
+
+        m_w_index++;
+        if (!skip) {
+            condvarWakeOne(std::addressof(m_can_work));
+        }
+    }
+
+    // returns true if the oldest job has finished.
+    auto IsFrontDone() -> bool {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        return !IsEmpty() && m_slots[m_r_index % m_slots.size()].done;
+    }
+
+    // blocks until the oldest job has finished, only valid if !IsEmpty().
+    Result WaitFront(Job** out) {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        auto& slot = m_slots[m_r_index % m_slots.size()];
+        while (!slot.done) {
+            condvarWait(std::addressof(m_can_pop), std::addressof(m_mutex));
+        }
+
+        *out = std::addressof(slot.job);
+        return slot.rc;
+    }
+
+    // releases the oldest job, allowing it to be reused.
+    void Pop() {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        m_r_index++;
+        // skipped jobs may be popped before a worker steps over them.
+        m_job_index = std::max(m_job_index, m_r_index);
+    }
+
+private:
+    struct Slot {
+        Job job{};
+        bool done{};
+        Result rc{};
+    };
+
+    static void WorkerFunc(void* arg) {
+        static_cast<OrderedWorkerPool*>(arg)->WorkerFuncInternal();
+    }
+
+    void WorkerFuncInternal() {
+        auto worker = m_create_worker();
+
+        for (;;) {
+            Slot* slot{};
+            {
+                SCOPED_MUTEX(std::addressof(m_mutex));
+                // step over jobs that were skipped.
+                while (!m_quit && (m_job_index == m_w_index || m_slots[m_job_index % m_slots.size()].done)) {
+                    if (m_job_index != m_w_index) {
+                        m_job_index++;
+                    } else {
+                        condvarWait(std::addressof(m_can_work), std::addressof(m_mutex));
+                    }
+                }
+
+                if (m_quit) {
+                    break;
+                }
+
+                slot = std::addressof(m_slots[m_job_index % m_slots.size()]);
+                m_job_index++;
+            }
+
+            const auto rc = worker.Process(slot->job);
+
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            slot->rc = rc;
+            slot->done = true;
+            condvarWakeAll(std::addressof(m_can_pop));
+        }
+    }
+
+private:
+    const CreateWorker m_create_worker;
+
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+    CondVar m_can_pop{};
+
+    std::vector<Thread> m_threads{};
+    std::vector<Slot> m_slots{};
+
+    // index of the next job to be pushed.
+    u64 m_w_index{};
+    // index of the next job to be popped.
+    u64 m_r_index{};
+    // index of the next job to be handed to a worker.
+    u64 m_job_index{};
+    bool m_quit{};
+};
+
+} // namespace sphaira::utils
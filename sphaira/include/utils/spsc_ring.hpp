@@ -0,0 +1,162 @@
+#pragma once
+
+#include "defines.hpp"
+#include "utils/buffer_pool.hpp"
+#include <switch.h>
+#include <vector>
+#include <atomic>
+#include <utility>
+
+namespace sphaira::utils {
+
+// single producer / single consumer ring of preallocated buffers.
+// the producer fills the buffer at the back and pushes it, the consumer
+// uses the buffer at the front and pops it.
+// no locks are taken, a thread only blocks when the ring is full / empty.
+struct SpscRing {
+    struct Buffer {
+        // owns the memory, moved along with the data when swapped.
+        pool::Lease lease{};
+        u8* data{};
+        u64 capacity{};
+        // size of the data stored in the buffer.
+        u64 size{};
+        // offset of the data, set by the producer.
+        s64 off{};
+    };
+
+    SpscRing() {
+        ueventCreate(&m_can_push, true);
+        ueventCreate(&m_can_pop, true);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // must be called before any thread uses the ring.
+    // buffers are leased from the pool and returned when the ring is destroyed.
+    Result Create(u32 depth, u64 buffer_size) {
+        R_UNLESS(depth && m_slots.empty(), Result_ThreadRingAllocFailed);
+
+        m_slots.resize(depth);
+        for (auto& e : m_slots) {
+            e.lease = pool::Acquire(buffer_size);
+            R_UNLESS(e.lease, Result_ThreadRingAllocFailed);
+            e.data = e.lease.data();
+            e.capacity = e.lease.size();
+        }
+
+        R_SUCCEED();
+    }
+
+    // wakes up both threads, the producer can no longer push and
+    // the consumer will receive the remaining buffers followed by nullptr.
+    // called by the producer when it has finished, or by either side on error.
+    void Close() {
+        m_closed = true;
+        ueventSignal(&m_can_push);
+        ueventSignal(&m_can_pop);
+    }
+
+    auto IsClosed() const -> bool {
+        return m_closed;
+    }
+
+    // producer: returns the next free buffer, blocking if the ring is full.
+    // returns nullptr if the ring was closed.
+    auto GetBack() -> Buffer* {
+        const auto w = m_w_index.load(std::memory_order_relaxed);
+        const auto can_push = [this, w]() {
+            return m_closed || w - m_r_index < m_slots.size();
+        };
+
+        while (!can_push()) {
+            Wait(&m_can_push, m_push_waiting, can_push);
+        }
+
+        if (m_closed) {
+            return nullptr;
+        }
+
+        auto buf = &m_slots[w % m_slots.size()];
+        buf->size = 0;
+        buf->off = 0;
+        return buf;
+    }
+
+    // producer: hands the buffer returned by GetBack() to the consumer.
+    void Push() {
+        m_w_index = m_w_index.load(std::memory_order_relaxed) + 1;
+        Wake(&m_can_pop, m_pop_waiting);
+    }
+
+    // consumer: returns the oldest pushed buffer, blocking if the ring is empty.
+    // returns nullptr once the ring is closed and empty.
+    auto GetFront() -> Buffer* {
+        const auto r = m_r_index.load(std::memory_order_relaxed);
+        const auto can_pop = [this, r]() {
+            return m_closed || m_w_index != r;
+        };
+
+        while (!can_pop()) {
+            Wait(&m_can_pop, m_pop_waiting, can_pop);
+        }
+
+        if (m_w_index == r) {
+            return nullptr;
+        }
+
+        return &m_slots[r % m_slots.size()];
+    }
+
+    // consumer: releases the buffer returned by GetFront() back to the producer.
+    void Pop() {
+        m_r_index = m_r_index.load(std::memory_order_relaxed) + 1;
+        Wake(&m_can_push, m_push_waiting);
+    }
+
+    // swaps the memory backing two buffers, used to pass a buffer between
+    // rings without copying, ownership of the memory moves with the data.
+    static void SwapData(Buffer* lhs, Buffer* rhs) {
+        lhs->lease.swap(rhs->lease);
+        std::swap(lhs->data, rhs->data);
+        std::swap(lhs->capacity, rhs->capacity);
+        std::swap(lhs->size, rhs->size);
+        std::swap(lhs->off, rhs->off);
+    }
+
+private:
+    // the waiting flag is set before checking the condition so that the
+    // other side either sees the flag and signals, or we see its update.
+    template<typename F>
+    static void Wait(UEvent* event, std::atomic_bool& waiting, const F& ready) {
+        waiting = true;
+        if (!ready()) {
+            waitSingle(waiterForUEvent(event), UINT64_MAX);
+        }
+        waiting = false;
+    }
+
+    // only signal if the other side is blocked, avoids a syscall per buffer.
+    static void Wake(UEvent* event, std::atomic_bool& waiting) {
+        if (waiting) {
+            ueventSignal(event);
+        }
+    }
+
+private:
+    std::vector<Buffer> m_slots{};
+
+    // written by the producer, read by the consumer.
+    alignas(64) std::atomic<u64> m_w_index{};
+    std::atomic_bool m_pop_waiting{};
+    // written by the consumer, read by the producer.
+    alignas(64) std::atomic<u64> m_r_index{};
+    std::atomic_bool m_push_waiting{};
+
+    UEvent m_can_push{};
+    UEvent m_can_pop{};
+    std::atomic_bool m_closed{};
+};
+
+} // namespace sphaira::utils
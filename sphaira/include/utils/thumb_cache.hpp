@@ -0,0 +1,99 @@
+#pragma once
+
+#include "image.hpp"
+#include "fs.hpp"
+#include <switch.h>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sphaira::utils {
+
+// stores small copies of icons as jpeg, so that they can be drawn without
+// reading and decoding the original image.
+// thumbnails are read from the sd card, where the time taken is mostly the
+// number of bytes read, so they are kept as small as possible.
+//
+// the file is a header, followed by a fixed size index and the thumbnails,
+// so loading a thumbnail is a single read at a known offset.
+// thumbnails are written one after the other, once the end of the data is
+// reached, writing starts from the beginning again, replacing the oldest.
+// once the index is full, the oldest entry is replaced.
+struct ThumbCache {
+    // max width / height of a thumbnail, larger images are scaled down.
+    // this covers the largest grid icon, which is drawn at 174x174.
+    static constexpr u32 THUMB_SIZE = 176;
+    static constexpr u32 MAX_ENTRIES = 1024;
+    // max size of the thumbnails, this caps the size of the file.
+    static constexpr u64 MAX_DATA_SIZE = 1024 * 1024 * 16;
+
+    using LoadCallback = std::function<ImageResult()>;
+
+    // the cache is stored in /switch/sphaira/cache/thumbs/<name>.bin
+    explicit ThumbCache(const char* name);
+
+    // returns the thumbnail if the key is cached with the same stamp.
+    // otherwise, the image is loaded with func, scaled down and cached.
+    // the stamp should change whenever the image does, eg the file size and timestamp.
+    // this is safe to call from multiple threads.
+    auto Load(u64 key, u64 stamp, const LoadCallback& func) -> ImageResult;
+
+    // deletes the cache file of a cache that is no longer used.
+    static void Remove(const char* name);
+
+    // helper for building keys and stamps from a path or data.
+    static auto Hash(std::span<const u8> data) -> u64;
+    static auto Hash(std::string_view str) -> u64;
+
+private:
+    struct Header {
+        u32 magic;
+        u32 version;
+        u32 thumb_size;
+        u32 max_entries;
+        // slot that will be used by the next new entry.
+        u32 next_slot;
+        // offset in the data that the next thumbnail is written to.
+        u32 data_end;
+        u32 reserved[2];
+    };
+
+    struct Entry {
+        u64 key;
+        u64 stamp;
+        u16 w;
+        u16 h;
+        // size of the jpeg, 0 if the slot is empty.
+        u32 size;
+        // offset of the jpeg in the data.
+        u32 offset;
+        u32 reserved;
+    };
+
+    static_assert(sizeof(Header) == 0x20);
+    static_assert(sizeof(Entry) == 0x20);
+
+    bool Open();
+    bool Create();
+    bool Get(u64 key, u64 stamp, ImageResult& out);
+    void Put(u64 key, u64 stamp, const ImageResult& image);
+    Result WriteEntry(u32 slot);
+    bool IsValidEntry(const Entry& e) const;
+
+private:
+    fs::FsPath m_path{};
+    fs::FsNativeSd m_fs{};
+    fs::File m_file{};
+    Mutex m_mutex{};
+
+    Header m_header{};
+    std::vector<Entry> m_entries{};
+    // key to slot.
+    std::unordered_map<u64, u32> m_lookup{};
+    bool m_tried_open{};
+    bool m_open{};
+};
+
+} // namespace sphaira::utils
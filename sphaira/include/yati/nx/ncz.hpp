@@ -73,22 +73,52 @@ struct Section {
 };
 using Sections = std::vector<Section>;
 
+// default size of the decompressed block cache.
+constexpr u64 NCZ_BLOCK_CACHE_SIZE = 1024*1024*32;
+// the cache size is user set, so it's clamped to this range.
+constexpr u64 NCZ_BLOCK_CACHE_SIZE_MIN = 1024*1024*4;
+constexpr u64 NCZ_BLOCK_CACHE_SIZE_MAX = 1024*1024*128;
+
 struct NczBlockReader final : yati::source::Base {
-    explicit NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source);
+    struct Stats {
+        // block was found in the cache.
+        u64 hits;
+        // block had to be read and decompressed by the reader.
+        u64 misses;
+        // blocks decompressed ahead of time.
+        u64 prefetched;
+        // prefetched blocks that were evicted without ever being read.
+        u64 prefetch_wasted;
+    };
+
+    explicit NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source, u64 cache_size = NCZ_BLOCK_CACHE_SIZE);
+    ~NczBlockReader();
+
     Result Read(void *_buf, s64 off, s64 size, u64* bytes_read) override;
 
+    auto GetStats() -> Stats;
+
 private:
     struct LruData {
-        s64 offset{};
+        // index of the block stored, -1 if empty.
+        s64 block_id{-1};
         std::vector<u8> data{};
-
-        auto InRange(u64 off) const -> bool {
-            return off < offset + data.size() && off >= offset;
-        }
+        // set whilst the block is being read / decompressed.
+        bool loading{};
+        // set if prefetched and not yet read.
+        bool prefetched{};
     };
 
 private:
-    Result ReadInternal(void *_buf, s64 off, s64 size, u64* bytes_read, bool decrypt);
+    // reads and decompresses the block into out.
+    Result LoadBlock(ZSTD_DCtx* dctx, u64 block_id, std::vector<u8>& out);
+    // evicts the least recently used block that isn't loading, must be called with the mutex locked.
+    auto AcquireSlot(u64 block_id) -> LruData*;
+    // queues blocks after block_id to be prefetched if reads are sequential.
+    void UpdateReadahead(u64 block_id);
+
+    static void PrefetchFunc(void* arg);
+    void PrefetchFuncInternal();
 
 private:
     const Header m_header;
@@ -104,6 +134,34 @@ private:
     // lru cache of blocks
     std::vector<LruData> m_lru_data{};
     utils::Lru<LruData> m_lru{};
+    // maps the block id to the index in m_lru_data, -1 if not cached.
+    std::vector<s32> m_block_slots{};
+
+    // protects everything below and the cache above.
+    Mutex m_mutex{};
+    // signalled when a block has finished loading.
+    CondVar m_can_read{};
+    // signalled when there are blocks to prefetch, or on exit.
+    CondVar m_can_prefetch{};
+    // serialises reads from the source as it may not be thread safe.
+    Mutex m_source_mutex{};
+
+    ZSTD_DCtx* m_dctx{};
+    Thread m_prefetch_thread{};
+    bool m_prefetch_running{};
+    bool m_quit{};
+
+    // last block that was read, used to detect sequential reads.
+    s64 m_last_block_id{-1};
+    // number of blocks in a row that were read sequentially.
+    u32 m_sequential_count{};
+    // range of blocks to prefetch [next, end).
+    u64 m_prefetch_next{};
+    u64 m_prefetch_end{};
+    // max number of blocks to prefetch ahead of the reader.
+    u64 m_prefetch_max{};
+
+    Stats m_stats{};
 };
 
 } // namespace sphaira::ncz
@@ -19,6 +19,10 @@ struct Usb final : Base {
         m_usb->SignalCancel();
     }
 
+    void ClearCancel() {
+        m_usb->ClearCancel();
+    }
+
     bool IsStream() const override {
         return m_usb->GetFlags() & usb::api::FLAG_STREAM;
     }
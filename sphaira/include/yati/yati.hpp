@@ -63,6 +63,10 @@ struct Config {
     // if mkey is higher than fw version, the game still won't launch
     // as the fw won't have the key to decrypt keak.
     bool lower_system_version{};
+
+    // if the install fails, the placeholders are kept so that the next install
+    // of the same nca's can continue from the last written offset.
+    bool resumable{};
 };
 
 // overridable options, set to avoid
@@ -76,6 +80,7 @@ struct ConfigOverride {
     std::optional<bool> convert_to_standard_crypto{};
     std::optional<bool> lower_master_key{};
     std::optional<bool> lower_system_version{};
+    std::optional<bool> resumable{};
 };
 
 Result InstallFromFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& path, const ConfigOverride& override = {});
@@ -83,4 +88,7 @@ Result InstallFromSource(ui::ProgressBox* pbox, source::Base* source, const fs::
 Result InstallFromContainer(ui::ProgressBox* pbox, container::Base* container, const ConfigOverride& override = {});
 Result InstallFromCollections(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override = {});
 
+// deletes the placeholders kept from failed resumable installs.
+void DiscardResumeData();
+
 } // namespace sphaira::yati
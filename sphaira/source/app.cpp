@@ -764,6 +764,19 @@ auto App::GetNszBlockExponent() -> u8 {
     return NSZ_COMPRESS_BLOCK_OPTIONS[App::GetApp()->m_nsz_compress_block_exponent.Get()].value;
 }
 
+auto App::GetTransferRingDepth() -> u32 {
+    return App::GetApp()->m_transfer_ring_depth.Get();
+}
+
+auto App::GetNczBlockCacheSize() -> u64 {
+    // the option is in MiB, the reader clamps it to a sane range.
+    return std::max<long>(0, App::GetApp()->m_ncz_block_cache_size.Get()) * 1024 * 1024;
+}
+
+auto App::GetZipSeekIndexEnable() -> bool {
+    return App::GetApp()->m_zip_seek_index.Get();
+}
+
 void App::SetNxlinkEnable(bool enable) {
     if (App::GetNxlinkEnable() != enable) {
         g_app->m_nxlink_enabled.Set(enable);
@@ -1514,6 +1527,7 @@ App::App(const char* argv0) {
             else if (app->m_install_emummc.LoadFrom(Key, Value)) {}
             else if (app->m_install_sd.LoadFrom(Key, Value)) {}
             else if (app->m_progress_boost_mode.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_ring_depth.LoadFrom(Key, Value)) {}
             else if (app->m_allow_downgrade.LoadFrom(Key, Value)) {}
             else if (app->m_skip_if_already_installed.LoadFrom(Key, Value)) {}
             else if (app->m_ticket_only.LoadFrom(Key, Value)) {}
@@ -1530,6 +1544,8 @@ App::App(const char* argv0) {
             else if (app->m_convert_to_standard_crypto.LoadFrom(Key, Value)) {}
             else if (app->m_lower_master_key.LoadFrom(Key, Value)) {}
             else if (app->m_lower_system_version.LoadFrom(Key, Value)) {}
+            else if (app->m_ncz_block_cache_size.LoadFrom(Key, Value)) {}
+            else if (app->m_zip_seek_index.LoadFrom(Key, Value)) {}
         } else if (!std::strcmp(Section, "accessibility")) {
             if (app->m_text_scroll_speed.LoadFrom(Key, Value)) {}
         } else if (!std::strcmp(Section, "dump")) {
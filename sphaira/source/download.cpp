@@ -9,9 +9,13 @@
 #include <switch.h>
 #include <cstring>
 #include <cassert>
+#include <ctime>
 #include <vector>
+#include <array>
 #include <deque>
+#include <memory>
 #include <mutex>
+#include <unordered_set>
 #include <algorithm>
 #include <ranges>
 #include <curl/curl.h>
@@ -32,7 +36,31 @@ namespace {
 
 constexpr auto API_AGENT = "TotalJustice";
 constexpr u64 CHUNK_SIZE = 1024*1024;
-constexpr auto MAX_THREADS = 4;
+// max number of async transfers in progress at once.
+constexpr u32 MAX_TRANSFERS = 16;
+// max number of async transfers in progress for a single host, each uses its own connection.
+constexpr u32 MAX_HOST_CONNECTIONS = 6;
+// same as above, but for hosts that have been seen using http/2, these share a single connection.
+constexpr u32 MAX_HOST_STREAMS = 16;
+
+// number of connections used by a segmented download, see Flag_Segmented.
+constexpr u32 SEGMENT_CONNECTIONS = 4;
+// min size of a segment, files smaller than two segments are downloaded normally.
+constexpr s64 SEGMENT_MIN_SIZE = 1024*1024*2;
+// max number of segments, a segment is split in half when a connection becomes idle.
+constexpr u32 SEGMENT_MAX = 32;
+// min size left in a segment for it to be split.
+constexpr s64 SEGMENT_MIN_SPLIT = 1024*1024;
+// times a segment is retried before the download fails.
+constexpr u32 SEGMENT_MAX_RETRY = 3;
+// data is buffered per connection, so that the sd card is written in large blocks.
+constexpr u64 SEGMENT_BUFFER_SIZE = 1024*256;
+// how often the resume data is saved.
+constexpr u64 SEGMENT_SAVE_INTERVAL_NS = 1000ULL * 1000ULL * 1000ULL;
+// resume files of other downloads older than this are removed.
+constexpr u64 SEGMENT_CACHE_MAX_AGE = 60 * 60 * 24 * 7;
+// max size of the resume files of other downloads, the oldest are removed first.
+constexpr s64 SEGMENT_CACHE_MAX_SIZE = 1024LL*1024*1024*4;
 
 std::atomic_bool g_running{};
 CURLSH* g_curl_share{};
@@ -60,6 +88,35 @@ struct SeekCustomData {
     s64 size{};
 };
 
+// state of a single transfer, which must stay alive until the transfer has finished.
+// this is shared by the blocking api and the async queue.
+struct Transfer {
+    Transfer(const Api& api) : e{api} {}
+
+    ~Transfer() {
+        if (list) {
+            curl_slist_free_all(list);
+        }
+
+        if (sleep_disabled) {
+            App::SetAutoSleepDisabled(false);
+        }
+    }
+
+    Api e;
+    fs::FsNativeSd fs{};
+    fs::FsPath tmp_buf{};
+    std::string url{};
+    UploadStruct chunk_in{};
+    DataStruct chunk{};
+    SeekCustomData seek_data{};
+    Header header_in{};
+    Header header_out{};
+    struct curl_slist* list{};
+    bool has_file{};
+    bool sleep_disabled{};
+};
+
 auto generate_key_from_path(const fs::FsPath& path) -> std::string {
     const auto key = crc32Calculate(path.s, path.size());
     return std::to_string(key);
@@ -261,114 +318,102 @@ private:
     u32 m_init_ref_count{};
 };
 
-struct ThreadEntry {
-    auto Create() -> Result {
-        m_curl = curl_easy_init();
-        R_UNLESS(m_curl != nullptr, Result_CurlFailedEasyInit);
-
-        ueventCreate(&m_uevent, true);
-        R_TRY(utils::CreateThread(&m_thread, ThreadFunc, this, 1024*32));
-        R_TRY(threadStart(&m_thread));
-        R_SUCCEED();
-    }
-
-    void SignalClose() {
-        ueventSignal(&m_uevent);
-    }
-
-    void Close() {
-        SignalClose();
-        threadWaitForExit(&m_thread);
-        threadClose(&m_thread);
-        if (m_curl) {
-            curl_easy_cleanup(m_curl);
-            m_curl = nullptr;
-        }
-    }
-
-    auto InProgress() -> bool {
-        return m_in_progress == true;
-    }
-
-    auto Setup(const Api& api) -> bool {
-        assert(m_in_progress == false && "Setting up thread while active");
-        mutexLock(&m_mutex);
-        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
-
-        if (m_in_progress) {
-            return false;
+// runs every async transfer on a single curl multi handle.
+// transfers are started in priority order, with a limit per host.
+struct TransferQueue {
+    struct Pending {
+        // higher is started first, see Add().
+        u64 order{};
+        std::string host{};
+        std::unique_ptr<Transfer> transfer{};
+    };
+
+    struct Host {
+        // heap of pending transfers, ordered by Pending::order.
+        std::vector<Pending> pending{};
+        u32 active{};
+    };
+
+    // cancels an active transfer when its StopToken is signalled.
+    struct StopCallback {
+        void operator()() const {
+            queue->Cancel(id);
         }
-        m_api = api;
-        m_in_progress = true;
-        // log_write("started download :)\n");
-        ueventSignal(&m_uevent);
-        return true;
-    }
 
-    static void ThreadFunc(void* p);
+        TransferQueue* queue;
+        u64 id;
+    };
 
-    CURL* m_curl{};
-    Thread m_thread{};
-    Api m_api{};
-    std::atomic_bool m_in_progress{};
-    Mutex m_mutex{};
-    UEvent m_uevent{};
-};
+    struct Active {
+        u64 id{};
+        CURL* curl{};
+        std::string host{};
+        std::unique_ptr<Transfer> transfer{};
+        std::unique_ptr<std::stop_callback<StopCallback>> stop_callback{};
+    };
 
-struct ThreadQueueEntry {
-    Api api;
-    bool m_delete{};
-};
+    auto Create() -> Result {
+        m_multi = curl_multi_init();
+        R_UNLESS(m_multi != nullptr, Result_CurlFailedMultiInit);
 
-struct ThreadQueue {
-    std::deque<ThreadQueueEntry> m_entries{};
-    Thread m_thread{};
-    Mutex m_mutex{};
-    UEvent m_uevent{};
+        // multiplex transfers to the same host over a single http/2 connection.
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
 
-    auto Create() -> Result {
-        ueventCreate(&m_uevent, true);
         R_TRY(utils::CreateThread(&m_thread, ThreadFunc, this, 1024*32));
         R_TRY(threadStart(&m_thread));
         R_SUCCEED();
     }
 
     void SignalClose() {
-        ueventSignal(&m_uevent);
+        if (m_multi) {
+            curl_multi_wakeup(m_multi);
+        }
     }
 
     void Close() {
         SignalClose();
         threadWaitForExit(&m_thread);
         threadClose(&m_thread);
-    }
 
-    auto Add(const Api& api, bool is_upload = false) -> bool {
-        if (api.GetUrl().empty() || !api.GetOnComplete()) {
-            return false;
+        if (m_multi) {
+            curl_multi_cleanup(m_multi);
+            m_multi = nullptr;
         }
+    }
 
-        mutexLock(&m_mutex);
-        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+    auto Add(const Api& api, bool is_upload = false) -> bool;
+    void Cancel(u64 id);
 
-        switch (api.GetPriority()) {
-            case Priority::Normal:
-                m_entries.emplace_back(api).api.SetUpload(is_upload);
-                break;
-            case Priority::High:
-                m_entries.emplace_front(api).api.SetUpload(is_upload);
-                break;
-        }
+    static void ThreadFunc(void* p);
 
-        ueventSignal(&m_uevent);
-        return true;
-    }
+private:
+    void Loop();
+    void Dispatch();
+    void Start(Pending&& pending, Host& host);
+    void Finish(Active* active, CURLcode res);
 
-    static void ThreadFunc(void* p);
+private:
+    CURLM* m_multi{};
+    Thread m_thread{};
+    Mutex m_mutex{};
+
+    // pushed by Add(), moved into m_hosts by the queue thread.
+    std::vector<Pending> m_incoming{};
+    // ids of active transfers to stop, pushed by Cancel().
+    std::vector<u64> m_cancelled{};
+    u64 m_count{};
+
+    // everything below is only accessed by the queue thread.
+    std::unordered_map<std::string, Host> m_hosts{};
+    std::unordered_map<u64, std::unique_ptr<Active>> m_active{};
+    // hosts that have responded with http/2, see MAX_HOST_STREAMS.
+    std::unordered_set<std::string> m_multiplexed{};
+    // easy handles are reused so that their buffers are kept.
+    std::vector<CURL*> m_handles{};
+    u64 m_next_id{};
 };
 
-ThreadEntry g_threads[MAX_THREADS]{};
-ThreadQueue g_thread_queue;
+TransferQueue g_thread_queue;
 Cache g_cache;
 
 void GetDownloadTempPath(fs::FsPath& buf) {
@@ -503,9 +548,10 @@ auto WriteMemoryCallback(void *contents, size_t size, size_t num_files, void *us
     auto data_struct = static_cast<DataStruct*>(userp);
     const auto realsize = size * num_files;
 
-    // give it more memory
+    // give it more memory, small at first as many small transfers may be in progress at once.
     if (data_struct->data.capacity() < data_struct->offset + realsize) {
-        data_struct->data.reserve(data_struct->data.capacity() + CHUNK_SIZE);
+        const auto grow = std::clamp<u64>(data_struct->data.capacity(), 1024*64, CHUNK_SIZE);
+        data_struct->data.reserve(std::max<u64>(data_struct->offset + realsize, data_struct->data.capacity() + grow));
     }
 
     data_struct->data.resize(data_struct->offset + realsize);
@@ -680,98 +726,98 @@ void SetCommonCurlOptions(CURL* curl, const Api& e) {
     }
 
 }
-auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
+void SetHeaderList(CURL* curl, const Header& header, struct curl_slist*& list) {
+    for (const auto& [key, value] : header.m_map) {
+        if (value.empty()) {
+            continue;
+        }
+
+        // create header key value pair.
+        const auto header_str = key + ": " + value;
+
+        // try to append header chunk.
+        auto temp = curl_slist_append(list, header_str.c_str());
+        if (temp) {
+            log_write("adding header: %s\n", header_str.c_str());
+            list = temp;
+        } else {
+            log_write("failed to append header\n");
+        }
+    }
+
+    if (list) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+    }
+}
+
+auto DownloadSetup(CURL* curl, Transfer& t) -> bool {
+    const auto& e = t.e;
+
     App::SetAutoSleepDisabled(true);
-    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
+    t.sleep_disabled = true;
 
     // check if stop has been requested before starting download
     if (e.GetToken().stop_requested()) {
-        return {};
+        return false;
     }
 
-    fs::FsPath tmp_buf;
-    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
     const bool has_post = !e.GetFields().empty() && e.GetFields() != "";
-    const auto encoded_url = EncodeUrl(e.GetUrl());
-
-    DataStruct chunk;
-    Header header_in = e.GetHeader();
-    Header header_out;
-    fs::FsNativeSd fs;
+    t.has_file = !e.GetPath().empty() && e.GetPath() != "";
+    t.url = EncodeUrl(e.GetUrl());
+    t.header_in = e.GetHeader();
 
-    if (has_file) {
-        GetDownloadTempPath(tmp_buf);
-        fs.CreateDirectoryRecursivelyWithPath(tmp_buf);
+    if (t.has_file) {
+        GetDownloadTempPath(t.tmp_buf);
+        t.fs.CreateDirectoryRecursivelyWithPath(t.tmp_buf);
 
-        if (auto rc = fs.CreateFile(tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
-            log_write("failed to create file: %s\n", tmp_buf.s);
-            return {};
+        if (auto rc = t.fs.CreateFile(t.tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+            log_write("failed to create file: %s\n", t.tmp_buf.s);
+            return false;
         }
 
-        if (R_FAILED(fs.OpenFile(tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &chunk.f))) {
-            log_write("failed to open file: %s\n", tmp_buf.s);
-            return {};
+        if (R_FAILED(t.fs.OpenFile(t.tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &t.chunk.f))) {
+            log_write("failed to open file: %s\n", t.tmp_buf.s);
+            t.fs.DeleteFile(t.tmp_buf);
+            return false;
         }
 
         // only add etag if the dst file still exists.
-        if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&fs.m_fs, e.GetPath())) {
-            g_cache.get(e.GetPath(), header_in);
+        if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&t.fs.m_fs, e.GetPath())) {
+            g_cache.get(e.GetPath(), t.header_in);
         }
     }
 
-    // reserve the first chunk
-    chunk.data.reserve(CHUNK_SIZE);
-
     curl_easy_reset(curl);
     SetCommonCurlOptions(curl, e);
 
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, t.url.c_str());
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &t.header_out);
 
     if (has_post) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_POSTFIELDS, e.GetFields().c_str());
         log_write("setting post field: %s\n", e.GetFields().c_str());
     }
 
-    struct curl_slist* list = NULL;
-    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
-
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
-
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
-
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
-    }
-
-    if (list) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
-    }
+    SetHeaderList(curl, t.header_in, t.list);
 
     // write calls.
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, has_file ? WriteFileCallback : WriteMemoryCallback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, t.has_file ? WriteFileCallback : WriteMemoryCallback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &t.chunk);
+    return true;
+}
 
-    // perform download and cleanup after and report the result.
-    const auto res = curl_easy_perform(curl);
+auto DownloadFinish(CURL* curl, Transfer& t, CURLcode res) -> ApiResult {
+    const auto& e = t.e;
+    auto& fs = t.fs;
+    auto& chunk = t.chunk;
     bool success = res == CURLE_OK;
 
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-    if (has_file) {
-        ON_SCOPE_EXIT( fs.DeleteFile(tmp_buf) );
+    if (t.has_file) {
+        ON_SCOPE_EXIT( fs.DeleteFile(t.tmp_buf) );
         if (res == CURLE_OK && chunk.offset) {
             chunk.f.Write(chunk.file_offset, chunk.data.data(), chunk.offset, FsWriteOption_None);
         }
@@ -784,13 +830,13 @@ auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
             } else {
                 log_write("un-cached download: %s code: %lu\n", e.GetUrl().c_str(), http_code);
                 if (e.GetFlags() & Flag_Cache) {
-                    g_cache.set(e.GetPath(), header_out);
+                    g_cache.set(e.GetPath(), t.header_out);
                 }
 
                 // enable to log received headers.
                 #if 0
                 log_write("\n\nLOGGING HEADER\n");
-                    for (auto [a, b] : header_out.m_map) {
+                    for (auto [a, b] : t.header_out.m_map) {
                         log_write("\t%s: %s\n", a.c_str(), b.c_str());
                     }
                 log_write("\n\n");
@@ -798,7 +844,7 @@ auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
 
                 fs.DeleteFile(e.GetPath());
                 fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
-                if (R_FAILED(fs.RenameFile(tmp_buf, e.GetPath()))) {
+                if (R_FAILED(fs.RenameFile(t.tmp_buf, e.GetPath()))) {
                     success = false;
                 }
             }
@@ -812,31 +858,29 @@ auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
     }
 
     log_write("Downloaded %s code: %ld %s\n", e.GetUrl().c_str(), http_code, curl_easy_strerror(res));
-    return {success, http_code, header_out, chunk.data, e.GetPath()};
+    return {success, http_code, t.header_out, std::move(chunk.data), e.GetPath()};
 }
 
-auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
+auto UploadSetup(CURL* curl, Transfer& t) -> bool {
+    const auto& e = t.e;
+
     // check if stop has been requested before starting download
     if (e.GetToken().stop_requested()) {
-        return {};
+        return false;
     }
 
     const auto& info = e.GetUploadInfo();
     const auto url = e.GetUrl() + "/" + info.m_name;
-    const auto encoded_url = EncodeUrl(url);
-    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
-
-    UploadStruct chunk{};
-    DataStruct chunk_out{};
-    SeekCustomData seek_data{};
-    Header header_in = e.GetHeader();
-    Header header_out;
-    fs::FsNativeSd fs{};
+    auto& fs = t.fs;
+    auto& chunk = t.chunk_in;
+    t.has_file = !e.GetPath().empty() && e.GetPath() != "";
+    t.url = EncodeUrl(url);
+    t.header_in = e.GetHeader();
 
-    if (has_file) {
+    if (t.has_file) {
         if (R_FAILED(fs.OpenFile(e.GetPath(), FsOpenMode_Read, &chunk.f))) {
             log_write("failed to open file: %s\n", e.GetPath().s);
-            return {};
+            return false;
         }
 
         chunk.f.GetSize(&chunk.size);
@@ -860,15 +904,12 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
         fs.DeleteFile(folder_path);
     }
 
-    // reserve the first chunk
-    chunk_out.data.reserve(CHUNK_SIZE);
-
     curl_easy_reset(curl);
     SetCommonCurlOptions(curl, e);
 
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, t.url.c_str());
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &t.header_out);
 
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_UPLOAD, 1L);
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)chunk.size);
@@ -876,30 +917,7 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
     // instruct libcurl to create ftp folders if they don't yet exist.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_FTP_CREATE_MISSING_DIRS, CURLFTP_CREATE_DIR_RETRY);
 
-    struct curl_slist* list = NULL;
-    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
-
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
-
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
-
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
-    }
-
-    if (list) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
-    }
+    SetHeaderList(curl, t.header_in, t.list);
 
     // set callback for reading more data.
     if (info.m_callback) {
@@ -907,13 +925,13 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_READDATA, &info);
 
         if (e.GetOnUploadSeek()) {
-            seek_data.cb = e.GetOnUploadSeek();
-            seek_data.size = chunk.size;
+            t.seek_data.cb = e.GetOnUploadSeek();
+            t.seek_data.size = chunk.size;
             CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKFUNCTION, SeekCustomCallback);
-            CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKDATA, &seek_data);
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKDATA, &t.seek_data);
         }
     } else {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_READFUNCTION, has_file ? ReadFileCallback : ReadMemoryCallback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_READFUNCTION, t.has_file ? ReadFileCallback : ReadMemoryCallback);
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_READDATA, &chunk);
 
         // allow for seeking upon uploads, may be used for ftp and http.
@@ -923,21 +941,642 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
 
     // write calls.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &t.chunk);
+    return true;
+}
 
-    // perform upload and cleanup after and report the result.
-    const auto res = curl_easy_perform(curl);
-    bool success = res == CURLE_OK;
+auto UploadFinish(CURL* curl, Transfer& t, CURLcode res) -> ApiResult {
+    const bool success = res == CURLE_OK;
 
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-    if (has_file) {
-        chunk.f.Close();
+    if (t.has_file) {
+        t.chunk_in.f.Close();
+    }
+
+    log_write("Uploaded %s code: %ld %s\n", t.url.c_str(), http_code, curl_easy_strerror(res));
+    return {success, http_code, t.header_out, std::move(t.chunk.data)};
+}
+
+auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
+    Transfer t{e};
+    if (!DownloadSetup(curl, t)) {
+        return {};
+    }
+
+    // perform download and cleanup after and report the result.
+    return DownloadFinish(curl, t, curl_easy_perform(curl));
+}
+
+auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
+    Transfer t{e};
+    if (!UploadSetup(curl, t)) {
+        return {};
+    }
+
+    // perform upload and cleanup after and report the result.
+    return UploadFinish(curl, t, curl_easy_perform(curl));
+}
+
+// downloads a file over multiple connections using range requests.
+// progress is saved alongside the file, so that an interrupted download
+// continues from where it stopped on the next attempt.
+struct SegmentedDownload {
+    struct Segment {
+        // next byte to be written.
+        s64 offset;
+        // end of the segment, exclusive.
+        s64 end;
+    };
+
+    struct Meta {
+        u32 magic;
+        u32 version;
+        s64 size;
+        // hash of the url and etag / last-modified, see Probe().
+        u32 validator;
+        u32 count;
+    };
+
+    static_assert(sizeof(Segment) == 0x10);
+    static_assert(sizeof(Meta) == 0x18);
+
+    struct Connection {
+        SegmentedDownload* self{};
+        CURL* curl{};
+        struct curl_slist* list{};
+        std::string range{};
+        // data received but not yet written, starts at the segment offset.
+        std::vector<u8> buf{};
+        // index into m_segments, or -1 if idle.
+        s32 index{-1};
+        bool checked{};
+        // set if the segment can't be retried, eg a write failed.
+        bool fatal{};
+    };
+
+    SegmentedDownload(CURL* curl, const Api& e) : m_curl{curl}, m_e{e} {
+        const auto key = generate_key_from_path(e.GetPath());
+        std::snprintf(m_part_path, sizeof(m_part_path), "%s/%s.part", CACHE_PATH.s, key.c_str());
+        std::snprintf(m_meta_path, sizeof(m_meta_path), "%s/%s.meta", CACHE_PATH.s, key.c_str());
+    }
+
+    ~SegmentedDownload() {
+        for (auto& c : m_connections) {
+            if (c.curl) {
+                if (c.index >= 0) {
+                    curl_multi_remove_handle(m_multi, c.curl);
+                }
+                curl_easy_cleanup(c.curl);
+            }
+
+            if (c.list) {
+                curl_slist_free_all(c.list);
+            }
+        }
+
+        if (m_multi) {
+            curl_multi_cleanup(m_multi);
+        }
     }
 
-    log_write("Uploaded %s code: %ld %s\n", url.c_str(), http_code, curl_easy_strerror(res));
-    return {success, http_code, header_out, chunk_out.data};
+    // returns false if the server doesn't support ranges or the file is too small,
+    // in which case the file should be downloaded normally.
+    auto Probe() -> bool;
+    auto Run() -> ApiResult;
+
+private:
+    auto Open() -> bool;
+    auto Load() -> bool;
+    void Save();
+    // removes the resume files of this download.
+    void Remove();
+    void PruneCache();
+    auto Next() -> s32;
+    auto StartSegment(Connection& c, s32 index) -> bool;
+    void FinishSegment(Connection& c, CURLcode res);
+    auto Flush(Connection& c) -> bool;
+    auto GetDownloaded() const -> s64;
+
+    static auto WriteCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t;
+
+private:
+    static constexpr u32 MAGIC = 0x47455353; // SSEG
+    static constexpr u32 VERSION = 1;
+    static constexpr inline fs::FsPath CACHE_PATH{"/switch/sphaira/cache/segmented"};
+
+    CURL* const m_curl;
+    const Api& m_e;
+    fs::FsNativeSd m_fs{};
+    fs::FsPath m_part_path{};
+    fs::FsPath m_meta_path{};
+    fs::File m_file{};
+    CURLM* m_multi{};
+
+    // the url after redirects, so that each segment doesn't redirect again.
+    std::string m_url{};
+    Header m_header{};
+    long m_code{};
+    s64 m_size{};
+    u32 m_validator{};
+
+    // these always cover the whole file, see Next().
+    std::vector<Segment> m_segments{};
+    std::vector<u32> m_retries{};
+    std::array<Connection, SEGMENT_CONNECTIONS> m_connections{};
+    bool m_failed{};
+    // set if a segment was sent the whole file rather than its range.
+    bool m_range_ignored{};
+};
+
+auto SegmentedDownload::Probe() -> bool {
+    curl_easy_reset(m_curl);
+    SetCommonCurlOptions(m_curl, m_e);
+
+    const auto url = EncodeUrl(m_e.GetUrl());
+    struct curl_slist* list{};
+    ON_SCOPE_EXIT(curl_slist_free_all(list));
+
+    // ranges are of the encoded data, so request the file as is.
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_URL, url.c_str());
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_RANGE, "0-0");
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_HEADERFUNCTION, header_callback);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_HEADERDATA, &m_header);
+    SetHeaderList(m_curl, m_e.GetHeader(), list);
+
+    // stop straight away if the server ignores the range and sends the whole file.
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_WRITEFUNCTION, +[](void*, size_t size, size_t num_files, void*) -> size_t {
+        return size * num_files <= 1 ? size * num_files : 0;
+    });
+
+    const auto res = curl_easy_perform(m_curl);
+    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &m_code);
+    if (res != CURLE_OK || m_code != 206) {
+        log_write("[SEGMENT] range not supported: %s code: %ld %s\n", m_e.GetUrl().c_str(), m_code, curl_easy_strerror(res));
+        return false;
+    }
+
+    // eg, Content-Range: bytes 0-0/1234
+    const auto it = m_header.Find("content-range");
+    if (it == m_header.m_map.end() || it->second.rfind('/') == std::string::npos) {
+        return false;
+    }
+
+    m_size = std::atoll(it->second.c_str() + it->second.rfind('/') + 1);
+    if (m_size < SEGMENT_MIN_SIZE * 2) {
+        log_write("[SEGMENT] file too small: %s size: %zd\n", m_e.GetUrl().c_str(), m_size);
+        return false;
+    }
+
+    char* effective_url{};
+    curl_easy_getinfo(m_curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+    m_url = effective_url ? effective_url : url;
+
+    // the file can only be resumed if the server tells us when it has changed.
+    std::string validator;
+    if (const auto it = m_header.Find("etag"); it != m_header.m_map.end()) {
+        validator += it->second;
+    }
+    if (const auto it = m_header.Find("last-modified"); it != m_header.m_map.end()) {
+        validator += it->second;
+    }
+
+    if (!validator.empty()) {
+        validator += m_e.GetUrl();
+        m_validator = crc32Calculate(validator.data(), validator.size());
+    }
+
+    log_write("[SEGMENT] probed: %s size: %zd validator: 0x%X\n", m_url.c_str(), m_size, m_validator);
+    return true;
+}
+
+auto SegmentedDownload::Run() -> ApiResult {
+    App::SetAutoSleepDisabled(true);
+    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
+
+    if (!Open()) {
+        return {};
+    }
+
+    m_multi = curl_multi_init();
+    if (!m_multi) {
+        return {};
+    }
+
+    // each segment uses its own connection, rather than being multiplexed over one.
+    curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+
+    for (auto& c : m_connections) {
+        c.self = this;
+        c.buf.reserve(SEGMENT_BUFFER_SIZE);
+        if (!(c.curl = curl_easy_init())) {
+            return {};
+        }
+    }
+
+    auto last_save = armTicksToNs(armGetSystemTick());
+    // the resume files are kept when exiting, but not when the user cancels.
+    bool exiting{};
+    bool cancelled{};
+
+    for (;;) {
+        if (!m_failed && !exiting && !cancelled) {
+            for (auto& c : m_connections) {
+                if (c.index < 0) {
+                    if (const auto index = Next(); index >= 0 && !StartSegment(c, index)) {
+                        m_failed = true;
+                    }
+                }
+            }
+        }
+
+        if (std::ranges::none_of(m_connections, [](auto& c) { return c.index >= 0; })) {
+            break;
+        }
+
+        int running;
+        if (const auto mc = curl_multi_perform(m_multi, &running); mc != CURLM_OK) {
+            log_write("[SEGMENT] curl_multi_perform() failed: %s\n", curl_multi_strerror(mc));
+            m_failed = true;
+        }
+
+        int msgs_left;
+        while (auto msg = curl_multi_info_read(m_multi, &msgs_left)) {
+            if (msg->msg == CURLMSG_DONE) {
+                Connection* c{};
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &c);
+                FinishSegment(*c, msg->data.result);
+            }
+        }
+
+        if (!g_running) {
+            exiting = true;
+        } else if (m_e.GetToken().stop_requested() || (m_e.GetOnProgress() && !m_e.GetOnProgress()(m_size, GetDownloaded(), 0, 0))) {
+            cancelled = true;
+        }
+
+        // stop everything in progress, keeping what has been downloaded so far.
+        if (m_failed || exiting || cancelled) {
+            for (auto& c : m_connections) {
+                if (c.index >= 0) {
+                    FinishSegment(c, CURLE_ABORTED_BY_CALLBACK);
+                }
+            }
+        }
+
+        if (const auto now = armTicksToNs(armGetSystemTick()); now - last_save >= SEGMENT_SAVE_INTERVAL_NS) {
+            Save();
+            last_save = now;
+        }
+
+        curl_multi_poll(m_multi, nullptr, 0, 100, nullptr);
+    }
+
+    const auto done = std::ranges::all_of(m_segments, [](auto& s) { return s.offset == s.end; });
+    if (!done) {
+        m_file.Close();
+
+        // eg, a cdn node that doesn't support ranges, so download it from the start.
+        if (m_range_ignored && !exiting && !cancelled) {
+            log_write("[SEGMENT] range ignored, downloading normally: %s\n", m_e.GetUrl().c_str());
+            Remove();
+            return DownloadInternal(m_curl, m_e);
+        }
+
+        // a download without a validator can never be resumed.
+        if (cancelled || m_range_ignored || !m_validator) {
+            Remove();
+        } else {
+            Save();
+        }
+
+        log_write("[SEGMENT] stopped: %s downloaded: %zd / %zd\n", m_e.GetUrl().c_str(), GetDownloaded(), m_size);
+        return {false, m_code, m_header};
+    }
+
+    m_file.Close();
+    m_fs.DeleteFile(m_meta_path);
+
+    const auto& path = m_e.GetPath();
+    m_fs.DeleteFile(path);
+    m_fs.CreateDirectoryRecursivelyWithPath(path);
+    if (R_FAILED(m_fs.RenameFile(m_part_path, path))) {
+        m_fs.DeleteFile(m_part_path);
+        return {false, m_code, m_header};
+    }
+
+    log_write("[SEGMENT] downloaded: %s size: %zd segments: %zu\n", m_e.GetUrl().c_str(), m_size, m_segments.size());
+    return {true, m_code, m_header, {}, path};
+}
+
+auto SegmentedDownload::Open() -> bool {
+    PruneCache();
+
+    if (Load()) {
+        log_write("[SEGMENT] resuming: %s downloaded: %zd / %zd\n", m_e.GetUrl().c_str(), GetDownloaded(), m_size);
+    } else {
+        m_fs.DeleteFile(m_meta_path);
+        m_fs.DeleteFile(m_part_path);
+        m_fs.CreateDirectoryRecursivelyWithPath(m_part_path);
+
+        if (R_FAILED(m_fs.CreateFile(m_part_path, m_size, 0))) {
+            log_write("[SEGMENT] failed to create file: %s\n", m_part_path.s);
+            return false;
+        }
+
+        // split the file evenly between the connections.
+        const auto count = std::clamp<s64>(m_size / SEGMENT_MIN_SIZE, 1, SEGMENT_CONNECTIONS);
+        const auto segment_size = m_size / count;
+        m_segments.clear();
+        for (s64 i = 0; i < count; i++) {
+            m_segments.emplace_back(i * segment_size, i == count - 1 ? m_size : (i + 1) * segment_size);
+        }
+    }
+
+    m_retries.resize(m_segments.size());
+
+    if (R_FAILED(m_fs.OpenFile(m_part_path, FsOpenMode_Write, &m_file))) {
+        log_write("[SEGMENT] failed to open file: %s\n", m_part_path.s);
+        m_fs.DeleteFile(m_part_path);
+        return false;
+    }
+
+    return true;
+}
+
+auto SegmentedDownload::Load() -> bool {
+    if (!m_validator) {
+        return false;
+    }
+
+    fs::File f;
+    if (R_FAILED(m_fs.OpenFile(m_meta_path, FsOpenMode_Read, &f))) {
+        return false;
+    }
+
+    Meta meta;
+    u64 bytes_read;
+    if (R_FAILED(f.Read(0, &meta, sizeof(meta), 0, &bytes_read)) || bytes_read != sizeof(meta) ||
+        meta.magic != MAGIC || meta.version != VERSION || meta.size != m_size || meta.validator != m_validator ||
+        !meta.count || meta.count > SEGMENT_MAX) {
+        return false;
+    }
+
+    std::vector<Segment> segments(meta.count);
+    const auto size = segments.size() * sizeof(Segment);
+    if (R_FAILED(f.Read(sizeof(meta), segments.data(), size, 0, &bytes_read)) || bytes_read != size) {
+        return false;
+    }
+
+    for (const auto& s : segments) {
+        if (s.offset < 0 || s.offset > s.end || s.end > m_size) {
+            return false;
+        }
+    }
+
+    s64 part_size;
+    fs::File part;
+    if (R_FAILED(m_fs.OpenFile(m_part_path, FsOpenMode_Read, &part)) || R_FAILED(part.GetSize(&part_size)) || part_size != m_size) {
+        return false;
+    }
+
+    m_segments = std::move(segments);
+    return true;
+}
+
+void SegmentedDownload::Save() {
+    if (!m_validator) {
+        return;
+    }
+
+    const Meta meta{MAGIC, VERSION, m_size, m_validator, u32(m_segments.size())};
+
+    m_fs.DeleteFile(m_meta_path);
+    fs::File f;
+    if (R_FAILED(m_fs.CreateFile(m_meta_path, 0, 0)) ||
+        R_FAILED(m_fs.OpenFile(m_meta_path, FsOpenMode_Write|FsOpenMode_Append, &f)) ||
+        R_FAILED(f.Write(0, &meta, sizeof(meta), FsWriteOption_None)) ||
+        R_FAILED(f.Write(sizeof(meta), m_segments.data(), m_segments.size() * sizeof(Segment), FsWriteOption_None))) {
+        log_write("[SEGMENT] failed to save: %s\n", m_meta_path.s);
+    }
+}
+
+void SegmentedDownload::Remove() {
+    m_fs.DeleteFile(m_meta_path);
+    m_fs.DeleteFile(m_part_path);
+}
+
+void SegmentedDownload::PruneCache() {
+    struct Entry {
+        fs::FsPath path;
+        s64 size;
+        u64 modified;
+    };
+
+    fs::Dir d;
+    std::vector<FsDirectoryEntry> dir_entries;
+    if (R_FAILED(m_fs.OpenDirectory(CACHE_PATH, FsDirOpenMode_ReadFiles, &d)) || R_FAILED(d.ReadAll(dir_entries))) {
+        return;
+    }
+
+    std::vector<Entry> entries;
+    for (const auto& e : dir_entries) {
+        const auto path = fs::AppendPath(CACHE_PATH, e.name);
+        if (path == m_part_path || path == m_meta_path) {
+            continue;
+        }
+
+        FsTimeStampRaw ts{};
+        s64 size{};
+        if (R_SUCCEEDED(m_fs.FileGetSizeAndTimestamp(path, &ts, &size))) {
+            entries.emplace_back(path, size, ts.modified);
+        }
+    }
+
+    // newest first, so that the oldest are removed once over the max size.
+    std::ranges::sort(entries, [](const auto& a, const auto& b) { return a.modified > b.modified; });
+
+    const u64 now = std::time(nullptr);
+    s64 total{};
+    for (const auto& e : entries) {
+        total += e.size;
+        if (total > SEGMENT_CACHE_MAX_SIZE || (now > e.modified && now - e.modified > SEGMENT_CACHE_MAX_AGE)) {
+            log_write("[SEGMENT] removing old resume file: %s\n", e.path.s);
+            m_fs.DeleteFile(e.path);
+            total -= e.size;
+        }
+    }
+}
+
+// returns the next segment to download, or -1 if there's nothing left to start.
+auto SegmentedDownload::Next() -> s32 {
+    for (s32 i = 0; i < s32(m_segments.size()); i++) {
+        const auto& s = m_segments[i];
+        if (s.offset < s.end && std::ranges::none_of(m_connections, [i](auto& c) { return c.index == i; })) {
+            return i;
+        }
+    }
+
+    if (m_segments.size() >= SEGMENT_MAX) {
+        return -1;
+    }
+
+    // take the second half of the largest segment in progress, so that a
+    // connection which finished early helps out a slower one.
+    s32 largest{-1};
+    s64 largest_remaining{};
+    for (const auto& c : m_connections) {
+        if (c.index >= 0) {
+            const auto& s = m_segments[c.index];
+            const auto remaining = s.end - s.offset - s64(c.buf.size());
+            if (remaining > largest_remaining) {
+                largest = c.index;
+                largest_remaining = remaining;
+            }
+        }
+    }
+
+    if (largest < 0 || largest_remaining < SEGMENT_MIN_SPLIT) {
+        return -1;
+    }
+
+    // the connection stops once it reaches the new end, see WriteCallback().
+    const auto mid = m_segments[largest].end - largest_remaining / 2;
+    m_segments.emplace_back(mid, m_segments[largest].end);
+    m_segments[largest].end = mid;
+    m_retries.emplace_back();
+    return m_segments.size() - 1;
+}
+
+auto SegmentedDownload::StartSegment(Connection& c, s32 index) -> bool {
+    const auto& s = m_segments[index];
+    c.range = std::to_string(s.offset) + "-" + std::to_string(s.end - 1);
+    c.checked = false;
+    c.fatal = false;
+
+    if (c.list) {
+        curl_slist_free_all(c.list);
+        c.list = nullptr;
+    }
+
+    curl_easy_reset(c.curl);
+    SetCommonCurlOptions(c.curl, m_e);
+
+    // progress is reported for all segments at once by Run().
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_URL, m_url.c_str());
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_RANGE, c.range.c_str());
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_WRITEDATA, &c);
+    CURL_EASY_SETOPT_LOG(c.curl, CURLOPT_PRIVATE, &c);
+    SetHeaderList(c.curl, m_e.GetHeader(), c.list);
+
+    if (const auto mc = curl_multi_add_handle(m_multi, c.curl); mc != CURLM_OK) {
+        log_write("[SEGMENT] curl_multi_add_handle() failed: %s\n", curl_multi_strerror(mc));
+        return false;
+    }
+
+    c.index = index;
+    return true;
+}
+
+void SegmentedDownload::FinishSegment(Connection& c, CURLcode res) {
+    curl_multi_remove_handle(m_multi, c.curl);
+    ON_SCOPE_EXIT(c.index = -1);
+
+    // whatever was received is kept, even if the transfer failed.
+    if (!Flush(c)) {
+        c.fatal = true;
+    }
+
+    const auto& s = m_segments[c.index];
+    if (s.offset == s.end) {
+        return;
+    }
+
+    if (c.fatal || (res != CURLE_ABORTED_BY_CALLBACK && ++m_retries[c.index] > SEGMENT_MAX_RETRY)) {
+        log_write("[SEGMENT] segment failed: %zd-%zd %s\n", s.offset, s.end, curl_easy_strerror(res));
+        m_failed = true;
+    } else if (res != CURLE_ABORTED_BY_CALLBACK) {
+        log_write("[SEGMENT] retrying segment: %zd-%zd %s\n", s.offset, s.end, curl_easy_strerror(res));
+    }
+}
+
+auto SegmentedDownload::Flush(Connection& c) -> bool {
+    if (c.buf.empty()) {
+        return true;
+    }
+
+    auto& s = m_segments[c.index];
+    if (R_FAILED(m_file.Write(s.offset, c.buf.data(), c.buf.size(), FsWriteOption_None))) {
+        log_write("[SEGMENT] failed to write: %s offset: %zd\n", m_part_path.s, s.offset);
+        c.buf.clear();
+        return false;
+    }
+
+    s.offset += c.buf.size();
+    c.buf.clear();
+    return true;
+}
+
+auto SegmentedDownload::GetDownloaded() const -> s64 {
+    auto downloaded = m_size;
+    for (const auto& s : m_segments) {
+        downloaded -= s.end - s.offset;
+    }
+
+    for (const auto& c : m_connections) {
+        downloaded += c.buf.size();
+    }
+
+    return downloaded;
+}
+
+auto SegmentedDownload::WriteCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+    if (!g_running) {
+        return 0;
+    }
+
+    auto& c = *static_cast<Connection*>(userp);
+    const auto& s = c.self->m_segments[c.index];
+    const auto realsize = size * num_files;
+
+    // the server has to reply with the range that was asked for.
+    if (!c.checked) {
+        long http_code = 0;
+        curl_easy_getinfo(c.curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != 206) {
+            log_write("[SEGMENT] range ignored, code: %ld\n", http_code);
+            if (http_code == 200) {
+                c.self->m_range_ignored = true;
+            }
+            c.fatal = true;
+            return 0;
+        }
+        c.checked = true;
+    }
+
+    const auto pos = s.offset + s64(c.buf.size());
+    const auto len = std::min<s64>(realsize, s.end - pos);
+    c.buf.insert(c.buf.end(), (const u8*)contents, (const u8*)contents + len);
+
+    if (c.buf.size() >= SEGMENT_BUFFER_SIZE || pos + len == s.end) {
+        if (!c.self->Flush(c)) {
+            c.fatal = true;
+            return 0;
+        }
+    }
+
+    // the segment was split and this connection has reached its new end.
+    if (len < s64(realsize)) {
+        return 0;
+    }
+
+    return realsize;
 }
 
 void my_lock(CURL *handle, curl_lock_data data, curl_lock_access laccess, void *useptr) {
@@ -948,96 +1587,236 @@ void my_unlock(CURL *handle, curl_lock_data data, void *useptr) {
     mutexUnlock(&g_mutex_share[data]);
 }
 
-void ThreadEntry::ThreadFunc(void* p) {
-    auto data = static_cast<ThreadEntry*>(p);
+// the url up until the path, eg https://github.com:443
+auto GetHostFromUrl(const std::string& url) -> std::string {
+    const auto start = url.find("://");
+    if (start == std::string::npos) {
+        return {};
+    }
+
+    return url.substr(0, url.find_first_of("/?#", start + 3));
+}
+
+// sends the result to the ui, unless the transfer was cancelled.
+void PushResult(const Transfer& t, ApiResult&& result) {
+    if (g_running && t.e.GetOnComplete() && !t.e.GetToken().stop_requested()) {
+        evman::push(
+            DownloadEventData{t.e.GetOnComplete(), std::move(result), t.e.GetToken()},
+            false
+        );
+    }
+}
+
+auto TransferQueue::Add(const Api& api, bool is_upload) -> bool {
+    if (!m_multi || api.GetUrl().empty() || !api.GetOnComplete()) {
+        return false;
+    }
+
+    Pending pending{};
+    pending.host = GetHostFromUrl(api.GetUrl());
+    pending.transfer = std::make_unique<Transfer>(api);
+    pending.transfer->e.SetUpload(is_upload);
+
+    SCOPED_MUTEX(&m_mutex);
+
+    // high priority is started newest first, normal is started oldest first.
+    const auto count = m_count++;
+    switch (api.GetPriority()) {
+        case Priority::Normal:
+            pending.order = (1ULL << 62) - count;
+            break;
+        case Priority::High:
+            pending.order = (1ULL << 63) | count;
+            break;
+    }
+
+    m_incoming.emplace_back(std::move(pending));
+    curl_multi_wakeup(m_multi);
+    return true;
+}
+
+void TransferQueue::Cancel(u64 id) {
+    SCOPED_MUTEX(&m_mutex);
+    m_cancelled.emplace_back(id);
+    curl_multi_wakeup(m_multi);
+}
+
+void TransferQueue::ThreadFunc(void* p) {
+    auto data = static_cast<TransferQueue*>(p);
 
     if (!g_cache.init()) {
         log_write("failed to init json cache\n");
     }
     ON_SCOPE_EXIT(g_cache.exit());
 
+    data->Loop();
+    log_write("exited download thread queue\n");
+}
+
+void TransferQueue::Loop() {
+    std::vector<Pending> incoming;
+    std::vector<u64> cancelled;
+
     while (g_running) {
-        auto rc = waitSingle(waiterForUEvent(&data->m_uevent), UINT64_MAX);
-        // log_write("woke up\n");
-        if (!g_running) {
-            break;
+        {
+            SCOPED_MUTEX(&m_mutex);
+            std::swap(incoming, m_incoming);
+            std::swap(cancelled, m_cancelled);
         }
 
-        if (R_FAILED(rc)) {
-            continue;
+        for (auto& pending : incoming) {
+            auto& host = m_hosts[pending.host];
+            host.pending.emplace_back(std::move(pending));
+            std::ranges::push_heap(host.pending, {}, &Pending::order);
+        }
+        incoming.clear();
+
+        // the transfer may have already finished.
+        for (const auto id : cancelled) {
+            if (const auto it = m_active.find(id); it != m_active.end()) {
+                Finish(it->second.get(), CURLE_ABORTED_BY_CALLBACK);
+            }
         }
+        cancelled.clear();
 
-        const auto result = data->m_api.IsUpload() ? UploadInternal(data->m_curl, data->m_api) : DownloadInternal(data->m_curl, data->m_api);
-        if (g_running && data->m_api.GetOnComplete() && !data->m_api.GetToken().stop_requested()) {
-            evman::push(
-                DownloadEventData{data->m_api.GetOnComplete(), result, data->m_api.GetToken()},
-                false
-            );
+        Dispatch();
+
+        int running;
+        if (const auto mc = curl_multi_perform(m_multi, &running); mc != CURLM_OK) {
+            log_write("[CURL] curl_multi_perform() failed: %s\n", curl_multi_strerror(mc));
         }
 
-        data->m_in_progress = false;
-        // notify the queue that there's a space free
-        ueventSignal(&g_thread_queue.m_uevent);
+        bool finished{};
+        int msgs_left;
+        while (auto msg = curl_multi_info_read(m_multi, &msgs_left)) {
+            if (msg->msg == CURLMSG_DONE) {
+                const auto curl = msg->easy_handle;
+                const auto res = msg->data.result;
+
+                Active* active{};
+                curl_easy_getinfo(curl, CURLINFO_PRIVATE, &active);
+                Finish(active, res);
+                finished = true;
+            }
+        }
+
+        // skip waiting so that the next pending transfers are started.
+        if (!finished) {
+            curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    while (!m_active.empty()) {
+        Finish(m_active.begin()->second.get(), CURLE_ABORTED_BY_CALLBACK);
+    }
+
+    for (auto curl : m_handles) {
+        curl_easy_cleanup(curl);
     }
-    log_write("exited download thread\n");
+
+    m_handles.clear();
+    m_hosts.clear();
 }
 
-void ThreadQueue::ThreadFunc(void* p) {
-    auto data = static_cast<ThreadQueue*>(p);
+void TransferQueue::Dispatch() {
+    while (m_active.size() < MAX_TRANSFERS) {
+        // find the highest priority transfer whose host isn't at the limit.
+        auto best = m_hosts.end();
+        for (auto it = m_hosts.begin(); it != m_hosts.end(); it++) {
+            const auto& host = it->second;
+            const auto limit = m_multiplexed.contains(it->first) ? MAX_HOST_STREAMS : MAX_HOST_CONNECTIONS;
+            if (host.pending.empty() || host.active >= limit) {
+                continue;
+            }
 
-    while (g_running) {
-        auto rc = waitSingle(waiterForUEvent(&data->m_uevent), UINT64_MAX);
-        log_write("[thread queue] woke up\n");
-        if (!g_running) {
-            return;
+            if (best == m_hosts.end() || host.pending.front().order > best->second.pending.front().order) {
+                best = it;
+            }
         }
-        if (R_FAILED(rc)) {
-            continue;
+
+        if (best == m_hosts.end()) {
+            break;
         }
 
-        mutexLock(&data->m_mutex);
-        ON_SCOPE_EXIT(mutexUnlock(&data->m_mutex));
-        if (data->m_entries.empty()) {
+        auto& host = best->second;
+        std::ranges::pop_heap(host.pending, {}, &Pending::order);
+        auto pending = std::move(host.pending.back());
+        host.pending.pop_back();
+
+        // transfers that were cancelled whilst pending are dropped here.
+        if (pending.transfer->e.GetToken().stop_requested()) {
             continue;
         }
 
-        // find the next avaliable thread
-        for (auto& entry : data->m_entries) {
-            if (!g_running) {
-                return;
-            }
+        Start(std::move(pending), host);
+    }
 
-            bool keep_going{};
+    std::erase_if(m_hosts, [](const auto& e) {
+        return e.second.pending.empty() && !e.second.active;
+    });
+}
 
-            for (auto& thread : g_threads) {
-                if (!g_running) {
-                    return;
-                }
+void TransferQueue::Start(Pending&& pending, Host& host) {
+    auto& t = *pending.transfer;
 
-                if (!thread.InProgress()) {
-                    if (thread.Setup(entry.api)) {
-                        // log_write("[dl queue] starting download\n");
-                        // mark entry for deletion
-                        entry.m_delete = true;
-                        // pop_count++;
-                        keep_going = true;
-                        break;
-                    }
-                }
-            }
+    CURL* curl{};
+    if (!m_handles.empty()) {
+        curl = m_handles.back();
+        m_handles.pop_back();
+    } else if (!(curl = curl_easy_init())) {
+        log_write("[CURL] failed to create easy handle\n");
+        PushResult(t, {});
+        return;
+    }
 
-            if (!keep_going) {
-                break;
-            }
-        }
+    if (!(t.e.IsUpload() ? UploadSetup(curl, t) : DownloadSetup(curl, t))) {
+        m_handles.emplace_back(curl);
+        PushResult(t, {});
+        return;
+    }
 
-        // delete all entries marked for deletion
-        std::erase_if(data->m_entries, [](auto& e){
-            return e.m_delete;
-        });
+    // wait for an existing connection to multiplex on, rather than opening a new one.
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_PIPEWAIT, 1L);
+
+    auto active = std::make_unique<Active>();
+    active->id = m_next_id++;
+    active->curl = curl;
+    active->host = std::move(pending.host);
+    active->transfer = std::move(pending.transfer);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_PRIVATE, active.get());
+
+    if (const auto mc = curl_multi_add_handle(m_multi, curl); mc != CURLM_OK) {
+        log_write("[CURL] curl_multi_add_handle() failed: %s\n", curl_multi_strerror(mc));
+        m_handles.emplace_back(curl);
+        PushResult(*active->transfer, {});
+        return;
     }
 
-    log_write("exited download thread queue\n");
+    host.active++;
+    auto& ref = *m_active.emplace(active->id, std::move(active)).first->second;
+
+    // created last as this calls Cancel() straight away if a stop was already requested.
+    ref.stop_callback = std::make_unique<std::stop_callback<StopCallback>>(ref.transfer->e.GetToken(), StopCallback{this, ref.id});
+}
+
+void TransferQueue::Finish(Active* active, CURLcode res) {
+    curl_multi_remove_handle(m_multi, active->curl);
+    // blocks until the callback returns, if it's being called on another thread.
+    active->stop_callback.reset();
+
+    long http_version{};
+    curl_easy_getinfo(active->curl, CURLINFO_HTTP_VERSION, &http_version);
+    if (http_version >= CURL_HTTP_VERSION_2_0) {
+        m_multiplexed.emplace(active->host);
+    }
+
+    auto& t = *active->transfer;
+    auto result = t.e.IsUpload() ? UploadFinish(active->curl, t, res) : DownloadFinish(active->curl, t, res);
+    PushResult(t, std::move(result));
+
+    m_hosts[active->host].active--;
+    m_handles.emplace_back(active->curl);
+    m_active.erase(active->id);
 }
 
 } // namespace
@@ -1064,12 +1843,6 @@ auto Init() -> bool {
         log_write("!failed to create download thread queue\n");
     }
 
-    for (auto& entry : g_threads) {
-        if (R_FAILED(entry.Create())) {
-            log_write("!failed to create download thread\n");
-        }
-    }
-
     g_curl_single = curl_easy_init();
     if (!g_curl_single) {
         log_write("failed to create g_curl_single\n");
@@ -1084,10 +1857,6 @@ void ExitSignal() {
     g_running = false;
 
     g_thread_queue.SignalClose();
-
-    for (auto& entry : g_threads) {
-        entry.SignalClose();
-    }
 }
 
 void Exit() {
@@ -1100,10 +1869,6 @@ void Exit() {
         g_curl_single = nullptr;
     }
 
-    for (auto& entry : g_threads) {
-        entry.Close();
-    }
-
     if (g_curl_share) {
         curl_share_cleanup(g_curl_share);
         g_curl_share = {};
@@ -1123,6 +1888,14 @@ auto ToFile(const Api& e) -> ApiResult {
     if (e.GetPath().empty()) {
         return {};
     }
+
+    if ((e.GetFlags() & Flag_Segmented) && !(e.GetFlags() & (Flag_Cache|Flag_NoBody)) && e.GetFields().empty() && e.GetCustomRequest().empty()) {
+        SegmentedDownload segmented{g_curl_single, e};
+        if (segmented.Probe()) {
+            return segmented.Run();
+        }
+    }
+
     return DownloadInternal(g_curl_single, e);
 }
 
@@ -1,8 +1,11 @@
 #include "hasher.hpp"
 #include "app.hpp"
 #include "threaded_file_transfer.hpp"
+#include "utils/thread.hpp"
+#include "log.hpp"
 #include <mbedtls/md5.h>
 #include <utility>
+#include <vector>
 
 namespace sphaira::hash {
 namespace {
@@ -173,6 +176,146 @@ private:
     Sha256Context m_ctx{};
 };
 
+auto CreateHashSource(Type type) -> std::unique_ptr<HashSource> {
+    switch (type) {
+        case Type::Crc32: return std::make_unique<HashCrc32>();
+        case Type::Md5: return std::make_unique<HashMd5>();
+        case Type::Sha1: return std::make_unique<HashSha1>();
+        case Type::Sha256: return std::make_unique<HashSha256>();
+        case Type::Null: return std::make_unique<HashNull>();
+    }
+    std::unreachable();
+}
+
+// feeds each buffer to multiple hashes at once.
+// the calling thread updates the first hash and one worker is created for each
+// of the others, Update() returns once every hash has consumed the buffer.
+struct MultiHash {
+    MultiHash(std::span<const Type> types) {
+        mutexInit(std::addressof(m_mutex));
+        condvarInit(std::addressof(m_can_work));
+        condvarInit(std::addressof(m_done));
+
+        for (auto type : types) {
+            m_hashes.emplace_back(CreateHashSource(type));
+        }
+
+        // the thread struct must not move once created.
+        m_threads.reserve(m_hashes.size() - 1);
+        for (u32 i = 1; i < m_hashes.size(); i++) {
+            auto& t = m_threads.emplace_back();
+            if (R_FAILED(utils::CreateThread(std::addressof(t), WorkerFunc, this, 1024*32))) {
+                m_threads.pop_back();
+                break;
+            }
+
+            if (R_FAILED(threadStart(std::addressof(t)))) {
+                threadClose(std::addressof(t));
+                m_threads.pop_back();
+                break;
+            }
+        }
+
+        log_write("[HASH] created %zu workers for %zu hashes\n", m_threads.size(), m_hashes.size());
+    }
+
+    ~MultiHash() {
+        {
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            m_quit = true;
+            condvarWakeAll(std::addressof(m_can_work));
+        }
+
+        for (auto& t : m_threads) {
+            threadWaitForExit(std::addressof(t));
+            threadClose(std::addressof(t));
+        }
+    }
+
+    void Update(const void* buf, s64 size, s64 file_size) {
+        {
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            m_buf = buf;
+            m_size = size;
+            m_file_size = file_size;
+            m_pending = m_threads.size();
+            m_generation++;
+            condvarWakeAll(std::addressof(m_can_work));
+        }
+
+        // the first hash, and any that a worker couldn't be created for.
+        m_hashes[0]->Update(buf, size, file_size);
+        for (u32 i = m_threads.size() + 1; i < m_hashes.size(); i++) {
+            m_hashes[i]->Update(buf, size, file_size);
+        }
+
+        // the buffer is only valid until this returns.
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        while (m_pending) {
+            condvarWait(std::addressof(m_done), std::addressof(m_mutex));
+        }
+    }
+
+    void Get(std::vector<std::string>& out) {
+        out.resize(m_hashes.size());
+        for (u32 i = 0; i < m_hashes.size(); i++) {
+            m_hashes[i]->Get(out[i]);
+        }
+    }
+
+private:
+    static void WorkerFunc(void* arg) {
+        static_cast<MultiHash*>(arg)->WorkerFuncInternal();
+    }
+
+    void WorkerFuncInternal() {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+
+        // workers are started in order, so the index matches the thread.
+        auto& hash = m_hashes[++m_worker_count];
+        u64 generation{};
+
+        for (;;) {
+            while (!m_quit && generation == m_generation) {
+                condvarWait(std::addressof(m_can_work), std::addressof(m_mutex));
+            }
+
+            if (m_quit) {
+                break;
+            }
+
+            generation = m_generation;
+            const auto buf = m_buf;
+            const auto size = m_size;
+            const auto file_size = m_file_size;
+
+            mutexUnlock(std::addressof(m_mutex));
+            hash->Update(buf, size, file_size);
+            mutexLock(std::addressof(m_mutex));
+
+            if (!--m_pending) {
+                condvarWakeOne(std::addressof(m_done));
+            }
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<HashSource>> m_hashes{};
+    std::vector<Thread> m_threads{};
+
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+    CondVar m_done{};
+
+    const void* m_buf{};
+    s64 m_size{};
+    s64 m_file_size{};
+    u64 m_generation{};
+    u32 m_pending{};
+    u32 m_worker_count{};
+    bool m_quit{};
+};
+
 Result Hash(ui::ProgressBox* pbox, std::unique_ptr<HashSource> hash, BaseSource* source, std::string& out) {
     s64 file_size;
     R_TRY(source->Size(&file_size));
@@ -205,14 +348,7 @@ auto GetTypeStr(Type type) -> const char* {
 }
 
 Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& out) {
-    switch (type) {
-        case Type::Crc32: return Hash(pbox, std::make_unique<HashCrc32>(), source, out);
-        case Type::Md5: return Hash(pbox, std::make_unique<HashMd5>(), source, out);
-        case Type::Sha1: return Hash(pbox, std::make_unique<HashSha1>(), source, out);
-        case Type::Sha256: return Hash(pbox, std::make_unique<HashSha256>(), source, out);
-        case Type::Null: return Hash(pbox, std::make_unique<HashNull>(), source, out);
-    }
-    std::unreachable();
+    return Hash(pbox, CreateHashSource(type), source, out);
 }
 
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out) {
@@ -225,4 +361,32 @@ Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::str
     return Hash(pbox, type, source.get(), out);
 }
 
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out) {
+    R_UNLESS(!types.empty(), 0x1);
+
+    s64 file_size;
+    R_TRY(source->Size(&file_size));
+
+    // created here as the workers must exit before returning.
+    MultiHash hash{types};
+
+    R_TRY(thread::Transfer(pbox, file_size,
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            return source->Read(data, off, size, bytes_read);
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            hash.Update(data, size, file_size);
+            R_SUCCEED();
+        }
+    ));
+
+    hash.Get(out);
+    R_SUCCEED();
+}
+
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out) {
+    auto source = std::make_unique<FileSource>(fs, path);
+    return Hash(pbox, types, source.get(), out);
+}
+
 } // namespace sphaira::has
@@ -22,6 +22,7 @@
 
 #include "app.hpp"
 #include "log.hpp"
+#include "defines.hpp"
 #ifdef USE_NVJPG
 #include <nvjpg.hpp>
 #endif
@@ -48,6 +49,9 @@ auto ImageLoadInternal(stbi_uc* image_data, int x, int y) -> ImageResult {
 }
 
 #ifdef USE_NVJPG
+// the decoder is shared, images may be loaded from multiple threads.
+Mutex g_decoder_mutex{};
+
 auto ImageLoadInternal(nj::Image&& image) -> ImageResult {
     if (!image.is_valid() || image.parse()) {
         log_write("[NVJPG] failed to parse image\n");
@@ -60,6 +64,7 @@ auto ImageLoadInternal(nj::Image&& image) -> ImageResult {
         return {};
     }
 
+    SCOPED_MUTEX(&g_decoder_mutex);
     if (R_FAILED(App::GetApp()->m_decoder.render(image, surf, 255))) {
         log_write("[NVJPG] failed to render\n");
         return {};
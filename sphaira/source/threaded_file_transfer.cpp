@@ -4,6 +4,7 @@
 #include "app.hpp"
 #include "minizip_helper.hpp"
 #include "utils/thread.hpp"
+#include "utils/spsc_ring.hpp"
 
 #include <vector>
 #include <algorithm>
@@ -20,61 +21,15 @@ constexpr u64 SMALL_BUFFER_SIZE = 1024 * 512;
 // used for everything else.
 constexpr u64 NORMAL_BUFFER_SIZE = 1024*1024*4;
 
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(NORMAL_BUFFER_SIZE);
-    }
-
-    std::vector<u8> buf;
-    s64 off;
-};
-
-template<std::size_t Size>
-struct RingBuf {
-private:
-    ThreadBuffer buf[Size]{};
-    unsigned r_index{};
-    unsigned w_index{};
-
-    static_assert((sizeof(RingBuf::buf) & (sizeof(RingBuf::buf) - 1)) == 0, "Must be power of 2!");
-
-public:
-    void ringbuf_reset() {
-        this->r_index = this->w_index;
-    }
-
-    unsigned ringbuf_capacity() const {
-        return sizeof(this->buf) / sizeof(this->buf[0]);
-    }
-
-    unsigned ringbuf_size() const {
-        return (this->w_index - this->r_index) % (ringbuf_capacity() * 2U);
-    }
-
-    unsigned ringbuf_free() const {
-        return ringbuf_capacity() - ringbuf_size();
-    }
-
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
-        auto& value = this->buf[this->w_index % ringbuf_capacity()];
-        value.off = off_in;
-        std::swap(value.buf, buf_in);
-
-        this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
-    }
-
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
-        auto& value = this->buf[this->r_index % ringbuf_capacity()];
-        off_out = value.off;
-        std::swap(value.buf, buf_out);
-
-        this->r_index = (this->r_index + 1U) % (ringbuf_capacity() * 2U);
-    }
-};
+// number of buffers in each ring, set from the config.
+// 2 is enough for double buffering, deeper rings absorb bursty read / write speeds.
+constexpr u32 RING_DEPTH_MIN = 2;
+constexpr u32 RING_DEPTH_MAX = 4;
 
 struct ThreadData {
-    ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size);
+    ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size, u32 ring_depth);
 
+    auto Create() -> Result;
     auto GetResults() volatile -> Result;
     void WakeAllThreads();
 
@@ -118,9 +73,10 @@ struct ThreadData {
         read_result = result;
 
         // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress));
+        read_buffers.Close();
 
         if (R_FAILED(result)) {
+            WakeAllThreads();
             ueventSignal(GetDoneEvent());
         }
     }
@@ -128,10 +84,14 @@ struct ThreadData {
     void SetDecompressResult(Result result) {
         decompress_result = result;
 
-        // wake up write thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_write));
+        // wake up read and write thread as they may be waiting on a buffer.
+        if (dfunc) {
+            read_buffers.Close();
+            write_buffers.Close();
+        }
 
         if (R_FAILED(result)) {
+            WakeAllThreads();
             ueventSignal(GetDoneEvent());
         }
     }
@@ -139,15 +99,26 @@ struct ThreadData {
     void SetWriteResult(Result result) {
         write_result = result;
 
-        // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress_write));
+        // wake up decompress thread as it may be waiting on a buffer.
+        if (wfunc) {
+            GetOutputRing().Close();
+        }
+
+        if (R_FAILED(result)) {
+            WakeAllThreads();
+        }
 
         ueventSignal(GetDoneEvent());
     }
 
     void SetPullResult(Result result) {
         pull_result = result;
+
+        // nothing else will pull, wake up the thread that is filling the buffers.
+        GetOutputRing().Close();
+
         if (R_FAILED(result)) {
+            WakeAllThreads();
             ueventSignal(GetDoneEvent());
         }
     }
@@ -158,12 +129,11 @@ struct ThreadData {
     Result writeFuncInternal();
 
 private:
-    Result SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size);
-    Result GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out);
-    Result SetWriteBuf(std::vector<u8>& buf, s64 size);
-    Result GetWriteBuf(std::vector<u8>& buf_out, s64& off_out);
-    Result SetPullBuf(std::vector<u8>& buf, s64 size);
-    Result GetPullBuf(void* data, s64 size, u64* bytes_read);
+    // the ring that the write thread (or pull) consumes.
+    // if there's no decompress func, the read buffers are passed through as-is.
+    auto GetOutputRing() -> utils::SpscRing& {
+        return dfunc ? write_buffers : read_buffers;
+    }
 
     Result Read(void* buf, s64 size, u64* bytes_read);
 
@@ -175,32 +145,19 @@ private:
     const WriteCallback& wfunc;
 
     // these need to be created
-    Mutex read_mutex{};
-    Mutex write_mutex{};
-
-    Mutex pull_mutex{};
-
-    CondVar can_read{};
-    CondVar can_write{};
-    CondVar can_decompress{};
-    CondVar can_decompress_write{};
-
-    // only used when pull is active.
-    CondVar can_pull{};
-    CondVar can_pull_write{};
-
     UEvent m_uevent_done{};
     UEvent m_uevent_read_progress{};
     UEvent m_uevent_decompress_progress{};
     UEvent m_uevent_write_progress{};
 
-    RingBuf<2> read_buffers{};
-    RingBuf<2> write_buffers{};
+    utils::SpscRing read_buffers{};
+    utils::SpscRing write_buffers{};
 
-    std::vector<u8> pull_buffer{};
-    s64 pull_buffer_offset{};
+    // offset into the front output buffer, only used when pull is active.
+    u64 pull_buffer_offset{};
 
     const u64 read_buffer_size;
+    const u32 ring_depth;
     const s64 write_size;
 
     // these are shared between threads
@@ -218,31 +175,31 @@ private:
     std::atomic_bool write_running{true};
 };
 
-ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size)
+ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size, u32 _ring_depth)
 : pbox{_pbox}
 , rfunc{_rfunc}
 , dfunc{_dfunc}
 , wfunc{_wfunc}
 , read_buffer_size{buffer_size}
+, ring_depth{_ring_depth}
 , write_size{size} {
-    mutexInit(std::addressof(read_mutex));
-    mutexInit(std::addressof(write_mutex));
-    mutexInit(std::addressof(pull_mutex));
-
-    condvarInit(std::addressof(can_read));
-    condvarInit(std::addressof(can_decompress));
-    condvarInit(std::addressof(can_decompress_write));
-    condvarInit(std::addressof(can_write));
-
-    condvarInit(std::addressof(can_pull));
-    condvarInit(std::addressof(can_pull_write));
-
     ueventCreate(GetDoneEvent(), false);
     ueventCreate(GetReadProgressEvent(), true);
     ueventCreate(GetDecompressProgressEvent(), true);
     ueventCreate(GetWriteProgressEvent(), true);
 }
 
+auto ThreadData::Create() -> Result {
+    R_TRY(read_buffers.Create(ring_depth, read_buffer_size));
+
+    // only needed if the data is modified, otherwise the read buffers are used.
+    if (dfunc) {
+        R_TRY(write_buffers.Create(ring_depth, read_buffer_size));
+    }
+
+    R_SUCCEED();
+}
+
 auto ThreadData::GetResults() volatile -> Result {
     R_TRY(pbox->ShouldExitResult());
     R_TRY(read_result.load());
@@ -253,155 +210,64 @@ auto ThreadData::GetResults() volatile -> Result {
 }
 
 void ThreadData::WakeAllThreads() {
-    condvarWakeAll(std::addressof(can_read));
-    condvarWakeAll(std::addressof(can_write));
-    condvarWakeAll(std::addressof(can_decompress));
-    condvarWakeAll(std::addressof(can_decompress_write));
-    condvarWakeAll(std::addressof(can_pull));
-    condvarWakeAll(std::addressof(can_pull_write));
-
-    mutexUnlock(std::addressof(read_mutex));
-    mutexUnlock(std::addressof(write_mutex));
-    mutexUnlock(std::addressof(pull_mutex));
-}
-
-Result ThreadData::SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
-    buf.resize(size);
-
-    mutexLock(std::addressof(read_mutex));
-    if (!read_buffers.ringbuf_free()) {
-        if (!write_running) {
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_read), std::addressof(read_mutex)));
-    }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-    R_TRY(GetResults());
-    read_buffers.ringbuf_push(buf, off);
-    return condvarWakeOne(std::addressof(can_decompress));
-}
-
-Result ThreadData::GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out) {
-    mutexLock(std::addressof(read_mutex));
-    if (!read_buffers.ringbuf_size()) {
-        if (!read_running) {
-            buf_out.resize(0);
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_decompress), std::addressof(read_mutex)));
-    }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-    R_TRY(GetResults());
-    read_buffers.ringbuf_pop(buf_out, off_out);
-    return condvarWakeOne(std::addressof(can_read));
-}
-
-Result ThreadData::SetWriteBuf(std::vector<u8>& buf, s64 size) {
-    buf.resize(size);
-
-    mutexLock(std::addressof(write_mutex));
-    if (!write_buffers.ringbuf_free()) {
-        if (!decompress_running) {
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_decompress_write), std::addressof(write_mutex)));
-    }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
-    R_TRY(GetResults());
-    write_buffers.ringbuf_push(buf, 0);
-    return condvarWakeOne(std::addressof(can_write));
+    read_buffers.Close();
+    write_buffers.Close();
 }
 
-Result ThreadData::GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
-    mutexLock(std::addressof(write_mutex));
-    if (!write_buffers.ringbuf_size()) {
-        if (!decompress_running) {
-            buf_out.resize(0);
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_write), std::addressof(write_mutex)));
-    }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
-    R_TRY(GetResults());
-    write_buffers.ringbuf_pop(buf_out, off_out);
-    return condvarWakeOne(std::addressof(can_decompress_write));
+Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
+    size = std::min<s64>(size, write_size - read_offset);
+    const auto rc = rfunc(buf, read_offset, size, bytes_read);
+    read_offset += *bytes_read;
+    return rc;
 }
 
-Result ThreadData::SetPullBuf(std::vector<u8>& buf, s64 size) {
-    buf.resize(size);
-
-    mutexLock(std::addressof(pull_mutex));
-    if (!pull_buffer.empty()) {
-        R_TRY(condvarWait(std::addressof(can_pull_write), std::addressof(pull_mutex)));
-    }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(pull_mutex)));
-    R_TRY(GetResults());
-
-    pull_buffer.swap(buf);
-    return condvarWakeOne(std::addressof(can_pull));
-}
+Result ThreadData::Pull(void* data, s64 size, u64* bytes_read) {
+    auto& ring = GetOutputRing();
 
-Result ThreadData::GetPullBuf(void* data, s64 size, u64* bytes_read) {
-    mutexLock(std::addressof(pull_mutex));
-    if (pull_buffer.empty()) {
-        R_TRY(condvarWait(std::addressof(can_pull), std::addressof(pull_mutex)));
+    // pull from the buffer directly, rather than waiting for the write thread.
+    auto buf = ring.GetFront();
+    if (!buf) {
+        *bytes_read = 0;
+        return GetResults();
     }
 
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(pull_mutex)));
-    R_TRY(GetResults());
-
-    *bytes_read = size = std::min<s64>(size, pull_buffer.size() - pull_buffer_offset);
-    std::memcpy(data, pull_buffer.data() + pull_buffer_offset, size);
+    *bytes_read = size = std::min<s64>(size, buf->size - pull_buffer_offset);
+    std::memcpy(data, buf->data + pull_buffer_offset, size);
     pull_buffer_offset += size;
 
-    if (pull_buffer_offset == pull_buffer.size()) {
+    if (pull_buffer_offset == buf->size) {
         pull_buffer_offset = 0;
-        pull_buffer.clear();
-        return condvarWakeOne(std::addressof(can_pull_write));
-    } else {
-        R_SUCCEED();
+        ring.Pop();
     }
-}
 
-Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
-    size = std::min<s64>(size, write_size - read_offset);
-    const auto rc = rfunc(buf, read_offset, size, bytes_read);
-    read_offset += *bytes_read;
-    return rc;
-}
-
-Result ThreadData::Pull(void* data, s64 size, u64* bytes_read) {
-    return GetPullBuf(data, size, bytes_read);
+    this->write_offset += size;
+    ueventSignal(GetWriteProgressEvent());
+    R_SUCCEED();
 }
 
 // read thread reads all data from the source
 Result ThreadData::readFuncInternal() {
     ON_SCOPE_EXIT( read_running = false; );
 
-    // the main buffer which data is read into.
-    std::vector<u8> buf;
-    buf.reserve(this->read_buffer_size);
-
     while (this->read_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
-        // read more data
-        const auto buffer_offset = this->read_offset.load();
-        s64 read_size = this->read_buffer_size;
+        // read directly into the next free buffer.
+        auto buf = this->read_buffers.GetBack();
+        if (!buf) {
+            log_write("exiting read func early because the ring was closed\n");
+            break;
+        }
+
+        buf->off = this->read_offset.load();
 
         u64 bytes_read{};
-        buf.resize(read_size);
-        R_TRY(this->Read(buf.data(), read_size, std::addressof(bytes_read)));
+        R_TRY(this->Read(buf->data, this->read_buffer_size, std::addressof(bytes_read)));
         if (!bytes_read) {
             break;
         }
 
+        buf->size = bytes_read;
+        this->read_buffers.Push();
         ueventSignal(GetReadProgressEvent());
-        auto buf_size = bytes_read;
-        R_TRY(this->SetDecompressBuf(buf, buffer_offset, buf_size));
     }
 
     log_write("finished read thread success!\n");
@@ -412,57 +278,88 @@ Result ThreadData::readFuncInternal() {
 Result ThreadData::decompressFuncInternal() {
     ON_SCOPE_EXIT( decompress_running = false; );
 
-    std::vector<u8> buf{};
-    std::vector<u8> temp_buf{};
-    buf.reserve(this->read_buffer_size);
-    temp_buf.reserve(this->read_buffer_size);
-    const auto temp_buf_flush_max = this->read_buffer_size / 2;
+    // nothing to do, the write thread uses the read buffers directly.
+    if (!this->dfunc) {
+        R_SUCCEED();
+    }
+
+    // buffer that the output is copied into, pushed once full.
+    utils::SpscRing::Buffer* out{};
+    const auto out_flush_max = this->read_buffer_size / 2;
 
     while (this->decompress_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
-        s64 decompress_buf_off{};
-        R_TRY(this->GetDecompressBuf(buf, decompress_buf_off));
-        if (buf.empty()) {
+        auto buf = this->read_buffers.GetFront();
+        if (!buf) {
             log_write("exiting decompress func early because no data was received\n");
             break;
         }
 
-        if (this->dfunc) {
-            R_TRY(this->dfunc(buf.data(), decompress_buf_off, buf.size(), [&](const void* _data, s64 size) -> Result {
-                auto data = (const u8*)_data;
+        const auto write = [&](const void* _data, s64 size) -> Result {
+            auto data = (const u8*)_data;
 
-                while (size) {
-                    const auto block_off = temp_buf.size();
-                    const auto rsize = std::min<s64>(size, temp_buf_flush_max - block_off);
+            while (size) {
+                if (!out) {
+                    out = this->write_buffers.GetBack();
+                    if (!out) {
+                        // write thread has exited.
+                        return this->GetResults();
+                    }
+                }
 
-                    temp_buf.resize(block_off + rsize);
-                    std::memcpy(temp_buf.data() + block_off, data, rsize);
+                // swapped in buffers may be smaller than the ring was created with.
+                const auto out_max = std::min<u64>(out_flush_max, out->capacity);
+                const auto rsize = std::min<s64>(size, out_max - out->size);
+                std::memcpy(out->data + out->size, data, rsize);
+                out->size += rsize;
 
-                    if (temp_buf.size() == temp_buf_flush_max) {
-                        // log_write("flushing data: %zu %.2f MiB\n", temp_buf.size(), temp_buf.size() / 1024.0 / 1024.0);
-                        R_TRY(this->SetWriteBuf(temp_buf, temp_buf.size()));
-                        temp_buf.resize(0);
-                    }
+                if (out->size == out_max) {
+                    this->write_buffers.Push();
+                    out = nullptr;
+                }
+
+                size -= rsize;
+                data += rsize;
+                this->decompress_offset += rsize;
+                ueventSignal(GetDecompressProgressEvent());
+            }
+
+            R_SUCCEED();
+        };
+
+        const auto swap = [&](utils::pool::Lease& lease, s64 size) -> Result {
+            // anything already copied is written first, to keep the order.
+            if (out && out->size) {
+                this->write_buffers.Push();
+                out = nullptr;
+            }
 
-                    size -= rsize;
-                    data += rsize;
-                    this->decompress_offset += rsize;
-                    ueventSignal(GetDecompressProgressEvent());
+            if (!out) {
+                out = this->write_buffers.GetBack();
+                if (!out) {
+                    return this->GetResults();
                 }
+            }
 
-                R_SUCCEED();
-            }));
-        } else {
-            this->decompress_offset += buf.size();
+            out->lease.swap(lease);
+            out->data = out->lease.data();
+            out->capacity = out->lease.size();
+            out->size = size;
+            this->write_buffers.Push();
+            out = nullptr;
+
+            this->decompress_offset += size;
             ueventSignal(GetDecompressProgressEvent());
+            R_SUCCEED();
+        };
 
-            R_TRY(this->SetWriteBuf(buf, buf.size()));
-        }
+        R_TRY(this->dfunc(buf->data, buf->off, buf->size, DecompressWriteCallback{write, swap}));
+        this->read_buffers.Pop();
     }
 
     // flush buffer.
-    if (!temp_buf.empty()) {
-        log_write("flushing data: %zu\n", temp_buf.size());
-        R_TRY(this->SetWriteBuf(temp_buf, temp_buf.size()));
+    if (out && out->size) {
+        log_write("flushing data: %zu\n", out->size);
+        this->write_buffers.Push();
     }
 
     log_write("finished decompress thread success!\n");
@@ -473,23 +370,23 @@ Result ThreadData::decompressFuncInternal() {
 Result ThreadData::writeFuncInternal() {
     ON_SCOPE_EXIT( write_running = false; );
 
-    std::vector<u8> buf;
-    buf.reserve(this->read_buffer_size);
+    // nothing to do, the data is consumed by pull() instead.
+    if (!this->wfunc) {
+        R_SUCCEED();
+    }
+
+    auto& ring = this->GetOutputRing();
 
     while (this->write_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
-        s64 dummy_off;
-        R_TRY(this->GetWriteBuf(buf, dummy_off));
-        const auto size = buf.size();
-        if (!size) {
+        auto buf = ring.GetFront();
+        if (!buf) {
             log_write("exiting write func early because no data was received\n");
             break;
         }
 
-        if (!this->wfunc) {
-            R_TRY(this->SetPullBuf(buf, buf.size()));
-        } else {
-            R_TRY(this->wfunc(buf.data(), this->write_offset, buf.size()));
-        }
+        const auto size = buf->size;
+        R_TRY(this->wfunc(buf->data, this->write_offset, size));
+        ring.Pop();
 
         this->write_offset += size;
         ueventSignal(GetWriteProgressEvent());
@@ -562,7 +459,9 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
         R_SUCCEED();
     }
     else {
-        ThreadData t_data{pbox, size, rfunc, dfunc, wfunc, buffer_size};
+        const auto ring_depth = std::clamp<u32>(App::GetTransferRingDepth(), RING_DEPTH_MIN, RING_DEPTH_MAX);
+        ThreadData t_data{pbox, size, rfunc, dfunc, wfunc, buffer_size, ring_depth};
+        R_TRY(t_data.Create());
 
         Thread t_read{};
         R_TRY(utils::CreateThread(&t_read, readFunc, std::addressof(t_data)));
@@ -8,12 +8,14 @@
 #include "yati/nx/ncm.hpp"
 
 #include "utils/thread.hpp"
+#include "utils/id_queue.hpp"
 #include "i18n.hpp"
 
 #include <cstring>
 #include <atomic>
 #include <ranges>
 #include <algorithm>
+#include <unordered_map>
 
 #include <nxtc.h>
 #include <minIni.h>
@@ -21,6 +23,11 @@
 namespace sphaira::title {
 namespace {
 
+// background loads sleep for as long as the load took, so that they use at most
+// half of the io time. visible entries are loaded without sleeping.
+constexpr s64 BACKGROUND_SLEEP_MIN_NS = 1e+6;
+constexpr s64 BACKGROUND_SLEEP_MAX_NS = 10e+6;
+
 struct ThreadData {
     ThreadData(bool title_cache);
 
@@ -30,6 +37,7 @@ struct ThreadData {
 
     void PushAsync(u64 id);
     void PushAsync(const std::span<const NsApplicationRecord> app_ids);
+    void Prioritise(const std::span<const u64> app_ids);
     auto GetAsync(u64 app_id) -> ThreadResultData*;
     auto Get(u64 app_id, bool* cached = nullptr) -> ThreadResultData*;
 
@@ -41,6 +49,10 @@ struct ThreadData {
         return m_title_cache;
     }
 
+private:
+    // must be called with m_mutex_id and m_mutex_result locked.
+    bool PushId(u64 id);
+
 private:
     fs::FsNativeSd m_fs{};
     UEvent m_uevent{};
@@ -48,10 +60,10 @@ private:
     Mutex m_mutex_result{};
     bool m_title_cache{};
 
-    // app_ids pushed to the queue, signal uevent when pushed.
-    std::vector<u64> m_ids{};
-    // control data pushed to the queue.
-    std::vector<std::unique_ptr<ThreadResultData>> m_result{};
+    // app_ids waiting to be loaded, signal uevent when pushed.
+    utils::IdQueue m_ids{};
+    // control data pushed to the queue, the pointers remain valid until Clear().
+    std::unordered_map<u64, std::unique_ptr<ThreadResultData>> m_result{};
 
     std::atomic_bool m_running{};
 };
@@ -142,8 +154,6 @@ ThreadData::ThreadData(bool title_cache) : m_title_cache{title_cache} {
 }
 
 void ThreadData::Run() {
-    TimeStamp ts{};
-    bool cached{true};
     const auto waiter = waiterForUEvent(&m_uevent);
 
     while (IsRunning()) {
@@ -155,30 +165,30 @@ void ThreadData::Run() {
             continue;
         }
 
-        if (!IsRunning()) {
-            return;
-        }
-
-        std::vector<u64> ids;
-        {
-            SCOPED_MUTEX(&m_mutex_id);
-            std::swap(ids, m_ids);
-        }
-
-        for (u64 i = 0; i < std::size(ids); i++) {
+        for (;;) {
             if (!IsRunning()) {
                 return;
             }
 
-            // sleep after every other entry loaded.
-            const auto elapsed = (s64)2e+6 - (s64)ts.GetNs();
-            if (!cached && elapsed > 0) {
-                svcSleepThread(elapsed);
+            u64 id;
+            bool priority;
+            {
+                SCOPED_MUTEX(&m_mutex_id);
+                if (!m_ids.Pop(id, priority)) {
+                    break;
+                }
             }
 
             // loads new entry into cache.
-            std::ignore = Get(ids[i], &cached);
-            ts.Update();
+            TimeStamp ts;
+            bool cached;
+            std::ignore = Get(id, &cached);
+
+            // the wait ends early if more entries are pushed or prioritised.
+            if (!cached && !priority) {
+                const auto sleep_ns = std::clamp<s64>(ts.GetNs(), BACKGROUND_SLEEP_MIN_NS, BACKGROUND_SLEEP_MAX_NS);
+                std::ignore = waitSingle(waiter, sleep_ns);
+            }
         }
     }
 }
@@ -195,17 +205,15 @@ void ThreadData::Clear() {
     nxtcWipeCache();
 }
 
+bool ThreadData::PushId(u64 id) {
+    return !m_result.contains(id) && m_ids.Push(id);
+}
+
 void ThreadData::PushAsync(u64 id) {
     SCOPED_MUTEX(&m_mutex_id);
     SCOPED_MUTEX(&m_mutex_result);
 
-    const auto it_id = std::ranges::find(m_ids, id);
-    const auto it_result = std::ranges::find_if(m_result, [id](auto& e){
-        return id == e->id;
-    });
-
-    if (it_id == m_ids.end() && it_result == m_result.end()) {
-        m_ids.emplace_back(id);
+    if (PushId(id)) {
         ueventSignal(&m_uevent);
     }
 }
@@ -213,23 +221,24 @@ void ThreadData::PushAsync(u64 id) {
 void ThreadData::PushAsync(const std::span<const NsApplicationRecord> app_ids) {
     SCOPED_MUTEX(&m_mutex_id);
     SCOPED_MUTEX(&m_mutex_result);
-    bool added_at_least_one = false;
 
-    for (auto& record : app_ids) {
-        const auto id = record.application_id;
+    m_ids.Reserve(m_ids.Size() + app_ids.size());
+    bool pushed = false;
 
-        const auto it_id = std::ranges::find(m_ids, id);
-        const auto it_result = std::ranges::find_if(m_result, [id](auto& e){
-            return id == e->id;
-        });
+    for (auto& record : app_ids) {
+        pushed |= PushId(record.application_id);
+    }
 
-        if (it_id == m_ids.end() && it_result == m_result.end()) {
-            m_ids.emplace_back(id);
-            added_at_least_one = true;
-        }
+    if (pushed) {
+        ueventSignal(&m_uevent);
     }
+}
+
+void ThreadData::Prioritise(const std::span<const u64> app_ids) {
+    SCOPED_MUTEX(&m_mutex_id);
 
-    if (added_at_least_one) {
+    // replaces the previous priority list, as those entries are no longer visible.
+    if (m_ids.Prioritise(app_ids)) {
         ueventSignal(&m_uevent);
     }
 }
@@ -237,13 +246,12 @@ void ThreadData::PushAsync(const std::span<const NsApplicationRecord> app_ids) {
 auto ThreadData::GetAsync(u64 app_id) -> ThreadResultData* {
     SCOPED_MUTEX(&m_mutex_result);
 
-    for (s64 i = 0; i < std::size(m_result); i++) {
-        if (app_id == m_result[i]->id) {
-            return m_result[i].get();
-        }
+    const auto it = m_result.find(app_id);
+    if (it == m_result.end()) {
+        return {};
     }
 
-    return {};
+    return it->second.get();
 }
 
 auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
@@ -376,8 +384,10 @@ auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
         }
     }
 
+    // if the entry was loaded by another thread in the meantime, keep that one
+    // as it may already be in use.
     SCOPED_MUTEX(&m_mutex_result);
-    return m_result.emplace_back(std::move(result)).get();
+    return m_result.try_emplace(app_id, std::move(result)).first->second.get();
 }
 
 void ThreadFunc(void* user) {
@@ -461,6 +471,13 @@ void PushAsync(const std::span<const NsApplicationRecord> app_ids) {
     }
 }
 
+void Prioritise(const std::span<const u64> app_ids) {
+    SCOPED_MUTEX(&g_mutex);
+    if (g_thread_data) {
+        g_thread_data->Prioritise(app_ids);
+    }
+}
+
 auto GetAsync(u64 app_id) -> ThreadResultData* {
     SCOPED_MUTEX(&g_mutex);
     if (g_thread_data) {
@@ -134,6 +134,7 @@ auto GetCodeMessage(Result rc) -> const char* {
         case Result_UsbBadTransferSize: return "SphairaError_UsbBadTransferSize";
         case Result_UsbEmptyTransferSize: return "SphairaError_UsbEmptyTransferSize";
         case Result_UsbOverflowTransferSize: return "SphairaError_UsbOverflowTransferSize";
+        case Result_UsbBadCrc32c: return "SphairaError_UsbBadCrc32c";
         case Result_UsbUploadBadMagic: return "SphairaError_UsbUploadBadMagic";
         case Result_UsbUploadExit: return "SphairaError_UsbUploadExit";
         case Result_UsbUploadBadCount: return "SphairaError_UsbUploadBadCount";
@@ -171,6 +172,10 @@ auto GetCodeMessage(Result rc) -> const char* {
         case Result_NszFailedCompressStream2: return "SphairaError_NszFailedCompressStream2";
         case Result_NszTooManyBlocks: return "SphairaError_NszTooManyBlocks";
         case Result_NszMissingBlocks: return "SphairaError_NszMissingBlocks";
+        case Result_ThreadRingAllocFailed: return "SphairaError_ThreadRingAllocFailed";
+        case Result_YatiInvalidResume: return "SphairaError_YatiInvalidResume";
+        case Result_CurlFailedMultiInit: return "SphairaError_CurlFailedMultiInit";
+        case Result_PoolLeaseFailed: return "SphairaError_PoolLeaseFailed";
     }
 
     return "";
@@ -19,6 +19,7 @@
 #include "nro.hpp"
 #include "web.hpp"
 #include "minizip_helper.hpp"
+#include "image.hpp"
 
 #include "utils/utils.hpp"
 
@@ -201,6 +202,22 @@ auto LoadAndParseManifest(const Entry& e) -> ManifestEntries {
     return ParseManifest(std::span{(const char*)data.data(), data.size()});
 }
 
+// the cached icon is loaded first, followed by the downloaded one if needed.
+auto IconKey(u32 index, bool downloaded) -> u64 {
+    return (u64(index) << 1) | downloaded;
+}
+
+auto EntryLoadImageResult(NVGcontext* vg, const ImageResult& result, LazyImage& image) -> bool {
+    if (!image.image && !result.data.empty()) {
+        image.w = result.w;
+        image.h = result.h;
+        std::memcpy(image.first_pixel, result.data.data(), sizeof(image.first_pixel));
+        image.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, result.data.data());
+    }
+
+    return image.image;
+}
+
 auto EntryLoadImageData(std::span<const u8> image_buf, LazyImage& image) -> bool {
     // already have the image
     if (image.image) {
@@ -390,7 +407,8 @@ auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
         const auto url = BuildZipUrl(entry);
         curl::Api api{
             curl::Url{url},
-            curl::OnProgress{pbox->OnDownloadProgressCallback()}
+            curl::OnProgress{pbox->OnDownloadProgressCallback()},
+            curl::Flags{curl::Flag_Segmented}
         };
 
         if (file_download) {
@@ -1029,23 +1047,44 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    m_image_loader.Upload([this, vg](u64 key, const ImageResult& result) {
+        auto& image = m_entries[key >> 1].image;
+        const auto downloaded = key & 1;
+
+        if (!downloaded) {
+            image.cached = EntryLoadImageResult(vg, result, image);
+        } else if (EntryLoadImageResult(vg, result, image)) {
+            image.cached = false;
+        } else {
+            image.state = ImageDownloadState::Failed;
+        }
+    });
 
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    const auto load_icon = [this](u32 index, bool downloaded) {
+        const auto key = IconKey(index, downloaded);
+        if (!m_image_loader.Touch(key)) {
+            m_image_loader.Request(key, [path = BuildIconCachePath(m_entries[index])]() -> ImageResult {
+                std::vector<u8> image_buf;
+                if (R_FAILED(fs::FsNativeSd().read_entire_file(path, image_buf))) {
+                    log_write("failed to load image from file: %s\n", path.s);
+                    return {};
+                }
+
+                return ImageLoadFromMemory(image_buf);
+            });
+        }
+    };
+
+    m_list->Draw(vg, theme, m_entries_current.size(), [this, &load_icon](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         const auto index = m_entries_current[pos];
         auto& e = m_entries[index];
         auto& image = e.image;
 
         // try and load cached image.
-        if (image_load_count < image_load_max && !image.image && !image.tried_cache) {
+        if (!image.image && !image.tried_cache) {
             image.tried_cache = true;
-            image.cached = EntryLoadImageFile(BuildIconCachePath(e), image);
-            if (image.cached) {
-                image_load_count++;
-            }
+            load_icon(index, false);
         }
 
         // lazy load image
@@ -1078,13 +1117,10 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
 
                 }   break;
                 case ImageDownloadState::Done: {
-                    if (image_load_count < image_load_max) {
+                    if (image.image) {
                         image.cached = false;
-                        if (!EntryLoadImageFile(BuildIconCachePath(e), e.image)) {
-                            image.state = ImageDownloadState::Failed;
-                        } else {
-                            image_load_count++;
-                        }
+                    } else {
+                        load_icon(index, true);
                     }
                 }   break;
                 case ImageDownloadState::Failed: {
@@ -1116,6 +1152,9 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
                 break;
         }
     });
+
+    // drop the icons that are no longer visible.
+    m_image_loader.Sweep();
 }
 
 void Menu::OnFocusGained() {
@@ -1175,6 +1214,7 @@ void Menu::ScanHomebrew() {
     App::SetBoostMode(true);
     ON_SCOPE_EXIT(App::SetBoostMode(false));
 
+    m_image_loader.Clear();
     from_json(REPO_PATH, m_entries);
 
     fs::FsNativeSd fs;
@@ -521,6 +521,8 @@ FsView::FsView(Base* menu, ViewSide side) : FsView{menu, menu->CreateFs(FS_ENTRY
 }
 
 FsView::~FsView() {
+    StopScan();
+
     // don't store mount points for non-sd card paths.
     if (IsSd() && !m_entries_current.empty()) {
         ini_puts("paths", "last_path", m_path, App::CONFIG_PATH);
@@ -537,6 +539,7 @@ void FsView::Update(Controller* controller, TouchInfo* touch) {
             auto old_index = m_index;
             SetIndex(i);
             const auto new_index = m_index;
+            m_scan_last_file.reset();
 
             // if L2 is helt, select all between old and new index.
             if (old_index != new_index && controller->GotHeld(Button::L2)) {
@@ -562,14 +565,14 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
     const auto& text_col = theme->GetColour(ThemeEntryID_TEXT);
 
     if (m_entries_current.empty()) {
-        gfx::drawTextArgs(vg, GetX() + GetW() / 2.f, GetY() + GetH() / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "Empty..."_i18n.c_str());
+        const auto text = m_scan_done ? "Empty..."_i18n : "Loading..."_i18n;
+        gfx::drawTextArgs(vg, GetX() + GetW() / 2.f, GetY() + GetH() / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), text.c_str());
         return;
     }
 
     constexpr float text_xoffset{15.f};
-    bool got_dir_count = false;
 
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, text_col, &got_dir_count](auto* vg, auto* theme, auto& v, auto i) {
+    m_list->Draw(vg, theme, m_entries_current.size(), [this, text_col](auto* vg, auto* theme, auto& v, auto i) {
         const auto& [x, y, w, h] = v;
         auto& e = GetEntry(i);
 
@@ -613,13 +616,11 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
 
         m_scroll_name.Draw(vg, selected, x + text_xoffset+65, y + (h / 2.f), w-(75+text_xoffset+65+50), 20, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(text_id), e.name);
 
+        // stat is done in the background, visible entries are requested first.
         if (e.IsDir() && !m_fs_entry.IsNoStatDir() && (e.dir_count != -1 || !e.done_stat)) {
-            // NOTE: this takes longer than 16ms when opening a new folder due to it
-            // checking all 9 folders at once.
-            if (!got_dir_count && !e.done_stat && e.file_count == -1 && e.dir_count == -1) {
-                got_dir_count = true;
+            if (!e.done_stat) {
                 e.done_stat = true;
-                m_fs->DirGetEntryCount(GetNewPath(e), &e.file_count, &e.dir_count);
+                m_scanner.PushStat(m_entries_current[i], static_cast<FsDirEntryType>(e.type), e.name);
             }
 
             if (e.file_count != -1) {
@@ -631,38 +632,37 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
         } else if (e.IsFile() && !m_fs_entry.IsNoStatFile() && (e.file_size != -1 || !e.time_stamp.is_valid)) {
             if (!e.time_stamp.is_valid && !e.done_stat) {
                 e.done_stat = true;
-                const auto path = GetNewPath(e);
-                if (m_fs->IsNative()) {
-                    m_fs->GetFileTimeStampRaw(path, &e.time_stamp);
-                } else {
-                    m_fs->FileGetSizeAndTimestamp(path, &e.time_stamp, &e.file_size);
-                }
+                m_scanner.PushStat(m_entries_current[i], static_cast<FsDirEntryType>(e.type), e.name);
             }
 
-            const auto t = (time_t)(e.time_stamp.modified);
-            struct tm tm{};
-            localtime_r(&t, &tm);
+            if (e.time_stamp.is_valid) {
+                const auto t = (time_t)(e.time_stamp.modified);
+                struct tm tm{};
+                localtime_r(&t, &tm);
 
-            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) + 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%02u/%02u/%u", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
-            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) - 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", utils::formatSizeStorage(e.file_size).c_str());
+                gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) + 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%02u/%02u/%u", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+            }
+
+            // the dir listing of stdio mounts doesn't contain the size.
+            if (e.time_stamp.is_valid || m_fs->IsNative()) {
+                gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) - 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", utils::formatSizeStorage(e.file_size).c_str());
+            }
         }
     });
 }
 
 void FsView::OnFocusGained() {
     Widget::OnFocusGained();
-    if (m_entries.empty()) {
+    if (m_entries.empty() && m_scan_done) {
         if (m_path.empty()) {
             Scan(m_fs->Root());
         } else {
             Scan(m_path);
         }
 
-        if (!m_entries.empty()) {
-            LastFile last_file{};
-            if (ini_gets("paths", "last_file", "", last_file.name, sizeof(last_file.name), App::CONFIG_PATH)) {
-                SetIndexFromLastFile(last_file);
-            }
+        LastFile last_file{};
+        if (ini_gets("paths", "last_file", "", last_file.name, sizeof(last_file.name), App::CONFIG_PATH)) {
+            m_scan_last_file = last_file;
         }
     }
 }
@@ -1027,9 +1027,6 @@ void FsView::ZipFiles(fs::FsPath zip_out) {
 }
 
 auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
-    App::SetBoostMode(true);
-    ON_SCOPE_EXIT(App::SetBoostMode(false));
-
     // ensure that we have a slash as part of the file name.
     if (!std::strchr(new_path, '/')) {
         std::strcat(new_path, "/");
@@ -1041,6 +1038,9 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
         m_previous_highlighted_file.emplace_back(f);
     }
 
+    // stop the previous scan before its entries are removed.
+    StopScan();
+
     g_change_signalled = false;
     m_path = new_path;
     m_entries.clear();
@@ -1050,68 +1050,182 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
     m_entries_current = {};
     m_selected_count = 0;
     m_is_update_folder = false;
+    m_scan_last_file.reset();
     SetIndex(0);
     m_menu->SetTitleSubHeading(m_path);
 
-    fs::Dir d;
-    R_TRY(m_fs->OpenDirectory(new_path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &d));
-
-    // we won't run out of memory here (tm)
-    std::vector<FsDirectoryEntry> dir_entries;
-    R_TRY(d.ReadAll(dir_entries));
-
-    const auto count = dir_entries.size();
-    m_entries.reserve(count);
-    m_entries_index.reserve(count);
-    m_entries_index_hidden.reserve(count);
-
-    u32 i = 0;
-    for (const auto& e : dir_entries) {
-        bool hidden = false;
-        if ('.' == e.name[0]) {
-            hidden = true;
-        }
-        // check if we have a filter.
-        else if (e.type == FsDirEntryType_File && !m_menu->m_filter.empty()) {
-            hidden = true;
-            if (const auto ext = std::strrchr(e.name, '.')) {
-                for (const auto& filter : m_menu->m_filter) {
-                    if (IsExtension(ext + 1, filter)) {
-                        hidden = false;
-                        break;
+    // find previous entry once the scan has finished.
+    if (is_walk_up && !m_previous_highlighted_file.empty()) {
+        m_scan_last_file = m_previous_highlighted_file.back();
+        m_previous_highlighted_file.pop_back();
+    }
+
+    // the dir listing of stdio mounts doesn't contain the size, so stat every file.
+    const auto stat_files = !m_fs->IsNative() && !m_fs_entry.IsNoStatFile();
+
+    // entries are added in UpdateScan() as they are read.
+    App::SetBoostMode(true);
+    m_scan_done = false;
+
+    if (auto rc = m_scanner.Start(m_fs, new_path, stat_files); R_FAILED(rc)) {
+        StopScan();
+        R_THROW(rc);
+    }
+
+    R_SUCCEED();
+}
+
+void FsView::StopScan() {
+    m_scanner.Stop();
+
+    if (!m_scan_done) {
+        m_scan_done = true;
+        App::SetBoostMode(false);
+    }
+}
+
+void FsView::UpdateScan() {
+    // keep the same entry selected as entries are added / moved.
+    const auto selected = m_entries_current.empty() ? -1 : (s64)m_entries_current[m_index];
+    auto& entries = m_menu->m_show_hidden.Get() ? m_entries_index_hidden : m_entries_index;
+    auto sorted_count = entries.size();
+    bool sort = false;
+
+    bool done = false;
+    if (!m_scan_done) {
+        done = m_scanner.PopEntries(m_scan_entries);
+
+        // the reader is usually ahead, so reserve for what it has read to
+        // avoid copying a large list each time it grows.
+        const auto read_count = m_scanner.GetReadCount();
+        if (m_entries.capacity() < read_count) {
+            m_entries.reserve(read_count);
+            m_entries_index.reserve(read_count);
+            m_entries_index_hidden.reserve(read_count);
+        }
+
+        for (const auto& e : m_scan_entries) {
+            const u32 i = m_entries.size();
+
+            bool hidden = false;
+            if ('.' == e.name[0]) {
+                hidden = true;
+            }
+            // check if we have a filter.
+            else if (e.type == FsDirEntryType_File && !m_menu->m_filter.empty()) {
+                hidden = true;
+                if (const auto ext = std::strrchr(e.name, '.')) {
+                    for (const auto& filter : m_menu->m_filter) {
+                        if (IsExtension(ext + 1, filter)) {
+                            hidden = false;
+                            break;
+                        }
                     }
                 }
             }
+
+            if (!hidden) {
+                m_entries_index.emplace_back(i);
+            }
+
+            m_entries_index_hidden.emplace_back(i);
+            m_entries.emplace_back(e);
+            sort = true;
         }
+    }
 
-        if (!hidden) {
-            m_entries_index.emplace_back(i);
+    m_scanner.PopStats(m_scan_stats);
+    if (!m_scan_stats.empty()) {
+        const auto sort_by_size = m_menu->m_sort.Get() == SortType_Size;
+        std::vector<bool> moved;
+
+        for (const auto& stat : m_scan_stats) {
+            if (stat.index >= m_entries.size()) {
+                continue;
+            }
+
+            auto& e = m_entries[stat.index];
+            e.done_stat = true;
+            if (R_FAILED(stat.rc)) {
+                continue;
+            }
+
+            if (stat.type == FsDirEntryType_Dir) {
+                e.file_count = stat.file_count;
+                e.dir_count = stat.dir_count;
+            } else {
+                e.time_stamp = stat.time_stamp;
+
+                if (stat.file_size != -1 && stat.file_size != e.file_size) {
+                    e.file_size = stat.file_size;
+
+                    // the entry has to be moved to its new position.
+                    if (sort_by_size) {
+                        if (moved.empty()) {
+                            moved.resize(m_entries.size());
+                        }
+                        moved[stat.index] = true;
+                    }
+                }
+            }
         }
 
-        m_entries_index_hidden.emplace_back(i);
-        m_entries.emplace_back(e);
-        i++;
+        // move the changed entries to the end, the rest are still in order.
+        if (!moved.empty()) {
+            const auto it = std::stable_partition(entries.begin(), entries.begin() + sorted_count, [&moved](u32 i) {
+                return !moved[i];
+            });
+
+            const auto count = std::distance(entries.begin(), it);
+            std::rotate(it, entries.begin() + sorted_count, entries.end());
+            sorted_count = count;
+            sort = true;
+        }
     }
 
-    Sort();
-    SetIndex(0);
+    if (sort) {
+        SortEntries(entries, sorted_count);
 
-    // quick check to see if this is an update folder
-    // todo: only check this on click.
-    if (m_menu->m_options & FsOption_LoadAssoc) {
-        m_is_update_folder = R_SUCCEEDED(CheckIfUpdateFolder());
+        if (selected >= 0) {
+            const auto it = std::ranges::find(m_entries_current, (u32)selected);
+            if (it != m_entries_current.end()) {
+                const s64 index = std::distance(m_entries_current.begin(), it);
+                const auto yoff = m_list->GetYoff() + (index - m_index) * m_list->GetMaxY();
+                SetIndex(index);
+                m_list->SetYoff(std::max(0.f, yoff));
+            }
+        } else {
+            SetIndex(m_index);
+        }
     }
 
-    // find previous entry
-    if (is_walk_up && !m_previous_highlighted_file.empty()) {
-        ON_SCOPE_EXIT(m_previous_highlighted_file.pop_back());
-        SetIndexFromLastFile(m_previous_highlighted_file.back());
-    }
+    if (done) {
+        m_scan_done = true;
+        App::SetBoostMode(false);
+        log_write("scan finished: %s entries: %zu\n", m_path.s, m_entries.size());
 
-    R_SUCCEED();
+        // quick check to see if this is an update folder
+        // todo: only check this on click.
+        if (m_menu->m_options & FsOption_LoadAssoc) {
+            m_is_update_folder = R_SUCCEEDED(CheckIfUpdateFolder());
+        }
+
+        if (m_scan_last_file.has_value()) {
+            SetIndexFromLastFile(*m_scan_last_file);
+            m_scan_last_file.reset();
+        }
+    }
 }
 
 void FsView::Sort() {
+    if (m_menu->m_show_hidden.Get()) {
+        SortEntries(m_entries_index_hidden, 0);
+    } else {
+        SortEntries(m_entries_index, 0);
+    }
+}
+
+void FsView::SortEntries(std::vector<u32>& entries, size_t sorted_count) {
     // returns true if lhs should be before rhs
     const auto sort = m_menu->m_sort.Get();
     const auto order = m_menu->m_order.Get();
@@ -1160,13 +1274,9 @@ void FsView::Sort() {
         std::unreachable();
     };
 
-    if (m_menu->m_show_hidden.Get()) {
-        m_entries_current = m_entries_index_hidden;
-    } else {
-        m_entries_current = m_entries_index;
-    }
-
-    std::sort(m_entries_current.begin(), m_entries_current.end(), sorter);
+    std::sort(entries.begin() + sorted_count, entries.end(), sorter);
+    std::inplace_merge(entries.begin(), entries.begin() + sorted_count, entries.end(), sorter);
+    m_entries_current = entries;
 }
 
 void FsView::SortAndFindLastFile(bool scan) {
@@ -1176,13 +1286,15 @@ void FsView::SortAndFindLastFile(bool scan) {
     }
 
     if (scan) {
+        // selected once the scan has finished.
         Scan(m_path);
+        m_scan_last_file = last_file;
     } else {
         Sort();
-    }
 
-    if (last_file.has_value()) {
-        SetIndexFromLastFile(*last_file);
+        if (last_file.has_value()) {
+            SetIndexFromLastFile(*last_file);
+        }
     }
 }
 
@@ -1566,6 +1678,7 @@ void FsView::SetFs(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& new_path
     }
 
     // m_fs.reset();
+    StopScan();
     m_path = new_path;
     m_entries.clear();
     m_entries_index.clear();
@@ -1577,6 +1690,7 @@ void FsView::SetFs(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& new_path
     m_selected_count = 0;
     m_fs_entry = new_entry;
     m_fs = fs;
+    m_scan_last_file.reset();
 
     if (HasFocus()) {
         if (m_path.empty()) {
@@ -1610,6 +1724,39 @@ void FsView::DisplayHash(hash::Type type) {
     });
 }
 
+void FsView::DisplayHashAll() {
+    static constexpr hash::Type types[]{
+        hash::Type::Crc32,
+        hash::Type::Md5,
+        hash::Type::Sha1,
+        hash::Type::Sha256,
+    };
+
+    // shared between the hashing thread and the done callback.
+    auto hash_out = std::make_shared<std::vector<std::string>>();
+
+    App::Push<ProgressBox>(0, "Hashing"_i18n, GetEntry().name, [this, hash_out](auto pbox) -> Result {
+        const auto full_path = GetNewPathCurrent();
+        pbox->NewTransfer(full_path);
+        R_TRY(hash::Hash(pbox, types, m_fs.get(), full_path, *hash_out));
+
+        R_SUCCEED();
+    }, [hash_out](Result rc){
+        App::PushErrorBox(rc, "Failed to hash file..."_i18n);
+
+        if (R_SUCCEEDED(rc)) {
+            std::string buf;
+            for (u32 i = 0; i < std::size(types); i++) {
+                if (i) {
+                    buf += '\n';
+                }
+                buf += std::string(hash::GetTypeStr(types[i])) + ": " + (*hash_out)[i];
+            }
+            App::Push<OptionBox>(buf, "OK"_i18n);
+        }
+    });
+}
+
 void FsView::DisplayOptions() {
     auto options = std::make_unique<Sidebar>("File Options"_i18n, Sidebar::Side::RIGHT);
     ON_SCOPE_EXIT(App::Push(std::move(options)));
@@ -1917,6 +2064,9 @@ void FsView::DisplayAdvancedOptions() {
             options->Add<SidebarEntryCallback>("SHA256"_i18n, [this](){
                 DisplayHash(hash::Type::Sha256);
             });
+            options->Add<SidebarEntryCallback>("All"_i18n, [this](){
+                DisplayHashAll();
+            });
             options->Add<SidebarEntryCallback>("/dev/null (Speed Test)"_i18n, [this](){
                 DisplayHash(hash::Type::Null);
             });
@@ -1966,6 +2116,13 @@ void Base::Update(Controller* controller, TouchInfo* touch) {
         }
     }
 
+    if (IsSplitScreen()) {
+        view_left->UpdateScan();
+        view_right->UpdateScan();
+    } else {
+        view->UpdateScan();
+    }
+
     // workaround the buttons not being display properly.
     // basically, inherit all actions from the view, draw them,
     // then restore state after.
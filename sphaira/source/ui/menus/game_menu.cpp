@@ -7,6 +7,7 @@
 #include "image.hpp"
 #include "swkbd.hpp"
 
+#include "utils/thumb_cache.hpp"
 #include "utils/utils.hpp"
 #include "utils/nsz_dumper.hpp"
 
@@ -465,6 +466,9 @@ Menu::Menu(u32 flags) : grid::Menu{"Games"_i18n, flags} {
     es::Initialize();
     title::Init();
 
+    // game icons used to be cached as thumbnails.
+    utils::ThumbCache::Remove("games");
+
     fsOpenGameCardDetectionEventNotifier(std::addressof(m_gc_event_notifier));
     fsEventNotifierGetEventHandle(std::addressof(m_gc_event_notifier), std::addressof(m_gc_event), true);
 }
@@ -513,11 +517,22 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    m_image_loader.Upload([this, vg](u64 app_id, const ImageResult& image) {
+        // the image may have been loaded in the meantime, see LoadControlEntry().
+        const auto it = std::ranges::find(m_entries, app_id, &Entry::app_id);
+        if (it == m_entries.end() || it->image) {
+            return;
+        }
+
+        if (!image.data.empty()) {
+            it->image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
+        } else {
+            it->image_failed = true;
+        }
+    });
 
-    m_list->Draw(vg, theme, m_entries.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_visible_pending.clear();
+    m_list->Draw(vg, theme, m_entries.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         auto& e = m_entries[pos];
 
@@ -528,10 +543,19 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             LoadResultIntoEntry(e, title::GetAsync(e.app_id));
         }
 
+        if (e.status == title::NacpLoadStatus::Progress) {
+            m_visible_pending.emplace_back(e.app_id);
+        }
+
         // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.app_id))) {
-                image_load_count++;
+        if (!e.image && !e.image_failed && !m_image_loader.Touch(e.app_id)) {
+            const auto result = title::GetAsync(e.app_id);
+            if (result && !result->icon.empty()) {
+                // the icon is already in memory, so it's decoded rather than using a
+                // thumbnail, which would need to be read from the sd card.
+                m_image_loader.Request(e.app_id, [icon = result->icon]() {
+                    return ImageLoadFromMemory(icon, ImageFlag_JPEG);
+                });
             }
         }
 
@@ -546,6 +570,14 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             gfx::drawText(vg, x + w / 2, y + h / 2, 24.f, "\uE14B", nullptr, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_SELECTED));
         }
     });
+
+    // load the visible entries first, as entries that were scrolled past are still queued.
+    if (!m_visible_pending.empty()) {
+        title::Prioritise(m_visible_pending);
+    }
+
+    // drop the icons that are no longer visible.
+    m_image_loader.Sweep();
 }
 
 void Menu::OnFocusGained() {
@@ -662,6 +694,7 @@ void Menu::SortAndFindLastFile(bool scan) {
 
 void Menu::FreeEntries() {
     auto vg = App::GetVg();
+    m_image_loader.Clear();
 
     for (auto&p : m_entries) {
         FreeEntry(vg, p);
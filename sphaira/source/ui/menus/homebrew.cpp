@@ -105,35 +105,46 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
 void Menu::Draw(NVGcontext* vg, Theme* theme) {
     MenuBase::Draw(vg, theme);
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    m_image_loader.Upload([this, vg](u64 index, const ImageResult& image) {
+        auto& e = m_entries[index];
+        if (!image.data.empty()) {
+            e.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
+        } else {
+            // prevent loading of this icon again as it's already failed.
+            e.icon_offset = e.icon_size = 0;
+        }
+    });
 
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_list->Draw(vg, theme, m_entries_current.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto index = m_entries_current[pos];
         auto& e = m_entries[index];
 
         // lazy load image
-        if (image_load_count < image_load_max) {
-            if (!e.image && e.icon_size && e.icon_offset) {
-                // NOTE: it seems that images can be any size. SuperTux uses a 1024x1024
-                // ~300Kb image, which takes a few frames to completely load.
-                // really, switch-tools should handle this by resizing the image before
-                // adding it to the nro, as well as validate its a valid jpeg.
-                const auto icon = nro_get_icon(e.path, e.icon_size, e.icon_offset);
-                TimeStamp ts;
-                if (!icon.empty()) {
-                    const auto image = ImageLoadFromMemory(icon, ImageFlag_JPEG);
-                    if (!image.data.empty()) {
-                        e.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
-                        log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-                        image_load_count++;
-                    } else {
-                        // prevent loading of this icon again as it's already failed.
-                        e.icon_offset = e.icon_size = 0;
+        if (!e.image && e.icon_size && e.icon_offset && !m_image_loader.Touch(index)) {
+            // NOTE: it seems that images can be any size. SuperTux uses a 1024x1024
+            // ~300Kb image, which takes a few frames to completely load.
+            // really, switch-tools should handle this by resizing the image before
+            // adding it to the nro, as well as validate its a valid jpeg.
+            // the list layout draws icons larger than thumbnails, so load the full icon.
+            const auto use_thumb = m_layout.Get() != LayoutType::LayoutType_List;
+            const auto stamp = (u64(e.timestamp.modified) << 32) | u32(e.size);
+
+            m_image_loader.Request(index, [this, use_thumb, stamp, path = e.path, size = e.icon_size, offset = e.icon_offset]() -> ImageResult {
+                const auto load = [&]() -> ImageResult {
+                    const auto icon = nro_get_icon(path, size, offset);
+                    if (icon.empty()) {
+                        return {};
                     }
+
+                    return ImageLoadFromMemory(icon, ImageFlag_JPEG);
+                };
+
+                if (!use_thumb) {
+                    return load();
                 }
-            }
+
+                return m_thumb_cache.Load(utils::ThumbCache::Hash(std::string_view{path.s}), stamp, load);
+            });
         }
 
 
@@ -155,6 +166,9 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         const auto selected = pos == m_index;
         DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, name.c_str(), e.GetAuthor(), e.GetDisplayVersion());
     });
+
+    // drop the icons that are no longer visible.
+    m_image_loader.Sweep();
 }
 
 void Menu::OnFocusGained() {
@@ -399,6 +413,7 @@ void Menu::SortAndFindLastFile(bool scan) {
 
 void Menu::FreeEntries() {
     auto vg = App::GetVg();
+    m_image_loader.Clear();
 
     for (auto&p : m_entries) {
         FreeEntry(vg, p);
@@ -414,6 +429,13 @@ void Menu::FreeEntries() {
 void Menu::OnLayoutChange() {
     m_index = 0;
     grid::Menu::OnLayoutChange(m_list, m_layout.Get());
+
+    // icons are reloaded as the list layout doesn't use thumbnails.
+    auto vg = App::GetVg();
+    m_image_loader.Clear();
+    for (auto& p : m_entries) {
+        FreeEntry(vg, p);
+    }
 }
 
 Result Menu::InstallHomebrew(const fs::FsPath& path, const std::vector<u8>& icon) {
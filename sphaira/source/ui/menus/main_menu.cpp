@@ -120,7 +120,8 @@ auto InstallUpdate(ProgressBox* pbox, const std::string url, const std::string v
         const auto result = curl::Api().ToFile(
             curl::Url{url},
             curl::Path{zip_out},
-            curl::OnProgress{pbox->OnDownloadProgressCallback()}
+            curl::OnProgress{pbox->OnDownloadProgressCallback()},
+            curl::Flags{curl::Flag_Segmented}
         );
 
         R_UNLESS(result.success, Result_MainFailedToDownloadUpdate);
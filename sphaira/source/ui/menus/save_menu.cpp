@@ -427,11 +427,22 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    m_image_loader.Upload([this, vg](u64 application_id, const ImageResult& image) {
+        for (auto& e : m_entries) {
+            if (e.application_id != application_id || e.image) {
+                continue;
+            }
+
+            if (!image.data.empty()) {
+                e.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
+            } else {
+                e.image_failed = true;
+            }
+        }
+    });
 
-    m_list->Draw(vg, theme, m_entries.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_visible_pending.clear();
+    m_list->Draw(vg, theme, m_entries.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         auto& e = m_entries[pos];
 
@@ -446,10 +457,17 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             LoadResultIntoEntry(e, title::GetAsync(e.application_id));
         }
 
+        if (e.status == title::NacpLoadStatus::Progress) {
+            m_visible_pending.emplace_back(e.application_id);
+        }
+
         // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.application_id))) {
-                image_load_count++;
+        if (!e.image && !e.image_failed && !m_image_loader.Touch(e.application_id)) {
+            const auto result = title::GetAsync(e.application_id);
+            if (result && !result->icon.empty()) {
+                m_image_loader.Request(e.application_id, [icon = result->icon]() {
+                    return ImageLoadFromMemory(icon, ImageFlag_JPEG);
+                });
             }
         }
 
@@ -467,6 +485,14 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             gfx::drawText(vg, x + w / 2, y + h / 2, 24.f, "\uE14B", nullptr, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_SELECTED));
         }
     });
+
+    // load the visible entries first, as entries that were scrolled past are still queued.
+    if (!m_visible_pending.empty()) {
+        title::Prioritise(m_visible_pending);
+    }
+
+    // drop the icons that are no longer visible.
+    m_image_loader.Sweep();
 }
 
 void Menu::OnFocusGained() {
@@ -602,6 +628,7 @@ void Menu::SortAndFindLastFile(bool scan) {
 
 void Menu::FreeEntries() {
     auto vg = App::GetVg();
+    m_image_loader.Clear();
 
     for (auto&p : m_entries) {
         FreeEntry(vg, p);
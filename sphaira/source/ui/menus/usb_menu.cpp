@@ -48,8 +48,7 @@ Menu::Menu(u32 flags) : MenuBase{"USB"_i18n, flags} {
     }
 
     if (m_state != State::Failed) {
-        utils::CreateThread(&m_thread, thread_func, this, 1024*32);
-        threadStart(&m_thread);
+        StartConnectionThread();
     }
 }
 
@@ -67,6 +66,9 @@ Menu::~Menu() {
     log_write("closing data!!!!\n");
     m_usb_source.reset();
 
+    // the install will no longer be resumed.
+    yati::DiscardResumeData();
+
     if (m_was_mtp_enabled) {
         App::Notify("Re-enabled MTP"_i18n);
         App::SetMtpEnable(true);
@@ -100,7 +102,7 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
             ON_SCOPE_EXIT(pbox->RemoveCancelEvent(m_usb_source->GetCancelEvent()));
 
             log_write("inside progress box\n");
-            for (u32 i = 0; i < std::size(m_names); i++) {
+            for (u32 i = m_install_index; i < std::size(m_names); i++) {
                 const auto& file_name = m_names[i];
 
                 s64 file_size;
@@ -115,6 +117,9 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
                     config_override.skip_rsa_npdm_fixed_key_verify = true;
                 }
 
+                // if the transfer fails, the install continues once reconnected.
+                config_override.resumable = true;
+
                 pbox->SetTitle(file_name);
                 const auto rc = yati::InstallFromSource(pbox, m_usb_source.get(), file_name, config_override);
                 if (R_FAILED(rc)) {
@@ -124,6 +129,7 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
                 }
 
                 App::Notify("Installed via usb"_i18n);
+                m_install_index = i + 1;
             }
 
             R_SUCCEED();
@@ -134,6 +140,12 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
                 App::Notify("Usb install success!"_i18n);
                 m_state = State::Done;
                 SetPop();
+            } else if (usb::install::IsTransportError(rc)) {
+                // wait for the host to reconnect, the install is then resumed.
+                // other errors (bad nca, no space) would only fail again.
+                App::Notify("Reconnect to resume install"_i18n);
+                m_usb_source->ClearCancel();
+                StartConnectionThread();
             } else {
                 m_state = State::Failed;
             }
@@ -171,6 +183,18 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
     }
 }
 
+void Menu::StartConnectionThread() {
+    // close the previous connection thread, which has already exited.
+    if (m_thread.handle) {
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
+    }
+
+    m_state = State::None;
+    utils::CreateThread(&m_thread, thread_func, this, 1024*32);
+    threadStart(&m_thread);
+}
+
 void Menu::ThreadFunction() {
     for (;;) {
         if (GetToken().stop_requested()) {
@@ -192,6 +216,11 @@ void Menu::ThreadFunction() {
         if (R_SUCCEEDED(rc)) {
             std::vector<std::string> names;
             if (R_SUCCEEDED(m_usb_source->WaitForConnection(CONNECTION_TIMEOUT, names))) {
+                // start again if the host is sending different files.
+                if (names != m_names) {
+                    m_install_index = 0;
+                }
+
                 m_names = names;
                 m_state = State::Connected_StartingTransfer;
                 break;
@@ -9,6 +9,7 @@
 
 #include "utils/utils.hpp"
 #include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <cstring>
 #include <cmath>
@@ -18,7 +19,14 @@ namespace {
 
 void threadFunc(void* arg) {
     auto d = static_cast<ProgressBox::ThreadData*>(arg);
-    d->result = d->callback(d->pbox);
+
+    {
+        // every install / dump / transfer runs here, buffers are reused between
+        // the files of the callback and given back to the system once it returns.
+        utils::pool::Hold hold{};
+        d->result = d->callback(d->pbox);
+    }
+
     d->pbox->RequestExit();
 }
 
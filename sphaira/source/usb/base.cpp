@@ -28,7 +28,11 @@ namespace {
 
 constexpr u64 TRANSFER_ALIGN = 0x1000;
 constexpr u64 TRANSFER_MAX = 1024*1024*16;
+// transfers are split into packets of this size, whilst one packet is in flight
+// the previous one is copied out (and hashed) or the next one is copied in.
+constexpr u64 PACKET_SIZE = 1024*1024;
 static_assert(!(TRANSFER_MAX % TRANSFER_ALIGN));
+static_assert(!(PACKET_SIZE % TRANSFER_ALIGN));
 
 } // namespace
 
@@ -37,22 +41,25 @@ Base::Base(u64 transfer_timeout) {
 
     m_transfer_timeout = transfer_timeout;
     ueventCreate(GetCancelEvent(), false);
-    m_aligned = std::make_unique<u8*>(new(std::align_val_t{TRANSFER_ALIGN}) u8[TRANSFER_MAX]);
+    // two packets, one in flight and one being copied.
+    m_aligned = std::make_unique<u8*>(new(std::align_val_t{TRANSFER_ALIGN}) u8[PACKET_SIZE * 2]);
 }
 
 Base::~Base() {
     App::SetAutoSleepDisabled(false);
 }
 
-Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size, u32 *out_size_transferred, u64 timeout) {
-    u32 xfer_id;
-
+Result Base::BeginPacket(bool read, void *page, u32 remaining, u32 size, u32 *out_xfer_id, u64 timeout) {
     /* If we're not configured yet, wait to become configured first. */
     R_TRY(IsUsbConnected(timeout));
 
     /* Select the appropriate endpoint and begin a transfer. */
     const auto ep = read ? UsbSessionEndpoint_Out : UsbSessionEndpoint_In;
-    R_TRY(TransferAsync(ep, page, remaining, size, std::addressof(xfer_id)));
+    return TransferAsync(ep, page, remaining, size, out_xfer_id);
+}
+
+Result Base::WaitPacket(bool read, u32 xfer_id, u32 *out_size_transferred, u64 timeout) {
+    const auto ep = read ? UsbSessionEndpoint_Out : UsbSessionEndpoint_In;
 
     /* Try to wait for the event. */
     R_TRY(WaitTransferCompletion(ep, timeout));
@@ -61,6 +68,12 @@ Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size,
     return GetTransferResult(ep, xfer_id, nullptr, out_size_transferred);
 }
 
+Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size, u32 *out_size_transferred, u64 timeout) {
+    u32 xfer_id;
+    R_TRY(BeginPacket(read, page, remaining, size, std::addressof(xfer_id), timeout));
+    return WaitPacket(read, xfer_id, out_size_transferred, timeout);
+}
+
 // while it may seem like a bad idea to transfer data to a buffer and copy it
 // in practice, this has no impact on performance.
 // the switch is *massively* bottlenecked by slow io (nand and sd).
@@ -69,31 +82,81 @@ Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size,
 // an changes are made.
 // yati already goes to great lengths to be zero-copy during installing
 // by swapping buffers and inflating in-place.
+// the copy is hidden by overlapping it with the next packet's transfer.
 Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
+    return TransferAllInternal(read, data, size, timeout, nullptr);
+}
+
+Result Base::ReadAllCrc32c(void *data, u32 size, u32 *out_crc32c, u64 timeout) {
+    *out_crc32c = 0;
+    return TransferAllInternal(true, data, size, timeout, out_crc32c);
+}
+
+Result Base::TransferAllInternal(bool read, void *data, u32 size, u64 timeout, u32 *out_crc32c) {
     auto buf = static_cast<u8*>(data);
-    auto transfer_buf = *m_aligned;
+    u8* const slots[]{*m_aligned, *m_aligned + PACKET_SIZE};
 
-    R_UNLESS(!((u64)transfer_buf & 0xFFF), Result_UsbBadBufferAlign);
+    R_UNLESS(!((u64)slots[0] & 0xFFF), Result_UsbBadBufferAlign);
     R_UNLESS(size <= TRANSFER_MAX, Result_UsbBadTransferSize);
 
+    u32 slot{};
+    // reads: the previous packet that has yet to be copied out and hashed.
+    const u8* prev_src{};
+    u8* prev_dst{};
+    u32 prev_size{};
+    // writes: set if the current slot already holds the data to send.
+    bool staged{};
+
+    const auto flush_prev = [&]() {
+        if (prev_size) {
+            std::memcpy(prev_dst, prev_src, prev_size);
+            if (out_crc32c) {
+                *out_crc32c = crc32cCalculateWithSeed(*out_crc32c, prev_dst, prev_size);
+            }
+            prev_size = 0;
+        }
+    };
+
     while (size) {
-        if (!read) {
-            std::memcpy(transfer_buf, buf, size);
+        const auto page = slots[slot];
+        const u32 packet_size = std::min<u64>(size, PACKET_SIZE);
+
+        if (!read && !staged) {
+            std::memcpy(page, buf, packet_size);
+        }
+
+        u32 xfer_id;
+        R_TRY(BeginPacket(read, page, size, packet_size, std::addressof(xfer_id), timeout));
+
+        // do the copy for the other slot whilst this packet is in flight.
+        if (read) {
+            flush_prev();
+        } else {
+            const auto next_size = std::min<u64>(size - packet_size, PACKET_SIZE);
+            std::memcpy(slots[slot ^ 1], buf + packet_size, next_size);
+            staged = next_size;
         }
 
         u32 out_size_transferred;
-        R_TRY(TransferPacketImpl(read, transfer_buf, size, size, &out_size_transferred, timeout));
+        R_TRY(WaitPacket(read, xfer_id, std::addressof(out_size_transferred), timeout));
         R_UNLESS(out_size_transferred > 0, Result_UsbEmptyTransferSize);
-        R_UNLESS(out_size_transferred <= size, Result_UsbOverflowTransferSize);
+        R_UNLESS(out_size_transferred <= packet_size, Result_UsbOverflowTransferSize);
 
         if (read) {
-            std::memcpy(buf, transfer_buf, out_size_transferred);
+            prev_src = page;
+            prev_dst = buf;
+            prev_size = out_size_transferred;
+        } else if (out_size_transferred != packet_size) {
+            // the staged data no longer starts where the next packet does.
+            staged = false;
         }
 
         buf += out_size_transferred;
         size -= out_size_transferred;
+        slot ^= 1;
     }
 
+    flush_prev();
     R_SUCCEED();
 }
 
@@ -4,14 +4,26 @@
 #include "log.hpp"
 
 #include <ranges>
+#include <algorithm>
+#include <cstring>
 
 namespace sphaira::usb::install {
 namespace {
 
 using namespace usb::api;
 
+// size of each read sent ahead when pipelining.
+// reads smaller than this (headers, tables) are rounded up.
+constexpr u32 PIPELINE_CHUNK_MIN = 1024*1024;
+constexpr u32 PIPELINE_CHUNK_MAX = 1024*1024*8;
+
 } // namespace
 
+auto IsTransportError(Result rc) -> bool {
+    // the state change on disconnect is also reported as a timeout.
+    return rc == KERNELRESULT(TimedOut) || R_MODULE(rc) == Module_Usb || rc == Result_UsbBadCrc32c;
+}
+
 Usb::Usb(u64 transfer_timeout) {
     m_usb = std::make_unique<usb::UsbDs>(transfer_timeout);
     m_open_result = m_usb->Init();
@@ -35,10 +47,14 @@ Result Usb::WaitForConnection(u64 timeout, std::vector<std::string>& out_names)
     R_TRY(m_open_result);
     R_TRY(m_usb->IsUsbConnected(timeout));
 
-    const auto send_header = SendPacket::Build(RESULT_OK);
+    // old hosts ignore the capabilities and reply with a window of 0.
+    const auto send_header = SendPacket::Build(RESULT_OK, CAP_PIPELINE, PIPELINE_WINDOW_MAX, HANDSHAKE_TAG);
     ResultPacket recv_header;
     R_TRY(SendAndVerify(&send_header, sizeof(send_header), timeout, &recv_header))
 
+    m_window = std::min<u32>(recv_header.arg4, PIPELINE_WINDOW_MAX);
+    log_write("[USB] pipeline window: %u\n", m_window);
+
     std::vector<char> names(recv_header.arg3);
     R_TRY(m_usb->TransferAll(true, names.data(), names.size(), timeout));
 
@@ -67,10 +83,16 @@ Result Usb::OpenFile(u32 index, s64& file_size) {
 
     m_flags = flags;
     file_size = ((u64)file_size_msb << 32) | file_size_lsb;
+    m_file_size = file_size;
+    ResetPipeline(0);
     R_SUCCEED();
 }
 
 Result Usb::CloseFile() {
+    // the host replies in order, so any reads in flight have to be received first.
+    R_TRY(DrainPending());
+    ResetPipeline(0);
+
     const auto send_header = SendDataPacket::Build(0, 0, 0);
 
     return SendAndVerify(&send_header, sizeof(send_header));
@@ -80,26 +102,157 @@ void Usb::SignalCancel() {
     m_usb->Cancel();
 }
 
+void Usb::ClearCancel() {
+    m_usb->ClearCancel();
+}
+
 u32 Usb::GetFlags() const {
     return m_flags;
 }
 
 Result Usb::Read(void* buf, u64 off, u32 size, u64* bytes_read) {
+    // stream installs read strictly in order as the host can't seek, so
+    // there's nothing to gain from reading ahead.
+    if (m_window && !(m_flags & FLAG_STREAM)) {
+        return ReadPipelined(buf, off, size, bytes_read);
+    }
+
     const auto send_header = SendDataPacket::Build(off, size, 0);
     ResultPacket recv_header;
     R_TRY(SendAndVerify(&send_header, sizeof(send_header), &recv_header))
 
     // adjust the size and read the data.
     size = recv_header.arg3;
-    R_TRY(m_usb->TransferAll(true, buf, size));
+    u32 crc32c;
+    R_TRY(m_usb->ReadAllCrc32c(buf, size, &crc32c));
 
     // verify crc32c.
-    R_UNLESS(crc32cCalculate(buf, size) == recv_header.arg4, 3);
+    R_UNLESS(crc32c == recv_header.arg4, Result_UsbBadCrc32c);
 
     *bytes_read = size;
     R_SUCCEED();
 }
 
+// keeps up to m_window reads in flight, so that the host can read the next
+// chunk from disk whilst the current one is being transferred.
+Result Usb::ReadPipelined(void* _buf, u64 off, u32 size, u64* bytes_read) {
+    auto buf = static_cast<u8*>(_buf);
+    *bytes_read = 0;
+
+    // forward seeks within the data already requested skip over it, such as
+    // the padding between nca's, rather than throwing the window away.
+    if (off > m_pipeline_off && off < m_request_off) {
+        while (m_pipeline_off < off) {
+            if (m_pipeline_buf_off == m_pipeline_buf.size()) {
+                R_TRY(RefillPipeline(size));
+                if (m_pipeline_buf.empty()) {
+                    break;
+                }
+            }
+
+            const auto skip = std::min<u64>(off - m_pipeline_off, m_pipeline_buf.size() - m_pipeline_buf_off);
+            m_pipeline_buf_off += skip;
+            m_pipeline_off += skip;
+        }
+    }
+
+    // anything else invalidates everything that was read ahead.
+    if (off != m_pipeline_off) {
+        log_write("[USB] pipeline seek: %zu -> %zu\n", m_pipeline_off, off);
+        R_TRY(DrainPending());
+        ResetPipeline(off);
+    }
+
+    while (size) {
+        if (m_pipeline_buf_off == m_pipeline_buf.size()) {
+            R_TRY(RefillPipeline(size));
+
+            // reached the end of the file.
+            if (m_pipeline_buf.empty()) {
+                break;
+            }
+        }
+
+        const auto rsize = std::min<u64>(size, m_pipeline_buf.size() - m_pipeline_buf_off);
+        std::memcpy(buf, m_pipeline_buf.data() + m_pipeline_buf_off, rsize);
+
+        buf += rsize;
+        size -= rsize;
+        m_pipeline_buf_off += rsize;
+        m_pipeline_off += rsize;
+        *bytes_read += rsize;
+    }
+
+    R_SUCCEED();
+}
+
+Result Usb::RefillPipeline(u32 size) {
+    m_pipeline_buf.clear();
+    m_pipeline_buf_off = 0;
+
+    // keep the window full.
+    const auto chunk_size = std::clamp<u32>(size, PIPELINE_CHUNK_MIN, PIPELINE_CHUNK_MAX);
+    while (m_pending.size() < m_window && m_request_off < m_file_size) {
+        const auto request_size = std::min<u64>(chunk_size, m_file_size - m_request_off);
+        auto send_header = SendDataPacket::Build(m_request_off, request_size, 0);
+        R_TRY(m_usb->TransferAll(false, &send_header, sizeof(send_header)));
+
+        m_pending.emplace_back(m_request_off, request_size);
+        m_request_off += request_size;
+    }
+
+    // reached the end of the file.
+    if (m_pending.empty()) {
+        R_SUCCEED();
+    }
+
+    const auto pending = m_pending.front();
+    R_TRY(ReceivePending(m_pipeline_buf));
+
+    // the host returned less than requested, so the reads in flight
+    // are no longer contiguous with the data, request them again.
+    if (m_pipeline_buf.size() < pending.size) {
+        R_TRY(DrainPending());
+        m_request_off = pending.off + m_pipeline_buf.size();
+    }
+
+    R_SUCCEED();
+}
+
+Result Usb::ReceivePending(std::vector<u8>& buf) {
+    R_UNLESS(!m_pending.empty(), Result_UsbBadCount);
+    m_pending.pop_front();
+
+    ResultPacket recv_header;
+    R_TRY(m_usb->TransferAll(true, &recv_header, sizeof(recv_header)));
+    R_TRY(recv_header.Verify());
+
+    buf.resize(recv_header.arg3);
+    u32 crc32c;
+    R_TRY(m_usb->ReadAllCrc32c(buf.data(), buf.size(), &crc32c));
+
+    // verify crc32c.
+    R_UNLESS(crc32c == recv_header.arg4, Result_UsbBadCrc32c);
+    R_SUCCEED();
+}
+
+Result Usb::DrainPending() {
+    std::vector<u8> temp;
+    while (!m_pending.empty()) {
+        R_TRY(ReceivePending(temp));
+    }
+
+    R_SUCCEED();
+}
+
+void Usb::ResetPipeline(u64 off) {
+    m_pending.clear();
+    m_pipeline_buf.clear();
+    m_pipeline_buf_off = 0;
+    m_pipeline_off = off;
+    m_request_off = off;
+}
+
 // casts away const, but it does not modify the buffer!
 Result Usb::SendAndVerify(const void* data, u32 size, u64 timeout, ResultPacket* out) {
     R_TRY(m_usb->TransferAll(false, const_cast<void*>(data), size, timeout));
@@ -0,0 +1,180 @@
+#include "utils/buffer_pool.hpp"
+#include "log.hpp"
+
+#include <vector>
+#include <cstdlib>
+#include <bit>
+#include <algorithm>
+
+namespace sphaira::utils::pool {
+namespace {
+
+// smallest size class, every class after is double the size of the previous.
+constexpr u64 MIN_CLASS_SIZE = ALIGN;
+// sizes larger than this are not cached.
+constexpr u64 MAX_CLASS_SIZE = 1024*1024*32;
+constexpr u32 CLASS_COUNT = std::countr_zero(MAX_CLASS_SIZE) - std::countr_zero(MIN_CLASS_SIZE) + 1;
+// max bytes kept in the pool once returned, anything over is freed.
+// this is enough to reuse the yati / transfer ring buffers between files.
+constexpr u64 MAX_CACHED_SIZE = 1024*1024*32;
+
+struct Pool {
+    Pool() {
+        mutexInit(std::addressof(mutex));
+    }
+
+    Mutex mutex{};
+    std::vector<u8*> free_list[CLASS_COUNT]{};
+    Stats stats{};
+    // number of live holds.
+    u32 holds{};
+};
+
+Pool g_pool{};
+
+auto GetClassSize(u64 size) -> u64 {
+    size = std::max(size, MIN_CLASS_SIZE);
+    if (size > MAX_CLASS_SIZE) {
+        // not cached, so only round up to the alignment.
+        return (size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    return std::bit_ceil(size);
+}
+
+auto GetClassIndex(u64 class_size) -> u32 {
+    return std::countr_zero(class_size) - std::countr_zero(MIN_CLASS_SIZE);
+}
+
+// takes the cached buffers out of the pool, must be called with the mutex locked.
+auto TakeCached() -> std::vector<u8*> {
+    std::vector<u8*> out{};
+    for (auto& list : g_pool.free_list) {
+        out.insert(out.end(), list.begin(), list.end());
+        list.clear();
+    }
+
+    g_pool.stats.cached = 0;
+    return out;
+}
+
+void FreeCached(const std::vector<u8*>& cached, const Stats& stats) {
+    for (auto p : cached) {
+        std::free(p);
+    }
+
+    if (!cached.empty()) {
+        log_write("[POOL] trimmed: %zu high water: %zu allocs: %zu reuses: %zu\n", cached.size(), stats.high_water, stats.allocs, stats.reuses);
+    }
+}
+
+} // namespace
+
+void Lease::Release() {
+    if (!m_data) {
+        return;
+    }
+
+    std::vector<u8*> cached{};
+    Stats stats{};
+    {
+        SCOPED_MUTEX(std::addressof(g_pool.mutex));
+        g_pool.stats.in_use -= m_size;
+
+        if (!g_pool.stats.in_use && !g_pool.holds) {
+            // last lease of the transfer, nothing is left to reuse the cache.
+            cached = TakeCached();
+            stats = g_pool.stats;
+        } else if (m_size <= MAX_CLASS_SIZE && g_pool.stats.cached + m_size <= MAX_CACHED_SIZE) {
+            g_pool.free_list[GetClassIndex(m_size)].emplace_back(m_data);
+            g_pool.stats.cached += m_size;
+            m_data = nullptr;
+        }
+    }
+
+    FreeCached(cached, stats);
+    std::free(m_data);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+auto Acquire(u64 size) -> Lease {
+    Lease lease{};
+    const auto class_size = GetClassSize(size);
+
+    {
+        SCOPED_MUTEX(std::addressof(g_pool.mutex));
+        if (class_size <= MAX_CLASS_SIZE) {
+            auto& list = g_pool.free_list[GetClassIndex(class_size)];
+            if (!list.empty()) {
+                lease.m_data = list.back();
+                lease.m_size = class_size;
+                list.pop_back();
+
+                g_pool.stats.cached -= class_size;
+                g_pool.stats.reuses++;
+            }
+        }
+    }
+
+    const auto reused = lease.m_data != nullptr;
+    if (!reused) {
+        lease.m_data = static_cast<u8*>(std::aligned_alloc(ALIGN, class_size));
+        if (!lease.m_data) {
+            log_write("[POOL] failed to allocate: %zu\n", class_size);
+            return {};
+        }
+
+        lease.m_size = class_size;
+    }
+
+    SCOPED_MUTEX(std::addressof(g_pool.mutex));
+    if (!reused) {
+        g_pool.stats.allocs++;
+    }
+
+    g_pool.stats.in_use += class_size;
+    g_pool.stats.high_water = std::max(g_pool.stats.high_water, g_pool.stats.in_use);
+    return lease;
+}
+
+Hold::Hold() {
+    SCOPED_MUTEX(std::addressof(g_pool.mutex));
+    g_pool.holds++;
+}
+
+Hold::~Hold() {
+    std::vector<u8*> cached{};
+    Stats stats{};
+    {
+        SCOPED_MUTEX(std::addressof(g_pool.mutex));
+        g_pool.holds--;
+
+        // leases still out will trim once returned.
+        if (!g_pool.stats.in_use && !g_pool.holds) {
+            cached = TakeCached();
+            stats = g_pool.stats;
+        }
+    }
+
+    FreeCached(cached, stats);
+}
+
+auto GetStats() -> Stats {
+    SCOPED_MUTEX(std::addressof(g_pool.mutex));
+    return g_pool.stats;
+}
+
+void Trim() {
+    std::vector<u8*> cached{};
+    Stats stats{};
+    {
+        SCOPED_MUTEX(std::addressof(g_pool.mutex));
+        cached = TakeCached();
+        stats = g_pool.stats;
+    }
+
+    FreeCached(cached, stats);
+}
+
+} // namespace sphaira::utils::pool
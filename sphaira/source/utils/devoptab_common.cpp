@@ -7,6 +7,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <bit>
 #include <fcntl.h>
 #include <minIni.h>
 #include <curl/curl.h>
@@ -21,6 +22,11 @@ namespace {
 
 RwLock g_rwlock{};
 
+// number of reads following on from the previous read before readahead starts.
+constexpr u32 SEQUENTIAL_STREAK = 2;
+// blocks fetched by the first readahead of a stream, so that short streams don't waste a full window.
+constexpr u32 READAHEAD_START = 4;
+
 // curl_url_strerror doesn't exist in the switch version of libcurl as its so old.
 // todo: update libcurl and send patches to dkp.
 const char* curl_url_strerror_wrap(CURLUcode code) {
@@ -66,6 +72,40 @@ struct Dir {
     void* fd;
 };
 
+// thread safe devices are only locked whilst mounting, so that multiple
+// requests to the same device can be in flight at once.
+struct ScopedDeviceLock {
+    explicit ScopedDeviceLock(Device* device) : mutex{device->mount_device && device->mount_device->IsThreadSafe() ? nullptr : &device->mutex} {
+        if (mutex) {
+            mutexLock(mutex);
+        }
+    }
+
+    ~ScopedDeviceLock() {
+        if (mutex) {
+            mutexUnlock(mutex);
+        }
+    }
+
+    ScopedDeviceLock(const ScopedDeviceLock&) = delete;
+    void operator=(const ScopedDeviceLock&) = delete;
+
+private:
+    Mutex* const mutex;
+};
+
+// the device lock is already held if the device isn't thread safe.
+// thread safe devices aren't locked by ScopedDeviceLock, so the mutex is taken
+// here, otherwise concurrent opens would race to mount the device.
+bool mount_device(Device* device) {
+    if (!device->mount_device->IsThreadSafe()) {
+        return device->mount_device->Mount();
+    }
+
+    SCOPED_MUTEX(&device->mutex);
+    return device->mount_device->Mount();
+}
+
 int set_errno(struct _reent *r, int err) {
     r->_errno = err;
     return -1;
@@ -76,7 +116,7 @@ int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int fla
     auto file = static_cast<File*>(fileStruct);
     std::memset(file, 0, sizeof(*file));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (device->config.read_only && (flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND))) {
         return set_errno(r, EROFS);
@@ -87,7 +127,7 @@ int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int fla
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -110,7 +150,7 @@ int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int fla
 int devoptab_close(struct _reent *r, void *fd) {
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     if (file->fd) {
         file->device->mount_device->devoptab_close(file->fd);
@@ -124,7 +164,7 @@ int devoptab_close(struct _reent *r, void *fd) {
 ssize_t devoptab_read(struct _reent *r, void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     const auto ret = file->device->mount_device->devoptab_read(file->fd, ptr, len);
     if (ret < 0) {
@@ -137,7 +177,7 @@ ssize_t devoptab_read(struct _reent *r, void *fd, char *ptr, size_t len) {
 ssize_t devoptab_write(struct _reent *r, void *fd, const char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     const auto ret = file->device->mount_device->devoptab_write(file->fd, ptr, len);
     if (ret < 0) {
@@ -150,7 +190,7 @@ ssize_t devoptab_write(struct _reent *r, void *fd, const char *ptr, size_t len)
 off_t devoptab_seek(struct _reent *r, void *fd, off_t pos, int dir) {
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     const auto ret = file->device->mount_device->devoptab_seek(file->fd, pos, dir);
     if (ret < 0) {
@@ -166,7 +206,7 @@ int devoptab_fstat(struct _reent *r, void *fd, struct stat *st) {
     auto file = static_cast<File*>(fd);
     std::memset(st, 0, sizeof(*st));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     const auto ret = file->device->mount_device->devoptab_fstat(file->fd, st);
     if (ret) {
@@ -179,7 +219,7 @@ int devoptab_fstat(struct _reent *r, void *fd, struct stat *st) {
 int devoptab_unlink(struct _reent *r, const char *_path) {
     auto device = static_cast<Device*>(r->deviceData);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (device->config.read_only) {
         return set_errno(r, EROFS);
@@ -190,7 +230,7 @@ int devoptab_unlink(struct _reent *r, const char *_path) {
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -205,7 +245,7 @@ int devoptab_unlink(struct _reent *r, const char *_path) {
 int devoptab_rename(struct _reent *r, const char *_oldName, const char *_newName) {
     auto device = static_cast<Device*>(r->deviceData);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (device->config.read_only) {
         return set_errno(r, EROFS);
@@ -221,7 +261,7 @@ int devoptab_rename(struct _reent *r, const char *_oldName, const char *_newName
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -236,7 +276,7 @@ int devoptab_rename(struct _reent *r, const char *_oldName, const char *_newName
 int devoptab_mkdir(struct _reent *r, const char *_path, int mode) {
     auto device = static_cast<Device*>(r->deviceData);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (device->config.read_only) {
         return set_errno(r, EROFS);
@@ -247,7 +287,7 @@ int devoptab_mkdir(struct _reent *r, const char *_path, int mode) {
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -262,7 +302,7 @@ int devoptab_mkdir(struct _reent *r, const char *_path, int mode) {
 int devoptab_rmdir(struct _reent *r, const char *_path) {
     auto device = static_cast<Device*>(r->deviceData);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (device->config.read_only) {
         return set_errno(r, EROFS);
@@ -273,7 +313,7 @@ int devoptab_rmdir(struct _reent *r, const char *_path) {
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -290,7 +330,7 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
     auto dir = static_cast<Dir*>(dirState->dirStruct);
     std::memset(dir, 0, sizeof(*dir));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     log_write("[DEVOPTAB] diropen %s\n", _path);
 
@@ -308,7 +348,7 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
 
     log_write("[DEVOPTAB] diropen fixed path %s\n", path);
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         set_errno(r, EIO);
         return nullptr;
     }
@@ -340,7 +380,7 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
 int devoptab_dirreset(struct _reent *r, DIR_ITER *dirState) {
     auto dir = static_cast<Dir*>(dirState->dirStruct);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&dir->device->mutex);
+    const ScopedDeviceLock device_lock{dir->device};
 
     const auto ret = dir->device->mount_device->devoptab_dirreset(dir->fd);
     if (ret) {
@@ -354,7 +394,7 @@ int devoptab_dirnext(struct _reent *r, DIR_ITER *dirState, char *filename, struc
     auto dir = static_cast<Dir*>(dirState->dirStruct);
     std::memset(filestat, 0, sizeof(*filestat));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&dir->device->mutex);
+    const ScopedDeviceLock device_lock{dir->device};
 
     const auto ret = dir->device->mount_device->devoptab_dirnext(dir->fd, filename, filestat);
     if (ret) {
@@ -367,7 +407,7 @@ int devoptab_dirnext(struct _reent *r, DIR_ITER *dirState, char *filename, struc
 int devoptab_dirclose(struct _reent *r, DIR_ITER *dirState) {
     auto dir = static_cast<Dir*>(dirState->dirStruct);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&dir->device->mutex);
+    const ScopedDeviceLock device_lock{dir->device};
 
     if (dir->fd) {
         dir->device->mount_device->devoptab_dirclose(dir->fd);
@@ -382,7 +422,7 @@ int devoptab_lstat(struct _reent *r, const char *_path, struct stat *st) {
     auto device = static_cast<Device*>(r->deviceData);
     std::memset(st, 0, sizeof(*st));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     // special case: root of the device.
     const auto dilem = std::strchr(_path, ':');
@@ -397,7 +437,7 @@ int devoptab_lstat(struct _reent *r, const char *_path, struct stat *st) {
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -411,7 +451,7 @@ int devoptab_lstat(struct _reent *r, const char *_path, struct stat *st) {
 
 int devoptab_ftruncate(struct _reent *r, void *fd, off_t len) {
     auto file = static_cast<File*>(fd);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     if (!file || !file->fd) {
         return set_errno(r, EBADF);
@@ -433,14 +473,14 @@ int devoptab_statvfs(struct _reent *r, const char *_path, struct statvfs *buf) {
     auto device = static_cast<Device*>(r->deviceData);
     std::memset(buf, 0, sizeof(*buf));
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     char path[PATH_MAX]{};
     if (!device->mount_device->fix_path(_path, path)) {
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -454,7 +494,7 @@ int devoptab_statvfs(struct _reent *r, const char *_path, struct statvfs *buf) {
 
 int devoptab_fsync(struct _reent *r, void *fd) {
     auto file = static_cast<File*>(fd);
-    SCOPED_MUTEX(&file->device->mutex);
+    const ScopedDeviceLock device_lock{file->device};
 
     if (!file || !file->fd) {
         return set_errno(r, EBADF);
@@ -475,7 +515,7 @@ int devoptab_fsync(struct _reent *r, void *fd) {
 int devoptab_utimes(struct _reent *r, const char *_path, const struct timeval times[2]) {
     auto device = static_cast<Device*>(r->deviceData);
     SCOPED_RWLOCK(&g_rwlock, false);
-    SCOPED_MUTEX(&device->mutex);
+    const ScopedDeviceLock device_lock{device};
 
     if (!times) {
         log_write("[DEVOPTAB] devoptab_utimes() times is null\n");
@@ -491,7 +531,7 @@ int devoptab_utimes(struct _reent *r, const char *_path, const struct timeval ti
         return set_errno(r, ENOENT);
     }
 
-    if (!device->mount_device->Mount()) {
+    if (!mount_device(device)) {
         return set_errno(r, EIO);
     }
 
@@ -608,8 +648,59 @@ Result BufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes
     R_SUCCEED();
 }
 
+LruBufferedData::LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, const Config& config)
+: BufferedDataBase{_source, _size}
+, m_block_size{std::bit_ceil(std::max<u32>(config.block_size, 512))}
+, m_readahead{config.readahead} {
+    mutexInit(&m_mutex);
+    mutexInit(&m_source_mutex);
+    condvarInit(&m_can_read);
+    condvarInit(&m_can_work);
+
+    // there must be enough blocks for the readahead window and the blocks being read.
+    const auto block_count = std::max<u64>(config.block_count, m_readahead * 2 + 2);
+    m_data = utils::pool::Acquire(block_count * m_block_size);
+    if (!m_data) {
+        log_write("[LRU] failed to allocate cache, reads will not be cached\n");
+        return;
+    }
+
+    // the pool rounds up the size, so use all of it.
+    m_blocks.resize(m_data.size() / m_block_size);
+    m_lru.Init(m_blocks);
+    m_index.reserve(m_blocks.size());
+}
+
+LruBufferedData::~LruBufferedData() {
+    if (m_thread_started) {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_quit = true;
+            condvarWakeAll(&m_can_work);
+        }
+
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
+    }
+
+    log_write("[LRU] hits: %llu misses: %llu readahead: %llu readahead waste: %llu\n",
+        (unsigned long long)m_stats.hits, (unsigned long long)m_stats.misses,
+        (unsigned long long)m_stats.readahead, (unsigned long long)m_stats.readahead_waste);
+}
+
+auto LruBufferedData::GetStats() -> Stats {
+    SCOPED_MUTEX(&m_mutex);
+    return m_stats;
+}
+
+void LruBufferedData::WaitIdle() {
+    SCOPED_MUTEX(&m_mutex);
+    while (m_ra_count || std::ranges::any_of(m_blocks, [](auto& e) { return e.loading; })) {
+        condvarWait(&m_can_read, &m_mutex);
+    }
+}
+
 Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes_read) {
-    // log_write("[FATFS] read offset: %zu size: %zu\n", file_off, read_size);
     auto dst = static_cast<u8*>(_buffer);
     size_t amount = 0;
     *bytes_read = 0;
@@ -617,82 +708,289 @@ Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* by
     R_UNLESS(file_off < capacity, FsError_UnsupportedOperateRangeForFileStorage);
     read_size = std::min<s64>(read_size, capacity - file_off);
 
-    // fatfs reads in max 16k chunks.
-    // knowing this, it's possible to detect large file reads by simply checking if
-    // the read size is 16k (or more, maybe in the further).
-    // however this would destroy random access performance, such as fetching 512 bytes.
-    // the fix was to have 2 LRU caches, one for large data and the other for small (anything below 16k).
-    // the results in file reads 32MB -> 184MB and directory listing is instant.
-    const auto large_read = read_size >= 1024 * 16;
-    auto& lru = large_read ? lru_cache[1] : lru_cache[0];
-
-    for (auto list = lru.begin(); list; list = list->next) {
-        const auto& m_buffered = list->data;
-        if (m_buffered->size) {
-            // check if we can read this data into the beginning of dst.
-            if (file_off < m_buffered->off + m_buffered->size && file_off >= m_buffered->off) {
-                const auto off = file_off - m_buffered->off;
-                const auto size = std::min<s64>(read_size, m_buffered->size - off);
-                if (size) {
-                    // log_write("[FAT] cache HIT at: %zu\n", file_off);
-                    std::memcpy(dst, m_buffered->data + off, size);
-
-                    read_size -= size;
-                    file_off += size;
-                    amount += size;
-                    dst += size;
-
-                    lru.Update(list);
-                    break;
+    if (!m_data) {
+        SCOPED_MUTEX(&m_source_mutex);
+        return source->Read(dst, file_off, read_size, bytes_read);
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+
+    // fatfs reads in max 16k chunks, so a sequential read is detected by
+    // the read starting where the last one ended, rather than by the size.
+    if ((u64)file_off == m_last_end) {
+        m_streak++;
+    } else {
+        m_streak = 0;
+    }
+    m_last_end = file_off + read_size;
+
+    while (read_size) {
+        const auto index = file_off / m_block_size;
+        const auto block_off = file_off % m_block_size;
+        auto entry = Find(index);
+
+        if (entry && entry->data->loading) {
+            condvarWait(&m_can_read, &m_mutex);
+            continue;
+        }
+
+        if (entry) {
+            m_stats.hits++;
+            entry->data->readahead = false;
+            m_lru.Update(entry);
+        } else if ((u64)read_size >= m_block_size) {
+            // read in place, stopping at the first cached block.
+            // unaligned reads are not split, so they cost a single source read.
+            const auto end = file_off + read_size;
+            u64 count = 1;
+            while ((index + count) * m_block_size < (u64)end && !Find(index + count)) {
+                count++;
+            }
+
+            const auto size = std::min<u64>(end, (index + count) * m_block_size) - file_off;
+            u64 bytes;
+            {
+                SCOPED_MUTEX(&m_source_mutex);
+                R_TRY(source->Read(dst, file_off, size, &bytes));
+            }
+            m_stats.misses += count;
+
+            // save the last whole block, as the next read is likely to continue from it.
+            const auto first = (file_off + m_block_size - 1) / m_block_size;
+            const auto last = (file_off + bytes) / m_block_size;
+            if (last > first) {
+                if (auto free_entry = Evict()) {
+                    Insert(free_entry, last - 1, false);
+                    std::memcpy(GetBlockData(free_entry->data), dst + (last - 1) * m_block_size - file_off, m_block_size);
+                    free_entry->data->size = m_block_size;
                 }
             }
+
+            read_size -= bytes;
+            file_off += bytes;
+            amount += bytes;
+            dst += bytes;
+
+            // short read, the source is smaller than reported.
+            if (bytes != size) {
+                break;
+            }
+            continue;
+        } else {
+            entry = Evict();
+            if (!entry) {
+                // every block is being loaded by readahead, wait for one to finish.
+                condvarWait(&m_can_read, &m_mutex);
+                continue;
+            }
+
+            m_stats.misses++;
+            R_TRY(Fill(entry, index));
+        }
+
+        const auto block = entry->data;
+        if (block->size <= block_off) {
+            break;
+        }
+
+        const auto size = std::min<u64>(read_size, block->size - block_off);
+        std::memcpy(dst, GetBlockData(block) + block_off, size);
+
+        read_size -= size;
+        file_off += size;
+        amount += size;
+        dst += size;
+    }
+
+    if (m_readahead && m_streak >= SEQUENTIAL_STREAK) {
+        Readahead((m_last_end + m_block_size - 1) / m_block_size);
+    }
+
+    *bytes_read = amount;
+    R_SUCCEED();
+}
+
+void LruBufferedData::thread_func(void* arg) {
+    auto self = static_cast<LruBufferedData*>(arg);
+    std::vector<ListEntry*> entries;
+    entries.reserve(self->m_readahead);
+
+    SCOPED_MUTEX(&self->m_mutex);
+
+    for (;;) {
+        while (!self->m_quit && !self->m_ra_count) {
+            condvarWait(&self->m_can_work, &self->m_mutex);
+        }
+
+        if (self->m_quit) {
+            break;
+        }
+
+        auto index = self->m_ra_index;
+        auto count = self->m_ra_count;
+        self->m_ra_count = 0;
+
+        // skip blocks the reader got to first, then claim the blocks,
+        // stopping at the next one that's already cached.
+        for (; count && self->Find(index); index++, count--) {
+        }
+
+        entries.clear();
+        for (u64 i = 0; i < count && !self->Find(index + i); i++) {
+            const auto entry = self->Evict();
+            if (!entry) {
+                break;
+            }
+
+            self->Insert(entry, index + i, true);
+            entries.emplace_back(entry);
+        }
+
+        if (entries.empty()) {
+            condvarWakeAll(&self->m_can_read);
+            continue;
+        }
+
+        // read the blocks as a single request, without blocking the reader.
+        const auto off = index * self->m_block_size;
+        const auto size = std::min<u64>(entries.size() * self->m_block_size, self->capacity - off);
+        u64 bytes{};
+        Result rc;
+
+        mutexUnlock(&self->m_mutex);
+        {
+            SCOPED_MUTEX(&self->m_source_mutex);
+            rc = self->source->Read(self->m_ra_buffer.data(), off, size, &bytes);
+        }
+        mutexLock(&self->m_mutex);
+
+        for (u64 i = 0; i < entries.size(); i++) {
+            const auto block = entries[i]->data;
+            const auto block_off = i * self->m_block_size;
+            block->loading = false;
+
+            // on failure, the reader will try again.
+            if (R_FAILED(rc) || bytes <= block_off) {
+                self->m_index.erase(block->index);
+                block->valid = false;
+                continue;
+            }
+
+            block->size = std::min<u64>(self->m_block_size, bytes - block_off);
+            block->readahead = true;
+            std::memcpy(self->GetBlockData(block), self->m_ra_buffer.data() + block_off, block->size);
+            self->m_stats.readahead++;
         }
+
+        condvarWakeAll(&self->m_can_read);
     }
+}
 
-    if (read_size) {
-        // log_write("[FAT] cache miss at: %zu %zu\n", file_off, read_size);
+auto LruBufferedData::GetBlockData(const Block* block) const -> u8* {
+    return m_data.data() + (block - m_blocks.data()) * m_block_size;
+}
 
-        auto alloc_size = large_read ? CACHE_LARGE_ALLOC_SIZE : std::max<u64>(read_size, 512 * 24);
-        alloc_size = std::min<s64>(alloc_size, capacity - file_off);
-        u64 bytes_read;
+auto LruBufferedData::GetBlockSize(u64 index) const -> u64 {
+    return std::min<u64>(m_block_size, capacity - index * m_block_size);
+}
 
-        auto m_buffered = lru.GetNextFree();
-        m_buffered->Allocate(alloc_size);
+auto LruBufferedData::Find(u64 index) -> ListEntry* {
+    const auto it = m_index.find(index);
+    if (it == m_index.end()) {
+        return nullptr;
+    }
 
-        // if the dst is big enough, read data in place.
-        if (read_size > alloc_size) {
-            R_TRY(source->Read(dst, file_off, read_size, &bytes_read));
-            // R_TRY(fsStorageRead(storage, file_off, dst, read_size));
-            read_size -= bytes_read;
-            file_off += bytes_read;
-            amount += bytes_read;
-            dst += bytes_read;
+    return m_lru.GetEntry(it->second);
+}
 
-            // save the last chunk of data to the m_buffered io.
-            const auto max_advance = std::min<u64>(amount, alloc_size);
-            m_buffered->off = file_off - max_advance;
-            m_buffered->size = max_advance;
-            std::memcpy(m_buffered->data, dst - max_advance, max_advance);
-        } else {
-            R_TRY(source->Read(m_buffered->data, file_off, alloc_size, &bytes_read));
-            // R_TRY(fsStorageRead(storage, file_off, m_buffered->data, alloc_size));
-			const auto max_advance = std::min<u64>(read_size, bytes_read);
-            std::memcpy(dst, m_buffered->data, max_advance);
+auto LruBufferedData::Evict() -> ListEntry* {
+    // blocks being loaded by readahead can't be evicted.
+    for (auto entry = m_lru.end(); entry; entry = entry->prev) {
+        const auto block = entry->data;
+        if (block->loading) {
+            continue;
+        }
 
-            m_buffered->off = file_off;
-            m_buffered->size = bytes_read;
+        if (block->valid) {
+            if (block->readahead) {
+                m_stats.readahead_waste++;
+            }
 
-            read_size -= max_advance;
-            file_off += max_advance;
-            amount += max_advance;
-            dst += max_advance;
+            m_index.erase(block->index);
+            block->valid = false;
+            block->readahead = false;
         }
+
+        m_lru.Update(entry);
+        return entry;
     }
 
-    *bytes_read = amount;
+    return nullptr;
+}
+
+void LruBufferedData::Insert(ListEntry* entry, u64 index, bool loading) {
+    const auto block = entry->data;
+    block->index = index;
+    block->size = 0;
+    block->valid = true;
+    block->loading = loading;
+    block->readahead = false;
+    m_index[index] = block - m_blocks.data();
+}
+
+Result LruBufferedData::Fill(ListEntry* entry, u64 index) {
+    const auto block = entry->data;
+    u64 bytes;
+
+    {
+        SCOPED_MUTEX(&m_source_mutex);
+        R_TRY(source->Read(GetBlockData(block), index * m_block_size, GetBlockSize(index), &bytes));
+    }
+
+    Insert(entry, index, false);
+    block->size = bytes;
     R_SUCCEED();
 }
 
+void LruBufferedData::Readahead(u64 next) {
+    const auto block_count = (capacity + m_block_size - 1) / m_block_size;
+
+    // reset the window if the reader has moved outside of it.
+    if (m_ra_next < next || m_ra_next > next + m_readahead) {
+        m_ra_next = next;
+        m_ra_window = std::min(READAHEAD_START, m_readahead);
+    }
+
+    // top up the window once half of it has been read.
+    if (m_ra_count || m_ra_next > next + m_ra_window / 2 || m_ra_next >= block_count) {
+        return;
+    }
+
+    if (!m_thread_started) {
+        m_ra_buffer = utils::pool::Acquire((u64)m_readahead * m_block_size);
+        if (!m_ra_buffer || R_FAILED(utils::CreateThread(&m_thread, thread_func, this))) {
+            log_write("[LRU] failed to create readahead thread\n");
+            m_readahead = 0;
+            return;
+        }
+
+        if (R_FAILED(threadStart(&m_thread))) {
+            log_write("[LRU] failed to start readahead thread\n");
+            threadClose(&m_thread);
+            m_readahead = 0;
+            return;
+        }
+
+        m_thread_started = true;
+    }
+
+    m_ra_index = m_ra_next;
+    m_ra_count = std::min(next + m_ra_window, block_count) - m_ra_next;
+    m_ra_next += m_ra_count;
+    m_ra_window = std::min<u64>(m_ra_window * 2, m_readahead);
+    condvarWakeOne(&m_can_work);
+}
+
 bool fix_path(const char* str, char* out, bool strip_leading_slash) {
     str = std::strchr(str, ':');
     if (!str) {
@@ -949,10 +1247,11 @@ Result MountNetworkDevice(const CreateDeviceCallback& create_device, size_t file
     R_SUCCEED();
 }
 
-PushPullThreadData::PushPullThreadData(CURL* _curl) : curl{_curl} {
+PushPullThreadData::PushPullThreadData(CURL* _curl, size_t buffer_size) : curl{_curl} {
     mutexInit(&mutex);
     condvarInit(&can_push);
     condvarInit(&can_pull);
+    buffer.resize(std::max<size_t>(buffer_size, CURL_MAX_WRITE_SIZE));
 }
 
 PushPullThreadData::~PushPullThreadData() {
@@ -994,6 +1293,28 @@ bool PushPullThreadData::IsRunning() {
     return !finished && !error;
 }
 
+size_t PushPullThreadData::ReadBuffer(char* data, size_t size) {
+    size = std::min(size, buffered);
+    const auto first = std::min(size, buffer.size() - buffer_off);
+    std::memcpy(data, buffer.data() + buffer_off, first);
+    std::memcpy(data + first, buffer.data(), size - first);
+
+    buffer_off = (buffer_off + size) % buffer.size();
+    buffered -= size;
+    return size;
+}
+
+size_t PushPullThreadData::WriteBuffer(const char* data, size_t size) {
+    size = std::min(size, buffer.size() - buffered);
+    const auto pos = (buffer_off + buffered) % buffer.size();
+    const auto first = std::min(size, buffer.size() - pos);
+    std::memcpy(buffer.data() + pos, data, first);
+    std::memcpy(buffer.data(), data + first, size - first);
+
+    buffered += size;
+    return size;
+}
+
 size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
     if (!data || !total_size) {
         return 0;
@@ -1005,7 +1326,7 @@ size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
     if (curl) {
         // this should be handled in the progress function.
         // however i handle it here as well just in case.
-        if (buffer.empty()) {
+        if (!buffered) {
             if (finished) {
                 log_write("[PUSH:PULL] PullData: finished and no data\n");
                 return 0;
@@ -1015,15 +1336,12 @@ size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
         }
 
         // read what we can.
-        const auto rsize = std::min(total_size, buffer.size());
-        std::memcpy(data, buffer.data(), rsize);
-        buffer.erase(buffer.begin(), buffer.begin() + rsize);
-        return rsize;
+        return ReadBuffer(data, total_size);
     } else {
         // if we are not in a curl callback, then we can block until we have data.
         size_t bytes_read = 0;
         while (bytes_read < total_size && !error) {
-            if (buffer.empty()) {
+            if (!buffered) {
                 if (finished) {
                     break;
                 }
@@ -1033,10 +1351,7 @@ size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
                 continue;
             }
 
-            const auto rsize = std::min(total_size - bytes_read, buffer.size());
-            std::memcpy(data + bytes_read, buffer.data(), rsize);
-            buffer.erase(buffer.begin(), buffer.begin() + rsize);
-            bytes_read += rsize;
+            bytes_read += ReadBuffer(data + bytes_read, total_size - bytes_read);
         }
 
         return bytes_read;
@@ -1054,29 +1369,25 @@ size_t PushPullThreadData::PushData(const char* data, size_t total_size, bool cu
     if (curl) {
         // this should be handled in the progress function.
         // however i handle it here as well just in case.
-        if (buffer.size() + total_size > MAX_BUFFER_SIZE) {
+        if (buffered + total_size > buffer.size()) {
             return CURL_WRITEFUNC_PAUSE;
         }
 
         // blocking / pausing is handled in the progress function.
         // do NOT block here as curl does not like it and it will deadlock.
         // the mutex block above is fine as it only blocks to perform a memcpy.
-        buffer.insert(buffer.end(), data, data + total_size);
-        return total_size;
+        return WriteBuffer(data, total_size);
     } else {
         // if we are not in a curl callback, then we can block until we have space.
         size_t bytes_written = 0;
         while (bytes_written < total_size && !error && !finished) {
-            const size_t space_left = MAX_BUFFER_SIZE - buffer.size();
-            if (space_left == 0) {
+            if (buffered == buffer.size()) {
                 condvarWakeOne(&can_pull);
                 condvarWait(&can_push, &mutex);
                 continue;
             }
 
-            const auto wsize = std::min(total_size - bytes_written, space_left);
-            buffer.insert(buffer.end(), data + bytes_written, data + bytes_written + wsize);
-            bytes_written += wsize;
+            bytes_written += WriteBuffer(data + bytes_written, total_size - bytes_written);
         }
 
         return bytes_written;
@@ -1114,15 +1425,15 @@ size_t PushPullThreadData::progress_callback(void *clientp, curl_off_t dltotal,
             return 1;
         }
 
-        // nothing yet.
         if (!dlnow && !ulnow) {
-            return 0;
-        }
-
-        // workout if this is a download or upload.
-        const auto is_download = dlnow > 0;
+            // nothing yet, unless an upload was paused before it had any data to send.
+            // it has to be resumed here, otherwise it stays paused forever.
+            if (!data->buffered && !data->finished) {
+                return 0;
+            }
 
-        if (is_download) {
+            should_pause = false;
+        } else if (dlnow > 0) {
             // no more data wanted, usually this is handled by curl using ranges.
             // however, if we did a seek, then we want to cancel early.
             if (data->finished) {
@@ -1131,11 +1442,11 @@ size_t PushPullThreadData::progress_callback(void *clientp, curl_off_t dltotal,
             }
 
             // pause if the buffer is full, otherwise continue.
-            should_pause = data->buffer.size() >= MAX_BUFFER_SIZE;
+            should_pause = data->buffered >= data->buffer.size();
         } else {
             // pause if we have no data to send, otherwise continue.
             // do not pause if finished as curl may have internal data pending to send.
-            should_pause = !data->finished && data->buffer.empty();
+            should_pause = !data->finished && !data->buffered;
         }
     }
 
@@ -1172,20 +1483,193 @@ void PushPullThreadData::thread_func(void* arg) {
     log_write("[PUSH:PULL] Read thread finished, code: %ld, error: %d\n", data->code, data->error);
 }
 
+namespace {
+
+auto GetTimeNs() -> u64 {
+    return armTicksToNs(armGetSystemTick());
+}
+
+// removes the trailing slash so that "/dir" and "/dir/" share an entry.
+auto NormalisePath(const std::string& path) -> std::string {
+    auto out = path;
+    while (out.size() > 1 && out.back() == '/') {
+        out.pop_back();
+    }
+
+    if (out.empty()) {
+        out = "/";
+    }
+
+    return out;
+}
+
+// splits the path into the parent folder and the name.
+auto SplitPath(const std::string& path) -> std::pair<std::string, std::string> {
+    const auto pos = path.rfind('/');
+    if (pos == std::string::npos) {
+        return {"/", path};
+    }
+
+    return {pos ? path.substr(0, pos) : "/", path.substr(pos + 1)};
+}
+
+} // namespace
+
+MetadataCache::MetadataCache() {
+    mutexInit(&m_mutex);
+    SetTtl(DEFAULT_TTL);
+}
+
+MetadataCache::~MetadataCache() {
+    log_write("[CACHE] hits: %zu misses: %zu\n", m_hits, m_misses);
+}
+
+void MetadataCache::SetTtl(u64 seconds) {
+    SCOPED_MUTEX(&m_mutex);
+    m_ttl_ns = seconds * 1'000'000'000ULL;
+    m_dirs.clear();
+    m_stats.clear();
+}
+
+bool MetadataCache::IsFresh(u64 timestamp) const {
+    return m_ttl_ns && GetTimeNs() - timestamp < m_ttl_ns;
+}
+
+bool MetadataCache::GetDir(const std::string& path, DirEntries& out) {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_dirs.find(NormalisePath(path));
+    if (it == m_dirs.end() || !IsFresh(it->second.timestamp)) {
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    out = it->second.entries;
+    return true;
+}
+
+auto MetadataCache::GetDirEtag(const std::string& path) -> std::string {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_dirs.find(NormalisePath(path));
+    if (it == m_dirs.end()) {
+        return {};
+    }
+
+    return it->second.etag;
+}
+
+bool MetadataCache::Revalidate(const std::string& path, DirEntries& out) {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_dirs.find(NormalisePath(path));
+    if (it == m_dirs.end()) {
+        return false;
+    }
+
+    it->second.timestamp = GetTimeNs();
+    out = it->second.entries;
+    return true;
+}
+
+void MetadataCache::SetDir(const std::string& path, const DirEntries& entries, bool complete, const std::string& etag) {
+    SCOPED_MUTEX(&m_mutex);
+
+    if (!m_ttl_ns) {
+        return;
+    }
+
+    auto& listing = m_dirs[NormalisePath(path)];
+    listing.entries = entries;
+    listing.etag = etag;
+    listing.timestamp = GetTimeNs();
+    listing.complete = complete;
+
+    listing.lookup.clear();
+    listing.lookup.reserve(entries.size());
+    for (u32 i = 0; i < entries.size(); i++) {
+        listing.lookup.emplace(entries[i].name, i);
+    }
+}
+
+auto MetadataCache::GetStat(const std::string& _path, struct stat* st) -> Lookup {
+    SCOPED_MUTEX(&m_mutex);
+    const auto path = NormalisePath(_path);
+
+    if (const auto it = m_stats.find(path); it != m_stats.end() && IsFresh(it->second.timestamp)) {
+        m_hits++;
+        *st = it->second.st;
+        return Lookup::Found;
+    }
+
+    // try and find the entry in the parent listing.
+    const auto [parent, name] = SplitPath(path);
+    if (const auto it = m_dirs.find(parent); it != m_dirs.end() && IsFresh(it->second.timestamp)) {
+        const auto& listing = it->second;
+        const auto entry = listing.lookup.find(name);
+
+        if (entry == listing.lookup.end()) {
+            if (listing.complete) {
+                m_hits++;
+                return Lookup::NotFound;
+            }
+        } else {
+            const auto& e = listing.entries[entry->second];
+            // the size of a folder isn't needed.
+            if (e.has_stat || S_ISDIR(e.st.st_mode)) {
+                m_hits++;
+                *st = e.st;
+                return Lookup::Found;
+            }
+        }
+    }
+
+    m_misses++;
+    return Lookup::Miss;
+}
+
+void MetadataCache::SetStat(const std::string& path, const struct stat& st) {
+    SCOPED_MUTEX(&m_mutex);
+
+    if (!m_ttl_ns) {
+        return;
+    }
+
+    m_stats[NormalisePath(path)] = {st, GetTimeNs()};
+}
+
+void MetadataCache::Invalidate(const std::string& _path) {
+    SCOPED_MUTEX(&m_mutex);
+    const auto path = NormalisePath(_path);
+    const auto prefix = path == "/" ? path : path + '/';
+
+    const auto is_affected = [&](const std::string& key) {
+        return key == path || key.starts_with(prefix);
+    };
+
+    std::erase_if(m_dirs, [&](const auto& e) { return is_affected(e.first); });
+    std::erase_if(m_stats, [&](const auto& e) { return is_affected(e.first); });
+    m_dirs.erase(SplitPath(path).first);
+}
+
+void MetadataCache::Clear() {
+    SCOPED_MUTEX(&m_mutex);
+    m_dirs.clear();
+    m_stats.clear();
+}
+
 MountCurlDevice::~MountCurlDevice() {
     log_write("[CURL] Cleaning up mount device\n");
     if (curlu) {
         curl_url_cleanup(curlu);
     }
 
-    if (curl) {
+    // handles must be freed before the share they use.
+    for (auto curl : m_curl_pool) {
         curl_easy_cleanup(curl);
     }
 
-    if (transfer_curl) {
-        curl_easy_cleanup(transfer_curl);
-    }
-
     if (m_curl_share) {
         curl_share_cleanup(m_curl_share);
     }
@@ -1197,19 +1681,37 @@ bool MountCurlDevice::Mount() {
         return true;
     }
 
-    if (!curl) {
-        curl = curl_easy_init();
-        if (!curl) {
-            log_write("[CURL] curl_easy_init() failed\n");
-            return false;
+    const auto cache_ttl = config.extra.find("cache_ttl");
+    if (cache_ttl != config.extra.end()) {
+        const auto ttl = ini_parse_getl(cache_ttl->second.c_str(), -1);
+        if (ttl < 0) {
+            log_write("[CURL] Invalid cache_ttl value: %s\n", cache_ttl->second.c_str());
+        } else {
+            log_write("[CURL] Setting cache_ttl: %ld\n", ttl);
+            cache.SetTtl(ttl);
         }
     }
 
-    if (!transfer_curl) {
-        transfer_curl = curl_easy_init();
-        if (!transfer_curl) {
-            log_write("[CURL] transfer curl_easy_init() failed\n");
-            return false;
+    const auto connections_it = config.extra.find("connections");
+    if (connections_it != config.extra.end()) {
+        const auto value = ini_parse_getl(connections_it->second.c_str(), -1);
+        if (value < 1 || value > MAX_CONNECTIONS) {
+            log_write("[CURL] Invalid connections value: %s\n", connections_it->second.c_str());
+        } else {
+            log_write("[CURL] Setting connections: %ld\n", value);
+            connections = value;
+        }
+    }
+
+    // size is in KiB.
+    const auto upload_buffer = config.extra.find("upload_buffer");
+    if (upload_buffer != config.extra.end()) {
+        const auto value = ini_parse_getl(upload_buffer->second.c_str(), -1);
+        if (value < 64 || value > 1024 * 16) {
+            log_write("[CURL] Invalid upload_buffer value: %s\n", upload_buffer->second.c_str());
+        } else {
+            log_write("[CURL] Setting upload_buffer: %ld KiB\n", value);
+            upload_buffer_size = value * 1024;
         }
     }
 
@@ -1273,7 +1775,7 @@ bool MountCurlDevice::Mount() {
         }
     }
 
-    // create share handle, used to share info between curl and transfer_curl.
+    // create share handle, used to share connections between the pooled handles.
     if (!m_curl_share) {
         m_curl_share = curl_share_init();
         if (!m_curl_share) {
@@ -1286,7 +1788,8 @@ bool MountCurlDevice::Mount() {
             rwlockInit(&e);
         }
 
-        static const auto lock_func = [](CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+        // must be function pointers, a lambda passed through the varargs of curl_share_setopt() is garbage.
+        static const curl_lock_function lock_func = [](CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
             auto rwlocks = static_cast<RwLock*>(userptr);
             rwlockWriteLock(&rwlocks[data]);
 
@@ -1299,7 +1802,7 @@ bool MountCurlDevice::Mount() {
             #endif
         };
 
-        static const auto unlock_func = [](CURL* handle, curl_lock_data data, void* userptr) {
+        static const curl_unlock_function unlock_func = [](CURL* handle, curl_lock_data data, void* userptr) {
             auto rwlocks = static_cast<RwLock*>(userptr);
             rwlockWriteUnlock(&rwlocks[data]);
         };
@@ -1319,16 +1822,50 @@ bool MountCurlDevice::Mount() {
     return m_mounted = true;
 }
 
-PushThreadData* MountCurlDevice::CreatePushData(CURL* curl, const std::string& url, size_t offset) {
-    auto data = new PushThreadData{curl};
-    if (!data) {
-        log_write("[PUSH:PULL] Failed to allocate PushThreadData\n");
-        return nullptr;
+CURL* MountCurlDevice::AcquireCurl() {
+    {
+        SCOPED_MUTEX(&m_curl_pool_mutex);
+        if (!m_curl_pool.empty()) {
+            const auto curl = m_curl_pool.back();
+            m_curl_pool.pop_back();
+            return curl;
+        }
     }
 
-    curl_set_common_options(curl, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, PushThreadData::push_thread_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)data);
+    const auto curl = curl_easy_init();
+    if (!curl) {
+        log_write("[CURL] curl_easy_init() failed\n");
+    }
+
+    return curl;
+}
+
+void MountCurlDevice::ReleaseCurl(CURL* curl) {
+    if (!curl) {
+        return;
+    }
+
+    {
+        SCOPED_MUTEX(&m_curl_pool_mutex);
+        if (m_curl_pool.size() < MAX_IDLE_CURL) {
+            m_curl_pool.emplace_back(curl);
+            return;
+        }
+    }
+
+    curl_easy_cleanup(curl);
+}
+
+PushThreadData* MountCurlDevice::CreatePushData(CURL* curl, const std::string& url, size_t offset) {
+    auto data = new PushThreadData{curl};
+    if (!data) {
+        log_write("[PUSH:PULL] Failed to allocate PushThreadData\n");
+        return nullptr;
+    }
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, PushThreadData::push_thread_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)data);
 
     if (offset > 0) {
         char range[64];
@@ -1347,7 +1884,7 @@ PushThreadData* MountCurlDevice::CreatePushData(CURL* curl, const std::string& u
 }
 
 PullThreadData* MountCurlDevice::CreatePullData(CURL* curl, const std::string& url, bool append) {
-    auto data = new PullThreadData{curl};
+    auto data = new PullThreadData{curl, (size_t)upload_buffer_size};
     if (!data) {
         log_write("[PUSH:PULL] Failed to allocate PullThreadData\n");
         return nullptr;
@@ -1372,6 +1909,626 @@ PullThreadData* MountCurlDevice::CreatePullData(CURL* curl, const std::string& u
     return data;
 }
 
+RangeReadData::RangeReadData(MountCurlDevice* device, const std::string& url, u64 file_size, u32 connections)
+: m_device{device}
+, m_url{url}
+, m_file_size{file_size} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_work);
+    condvarInit(&m_can_read);
+
+    // no more connections than segments, with two segments per connection
+    // so that one can be read whilst the other is loading.
+    const auto total = std::max<u64>(1, (m_file_size + SEGMENT_SIZE - 1) / SEGMENT_SIZE);
+    const auto workers = std::clamp<u64>(connections, 1, total);
+    m_workers.resize(workers);
+    m_segments.resize(std::min<u64>(workers * 2, total));
+}
+
+RangeReadData::~RangeReadData() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_quit = true;
+        condvarWakeAll(&m_can_work);
+    }
+
+    for (auto& worker : m_workers) {
+        if (worker.started) {
+            threadWaitForExit(&worker.thread);
+            threadClose(&worker.thread);
+        }
+
+        m_device->ReleaseCurl(worker.curl);
+    }
+}
+
+Result RangeReadData::CreateAndStart() {
+    for (auto& segment : m_segments) {
+        segment.lease = utils::pool::Acquire(std::min<u64>(SEGMENT_SIZE, m_file_size));
+        R_UNLESS(segment.lease, Result_ThreadRingAllocFailed);
+    }
+
+    for (auto& worker : m_workers) {
+        worker.self = this;
+        worker.curl = m_device->AcquireCurl();
+        R_UNLESS(worker.curl, Result_CurlFailedEasyInit);
+
+        R_TRY(utils::CreateThread(&worker.thread, thread_func, &worker));
+        if (R_FAILED(threadStart(&worker.thread))) {
+            threadClose(&worker.thread);
+            R_THROW(Result_CurlFailedEasyInit);
+        }
+        worker.started = true;
+    }
+
+    log_write("[RANGE] started %zu connections for: %s\n", m_workers.size(), m_url.c_str());
+    R_SUCCEED();
+}
+
+ssize_t RangeReadData::Read(char* data, u64 off, size_t size) {
+    if (off >= m_file_size) {
+        return 0;
+    }
+
+    size = std::min<u64>(size, m_file_size - off);
+    SCOPED_MUTEX(&m_mutex);
+
+    size_t bytes_read = 0;
+    while (bytes_read < size) {
+        const auto pos = off + bytes_read;
+        const auto index = pos / SEGMENT_SIZE;
+
+        Seek(index);
+        Fill();
+
+        auto& segment = GetSegment(index);
+        if (segment.index != index || segment.state != State::Done) {
+            if (segment.index == index && segment.state == State::Failed) {
+                log_write("[RANGE] segment failed at: %zu\n", pos);
+                return -EIO;
+            }
+
+            condvarWait(&m_can_read, &m_mutex);
+            continue;
+        }
+
+        const auto segment_off = pos - index * SEGMENT_SIZE;
+        const auto rsize = std::min<u64>(size - bytes_read, segment.size - segment_off);
+        std::memcpy(data + bytes_read, segment.lease.data() + segment_off, rsize);
+        bytes_read += rsize;
+    }
+
+    return bytes_read;
+}
+
+auto RangeReadData::GetSegment(u64 index) -> Segment& {
+    return m_segments[index % m_segments.size()];
+}
+
+auto RangeReadData::GetPending() -> Segment* {
+    // request the segment closest to the reader first.
+    Segment* pending{};
+    for (auto& segment : m_segments) {
+        if (segment.state == State::Pending && (!pending || segment.index < pending->index)) {
+            pending = &segment;
+        }
+    }
+
+    return pending;
+}
+
+void RangeReadData::Release(u64 index) {
+    auto& segment = GetSegment(index);
+    if (segment.index != index) {
+        return;
+    }
+
+    if (segment.state == State::Loading) {
+        segment.cancel = true;
+    } else {
+        segment.state = State::Empty;
+    }
+}
+
+void RangeReadData::Seek(u64 index) {
+    if (index >= m_first && index < m_first + m_segments.size()) {
+        // inside the window, only drop the segments that were skipped over.
+        for (; m_first < index; m_first++) {
+            if (m_first < m_next) {
+                Release(m_first);
+            }
+        }
+    } else {
+        log_write("[RANGE] seek outside of window, from: %zu to: %zu\n", m_first * SEGMENT_SIZE, index * SEGMENT_SIZE);
+        for (auto i = m_first; i < m_next; i++) {
+            Release(i);
+        }
+        m_first = m_next = index;
+    }
+
+    m_next = std::max(m_next, m_first);
+}
+
+void RangeReadData::Fill() {
+    const auto total = (m_file_size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+    const auto last = std::min<u64>(m_first + m_segments.size(), total);
+
+    for (; m_next < last; m_next++) {
+        auto& segment = GetSegment(m_next);
+
+        // still waiting for a cancelled request to finish.
+        if (segment.state == State::Loading) {
+            break;
+        }
+
+        segment.index = m_next;
+        segment.size = 0;
+        segment.state = State::Pending;
+        segment.retries = 0;
+        segment.cancel = false;
+        condvarWakeOne(&m_can_work);
+    }
+}
+
+int RangeReadData::Fetch(Worker* worker, u64 off) {
+    char range[64];
+    std::snprintf(range, sizeof(range), "%zu-%zu", off, off + worker->expected - 1);
+
+    m_device->curl_set_common_options(worker->curl, m_url);
+    curl_easy_setopt(worker->curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(worker->curl, CURLOPT_WRITEDATA, (void *)worker);
+    curl_easy_setopt(worker->curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+    curl_easy_setopt(worker->curl, CURLOPT_XFERINFODATA, (void *)worker);
+    curl_easy_setopt(worker->curl, CURLOPT_RANGE, range);
+
+    const auto res = curl_easy_perform(worker->curl);
+    long response_code = 0;
+    curl_easy_getinfo(worker->curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    // a 200 means the range was ignored, which is only fine if the whole file was requested.
+    // this won't change if asked again, so it isn't retried.
+    if (response_code && response_code != 206 && !(response_code == 200 && worker->expected == m_file_size)) {
+        log_write("[RANGE] unexpected response for range %s: %ld\n", range, response_code);
+        return -EIO;
+    }
+
+    if (res != CURLE_OK) {
+        log_write("[RANGE] curl_easy_perform(%s) failed: %s\n", range, curl_easy_strerror(res));
+        return -EAGAIN;
+    }
+
+    if (worker->segment->size != worker->expected) {
+        log_write("[RANGE] short read for range %s: %zu\n", range, worker->segment->size);
+        return -EAGAIN;
+    }
+
+    return 0;
+}
+
+size_t RangeReadData::write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto worker = static_cast<Worker*>(userdata);
+    auto segment = worker->segment;
+    const auto realsize = size * nmemb;
+
+    // the server sent more than was requested, likely ignoring the range.
+    if (segment->size + realsize > worker->expected) {
+        return 0;
+    }
+
+    // the segment is only accessed by this thread until it's marked as done.
+    std::memcpy(segment->lease.data() + segment->size, ptr, realsize);
+    segment->size += realsize;
+    return realsize;
+}
+
+size_t RangeReadData::progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    auto worker = static_cast<Worker*>(clientp);
+    auto self = worker->self;
+
+    SCOPED_MUTEX(&self->m_mutex);
+    return self->m_quit || worker->segment->cancel;
+}
+
+void RangeReadData::thread_func(void* arg) {
+    auto worker = static_cast<Worker*>(arg);
+    auto self = worker->self;
+
+    SCOPED_MUTEX(&self->m_mutex);
+
+    for (;;) {
+        Segment* segment{};
+        while (!self->m_quit && !(segment = self->GetPending())) {
+            condvarWait(&self->m_can_work, &self->m_mutex);
+        }
+
+        if (self->m_quit) {
+            break;
+        }
+
+        const auto off = segment->index * SEGMENT_SIZE;
+        segment->state = State::Loading;
+        worker->segment = segment;
+        worker->expected = std::min<u64>(SEGMENT_SIZE, self->m_file_size - off);
+
+        mutexUnlock(&self->m_mutex);
+        const auto rc = self->Fetch(worker, off);
+        mutexLock(&self->m_mutex);
+
+        if (segment->cancel) {
+            segment->state = State::Empty;
+            segment->cancel = false;
+        } else if (rc == -EAGAIN && segment->retries < MAX_RETRIES) {
+            log_write("[RANGE] retrying segment at: %zu\n", off);
+            segment->retries++;
+            segment->size = 0;
+            segment->state = State::Pending;
+            condvarWakeOne(&self->m_can_work);
+        } else {
+            segment->state = rc ? State::Failed : State::Done;
+        }
+
+        worker->segment = nullptr;
+        condvarWakeAll(&self->m_can_read);
+    }
+}
+
+ChunkedUploadData::ChunkedUploadData(MountCurlDevice* device, const UploadCallback& callback, u32 connections)
+: m_device{device}
+, m_callback{callback} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_work);
+    condvarInit(&m_can_write);
+
+    // one chunk per connection, plus the one being filled.
+    m_workers.resize(std::max<u32>(1, connections));
+    m_chunks.resize(m_workers.size() + 1);
+}
+
+ChunkedUploadData::~ChunkedUploadData() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_quit = true;
+        condvarWakeAll(&m_can_work);
+    }
+
+    for (auto& worker : m_workers) {
+        if (worker.started) {
+            threadWaitForExit(&worker.thread);
+            threadClose(&worker.thread);
+        }
+
+        m_device->ReleaseCurl(worker.curl);
+    }
+}
+
+Result ChunkedUploadData::CreateAndStart() {
+    for (auto& chunk : m_chunks) {
+        chunk.lease = utils::pool::Acquire(CHUNK_SIZE);
+        R_UNLESS(chunk.lease, Result_ThreadRingAllocFailed);
+    }
+
+    for (auto& worker : m_workers) {
+        worker.self = this;
+        worker.curl = m_device->AcquireCurl();
+        R_UNLESS(worker.curl, Result_CurlFailedEasyInit);
+
+        R_TRY(utils::CreateThread(&worker.thread, thread_func, &worker));
+        if (R_FAILED(threadStart(&worker.thread))) {
+            threadClose(&worker.thread);
+            R_THROW(Result_CurlFailedEasyInit);
+        }
+        worker.started = true;
+    }
+
+    log_write("[CHUNK] started %zu connections\n", m_workers.size());
+    R_SUCCEED();
+}
+
+ssize_t ChunkedUploadData::Write(const char* data, size_t size) {
+    SCOPED_MUTEX(&m_mutex);
+
+    size_t bytes_written = 0;
+    while (bytes_written < size) {
+        if (m_error) {
+            return -EIO;
+        }
+
+        if (!m_current) {
+            m_current = GetFree();
+            if (!m_current) {
+                condvarWait(&m_can_write, &m_mutex);
+                continue;
+            }
+
+            m_current->state = State::Filling;
+            m_current->off = m_off;
+            m_current->size = 0;
+        }
+
+        // the chunk is only accessed by the writer until it's submitted.
+        const auto wsize = std::min<u64>(size - bytes_written, CHUNK_SIZE - m_current->size);
+        std::memcpy(m_current->lease.data() + m_current->size, data + bytes_written, wsize);
+        m_current->size += wsize;
+        m_off += wsize;
+        bytes_written += wsize;
+
+        if (m_current->size == CHUNK_SIZE) {
+            Submit();
+        }
+    }
+
+    return bytes_written;
+}
+
+int ChunkedUploadData::Flush() {
+    SCOPED_MUTEX(&m_mutex);
+
+    if (m_current && m_current->size) {
+        Submit();
+    }
+
+    const auto is_idle = [this]() {
+        for (const auto& chunk : m_chunks) {
+            if (chunk.state == State::Pending || chunk.state == State::Uploading) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    while (!is_idle()) {
+        condvarWait(&m_can_write, &m_mutex);
+    }
+
+    return m_error ? -EIO : 0;
+}
+
+auto ChunkedUploadData::GetPending() -> Chunk* {
+    // upload the chunk with the lowest offset first.
+    Chunk* pending{};
+    for (auto& chunk : m_chunks) {
+        // the file doesn't exist until the first chunk has been uploaded.
+        if (!m_created && chunk.off) {
+            continue;
+        }
+
+        if (chunk.state == State::Pending && (!pending || chunk.off < pending->off)) {
+            pending = &chunk;
+        }
+    }
+
+    return pending;
+}
+
+auto ChunkedUploadData::GetFree() -> Chunk* {
+    for (auto& chunk : m_chunks) {
+        if (chunk.state == State::Free) {
+            return &chunk;
+        }
+    }
+
+    return nullptr;
+}
+
+void ChunkedUploadData::Submit() {
+    m_current->state = State::Pending;
+    m_current = nullptr;
+    condvarWakeOne(&m_can_work);
+}
+
+void ChunkedUploadData::thread_func(void* arg) {
+    auto worker = static_cast<Worker*>(arg);
+    auto self = worker->self;
+
+    SCOPED_MUTEX(&self->m_mutex);
+
+    for (;;) {
+        Chunk* chunk{};
+        while (!self->m_quit && !(chunk = self->GetPending())) {
+            condvarWait(&self->m_can_work, &self->m_mutex);
+        }
+
+        if (self->m_quit) {
+            break;
+        }
+
+        chunk->state = State::Uploading;
+
+        mutexUnlock(&self->m_mutex);
+        // skip the upload if a previous chunk failed, the file is already broken.
+        const auto ok = !self->m_error && self->m_callback(worker->curl, chunk->off, {chunk->lease.data(), chunk->size});
+        mutexLock(&self->m_mutex);
+
+        if (!ok) {
+            log_write("[CHUNK] failed to upload chunk at: %zu size: %zu\n", chunk->off, chunk->size);
+            self->m_error = true;
+        }
+
+        // the other chunks can now be uploaded.
+        if (!chunk->off) {
+            self->m_created = true;
+            condvarWakeAll(&self->m_can_work);
+        }
+
+        chunk->state = State::Free;
+        condvarWakeAll(&self->m_can_write);
+    }
+}
+
+PipelinedReadData::PipelinedReadData(u64 block_size, u32 depth, Orphans& orphans, u64 timeout_ms)
+: m_block_size{std::clamp<u64>(block_size, 1, MAX_BLOCK_SIZE)}
+, m_timeout_ns{timeout_ms * 1000 * 1000}
+, m_orphans{orphans} {
+    depth = std::clamp<u32>(depth, 1, MAX_DEPTH);
+    depth = std::min<u64>(depth, std::max<u64>(1, MAX_INFLIGHT_SIZE / m_block_size));
+    m_blocks.resize(depth);
+}
+
+Result PipelinedReadData::Create() {
+    for (auto& block : m_blocks) {
+        block.lease = utils::pool::Acquire(m_block_size);
+        R_UNLESS(block.lease, Result_ThreadRingAllocFailed);
+    }
+
+    log_write("[PIPE] created depth: %zu block_size: %zu\n", m_blocks.size(), m_block_size);
+    R_SUCCEED();
+}
+
+ssize_t PipelinedReadData::Read(char* data, u64 off, size_t size) {
+    // keep the queue if the read lands inside it, otherwise start again.
+    const auto first_off = m_count ? m_blocks[m_head].off : m_next_off;
+    if (off < first_off || off > m_next_off || (m_count && off == m_next_off)) {
+        Reset(off);
+    } else {
+        while (m_count && off >= m_blocks[m_head].off + m_block_size) {
+            if (const auto rc = Wait(m_blocks[m_head]); rc < 0) {
+                Orphan();
+                Reset(off);
+                return rc;
+            }
+            Pop();
+        }
+    }
+
+    size_t bytes_read = 0;
+    while (bytes_read < size) {
+        if (const auto rc = Fill(); rc < 0) {
+            Reset(off);
+            return rc;
+        }
+
+        if (!m_count) {
+            break;
+        }
+
+        auto& block = m_blocks[m_head];
+        if (const auto rc = Wait(block); rc < 0) {
+            Orphan();
+            Reset(off);
+            return rc;
+        }
+
+        if (block.result < 0) {
+            const auto rc = block.result;
+            log_write("[PIPE] read failed at: %zu errno: %s\n", block.off, std::strerror(-rc));
+            Reset(off);
+            return rc;
+        }
+
+        // a short block is the end of the file, the blocks after it are empty.
+        if (block.size < m_block_size) {
+            m_eof = true;
+        }
+
+        const auto block_off = off - block.off;
+        if (block_off >= block.size) {
+            break;
+        }
+
+        const auto rsize = std::min<u64>(size - bytes_read, block.size - block_off);
+        std::memcpy(data + bytes_read, block.lease.data() + block_off, rsize);
+        bytes_read += rsize;
+        off += rsize;
+
+        // the end of file block is kept so that further reads return 0.
+        if (off == block.off + m_block_size) {
+            Pop();
+            m_window = std::min<u32>(m_window * 2, m_blocks.size());
+        }
+    }
+
+    return bytes_read;
+}
+
+void PipelinedReadData::Complete(Block* block, int result) {
+    block->pending = false;
+    block->result = std::min(result, 0);
+    block->size = std::max(result, 0);
+}
+
+void PipelinedReadData::Drain() {
+    for (auto& block : m_blocks) {
+        if (Wait(block) < 0) {
+            Orphan();
+            break;
+        }
+    }
+
+    m_orphans.Collect();
+    m_head = 0;
+    m_count = 0;
+}
+
+void PipelinedReadData::Orphan() {
+    // the reads may still complete at any point, so the buffers are kept
+    // until they do, or until the connection is closed.
+    log_write("[PIPE] failed to drain, orphaning buffers\n");
+    m_orphans.m_blocks.emplace_back(std::move(m_blocks));
+    m_blocks.clear();
+}
+
+int PipelinedReadData::Wait(Block& block) {
+    const auto deadline = armGetSystemTick() + armNsToTicks(m_timeout_ns);
+
+    while (block.pending) {
+        if (const auto rc = Service(); rc < 0) {
+            log_write("[PIPE] service failed: %s\n", std::strerror(-rc));
+            return rc;
+        }
+
+        if (block.pending && armGetSystemTick() >= deadline) {
+            log_write("[PIPE] timed out waiting for block at: %zu\n", block.off);
+            return -ETIMEDOUT;
+        }
+    }
+
+    return 0;
+}
+
+void PipelinedReadData::Orphans::Collect() {
+    std::erase_if(m_blocks, [](const auto& blocks) {
+        return std::ranges::none_of(blocks, [](const auto& block) { return block.pending; });
+    });
+}
+
+int PipelinedReadData::Fill() {
+    // the buffers were orphaned by Drain().
+    if (m_blocks.empty()) {
+        return -EIO;
+    }
+
+    while (!m_eof && m_count < m_window) {
+        auto& block = m_blocks[(m_head + m_count) % m_blocks.size()];
+        block.off = m_next_off;
+        block.size = 0;
+        block.result = 0;
+        block.pending = true;
+
+        if (const auto rc = ReadAsync(&block, m_block_size); rc < 0) {
+            log_write("[PIPE] failed to start read at: %zu errno: %s\n", block.off, std::strerror(-rc));
+            block.pending = false;
+            return rc;
+        }
+
+        m_next_off += m_block_size;
+        m_count++;
+    }
+
+    return 0;
+}
+
+void PipelinedReadData::Reset(u64 off) {
+    Drain();
+    m_window = 1;
+    m_next_off = off;
+    m_eof = false;
+}
+
+void PipelinedReadData::Pop() {
+    m_head = (m_head + 1) % m_blocks.size();
+    m_count--;
+}
+
 void MountCurlDevice::curl_set_common_options(CURL* curl, const std::string& url) {
     // NOTE: port, user and pass are set in the curl_url.
     curl_easy_reset(curl);
@@ -1385,6 +2542,8 @@ void MountCurlDevice::curl_set_common_options(CURL* curl, const std::string& url
     curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 1024L * 64L);
     curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, 1024L * 64L);
     curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    // keep idle connections in the share alive between requests.
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
 
     if (config.timeout > 0) {
         // cancel if speed is less than 1 bytes/sec for timeout seconds.
@@ -1399,6 +2558,24 @@ void MountCurlDevice::curl_set_common_options(CURL* curl, const std::string& url
     }
 }
 
+int MountCurlDevice::stat_cached(const std::string& path, struct stat* st, const std::function<int(struct stat*)>& func) {
+    switch (cache.GetStat(path, st)) {
+        case MetadataCache::Lookup::Found:
+            return 0;
+        case MetadataCache::Lookup::NotFound:
+            return -ENOENT;
+        case MetadataCache::Lookup::Miss:
+            break;
+    }
+
+    const auto ret = func(st);
+    if (!ret) {
+        cache.SetStat(path, *st);
+    }
+
+    return ret;
+}
+
 size_t MountCurlDevice::write_memory_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
     auto data = static_cast<std::vector<char>*>(userdata);
 
@@ -1518,6 +2695,8 @@ std::string MountCurlDevice::build_url(const std::string& _path, bool is_dir) {
         }
     }
 
+    SCOPED_MUTEX(&m_url_mutex);
+
     if (!path.empty()) {
         const auto rc = curl_url_set(curlu, CURLUPART_PATH, path.c_str(), CURLU_URLENCODE);
         if (rc != CURLUE_OK) {
@@ -224,7 +224,11 @@ bool Device::Mount() {
             return false;
         }
 
-        fat.buffered = std::make_unique<common::LruBufferedData>(source, size);
+        // the fat and directory sectors are spread over the whole partition, so cache more blocks.
+        common::LruBufferedData::Config config{};
+        config.block_count = 512;
+
+        fat.buffered = std::make_unique<common::LruBufferedData>(source, size, config);
         if (!fat.buffered) {
             log_write("[FATFS] Failed to create LruBufferedData\n");
             return false;
@@ -19,11 +19,8 @@
 namespace sphaira::devoptab {
 namespace {
 
-struct DirEntry {
-    std::string name{};
-    bool is_dir{};
-};
-using DirEntries = std::vector<DirEntry>;
+using common::DirEntry;
+using common::DirEntries;
 
 struct FileEntry {
     std::string path{};
@@ -73,6 +70,7 @@ private:
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
     size_t off;
     size_t last_off;
@@ -225,15 +223,15 @@ void Device::ftp_parse_mlsd(std::string_view chunk, DirEntries& out) {
             continue;
         }
 
+        // parse every fact so that lstat can be served from the listing.
         DirEntry entry{};
-        struct stat st{};
-        if (!ftp_parse_mlst_line(line_str, &st, &entry.name, true)) {
+        if (!ftp_parse_mlst_line(line_str, &entry.st, &entry.name, false)) {
             log_write("[FTP] Failed to parse MLSD line: %.*s\n", (int)line.size(), line.data());
             continue;
         }
 
-        entry.is_dir = S_ISDIR(st.st_mode);
-        out.emplace_back(entry);
+        entry.has_stat = true;
+        out.emplace_back(std::move(entry));
     }
 }
 
@@ -247,37 +245,53 @@ std::pair<bool, long> Device::ftp_quote(std::span<const std::string> commands, b
         cmdlist = curl_slist_append(cmdlist, cmd.c_str());
     }
 
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_QUOTE, cmdlist);
-    curl_easy_setopt(this->curl, CURLOPT_NOBODY, 1L);
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return {false, 0};
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_QUOTE, cmdlist);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
 
     if (response_data) {
         response_data->clear();
-        curl_easy_setopt(this->curl, CURLOPT_HEADERFUNCTION, write_memory_callback);
-        curl_easy_setopt(this->curl, CURLOPT_HEADERDATA, (void *)response_data);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_memory_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)response_data);
     }
 
-    const auto res = curl_easy_perform(this->curl);
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[FTP] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return {false, 0};
     }
 
     long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
     return {true, response_code};
 }
 
 int Device::ftp_dirlist(const std::string& path, DirEntries& out) {
+    if (cache.GetDir(path, out)) {
+        return 0;
+    }
+
     const auto url = build_url(path, true);
     std::vector<char> chunk;
 
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(this->curl, CURLOPT_CUSTOMREQUEST, "MLSD");
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return -ENOMEM;
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "MLSD");
 
-    const auto res = curl_easy_perform(this->curl);
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[FTP] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return -EIO;
@@ -299,6 +313,7 @@ int Device::ftp_dirlist(const std::string& path, DirEntries& out) {
     }
 
     ftp_parse_mlsd({chunk.data(), chunk.size()}, out);
+    cache.SetDir(path, out, true);
     return 0;
 }
 
@@ -452,7 +467,9 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
     if ((flags & O_ACCMODE) == O_RDONLY || (flags & O_APPEND)) {
         // ensure the file exists and get its size.
-        const auto ret = ftp_stat(path, &st, false);
+        const auto ret = stat_cached(path, &st, [this, path](struct stat* st) {
+            return ftp_stat(path, st, false);
+        });
         if (ret < 0) {
             return ret;
         }
@@ -463,10 +480,19 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         }
     }
 
+    file->curl = AcquireCurl();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
     file->entry = new FileEntry{path, st};
     file->write_mode = (flags & (O_WRONLY | O_RDWR));
     file->append_mode = (flags & O_APPEND);
 
+    if (file->write_mode) {
+        cache.Invalidate(path);
+    }
+
     if (file->append_mode) {
         file->off = st.st_size;
         file->last_off = file->off;
@@ -479,6 +505,13 @@ int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
     delete file->push_pull_thread_data;
+    ReleaseCurl(file->curl);
+
+    // the upload finishes once the thread exits.
+    if (file->write_mode) {
+        cache.Invalidate(file->entry->path);
+    }
+
     delete file->entry;
     return 0;
 }
@@ -505,7 +538,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[FTP] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[FTP] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -533,7 +566,7 @@ ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[FTP] Creating upload thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePullData(this->transfer_curl, build_url(file->entry->path, false), file->append_mode);
+        file->push_pull_thread_data = CreatePullData(file->curl, build_url(file->entry->path, false), file->append_mode);
         if (!file->push_pull_thread_data) {
             log_write("[FTP] Failed to create upload thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -573,6 +606,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 }
 
 int Device::devoptab_unlink(const char *path) {
+    cache.Invalidate(path);
     const auto ret = ftp_unlink(path);
     if (ret < 0) {
         log_write("[FTP] ftp_unlink() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -583,6 +617,9 @@ int Device::devoptab_unlink(const char *path) {
 }
 
 int Device::devoptab_rename(const char *oldName, const char *newName) {
+    cache.Invalidate(oldName);
+    cache.Invalidate(newName);
+
     auto ret = ftp_rename(oldName, newName, false);
     if (ret == -ENOENT) {
         ret = ftp_rename(oldName, newName, true);
@@ -597,6 +634,7 @@ int Device::devoptab_rename(const char *oldName, const char *newName) {
 }
 
 int Device::devoptab_mkdir(const char *path, int mode) {
+    cache.Invalidate(path);
     const auto ret = ftp_mkdir(path);
     if (ret < 0) {
         log_write("[FTP] ftp_mkdir() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -607,6 +645,7 @@ int Device::devoptab_mkdir(const char *path, int mode) {
 }
 
 int Device::devoptab_rmdir(const char *path) {
+    cache.Invalidate(path);
     const auto ret = ftp_rmdir(path);
     if (ret < 0) {
         log_write("[FTP] ftp_rmdir() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -646,13 +685,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
     }
 
     auto& entry = (*dir->entries)[dir->index];
-    if (entry.is_dir) {
-        filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else {
-        filestat->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-    }
-
-    filestat->st_nlink = 1;
+    std::memcpy(filestat, &entry.st, sizeof(*filestat));
     std::strcpy(filename, entry.name.c_str());
 
     dir->index++;
@@ -667,10 +700,13 @@ int Device::devoptab_dirclose(void* fd) {
 }
 
 int Device::devoptab_lstat(const char *path, struct stat *st) {
-    auto ret = ftp_stat(path, st, false);
-    if (ret == -ENOENT) {
-        ret = ftp_stat(path, st, true);
-    }
+    const auto ret = stat_cached(path, st, [this, path](struct stat* st) {
+        auto ret = ftp_stat(path, st, false);
+        if (ret == -ENOENT) {
+            ret = ftp_stat(path, st, true);
+        }
+        return ret;
+    });
 
     if (ret < 0) {
         log_write("[FTP] ftp_stat() failed: %s errno: %s\n", path, std::strerror(-ret));
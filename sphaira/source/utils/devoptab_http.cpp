@@ -1,4 +1,5 @@
 #include "utils/devoptab_common.hpp"
+#include "utils/devoptab_listing.hpp"
 #include "utils/profile.hpp"
 
 #include "location.hpp"
@@ -13,20 +14,16 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <cctype>
+#include <strings.h>
 #include <optional>
 #include <sys/stat.h>
 
 namespace sphaira::devoptab {
 namespace {
 
-struct DirEntry {
-    // deprecated because the names can be truncated and really set to anything.
-    std::string name_deprecated{};
-    // url decoded href.
-    std::string href{};
-    bool is_dir{};
-};
-using DirEntries = std::vector<DirEntry>;
+using common::DirEntry;
+using common::DirEntries;
 
 struct FileEntry {
     std::string path{};
@@ -35,9 +32,13 @@ struct FileEntry {
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
+    common::RangeReadData* range_read_data;
     size_t off;
     size_t last_off;
+    // set if range requests failed, falls back to a single stream.
+    bool no_range;
 };
 
 struct Dir {
@@ -45,6 +46,27 @@ struct Dir {
     size_t index;
 };
 
+// stores the etag of the response, used to revalidate cached listings.
+size_t etag_header_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    const auto realsize = size * nmemb;
+    constexpr std::string_view key = "etag:";
+
+    std::string_view line{ptr, realsize};
+    if (line.size() > key.size() && !strncasecmp(line.data(), key.data(), key.size())) {
+        line.remove_prefix(key.size());
+        while (!line.empty() && std::isspace(line.front())) {
+            line.remove_prefix(1);
+        }
+        while (!line.empty() && std::isspace(line.back())) {
+            line.remove_suffix(1);
+        }
+
+        *static_cast<std::string*>(userdata) = line;
+    }
+
+    return realsize;
+}
+
 struct Device final : common::MountCurlDevice {
     using MountCurlDevice::MountCurlDevice;
 
@@ -69,28 +91,58 @@ private:
 };
 
 int Device::http_dirlist(const std::string& path, DirEntries& out) {
+    if (cache.GetDir(path, out)) {
+        return 0;
+    }
+
     const auto url = build_url(path, true);
-    std::vector<char> chunk;
+    std::string etag;
+
+    // entries are parsed as the response is received.
+    DirEntries entries;
+    common::HtmlListingParser parser{entries};
 
     log_write("[HTTP] Listing URL: %s path: %s\n", url.c_str(), path.c_str());
 
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEDATA, (void *)&chunk);
+    // if the listing was cached, ask the server if it has changed.
+    curl_slist* header_list{};
+    ON_SCOPE_EXIT(curl_slist_free_all(header_list));
+
+    const auto cached_etag = cache.GetDirEtag(path);
+    if (!cached_etag.empty()) {
+        header_list = curl_slist_append(header_list, ("If-None-Match: " + cached_etag).c_str());
+    }
+
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return -ENOMEM;
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, common::ListingParser::write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&parser);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, etag_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&etag);
 
-    const auto res = curl_easy_perform(this->curl);
+    SCOPED_TIMESTAMP("http_dirlist");
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[HTTP] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return -EIO;
     }
 
     long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
     switch (response_code) {
         case 200: // OK
         case 206: // Partial Content
             break;
+        case 304: // Not Modified
+            log_write("[HTTP] Directory listing not modified: %s\n", path.c_str());
+            return cache.Revalidate(path, out) ? 0 : -EIO;
         case 301: // Moved Permanently
         case 302: // Found
         case 303: // See Other
@@ -106,92 +158,15 @@ int Device::http_dirlist(const std::string& path, DirEntries& out) {
             return -EIO;
     }
 
-    log_write("[HTTP] Received %zu bytes for directory listing\n", chunk.size());
-
-    SCOPED_TIMESTAMP("http_dirlist parse");
-
-    // very fast/basic html parsing.
-    // takes 17ms to parse 3MB html with 7641 entries.
-    // todo: if i ever add an xml parser to sphaira, use that instead.
-    // todo: for the above, benchmark the parser to ensure its faster than the my code.
-    std::string_view chunk_view{chunk.data(), chunk.size()};
-
-    const auto body_start = chunk_view.find("<body");
-    const auto body_end = chunk_view.rfind("</body>");
-    const auto table_start = chunk_view.find("<table");
-    const auto table_end = chunk_view.rfind("</table>");
-
-    std::string_view table_view{};
-
-    // try and find the body, if this doesn't exist, fallback it's not a valid html page.
-    if (body_start != std::string_view::npos && body_end != std::string_view::npos && body_end > body_start) {
-        table_view = chunk_view.substr(body_start, body_end - body_start);
-    }
-
-    // try and find the table, massively speeds up parsing if it exists.
-    // todo: this may cause issues with some web servers that don't use a table for listings.
-    // todo: if table fails to fine anything, fallback to body_view.
-    if (table_start != std::string_view::npos && table_end != std::string_view::npos && table_end > table_start) {
-        table_view = chunk_view.substr(table_start, table_end - table_start);
-    }
-
-    if (!table_view.empty()) {
-        const std::string_view href_tag_start = "<a href=\"";
-        const std::string_view href_tag_end = "\">";
-        const std::string_view anchor_tag_end = "</a>";
-
-        size_t pos = 0;
-        out.reserve(10000);
-
-        for (;;) {
-            const auto href_pos = table_view.find(href_tag_start, pos);
-            if (href_pos == std::string_view::npos) {
-                break; // no more href.
-            }
-            pos = href_pos + href_tag_start.length();
-
-            const auto href_begin = pos;
-            const auto href_end = table_view.find(href_tag_end, href_begin);
-            if (href_end == std::string_view::npos) {
-                break; // no more href.
-            }
-
-            const auto href_name_end = table_view.find('"', href_begin);
-            if (href_name_end == std::string_view::npos || href_name_end < href_begin || href_name_end > href_end) {
-                break; // invalid href.
-            }
-
-            const auto name_begin = href_end + href_tag_end.length();
-            const auto name_end = table_view.find(anchor_tag_end, name_begin);
-            if (name_end == std::string_view::npos) {
-                break; // no more names.
-            }
-
-            pos = name_end + anchor_tag_end.length();
-            auto href = url_decode(std::string{table_view.substr(href_begin, href_name_end - href_begin)});
-            auto name = url_decode(std::string{table_view.substr(name_begin, name_end - name_begin)});
-
-            // skip empty names/links, root dir entry and links that are not actual files/dirs (e.g. sorting/filter controls).
-            if (name.empty() || href.empty() || name == "/" || href.starts_with('?') || href.starts_with('#')) {
-                continue;
-            }
-
-            // skip parent directory entry and external links.
-            if (href == ".." || name == ".." || href.starts_with("../") || name.starts_with("../") || href.find("://") != std::string::npos) {
-                continue;
-            }
-
-            const auto is_dir = href.ends_with('/');
-            if (is_dir) {
-                href.pop_back(); // remove the trailing '/'
-            }
-
-            out.emplace_back(name, href, is_dir);
-        }
+    if (!parser.Finish()) {
+        return -EIO;
     }
 
+    out = std::move(entries);
     log_write("[HTTP] Parsed %zu entries from directory listing\n", out.size());
 
+    // links can point anywhere, so the listing can't be used to check if a file doesn't exist.
+    cache.SetDir(path, out, false, etag);
     return 0;
 }
 
@@ -199,30 +174,36 @@ int Device::http_stat(const std::string& path, struct stat* st, bool is_dir) {
     std::memset(st, 0, sizeof(*st));
     const auto url = build_url(path, is_dir);
 
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(this->curl, CURLOPT_FILETIME, 1L);
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return -ENOMEM;
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_FILETIME, 1L);
 
-    const auto res = curl_easy_perform(this->curl);
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[HTTP] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return -EIO;
     }
 
     long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
     curl_off_t file_size = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &file_size);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &file_size);
 
     curl_off_t file_time = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_FILETIME_T, &file_time);
+    curl_easy_getinfo(curl, CURLINFO_FILETIME_T, &file_time);
 
     const char* content_type{};
-    curl_easy_getinfo(this->curl, CURLINFO_CONTENT_TYPE, &content_type);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
 
     const char* effective_url{};
-    curl_easy_getinfo(this->curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
 
     switch (response_code) {
         case 200: // OK
@@ -279,7 +260,7 @@ bool Device::Mount() {
 
     // todo: query server with OPTIONS to see if it supports range requests.
     // todo: see ftp for example.
-
+    // for now, reads fallback to a single stream if a range request fails.
     return mounted = true;
 }
 
@@ -287,7 +268,9 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
     auto file = static_cast<File*>(fileStruct);
 
     struct stat st;
-    const auto ret = http_stat(path, &st, false);
+    const auto ret = stat_cached(path, &st, [this, path](struct stat* st) {
+        return http_stat(path, st, false);
+    });
     if (ret < 0) {
         log_write("[HTTP] http_stat() failed for file: %s errno: %s\n", path, std::strerror(-ret));
         return ret;
@@ -298,6 +281,12 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         return -EISDIR;
     }
 
+    // each file has its own handle, so that transfers can run at the same time.
+    file->curl = AcquireCurl();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
     file->entry = new FileEntry{path, st};
     return 0;
 }
@@ -305,7 +294,9 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
+    delete file->range_read_data;
     delete file->push_pull_thread_data;
+    ReleaseCurl(file->curl);
     delete file->entry;
     return 0;
 }
@@ -318,6 +309,32 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
         return 0;
     }
 
+    // small files aren't worth splitting.
+    if (connections > 1 && !file->no_range && !file->range_read_data && (u64)file->entry->st.st_size >= common::RangeReadData::MIN_FILE_SIZE) {
+        log_write("[HTTP] Creating range read data for file: %s\n", file->entry->path.c_str());
+        file->range_read_data = new common::RangeReadData{this, build_url(file->entry->path, false), (u64)file->entry->st.st_size, (u32)connections};
+        if (R_FAILED(file->range_read_data->CreateAndStart())) {
+            log_write("[HTTP] Failed to create range read data for file: %s\n", file->entry->path.c_str());
+            delete file->range_read_data;
+            file->range_read_data = nullptr;
+            file->no_range = true;
+        }
+    }
+
+    if (file->range_read_data) {
+        const auto ret = file->range_read_data->Read(ptr, file->off, len);
+        if (ret >= 0) {
+            file->off += ret;
+            file->last_off = file->off;
+            return ret;
+        }
+
+        log_write("[HTTP] Range read failed, falling back to a single stream for file: %s\n", file->entry->path.c_str());
+        delete file->range_read_data;
+        file->range_read_data = nullptr;
+        file->no_range = true;
+    }
+
     if (file->off != file->last_off) {
         log_write("[HTTP] File offset changed from %zu to %zu, resetting download thread\n", file->last_off, file->off);
         file->last_off = file->off;
@@ -327,7 +344,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[HTTP] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[HTTP] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -392,16 +409,10 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
     }
 
     auto& entry = (*dir->entries)[dir->index];
-    if (entry.is_dir) {
-        filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else {
-        filestat->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-    }
+    std::memcpy(filestat, &entry.st, sizeof(*filestat));
 
     // <a href="Compass_2.0.7.1-Release_ScVi3.0.1-Standalone-21-2-0-7-1-1729820977.zip">Compass_2.0.7.1-Release_ScVi3.0.1-Standalone-21..&gt;</a>
-    filestat->st_nlink = 1;
-    // std::strcpy(filename, entry.name.c_str());
-    std::strcpy(filename, entry.href.c_str());
+    std::strcpy(filename, entry.name.c_str());
 
     dir->index++;
     return 0;
@@ -415,10 +426,13 @@ int Device::devoptab_dirclose(void* fd) {
 }
 
 int Device::devoptab_lstat(const char *path, struct stat *st) {
-    auto ret = http_stat(path, st, false);
-    if (ret < 0) {
-        ret = http_stat(path, st, true);
-    }
+    const auto ret = stat_cached(path, st, [this, path](struct stat* st) {
+        auto ret = http_stat(path, st, false);
+        if (ret < 0) {
+            ret = http_stat(path, st, true);
+        }
+        return ret;
+    });
 
     if (ret < 0) {
         log_write("[HTTP] http_stat() failed for path: %s errno: %s\n", path, std::strerror(-ret));
@@ -0,0 +1,392 @@
+#include "utils/devoptab_listing.hpp"
+#include "log.hpp"
+
+#include <cstdlib>
+#include <cctype>
+#include <curl/curl.h>
+
+namespace sphaira::devoptab::common {
+namespace {
+
+// max size of a tag (or text) that is waiting for more data.
+// anything larger is treated as malformed, which keeps memory usage flat.
+constexpr size_t MAX_PENDING_SIZE = 1024 * 64;
+// anchors without an end within this size are skipped.
+constexpr size_t MAX_ANCHOR_SIZE = 1024 * 8;
+
+constexpr std::string_view HTML_HREF_START = "<a href=\"";
+constexpr std::string_view HTML_HREF_END = "\">";
+constexpr std::string_view HTML_ANCHOR_END = "</a>";
+constexpr std::string_view HTML_TABLE_START = "<table";
+constexpr std::string_view HTML_TABLE_END = "</table>";
+constexpr std::string_view HTML_BODY_START = "<body";
+constexpr std::string_view HTML_BODY_END = "</body>";
+// longest of the above tags, used to know if there's enough data to check the tag.
+constexpr size_t HTML_MAX_TAG_SIZE = HTML_HREF_START.size();
+
+constexpr std::string_view XML_COMMENT_START = "<!--";
+constexpr std::string_view XML_CDATA_START = "<![CDATA[";
+
+auto trim(std::string_view str) -> std::string_view {
+    while (!str.empty() && std::isspace((unsigned char)str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && std::isspace((unsigned char)str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+// returns the offset of the closing '>', ignoring any inside quoted attributes.
+auto find_tag_end(std::string_view str) -> size_t {
+    char quote = 0;
+    for (size_t i = 1; i < str.size(); i++) {
+        if (quote) {
+            if (str[i] == quote) {
+                quote = 0;
+            }
+        } else if (str[i] == '"' || str[i] == '\'') {
+            quote = str[i];
+        } else if (str[i] == '>') {
+            return i;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+// strips attributes and the namespace prefix, <d:href a="b"> becomes href.
+auto get_local_name(std::string_view tag) -> std::string_view {
+    const auto name_end = tag.find_first_of(" \t\r\n/");
+    if (name_end != std::string_view::npos) {
+        tag = tag.substr(0, name_end);
+    }
+
+    const auto prefix = tag.find(':');
+    if (prefix != std::string_view::npos) {
+        tag = tag.substr(prefix + 1);
+    }
+
+    return tag;
+}
+
+} // namespace
+
+bool ListingParser::Feed(std::string_view data) {
+    if (m_error) {
+        return false;
+    }
+
+    // avoid copying into the buffer if there's nothing left over.
+    if (m_buf.empty()) {
+        const auto consumed = Parse(data);
+        m_buf.assign(data.substr(consumed));
+    } else {
+        m_buf.append(data);
+        const auto consumed = Parse(m_buf);
+        m_buf.erase(0, consumed);
+    }
+
+    if (m_buf.size() > MAX_PENDING_SIZE) {
+        log_write("[LISTING] pending data too large: %zu\n", m_buf.size());
+        m_error = true;
+    }
+
+    return !m_error;
+}
+
+bool ListingParser::Finish() {
+    return !m_error;
+}
+
+size_t ListingParser::write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto parser = static_cast<ListingParser*>(userdata);
+    const auto realsize = size * nmemb;
+
+    // returning less than the size aborts the transfer.
+    if (!parser->Feed({ptr, realsize})) {
+        return 0;
+    }
+
+    return realsize;
+}
+
+size_t HtmlListingParser::Parse(std::string_view data) {
+    size_t pos = 0;
+
+    for (;;) {
+        const auto tag = data.find('<', pos);
+        if (tag == std::string_view::npos) {
+            return data.size();
+        }
+
+        // wait for enough data to know which tag this is.
+        const auto view = data.substr(tag);
+        if (view.size() < HTML_MAX_TAG_SIZE) {
+            return tag;
+        }
+
+        if (view.starts_with(HTML_HREF_START)) {
+            const auto href_begin = HTML_HREF_START.size();
+            const auto href_end = view.find(HTML_HREF_END, href_begin);
+            const auto href_name_end = view.find('"', href_begin);
+            const auto name_begin = href_end + HTML_HREF_END.size();
+
+            auto name_end = std::string_view::npos;
+            if (href_end != std::string_view::npos) {
+                name_end = view.find(HTML_ANCHOR_END, name_begin);
+            }
+
+            if (name_end == std::string_view::npos) {
+                // wait for the rest of the anchor, unless it's broken.
+                if (view.size() < MAX_ANCHOR_SIZE) {
+                    return tag;
+                }
+
+                pos = tag + 1;
+                continue;
+            }
+
+            if (href_name_end <= href_end) {
+                AddLink(view.substr(href_begin, href_name_end - href_begin), view.substr(name_begin, name_end - name_begin));
+            }
+
+            pos = tag + name_end + HTML_ANCHOR_END.size();
+            continue;
+        }
+
+        if (view.starts_with(HTML_TABLE_START)) {
+            // the links found so far were outside of a table, such as a header.
+            if (!m_seen_table) {
+                m_out.clear();
+            }
+
+            m_in_table = true;
+            m_seen_table = true;
+        } else if (view.starts_with(HTML_TABLE_END)) {
+            m_in_table = false;
+        } else if (view.starts_with(HTML_BODY_START)) {
+            m_in_body = true;
+        } else if (view.starts_with(HTML_BODY_END)) {
+            m_in_body = false;
+        }
+
+        pos = tag + 1;
+    }
+}
+
+void HtmlListingParser::AddLink(std::string_view _href, std::string_view _name) {
+    // links outside of the table are only used if there's no table.
+    if (!m_in_table && (!m_in_body || m_seen_table)) {
+        return;
+    }
+
+    auto href = MountCurlDevice::url_decode(std::string{_href});
+    const auto name = MountCurlDevice::url_decode(std::string{_name});
+
+    // skip empty names/links, root dir entry and links that are not actual files/dirs (e.g. sorting/filter controls).
+    if (name.empty() || href.empty() || name == "/" || href.starts_with('?') || href.starts_with('#')) {
+        return;
+    }
+
+    // skip parent directory entry and external links.
+    if (href == ".." || name == ".." || href.starts_with("../") || name.starts_with("../") || href.find("://") != std::string::npos) {
+        return;
+    }
+
+    DirEntry entry{};
+    if (href.ends_with('/')) {
+        href.pop_back(); // remove the trailing '/'
+        entry.st.st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
+    } else {
+        entry.st.st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+    }
+
+    // apache links to the parent as "/" when it's the root.
+    if (href.empty()) {
+        return;
+    }
+
+    // the name can be truncated and really set to anything, so use the href.
+    entry.name = std::move(href);
+    entry.st.st_nlink = 1;
+    m_out.emplace_back(std::move(entry));
+}
+
+size_t XmlListingParser::Parse(std::string_view data) {
+    size_t pos = 0;
+
+    for (;;) {
+        // text is kept in the buffer until the next tag, so that it's never split.
+        const auto tag = data.find('<', pos);
+        if (tag == std::string_view::npos) {
+            return pos;
+        }
+
+        if (m_text.size() + (tag - pos) > MAX_PENDING_SIZE) {
+            log_write("[XML] text too large\n");
+            m_error = true;
+            return data.size();
+        }
+
+        m_text.append(data.substr(pos, tag - pos));
+        pos = tag;
+
+        const auto view = data.substr(tag);
+        if (view.size() < 2) {
+            return pos;
+        }
+
+        if (view[1] == '?') {
+            const auto end = view.find("?>");
+            if (end == std::string_view::npos) {
+                return pos;
+            }
+
+            pos += end + 2;
+        } else if (view.starts_with(XML_COMMENT_START)) {
+            const auto end = view.find("-->", XML_COMMENT_START.size());
+            if (end == std::string_view::npos) {
+                return pos;
+            }
+
+            pos += end + 3;
+        } else if (view.starts_with(XML_CDATA_START)) {
+            const auto end = view.find("]]>", XML_CDATA_START.size());
+            if (end == std::string_view::npos) {
+                return pos;
+            }
+
+            m_text.append(view.substr(XML_CDATA_START.size(), end - XML_CDATA_START.size()));
+            pos += end + 3;
+        } else if (view[1] == '!' && (XML_CDATA_START.starts_with(view) || XML_COMMENT_START.starts_with(view))) {
+            // not enough data to know if this is a comment or cdata.
+            return pos;
+        } else {
+            const auto end = find_tag_end(view);
+            if (end == std::string_view::npos) {
+                return pos;
+            }
+
+            const auto inner = view.substr(1, end - 1);
+            pos += end + 1;
+
+            // doctype and other declarations.
+            if (inner.starts_with('!')) {
+                continue;
+            }
+
+            if (inner.starts_with('/')) {
+                OnEndElement(get_local_name(inner.substr(1)), trim(m_text));
+                m_text.clear();
+            } else {
+                const auto name = get_local_name(inner);
+                OnStartElement(name);
+                m_text.clear();
+
+                if (inner.ends_with('/')) {
+                    OnEndElement(name, {});
+                }
+            }
+        }
+    }
+}
+
+PropfindListingParser::PropfindListingParser(DirEntries& out, const std::string& requested_path)
+: XmlListingParser{out}
+, m_requested_path{MountCurlDevice::url_decode(requested_path)} {
+    if (!m_requested_path.empty() && m_requested_path.back() == '/') {
+        m_requested_path.pop_back();
+    }
+}
+
+bool PropfindListingParser::Finish() {
+    if (!m_seen_multistatus) {
+        log_write("[WEBDAV] response is not a multistatus\n");
+        return false;
+    }
+
+    return XmlListingParser::Finish();
+}
+
+void PropfindListingParser::OnStartElement(std::string_view name) {
+    if (name == "multistatus") {
+        m_seen_multistatus = true;
+    } else if (name == "response") {
+        m_in_response = true;
+        m_href.clear();
+        m_entry = {};
+        m_entry.st.st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+        m_entry.st.st_nlink = 1;
+    } else if (name == "resourcetype") {
+        m_in_resourcetype = true;
+    } else if (name == "collection" && m_in_resourcetype) {
+        m_entry.st.st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
+    }
+}
+
+void PropfindListingParser::OnEndElement(std::string_view name, std::string_view text) {
+    if (!m_in_response) {
+        return;
+    }
+
+    if (name == "resourcetype") {
+        m_in_resourcetype = false;
+    } else if (name == "href") {
+        if (m_href.empty()) {
+            m_href = MountCurlDevice::url_decode(std::string{text});
+
+            // some servers send the full url, only the path is compared.
+            if (const auto scheme = m_href.find("://"); scheme != std::string::npos) {
+                const auto path = m_href.find('/', scheme + 3);
+                m_href = path == std::string::npos ? "/" : m_href.substr(path);
+            }
+        }
+    } else if (name == "getcontentlength") {
+        // the failed propstat has the same elements but empty.
+        if (!text.empty()) {
+            m_entry.st.st_size = std::strtoull(std::string{text}.c_str(), nullptr, 10);
+            m_entry.has_stat = true;
+        }
+    } else if (name == "getlastmodified") {
+        if (!text.empty()) {
+            const auto file_time = curl_getdate(std::string{text}.c_str(), nullptr);
+            m_entry.st.st_mtime = file_time > 0 ? file_time : 0;
+            m_entry.st.st_atime = m_entry.st.st_mtime;
+            m_entry.st.st_ctime = m_entry.st.st_mtime;
+        }
+    } else if (name == "response") {
+        m_in_response = false;
+
+        // todo: fix requested path still being displayed.
+        if (m_href.empty() || m_href == m_requested_path || m_href == m_requested_path + '/') {
+            return;
+        }
+
+        // directories report the size of their contents (if at all), so it's not used.
+        if (S_ISDIR(m_entry.st.st_mode)) {
+            m_entry.st.st_size = 0;
+            m_entry.has_stat = false;
+        }
+
+        auto entry_name = std::move(m_href);
+        if (!entry_name.empty() && entry_name.back() == '/') {
+            entry_name.pop_back();
+        }
+
+        const auto slash = entry_name.find_last_of('/');
+        if (slash != std::string::npos) {
+            entry_name = entry_name.substr(slash + 1);
+        }
+
+        // skip root entry
+        if (entry_name.empty() || entry_name == ".") {
+            return;
+        }
+
+        m_entry.name = std::move(entry_name);
+        m_out.emplace_back(std::move(m_entry));
+    }
+}
+
+} // namespace sphaira::devoptab::common
@@ -5,6 +5,7 @@
 
 #include "defines.hpp"
 #include "log.hpp"
+#include "app.hpp"
 
 #include "yati/nx/es.hpp"
 #include "yati/nx/nca.hpp"
@@ -367,7 +368,8 @@ Result MountNcaInternal(fs::Fs* fs, const std::shared_ptr<yati::source::Base>& s
 
         ncz_offset += ncz_blocks.size() * sizeof(ncz::Block);
         nca_reader = std::make_unique<ncz::NczBlockReader>(
-            ncz_header, ncz_sections, ncz_block_header, ncz_blocks, ncz_offset, source
+            ncz_header, ncz_sections, ncz_block_header, ncz_blocks, ncz_offset, source,
+            App::GetNczBlockCacheSize()
         );
     } else {
         keys::KeyEntry title_key;
@@ -4,6 +4,7 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <cstring>
 #include <string>
 #include <cstring>
@@ -13,6 +14,50 @@
 namespace sphaira::devoptab {
 namespace {
 
+// time to wait for the socket before servicing timeouts.
+constexpr int SERVICE_TIMEOUT_MS = 100;
+
+struct NfsReadData final : common::PipelinedReadData {
+    NfsReadData(nfs_context* nfs, nfsfh* fd, u64 block_size, u32 depth, Orphans& orphans, u64 timeout_ms)
+    : PipelinedReadData{block_size, depth, orphans, timeout_ms}, m_nfs{nfs}, m_fd{fd} {}
+
+    ~NfsReadData() {
+        Drain();
+    }
+
+private:
+    int ReadAsync(Block* block, u64 size) override {
+        return nfs_pread_async(m_nfs, m_fd, block->lease.data(), size, block->off, read_cb, block);
+    }
+
+    int Service() override {
+        pollfd pfd{};
+        pfd.fd = nfs_get_fd(m_nfs);
+        pfd.events = nfs_which_events(m_nfs);
+
+        const auto ret = poll(&pfd, 1, SERVICE_TIMEOUT_MS);
+        if (ret < 0) {
+            return -errno;
+        }
+
+        // servicing with no events handles timeouts.
+        if (nfs_service(m_nfs, ret ? pfd.revents : 0) < 0) {
+            log_write("[NFS] nfs_service() failed: %s\n", nfs_get_error(m_nfs));
+            return -EIO;
+        }
+
+        return 0;
+    }
+
+    static void read_cb(int err, nfs_context* nfs, void* data, void* private_data) {
+        Complete(static_cast<Block*>(private_data), err);
+    }
+
+private:
+    nfs_context* const m_nfs;
+    nfsfh* const m_fd;
+};
+
 struct Device final : common::MountDevice {
     using MountDevice::MountDevice;
     ~Device();
@@ -39,13 +84,21 @@ private:
     int devoptab_fsync(void *fd) override;
     int devoptab_utimes(const char *path, const struct timeval times[2]) override;
 
+    ssize_t nfs_read_sync(nfsfh* fd, char *ptr, size_t len);
+
 private:
     nfs_context* nfs{};
+    // number of reads in flight when reading a file.
+    u32 queue_depth{common::PipelinedReadData::DEFAULT_DEPTH};
+    // reads that failed to finish, freed once the context is destroyed.
+    common::PipelinedReadData::Orphans orphans{};
     bool mounted{};
 };
 
 struct File {
     nfsfh* fd;
+    NfsReadData* read_data;
+    bool read_only;
 };
 
 struct Dir {
@@ -109,6 +162,17 @@ bool Device::Mount() {
             }
         }
 
+        const auto depth = this->config.extra.find("queue_depth");
+        if (depth != this->config.extra.end()) {
+            const auto depth_val = ini_parse_getl(depth->second.c_str(), -1);
+            if (depth_val < 1 || depth_val > common::PipelinedReadData::MAX_DEPTH) {
+                log_write("[NFS] Invalid queue_depth value: %s\n", depth->second.c_str());
+            } else {
+                log_write("[NFS] Setting queue_depth: %ld\n", depth_val);
+                queue_depth = depth_val;
+            }
+        }
+
         if (this->config.timeout > 0) {
             nfs_set_timeout(nfs, this->config.timeout);
             nfs_set_readonly(nfs, this->config.read_only);
@@ -149,12 +213,15 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         return ret;
     }
 
+    file->read_only = (flags & O_ACCMODE) == O_RDONLY;
     return 0;
 }
 
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
+    // must be deleted before closing as it may have reads in flight.
+    delete file->read_data;
     nfs_close(nfs, file->fd);
     return 0;
 }
@@ -162,9 +229,41 @@ int Device::devoptab_close(void *fd) {
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
+    // only used for read only files as writes would not update the queued blocks.
+    if (file->read_only && queue_depth > 1 && !file->read_data) {
+        const u64 timeout = this->config.timeout > 0 ? this->config.timeout : common::PipelinedReadData::DEFAULT_TIMEOUT_MS;
+        file->read_data = new NfsReadData{nfs, file->fd, nfs_get_readmax(nfs), queue_depth, orphans, timeout};
+        if (R_FAILED(file->read_data->Create())) {
+            log_write("[NFS] Failed to create read data, falling back to sync reads\n");
+            delete file->read_data;
+            file->read_data = nullptr;
+            // don't try again for this file.
+            file->read_only = false;
+        }
+    }
+
+    if (file->read_data) {
+        // reads don't move the handle offset, so it's updated here for seek and write.
+        u64 off = 0;
+        nfs_lseek(nfs, file->fd, 0, SEEK_CUR, &off);
+
+        const auto ret = file->read_data->Read(ptr, off, len);
+        if (ret < 0) {
+            log_write("[NFS] pipelined read failed at: %zu errno: %s\n", off, std::strerror(-ret));
+            return ret;
+        }
+
+        nfs_lseek(nfs, file->fd, off + ret, SEEK_SET, &off);
+        return ret;
+    }
+
+    return nfs_read_sync(file->fd, ptr, len);
+}
+
+ssize_t Device::nfs_read_sync(nfsfh* fd, char *ptr, size_t len) {
     // todo: uncomment this when it's fixed upstream.
     #if 0
-    const auto ret = nfs_read(nfs, file->fd, ptr, len);
+    const auto ret = nfs_read(nfs, fd, ptr, len);
     if (ret < 0) {
         log_write("[NFS] nfs_read() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
         return ret;
@@ -179,7 +278,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     while (bytes_read < len) {
         const auto to_read = std::min<size_t>(len - bytes_read, max_read);
-        const auto ret = nfs_read(nfs, file->fd, ptr, to_read);
+        const auto ret = nfs_read(nfs, fd, ptr, to_read);
 
         if (ret < 0) {
             log_write("[NFS] nfs_read() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
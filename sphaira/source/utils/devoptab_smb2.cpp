@@ -4,6 +4,7 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <cstring>
 #include <string>
 #include <cstring>
@@ -14,6 +15,50 @@
 namespace sphaira::devoptab {
 namespace {
 
+// time to wait for the socket before servicing timeouts.
+constexpr int SERVICE_TIMEOUT_MS = 100;
+
+struct Smb2ReadData final : common::PipelinedReadData {
+    Smb2ReadData(smb2_context* smb2, smb2fh* fd, u64 block_size, u32 depth, Orphans& orphans, u64 timeout_ms)
+    : PipelinedReadData{block_size, depth, orphans, timeout_ms}, m_smb2{smb2}, m_fd{fd} {}
+
+    ~Smb2ReadData() {
+        Drain();
+    }
+
+private:
+    int ReadAsync(Block* block, u64 size) override {
+        return smb2_pread_async(m_smb2, m_fd, block->lease.data(), size, block->off, read_cb, block);
+    }
+
+    int Service() override {
+        pollfd pfd{};
+        pfd.fd = smb2_get_fd(m_smb2);
+        pfd.events = smb2_which_events(m_smb2);
+
+        const auto ret = poll(&pfd, 1, SERVICE_TIMEOUT_MS);
+        if (ret < 0) {
+            return -errno;
+        }
+
+        // servicing with no events handles timeouts.
+        if (smb2_service(m_smb2, ret ? pfd.revents : 0) < 0) {
+            log_write("[SMB2] smb2_service() failed: %s\n", smb2_get_error(m_smb2));
+            return -EIO;
+        }
+
+        return 0;
+    }
+
+    static void read_cb(smb2_context* smb2, int status, void* command_data, void* private_data) {
+        Complete(static_cast<Block*>(private_data), status);
+    }
+
+private:
+    smb2_context* const m_smb2;
+    smb2fh* const m_fd;
+};
+
 struct Device final : common::MountDevice {
     using MountDevice::MountDevice;
     ~Device();
@@ -43,13 +88,21 @@ private:
     int devoptab_statvfs(const char *path, struct statvfs *buf) override;
     int devoptab_fsync(void *fd) override;
 
+    ssize_t smb2_read_sync(smb2fh* fd, char *ptr, size_t len);
+
 private:
     smb2_context* smb2{};
+    // number of reads in flight when reading a file.
+    u32 queue_depth{common::PipelinedReadData::DEFAULT_DEPTH};
+    // reads that failed to finish, freed once the context is destroyed.
+    common::PipelinedReadData::Orphans orphans{};
     bool mounted{};
 };
 
 struct File {
     smb2fh* fd;
+    Smb2ReadData* read_data;
+    bool read_only;
 };
 
 struct Dir {
@@ -118,6 +171,17 @@ bool Device::Mount() {
             smb2_set_workstation(this->smb2, workstation->second.c_str());
         }
 
+        const auto depth = this->config.extra.find("queue_depth");
+        if (depth != this->config.extra.end()) {
+            const auto depth_val = ini_parse_getl(depth->second.c_str(), -1);
+            if (depth_val < 1 || depth_val > common::PipelinedReadData::MAX_DEPTH) {
+                log_write("[SMB2] Invalid queue_depth value: %s\n", depth->second.c_str());
+            } else {
+                log_write("[SMB2] Setting queue_depth: %ld\n", depth_val);
+                queue_depth = depth_val;
+            }
+        }
+
         if (config.timeout > 0) {
             smb2_set_timeout(this->smb2, this->config.timeout);
         }
@@ -155,12 +219,15 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         return -EIO;
     }
 
+    file->read_only = (flags & O_ACCMODE) == O_RDONLY;
     return 0;
 }
 
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
+    // must be deleted before closing as it may have reads in flight.
+    delete file->read_data;
     smb2_close(this->smb2, file->fd);
     return 0;
 }
@@ -168,12 +235,44 @@ int Device::devoptab_close(void *fd) {
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
+    // only used for read only files as writes would not update the queued blocks.
+    if (file->read_only && queue_depth > 1 && !file->read_data) {
+        const u64 timeout = this->config.timeout > 0 ? this->config.timeout : common::PipelinedReadData::DEFAULT_TIMEOUT_MS;
+        file->read_data = new Smb2ReadData{this->smb2, file->fd, smb2_get_max_read_size(this->smb2), queue_depth, orphans, timeout};
+        if (R_FAILED(file->read_data->Create())) {
+            log_write("[SMB2] Failed to create read data, falling back to sync reads\n");
+            delete file->read_data;
+            file->read_data = nullptr;
+            // don't try again for this file.
+            file->read_only = false;
+        }
+    }
+
+    if (file->read_data) {
+        // reads don't move the handle offset, so it's updated here for seek and write.
+        u64 off = 0;
+        smb2_lseek(this->smb2, file->fd, 0, SEEK_CUR, &off);
+
+        const auto ret = file->read_data->Read(ptr, off, len);
+        if (ret < 0) {
+            log_write("[SMB2] pipelined read failed at: %zu errno: %s\n", off, std::strerror(-ret));
+            return ret;
+        }
+
+        smb2_lseek(this->smb2, file->fd, off + ret, SEEK_SET, &off);
+        return ret;
+    }
+
+    return smb2_read_sync(file->fd, ptr, len);
+}
+
+ssize_t Device::smb2_read_sync(smb2fh* fd, char *ptr, size_t len) {
     const auto max_read = smb2_get_max_read_size(this->smb2);
     size_t bytes_read = 0;
 
     while (bytes_read < len) {
         const auto to_read = std::min<size_t>(len - bytes_read, max_read);
-        const auto ret = smb2_read(this->smb2, file->fd, (u8*)ptr, to_read);
+        const auto ret = smb2_read(this->smb2, fd, (u8*)ptr, to_read);
 
         if (ret < 0) {
             log_write("[SMB2] smb2_read() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
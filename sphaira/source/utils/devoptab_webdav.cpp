@@ -1,4 +1,5 @@
 #include "utils/devoptab_common.hpp"
+#include "utils/devoptab_listing.hpp"
 #include "utils/profile.hpp"
 
 #include "log.hpp"
@@ -10,27 +11,15 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <strings.h>
 #include <optional>
 #include <sys/stat.h>
 
-// todo: try to reduce binary size by using a smaller xml parser.
-#include <pugixml.hpp>
-
 namespace sphaira::devoptab {
 namespace {
 
-constexpr const char* XPATH_RESPONSE      = "//*[local-name()='response']";
-constexpr const char* XPATH_HREF          = ".//*[local-name()='href']";
-constexpr const char* XPATH_PROPSTAT_PROP = ".//*[local-name()='propstat']/*[local-name()='prop']";
-constexpr const char* XPATH_PROP          = ".//*[local-name()='prop']";
-constexpr const char* XPATH_RESOURCETYPE  = ".//*[local-name()='resourcetype']";
-constexpr const char* XPATH_COLLECTION    = ".//*[local-name()='collection']";
-
-struct DirEntry {
-    std::string name{};
-    bool is_dir{};
-};
-using DirEntries = std::vector<DirEntry>;
+using common::DirEntry;
+using common::DirEntries;
 
 struct FileEntry {
     std::string path{};
@@ -39,7 +28,9 @@ struct FileEntry {
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
+    common::ChunkedUploadData* chunked_upload_data;
     size_t off;
     size_t last_off;
     bool write_mode;
@@ -54,6 +45,7 @@ struct Device final : common::MountCurlDevice {
     using MountCurlDevice::MountCurlDevice;
 
 private:
+    bool Mount() override;
     int devoptab_open(void *fileStruct, const char *path, int flags, int mode) override;
     int devoptab_close(void *fd) override;
     ssize_t devoptab_read(void *fd, char *ptr, size_t len) override;
@@ -72,7 +64,7 @@ private:
     int devoptab_ftruncate(void *fd, off_t len) override;
     int devoptab_fsync(void *fd) override;
 
-    std::pair<bool, long> webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data = nullptr);
+    std::pair<bool, long> webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, common::ListingParser* parser = nullptr);
     int webdav_dirlist(const std::string& path, DirEntries& out);
     int webdav_stat(const std::string& path, struct stat* st, bool is_dir);
     int webdav_remove_file_folder(const std::string& path, bool is_dir);
@@ -80,13 +72,37 @@ private:
     int webdav_rename(const std::string& old_path, const std::string& new_path, bool is_dir);
     int webdav_mkdir(const std::string& path);
     int webdav_rmdir(const std::string& path);
+    int webdav_create(const std::string& path);
+    bool webdav_put(CURL* curl, const std::string& url, std::span<const u8> data);
+    bool webdav_patch(CURL* curl, const std::string& url, u64 off, std::span<const u8> data);
+
+private:
+    bool mounted{};
+    // set if the server supports sabre/dav partial updates, see webdav_patch().
+    bool partial_update{};
 };
 
 size_t dummy_data_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
     return size * nmemb;
 }
 
-std::pair<bool, long> Device::webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data) {
+// sets userdata to true if the DAV header lists sabredav-partialupdate.
+size_t dav_header_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    const auto realsize = size * nmemb;
+    constexpr std::string_view key = "dav:";
+    constexpr std::string_view feature = "sabredav-partialupdate";
+
+    const std::string_view line{ptr, realsize};
+    if (line.size() > key.size() && !strncasecmp(line.data(), key.data(), key.size())) {
+        if (line.find(feature) != std::string_view::npos) {
+            *static_cast<bool*>(userdata) = true;
+        }
+    }
+
+    return realsize;
+}
+
+std::pair<bool, long> Device::webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, common::ListingParser* parser) {
     const auto url = build_url(path, is_dir);
 
     curl_slist* header_list{};
@@ -97,41 +113,52 @@ std::pair<bool, long> Device::webdav_custom_command(const std::string& path, con
         header_list = curl_slist_append(header_list, header.c_str());
     }
 
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return {false, 0};
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
     log_write("[WEBDAV] %s %s\n", cmd.c_str(), url.c_str());
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_HTTPHEADER, header_list);
-    curl_easy_setopt(this->curl, CURLOPT_CUSTOMREQUEST, cmd.c_str());
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, cmd.c_str());
     if (!postfields.empty()) {
         log_write("[WEBDAV] Post fields: %.*s\n", (int)postfields.length(), postfields.data());
-        curl_easy_setopt(this->curl, CURLOPT_POSTFIELDS, postfields.data());
-        curl_easy_setopt(this->curl, CURLOPT_POSTFIELDSIZE, (long)postfields.length());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postfields.data());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)postfields.length());
     }
 
-    if (response_data) {
-        response_data->clear();
-        curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-        curl_easy_setopt(this->curl, CURLOPT_WRITEDATA, (void *)response_data);
+    if (parser) {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, common::ListingParser::write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)parser);
     } else {
-        curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, dummy_data_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, dummy_data_callback);
     }
 
-    const auto res = curl_easy_perform(this->curl);
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[WEBDAV] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return {false, 0};
     }
 
     long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
     return {true, response_code};
 }
 
 int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
+    if (cache.GetDir(path, out)) {
+        return 0;
+    }
+
+    // the size and time are requested so that lstat can be served from the listing.
     const std::string_view post_fields =
         "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
         "<d:propfind xmlns:d=\"DAV:\">"
             "<d:prop>"
-            // "<d:getcontentlength/>"
+            "<d:getcontentlength/>"
+            "<d:getlastmodified/>"
             "<d:resourcetype/>"
         "</d:prop>"
         "</d:propfind>";
@@ -141,8 +168,12 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
         "Depth: 1"
     };
 
-    std::vector<char> chunk;
-    const auto [success, response_code] = webdav_custom_command(path, "PROPFIND", post_fields, custom_headers, true, &chunk);
+    // entries are parsed as the response is received.
+    DirEntries entries;
+    common::PropfindListingParser parser{entries, path};
+
+    SCOPED_TIMESTAMP("webdav_dirlist");
+    const auto [success, response_code] = webdav_custom_command(path, "PROPFIND", post_fields, custom_headers, true, &parser);
     if (!success) {
         return -EIO;
     }
@@ -159,78 +190,15 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
             return -EIO;
     }
 
-    SCOPED_TIMESTAMP("webdav_dirlist parse");
-
-    pugi::xml_document doc;
-    const auto result = doc.load_buffer_inplace(chunk.data(), chunk.size());
-    if (!result) {
-        log_write("[WEBDAV] Failed to parse XML: %s\n", result.description());
+    if (!parser.Finish()) {
+        log_write("[WEBDAV] Failed to parse XML\n");
         return -EIO;
     }
 
-    log_write("\n[WEBDAV] XML parsed successfully\n");
-
-    auto requested_path = url_decode(path);
-    if (!requested_path.empty() && requested_path.back() == '/') {
-        requested_path.pop_back();
-    }
-
-    const auto responses = doc.select_nodes(XPATH_RESPONSE);
-
-    for (const auto& rnode : responses) {
-        const auto response = rnode.node();
-        if (!response) {
-            continue;
-        }
-
-        const auto href_x = response.select_node(XPATH_HREF);
-        if (!href_x) {
-            continue;
-        }
-
-        // todo: fix requested path still being displayed.
-        const auto href = url_decode(href_x.node().text().as_string());
-        if (href.empty() || href == requested_path || href == requested_path + '/') {
-            continue;
-        }
-
-        // propstat/prop/resourcetype
-        auto prop_x = response.select_node(XPATH_PROPSTAT_PROP);
-        if (!prop_x) {
-            // try direct prop if structure differs
-            prop_x = response.select_node(XPATH_PROP);
-            if (!prop_x) {
-                continue;
-            }
-        }
-
-        const auto prop = prop_x.node();
-        const auto rtype_x = prop.select_node(XPATH_RESOURCETYPE);
-        bool is_dir = false;
-        if (rtype_x && rtype_x.node().select_node(XPATH_COLLECTION)) {
-            is_dir = true;
-        }
-
-        auto name = href;
-        if (!name.empty() && name.back() == '/') {
-            name.pop_back();
-        }
-
-        const auto pos = name.find_last_of('/');
-        if (pos != std::string::npos) {
-            name = name.substr(pos + 1);
-        }
-
-        // skip root entry
-        if (name.empty() || name == ".") {
-            continue;
-        }
-
-        out.emplace_back(name, is_dir);
-    }
-
+    out = std::move(entries);
     log_write("[WEBDAV] Parsed %zu entries from directory listing\n", out.size());
 
+    cache.SetDir(path, out, true);
     return 0;
 }
 
@@ -239,30 +207,36 @@ int Device::webdav_stat(const std::string& path, struct stat* st, bool is_dir) {
     std::memset(st, 0, sizeof(*st));
     const auto url = build_url(path, is_dir);
 
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(this->curl, CURLOPT_FILETIME, 1L);
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return -ENOMEM;
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_FILETIME, 1L);
 
-    const auto res = curl_easy_perform(this->curl);
+    const auto res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         log_write("[WEBDAV] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return -EIO;
     }
 
     long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
     curl_off_t file_size = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &file_size);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &file_size);
 
     curl_off_t file_time = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_FILETIME_T, &file_time);
+    curl_easy_getinfo(curl, CURLINFO_FILETIME_T, &file_time);
 
     const char* content_type{};
-    curl_easy_getinfo(this->curl, CURLINFO_CONTENT_TYPE, &content_type);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
 
     const char* effective_url{};
-    curl_easy_getinfo(this->curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
 
     switch (response_code) {
         case 200: // OK
@@ -382,6 +356,135 @@ int Device::webdav_rmdir(const std::string& path) {
     return webdav_remove_file_folder(path, true);
 }
 
+// creates an empty file, or truncates an existing one.
+int Device::webdav_create(const std::string& path) {
+    const std::string custom_headers[] = {
+        "Content-Length: 0",
+    };
+
+    const auto [success, response_code] = webdav_custom_command(path, "PUT", "", custom_headers, false);
+    if (!success) {
+        return -EIO;
+    }
+
+    switch (response_code) {
+        case 200: // OK
+        case 201: // Created
+        case 204: // No Content
+            return 0;
+        case 409: // Conflict
+            return -ENOENT; // Parent collection does not exist
+        case 403: // Forbidden
+            return -EACCES;
+        default:
+            log_write("[WEBDAV] Unexpected HTTP response code: %ld\n", response_code);
+            return -EIO;
+    }
+}
+
+// writes a range of an existing file, this is called from the upload threads.
+// see: https://sabre.io/dav/http-patch/
+// creates or replaces the file with data, the rest is written with webdav_patch().
+bool Device::webdav_put(CURL* curl, const std::string& url, std::span<const u8> data) {
+    curl_slist* header_list{};
+    ON_SCOPE_EXIT(curl_slist_free_all(header_list));
+    header_list = curl_slist_append(header_list, "Content-Type: application/octet-stream");
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)data.size());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, dummy_data_callback);
+
+    const auto res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        log_write("[WEBDAV] PUT curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        return false;
+    }
+
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    switch (response_code) {
+        case 200: // OK
+        case 201: // Created
+        case 204: // No Content
+            return true;
+        default:
+            log_write("[WEBDAV] PUT unexpected HTTP response code: %ld\n", response_code);
+            return false;
+    }
+}
+
+bool Device::webdav_patch(CURL* curl, const std::string& url, u64 off, std::span<const u8> data) {
+    char range[96];
+    std::snprintf(range, sizeof(range), "X-Update-Range: bytes=%zu-%zu", off, off + data.size() - 1);
+
+    curl_slist* header_list{};
+    ON_SCOPE_EXIT(curl_slist_free_all(header_list));
+    header_list = curl_slist_append(header_list, "Content-Type: application/x-sabredav-partialupdate");
+    header_list = curl_slist_append(header_list, range);
+
+    curl_set_common_options(curl, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)data.size());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, dummy_data_callback);
+
+    const auto res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        log_write("[WEBDAV] PATCH curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        return false;
+    }
+
+    long response_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+    switch (response_code) {
+        case 200: // OK
+        case 204: // No Content
+            return true;
+        default:
+            log_write("[WEBDAV] PATCH %s unexpected HTTP response code: %ld\n", range, response_code);
+            return false;
+    }
+}
+
+bool Device::Mount() {
+    if (mounted) {
+        return true;
+    }
+
+    if (!MountCurlDevice::Mount()) {
+        return false;
+    }
+
+    const auto curl = AcquireCurl();
+    if (!curl) {
+        return false;
+    }
+    ON_SCOPE_EXIT(ReleaseCurl(curl));
+
+    // check if the server supports partial updates, which allows uploading over multiple connections.
+    // it doesn't matter if this fails, uploads fallback to a single PUT.
+    curl_set_common_options(curl, build_url("/", true));
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "OPTIONS");
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, dav_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&partial_update);
+
+    const auto res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        log_write("[WEBDAV] OPTIONS curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        partial_update = false;
+    }
+
+    log_write("[WEBDAV] partial update support: %d\n", partial_update);
+    return mounted = true;
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
     struct stat st{};
@@ -393,7 +496,9 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
     if ((flags & O_ACCMODE) == O_RDONLY) {
         // ensure the file exists and get its size.
-        const auto ret = webdav_stat(path, &st, false);
+        const auto ret = stat_cached(path, &st, [this, path](struct stat* st) {
+            return webdav_stat(path, st, false);
+        });
         if (ret < 0) {
             return ret;
         }
@@ -404,10 +509,19 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         }
     }
 
+    file->curl = AcquireCurl();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
     log_write("[WEBDAV] Opening file: %s\n", path);
     file->entry = new FileEntry{path, st};
     file->write_mode = (flags & (O_WRONLY | O_RDWR));
 
+    if (file->write_mode) {
+        cache.Invalidate(path);
+    }
+
     return 0;
 }
 
@@ -415,9 +529,28 @@ int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
     log_write("[WEBDAV] Closing file: %s\n", file->entry->path.c_str());
+    const auto started = file->push_pull_thread_data || file->chunked_upload_data;
     delete file->push_pull_thread_data;
+    ReleaseCurl(file->curl);
+
+    int ret = 0;
+    if (file->chunked_upload_data) {
+        ret = file->chunked_upload_data->Flush();
+        delete file->chunked_upload_data;
+    }
+
+    // nothing was written, so the upload was never started.
+    if (file->write_mode && !started) {
+        ret = webdav_create(file->entry->path);
+    }
+
+    // the upload finishes once the thread exits.
+    if (file->write_mode) {
+        cache.Invalidate(file->entry->path);
+    }
+
     delete file->entry;
-    return 0;
+    return ret;
 }
 
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
@@ -442,7 +575,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[WEBDAV] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[WEBDAV] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -468,9 +601,36 @@ ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
         return 0;
     }
 
+    // upload chunks in parallel if the server supports it.
+    // the first chunk is a plain PUT, which creates the file.
+    if (partial_update && connections > 1 && !file->off && !file->push_pull_thread_data && !file->chunked_upload_data) {
+        const auto url = build_url(file->entry->path, false);
+        file->chunked_upload_data = new common::ChunkedUploadData{this, [this, url](CURL* curl, u64 off, std::span<const u8> data) {
+            if (!off) {
+                return webdav_put(curl, url, data);
+            }
+            return webdav_patch(curl, url, off, data);
+        }, (u32)connections};
+
+        if (R_FAILED(file->chunked_upload_data->CreateAndStart())) {
+            log_write("[WEBDAV] Failed to start chunked upload, falling back to a single stream\n");
+            delete file->chunked_upload_data;
+            file->chunked_upload_data = nullptr;
+        }
+    }
+
+    if (file->chunked_upload_data) {
+        const auto ret = file->chunked_upload_data->Write(ptr, len);
+        if (ret > 0) {
+            file->off += ret;
+            file->entry->st.st_size = std::max<off_t>(file->entry->st.st_size, file->off);
+        }
+        return ret;
+    }
+
     if (!file->push_pull_thread_data) {
         log_write("[WEBDAV] Creating upload thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePullData(this->transfer_curl, build_url(file->entry->path, false));
+        file->push_pull_thread_data = CreatePullData(file->curl, build_url(file->entry->path, false));
         if (!file->push_pull_thread_data) {
             log_write("[WEBDAV] Failed to create upload thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -510,6 +670,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 }
 
 int Device::devoptab_unlink(const char *path) {
+    cache.Invalidate(path);
     const auto ret = webdav_unlink(path);
     if (ret < 0) {
         log_write("[WEBDAV] webdav_unlink() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -520,6 +681,9 @@ int Device::devoptab_unlink(const char *path) {
 }
 
 int Device::devoptab_rename(const char *oldName, const char *newName) {
+    cache.Invalidate(oldName);
+    cache.Invalidate(newName);
+
     auto ret = webdav_rename(oldName, newName, false);
     if (ret == -ENOENT) {
         ret = webdav_rename(oldName, newName, true);
@@ -534,6 +698,7 @@ int Device::devoptab_rename(const char *oldName, const char *newName) {
 }
 
 int Device::devoptab_mkdir(const char *path, int mode) {
+    cache.Invalidate(path);
     const auto ret = webdav_mkdir(path);
     if (ret < 0) {
         log_write("[WEBDAV] webdav_mkdir() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -544,6 +709,7 @@ int Device::devoptab_mkdir(const char *path, int mode) {
 }
 
 int Device::devoptab_rmdir(const char *path) {
+    cache.Invalidate(path);
     const auto ret = webdav_rmdir(path);
     if (ret < 0) {
         log_write("[WEBDAV] webdav_rmdir() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -583,13 +749,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
     }
 
     auto& entry = (*dir->entries)[dir->index];
-    if (entry.is_dir) {
-        filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else {
-        filestat->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-    }
-
-    filestat->st_nlink = 1;
+    std::memcpy(filestat, &entry.st, sizeof(*filestat));
     std::strcpy(filename, entry.name.c_str());
 
     dir->index++;
@@ -604,10 +764,13 @@ int Device::devoptab_dirclose(void* fd) {
 }
 
 int Device::devoptab_lstat(const char *path, struct stat *st) {
-    auto ret = webdav_stat(path, st, false);
-    if (ret == -ENOENT) {
-        ret = webdav_stat(path, st, true);
-    }
+    const auto ret = stat_cached(path, st, [this, path](struct stat* st) {
+        auto ret = webdav_stat(path, st, false);
+        if (ret == -ENOENT) {
+            ret = webdav_stat(path, st, true);
+        }
+        return ret;
+    });
 
     if (ret < 0) {
         log_write("[WEBDAV] webdav_stat() failed: %s errno: %s\n", path, std::strerror(-ret));
@@ -637,6 +800,10 @@ int Device::devoptab_fsync(void *fd) {
         return -EBADF;
     }
 
+    if (file->chunked_upload_data) {
+        return file->chunked_upload_data->Flush();
+    }
+
     return 0;
 }
 
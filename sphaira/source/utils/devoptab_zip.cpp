@@ -4,13 +4,19 @@
 #include "log.hpp"
 
 #include "yati/source/file.hpp"
+#include "utils/buffer_pool.hpp"
+#include "fs.hpp"
+#include "app.hpp"
 
 #include <cstring>
 #include <cerrno>
 #include <array>
 #include <memory>
 #include <algorithm>
+#include <span>
+#include <unordered_map>
 #include <zlib.h>
+#include <zstd.h>
 
 namespace sphaira::devoptab {
 namespace {
@@ -19,6 +25,25 @@ namespace {
 #define FILE_HEADER_SIG 0x2014B50
 #define DATA_DESCRIPTOR_SIG 0x8074B50
 #define END_RECORD_SIG 0x6054B50
+#define ZIP64_END_RECORD_SIG 0x6064B50
+#define ZIP64_END_LOCATOR_SIG 0x7064B50
+#define ZIP64_EXTRA_ID 0x0001
+#define SEEK_INDEX_SIG 0x58444953 // SIDX
+#define SEEK_INDEX_VERSION 1
+
+// an access point is added at the first deflate block after every span of output.
+// the span grows for large entries, so that an entry never has more than SEEK_MAX_POINTS.
+constexpr u64 SEEK_MIN_SPAN = 1024 * 1024;
+constexpr u64 SEEK_MAX_POINTS = 256;
+// only indexes of entries this large are saved next to the zip.
+constexpr u64 SEEK_PERSIST_MIN_SIZE = 1024 * 1024 * 64;
+// the oldest records are dropped when saving would make the index file larger than this.
+constexpr u64 SEEK_INDEX_MAX_SIZE = 1024 * 1024 * 32;
+// size of the buffer used to skip over data when seeking forward.
+constexpr u64 SEEK_SKIP_SIZE = 1024 * 64;
+// max size of the windows kept in memory, the least recently used indexes that
+// aren't open are freed once over, they are loaded from the index file or rebuilt.
+constexpr u64 SEEK_CACHE_MAX_SIZE = 1024 * 1024 * 8;
 
 enum mmz_Flag {
     mmz_Flag_Encrypted = 1 << 0,
@@ -29,6 +54,7 @@ enum mmz_Flag {
 enum mmz_Compression {
     mmz_Compression_None = 0,
     mmz_Compression_Deflate = 8,
+    mmz_Compression_Zstd = 93,
 };
 
 // 30 bytes (0x1E)
@@ -80,6 +106,29 @@ typedef struct mmz_FileHeader {
 } mmz_FileHeader;
 #pragma pack(pop)
 
+// a record is appended to the index file once an entry has been fully indexed.
+#pragma pack(push,1)
+struct SeekIndexRecord {
+    u32 sig;
+    u32 version;
+    // size of the record, including this header and the points.
+    u64 size;
+    u64 local_hdr_off;
+    u64 uncompressed_size;
+    u32 crc32;
+    u32 count;
+    u64 span;
+};
+
+// followed by the window.
+struct SeekIndexPoint {
+    u64 out;
+    u64 in;
+    u32 bits;
+    u32 window_size;
+};
+#pragma pack(pop)
+
 #pragma pack(push,1)
 typedef struct mmz_EndRecord {
     uint32_t sig;
@@ -93,35 +142,102 @@ typedef struct mmz_EndRecord {
 } mmz_EndRecord;
 #pragma pack(pop)
 
+// 56 bytes (0x38)
+#pragma pack(push,1)
+typedef struct mmz_Zip64EndRecord {
+    uint32_t sig;
+    uint64_t record_size;
+    uint16_t version;
+    uint16_t version_needed;
+    uint32_t disk_number;
+    uint32_t disk_wcd;
+    uint64_t disk_entries;
+    uint64_t total_entries;
+    uint64_t central_directory_size;
+    uint64_t file_hdr_off;
+} mmz_Zip64EndRecord;
+#pragma pack(pop)
+
+// 20 bytes (0x14), found directly before the end record.
+#pragma pack(push,1)
+typedef struct mmz_Zip64EndLocator {
+    uint32_t sig;
+    uint32_t disk_number;
+    uint64_t end_record_off;
+    uint32_t total_disks;
+} mmz_Zip64EndLocator;
+#pragma pack(pop)
+
 struct FileEntry {
     std::string path;
     u16 flags;
     u16 compression_type;
     u16 modtime;
     u16 moddate;
-    u32 compressed_size; // may be zero.
-    u32 uncompressed_size; // may be zero.
-    u32 local_file_header_off;
+    u32 crc32;
+    u64 compressed_size; // may be zero.
+    u64 uncompressed_size; // may be zero.
+    u64 local_file_header_off;
 };
 
 struct DirectoryEntry {
     std::string path;
-    std::vector<DirectoryEntry> dir_child;
-    std::vector<FileEntry> file_child;
+    std::vector<u32> dir_child; // index into ZipIndex::dirs.
+    std::vector<u32> file_child; // index into ZipIndex::files.
+};
+
+// flat tables sorted by path, so that lookups are a binary search.
+struct ZipIndex {
+    std::vector<DirectoryEntry> dirs; // the first entry is the root.
+    std::vector<FileEntry> files;
 };
 
 using FileTableEntries = std::vector<FileEntry>;
 
+// zran style access point, inflate can be restarted from here using the window.
+struct SeekPoint {
+    u64 out; // offset in the uncompressed data.
+    u64 in; // offset in the compressed data.
+    u32 bits; // number of bits needed from the byte before in.
+    std::vector<u8> window;
+};
+
+// access points of a deflate entry, added as the entry is inflated.
+struct SeekIndex {
+    u64 span;
+    std::vector<SeekPoint> points;
+    // set once inflated to the end, no more points will be added.
+    bool complete;
+    // set if the index was loaded from (or saved to) the index file.
+    bool persisted;
+    // number of files open using the index, it's not freed whilst open.
+    u32 open_count;
+    // set on open, the lowest is freed first.
+    u64 last_used;
+};
+
+auto GetSeekIndexSize(const SeekIndex& index) -> u64 {
+    u64 size{};
+    for (const auto& point : index.points) {
+        size += point.window.size();
+    }
+    return size;
+}
+
 struct Zfile {
     z_stream z; // zlib stream.
+    ZSTD_DCtx* zstd; // zstd stream.
+    ZSTD_inBuffer zstd_in; // compressed data that zstd has yet to consume.
     Bytef* buffer; // buffer that compressed data is read into.
     size_t buffer_size; // size of the above buffer.
     size_t compressed_off; // offset of the compressed file.
+    size_t out_off; // offset of the uncompressed data that the stream is at.
 };
 
 struct File {
     const FileEntry* entry;
     Zfile zfile; // only used if the file is compressed.
+    SeekIndex* index; // only used if the file is compressed.
     size_t data_off; // offset of the file data.
     size_t off;
 };
@@ -131,39 +247,25 @@ struct Dir {
     u32 index;
 };
 
-const FileEntry* find_file_entry(const DirectoryEntry& dir, std::string_view path) {
-    if (path.starts_with(dir.path)) {
-        // todo: check if / comes after file name in order to only check dirs.
-        for (const auto& e : dir.file_child) {
-            if (e.path == path) {
-                return &e;
-            }
-        }
+template<typename T>
+auto find_entry(T& entries, std::string_view path) -> decltype(entries.data()) {
+    const auto it = std::lower_bound(entries.begin(), entries.end(), path, [](const auto& e, std::string_view path) {
+        return e.path < path;
+    });
 
-        for (const auto& e : dir.dir_child) {
-            if (auto entry = find_file_entry(e, path)) {
-                return entry;
-            }
-        }
+    if (it == entries.end() || it->path != path) {
+        return nullptr;
     }
 
-    return nullptr;
+    return &*it;
 }
 
-const DirectoryEntry* find_dir_entry(const DirectoryEntry& dir, std::string_view path) {
-    if (dir.path == path) {
-        return &dir;
-    }
-
-    if (path.starts_with(dir.path)) {
-        for (const auto& e : dir.dir_child) {
-            if (auto entry = find_dir_entry(e, path)) {
-                return entry;
-            }
-        }
-    }
+const FileEntry* find_file_entry(const ZipIndex& table, std::string_view path) {
+    return find_entry(table.files, path);
+}
 
-    return nullptr;
+const DirectoryEntry* find_dir_entry(const ZipIndex& table, std::string_view path) {
+    return find_entry(table.dirs, path);
 }
 
 void set_stat_file(const FileEntry* entry, struct stat *st) {
@@ -186,11 +288,31 @@ void set_stat_file(const FileEntry* entry, struct stat *st) {
     st->st_ctime = st->st_atime;
 }
 
+// checks the record header against the bytes left in the index file.
+bool IsValidSeekIndexRecord(const SeekIndexRecord& record, u64 avail) {
+    if (record.sig != SEEK_INDEX_SIG || record.version != SEEK_INDEX_VERSION) {
+        return false;
+    }
+
+    if (record.size < sizeof(record) || record.size > avail) {
+        return false;
+    }
+
+    // every point has a header, so the count can't be more than the record holds.
+    return record.count <= (record.size - sizeof(record)) / sizeof(SeekIndexPoint);
+}
+
+bool IsSeekIndexRecordFor(const SeekIndexRecord& record, const FileEntry* entry) {
+    return record.local_hdr_off == entry->local_file_header_off && record.uncompressed_size == entry->uncompressed_size && record.crc32 == entry->crc32;
+}
+
 struct Device final : common::MountDevice {
-    Device(std::unique_ptr<common::LruBufferedData>&& _source, const DirectoryEntry& _root, const common::MountConfig& _config)
+    Device(std::unique_ptr<common::LruBufferedData>&& _source, ZipIndex&& _table, fs::Fs* _index_fs, const fs::FsPath& _index_path, const common::MountConfig& _config)
     : MountDevice{_config}
     , source{std::forward<decltype(_source)>(_source)}
-    , root{_root} {
+    , table{std::forward<decltype(_table)>(_table)}
+    , index_fs{_index_fs}
+    , index_path{_index_path} {
 
     }
 
@@ -207,15 +329,437 @@ private:
     int devoptab_dirclose(void* fd) override;
     int devoptab_lstat(const char *path, struct stat *st) override;
 
+    auto GetSeekIndex(const FileEntry* entry) -> SeekIndex*;
+    void EvictSeekIndexes();
+    void AddSeekPoint(File* file);
+    bool LoadSeekIndex(const FileEntry* entry, SeekIndex& index);
+    void SaveSeekIndex(const FileEntry* entry, SeekIndex& index);
+    ssize_t inflate_read(File* file, void* ptr, size_t len);
+    ssize_t zstd_read(File* file, void* ptr, size_t len);
+    ssize_t decompress_read(File* file, void* ptr, size_t len);
+    int decompress_seek(File* file);
+
 private:
     std::unique_ptr<common::LruBufferedData> source;
-    const DirectoryEntry root;
+    const ZipIndex table;
+    // fs that the zip is on, the index file is saved next to it.
+    fs::Fs* const index_fs;
+    // set if seek indexes are saved next to the zip.
+    const fs::FsPath index_path;
+    std::unordered_map<const FileEntry*, std::unique_ptr<SeekIndex>> seek_indexes{};
+    // size of the windows of all seek indexes.
+    u64 seek_indexes_size{};
+    u64 seek_indexes_tick{};
 };
 
+auto Device::GetSeekIndex(const FileEntry* entry) -> SeekIndex* {
+    auto& index = seek_indexes[entry];
+    if (!index) {
+        index = std::make_unique<SeekIndex>();
+        index->span = std::max<u64>(SEEK_MIN_SPAN, entry->uncompressed_size / SEEK_MAX_POINTS);
+
+        if (!index_path.empty() && entry->uncompressed_size >= SEEK_PERSIST_MIN_SIZE) {
+            LoadSeekIndex(entry, *index);
+            seek_indexes_size += GetSeekIndexSize(*index);
+        }
+    }
+
+    index->open_count++;
+    index->last_used = ++seek_indexes_tick;
+    auto out = index.get();
+    EvictSeekIndexes();
+    return out;
+}
+
+void Device::EvictSeekIndexes() {
+    while (seek_indexes_size > SEEK_CACHE_MAX_SIZE) {
+        auto lru = seek_indexes.end();
+        for (auto it = seek_indexes.begin(); it != seek_indexes.end(); it++) {
+            if (!it->second->open_count && (lru == seek_indexes.end() || it->second->last_used < lru->second->last_used)) {
+                lru = it;
+            }
+        }
+
+        // everything left is open.
+        if (lru == seek_indexes.end()) {
+            return;
+        }
+
+        const auto size = GetSeekIndexSize(*lru->second);
+        log_write("[ZIP] evicting seek index with %zu points for: %s\n", lru->second->points.size(), lru->first->path.c_str());
+        seek_indexes_size -= size;
+        seek_indexes.erase(lru);
+    }
+}
+
+// must be called at the end of a deflate block.
+void Device::AddSeekPoint(File* file) {
+    auto& zfile = file->zfile;
+    auto index = file->index;
+
+    if (index->complete) {
+        return;
+    }
+
+    const auto last_out = index->points.empty() ? 0 : index->points.back().out;
+    if (zfile.out_off < last_out + index->span) {
+        return;
+    }
+
+    SeekPoint point{};
+    point.out = zfile.out_off;
+    point.in = zfile.compressed_off - zfile.z.avail_in;
+    point.bits = zfile.z.data_type & 7;
+    point.window.resize(1 << MAX_WBITS);
+
+    uInt window_size = point.window.size();
+    if (Z_OK != inflateGetDictionary(&zfile.z, point.window.data(), &window_size)) {
+        return;
+    }
+
+    point.window.resize(window_size);
+    index->points.emplace_back(std::move(point));
+    seek_indexes_size += window_size;
+    EvictSeekIndexes();
+}
+
+bool Device::LoadSeekIndex(const FileEntry* entry, SeekIndex& index) {
+    fs::File f;
+    if (R_FAILED(index_fs->OpenFile(index_path, FsOpenMode_Read, &f))) {
+        return false;
+    }
+
+    s64 file_size;
+    if (R_FAILED(f.GetSize(&file_size))) {
+        return false;
+    }
+
+    SeekIndexRecord record{};
+    for (s64 off = 0; off + (s64)sizeof(record) <= file_size; off += record.size) {
+        u64 bytes_read;
+        if (R_FAILED(f.Read(off, &record, sizeof(record), 0, &bytes_read)) || bytes_read != sizeof(record)) {
+            return false;
+        }
+
+        if (!IsValidSeekIndexRecord(record, file_size - off)) {
+            log_write("[ZIP] invalid seek index record at: %lld\n", (long long)off);
+            return false;
+        }
+
+        if (!IsSeekIndexRecordFor(record, entry)) {
+            continue;
+        }
+
+        std::vector<u8> data(record.size - sizeof(record));
+        if (R_FAILED(f.Read(off + sizeof(record), data.data(), data.size(), 0, &bytes_read)) || bytes_read != data.size()) {
+            return false;
+        }
+
+        std::vector<SeekPoint> points(record.count);
+        u64 data_off = 0;
+        for (u32 i = 0; i < points.size(); i++) {
+            auto& point = points[i];
+            SeekIndexPoint hdr;
+            if (data_off + sizeof(hdr) > data.size()) {
+                return false;
+            }
+            std::memcpy(&hdr, data.data() + data_off, sizeof(hdr));
+            data_off += sizeof(hdr);
+
+            if (hdr.window_size > (1 << MAX_WBITS) || hdr.bits > 7 || (hdr.bits && !hdr.in) || data_off + hdr.window_size > data.size()) {
+                return false;
+            }
+
+            // points must be in order and inside of the entry.
+            if (hdr.out > entry->uncompressed_size || hdr.in > entry->compressed_size || (i && hdr.out <= points[i - 1].out)) {
+                log_write("[ZIP] invalid seek index point: %u\n", i);
+                return false;
+            }
+
+            point.out = hdr.out;
+            point.in = hdr.in;
+            point.bits = hdr.bits;
+            point.window.assign(data.data() + data_off, data.data() + data_off + hdr.window_size);
+            data_off += hdr.window_size;
+        }
+
+        log_write("[ZIP] loaded seek index with %zu points for: %s\n", points.size(), entry->path.c_str());
+        index.span = record.span;
+        index.points = std::move(points);
+        index.complete = true;
+        index.persisted = true;
+        return true;
+    }
+
+    return false;
+}
+
+void Device::SaveSeekIndex(const FileEntry* entry, SeekIndex& index) {
+    // only try once, even if it fails.
+    index.persisted = true;
+
+    SeekIndexRecord record{};
+    record.sig = SEEK_INDEX_SIG;
+    record.version = SEEK_INDEX_VERSION;
+    record.local_hdr_off = entry->local_file_header_off;
+    record.uncompressed_size = entry->uncompressed_size;
+    record.crc32 = entry->crc32;
+    record.count = index.points.size();
+    record.span = index.span;
+
+    std::vector<u8> data(sizeof(record));
+    for (const auto& point : index.points) {
+        SeekIndexPoint hdr{};
+        hdr.out = point.out;
+        hdr.in = point.in;
+        hdr.bits = point.bits;
+        hdr.window_size = point.window.size();
+
+        const auto off = data.size();
+        data.resize(off + sizeof(hdr) + point.window.size());
+        std::memcpy(data.data() + off, &hdr, sizeof(hdr));
+        std::memcpy(data.data() + off + sizeof(hdr), point.window.data(), point.window.size());
+    }
+
+    record.size = data.size();
+    std::memcpy(data.data(), &record, sizeof(record));
+
+    // keep the records of the other entries, stale records of this entry
+    // and anything after an invalid record are dropped.
+    std::vector<u8> old;
+    std::vector<std::span<const u8>> records;
+    {
+        fs::File f;
+        s64 file_size;
+        if (R_SUCCEEDED(index_fs->OpenFile(index_path, FsOpenMode_Read, &f)) && R_SUCCEEDED(f.GetSize(&file_size)) && file_size <= (s64)SEEK_INDEX_MAX_SIZE) {
+            old.resize(file_size);
+
+            u64 bytes_read;
+            if (R_FAILED(f.Read(0, old.data(), old.size(), 0, &bytes_read)) || bytes_read != old.size()) {
+                old.clear();
+            }
+        }
+    }
+
+    SeekIndexRecord old_record;
+    for (u64 off = 0; off + sizeof(old_record) <= old.size(); off += old_record.size) {
+        std::memcpy(&old_record, old.data() + off, sizeof(old_record));
+        if (!IsValidSeekIndexRecord(old_record, old.size() - off)) {
+            break;
+        }
+
+        if (!IsSeekIndexRecordFor(old_record, entry)) {
+            records.emplace_back(old.data() + off, old_record.size);
+        }
+    }
+
+    // drop the oldest records until the file fits.
+    u64 total_size = data.size();
+    for (const auto& e : records) {
+        total_size += e.size();
+    }
+
+    auto first = records.begin();
+    for (; first != records.end() && total_size > SEEK_INDEX_MAX_SIZE; first++) {
+        total_size -= first->size();
+    }
+
+    std::vector<u8> out;
+    out.reserve(total_size);
+    for (auto it = first; it != records.end(); it++) {
+        out.insert(out.end(), it->begin(), it->end());
+    }
+    out.insert(out.end(), data.begin(), data.end());
+
+    // written to a temp file first, so that a failed write keeps the old index.
+    const auto temp_path = index_path + ".tmp";
+    if (R_FAILED(index_fs->write_entire_file(temp_path, out))) {
+        log_write("[ZIP] failed to write seek index: %s\n", temp_path.s);
+        index_fs->DeleteFile(temp_path);
+        return;
+    }
+
+    index_fs->DeleteFile(index_path);
+    if (R_FAILED(index_fs->RenameFile(temp_path, index_path))) {
+        log_write("[ZIP] failed to rename seek index: %s\n", index_path.s);
+        index_fs->DeleteFile(temp_path);
+        return;
+    }
+
+    log_write("[ZIP] saved seek index with %zu points (%zu other records) for: %s\n", index.points.size(), (size_t)(records.end() - first), entry->path.c_str());
+}
+
+// inflates from the current position of the stream, adding access points along the way.
+ssize_t Device::inflate_read(File* file, void* ptr, size_t len) {
+    auto& zfile = file->zfile;
+    zfile.z.next_out = (Bytef*)ptr;
+    zfile.z.avail_out = len;
+
+    // run until we have inflated enough data.
+    while (zfile.z.avail_out) {
+        // check if we need to fetch more data.
+        if (!zfile.z.next_in || !zfile.z.avail_in) {
+            const auto clen = std::min<u64>(zfile.buffer_size, file->entry->compressed_size - zfile.compressed_off);
+            if (R_FAILED(this->source->Read2(zfile.buffer, file->data_off + zfile.compressed_off, clen))) {
+                return -ENOENT;
+            }
+
+            zfile.compressed_off += clen;
+            zfile.z.next_in = zfile.buffer;
+            zfile.z.avail_in = clen;
+        }
+
+        // stop at the end of each block so that access points can be added.
+        const auto avail_out = zfile.z.avail_out;
+        const auto rc = inflate(&zfile.z, Z_BLOCK);
+        zfile.out_off += avail_out - zfile.z.avail_out;
+
+        if (Z_STREAM_END == rc) {
+            break;
+        } else if (Z_OK != rc) {
+            log_write("[ZLIB] failed to inflate: %d %s\n", rc, zfile.z.msg);
+            return -ENOENT;
+        }
+
+        // the end of a block that isn't the last block, see zran.c
+        if ((zfile.z.data_type & 128) && !(zfile.z.data_type & 64)) {
+            AddSeekPoint(file);
+        }
+    }
+
+    // the stream end may not have been seen yet, but there's no more data.
+    if (zfile.out_off >= file->entry->uncompressed_size && !file->index->complete) {
+        file->index->complete = true;
+        log_write("[ZIP] seek index complete with %zu points for: %s\n", file->index->points.size(), file->entry->path.c_str());
+
+        if (!index_path.empty() && !file->index->persisted && file->entry->uncompressed_size >= SEEK_PERSIST_MIN_SIZE) {
+            SaveSeekIndex(file->entry, *file->index);
+        }
+    }
+
+    return len - zfile.z.avail_out;
+}
+
+ssize_t Device::zstd_read(File* file, void* ptr, size_t len) {
+    auto& zfile = file->zfile;
+    ZSTD_outBuffer output{ptr, len, 0};
+
+    while (output.pos < output.size) {
+        // check if we need to fetch more data.
+        if (zfile.zstd_in.pos == zfile.zstd_in.size && zfile.compressed_off < file->entry->compressed_size) {
+            const auto clen = std::min<u64>(zfile.buffer_size, file->entry->compressed_size - zfile.compressed_off);
+            if (R_FAILED(this->source->Read2(zfile.buffer, file->data_off + zfile.compressed_off, clen))) {
+                return -ENOENT;
+            }
+
+            zfile.compressed_off += clen;
+            zfile.zstd_in = {zfile.buffer, clen, 0};
+        }
+
+        const auto pos = output.pos;
+        const auto rc = ZSTD_decompressStream(zfile.zstd, &output, &zfile.zstd_in);
+        if (ZSTD_isError(rc)) {
+            log_write("[ZSTD] failed to decompress: %s\n", ZSTD_getErrorName(rc));
+            return -ENOENT;
+        }
+
+        // all the data has been read and flushed.
+        if (output.pos == pos && zfile.zstd_in.pos == zfile.zstd_in.size && zfile.compressed_off >= file->entry->compressed_size) {
+            break;
+        }
+    }
+
+    zfile.out_off += output.pos;
+    return output.pos;
+}
+
+ssize_t Device::decompress_read(File* file, void* ptr, size_t len) {
+    if (file->entry->compression_type == mmz_Compression_Zstd) {
+        return zstd_read(file, ptr, len);
+    }
+
+    return inflate_read(file, ptr, len);
+}
+
+// moves the stream to the file offset, restarting from the closest access point if needed.
+int Device::decompress_seek(File* file) {
+    auto& zfile = file->zfile;
+    const auto target = file->off;
+
+    if (file->entry->compression_type == mmz_Compression_Deflate) {
+        const auto& points = file->index->points;
+
+        // find the last point at or before the target.
+        const auto it = std::upper_bound(points.begin(), points.end(), target, [](u64 off, const SeekPoint& point) {
+            return off < point.out;
+        });
+        const auto point = it != points.begin() ? &*std::prev(it) : nullptr;
+        const u64 point_out = point ? point->out : 0;
+
+        // keep going from the current position if it's closer than the point.
+        if (target < zfile.out_off || zfile.out_off < point_out) {
+            if (Z_OK != inflateReset(&zfile.z)) {
+                return -EIO;
+            }
+
+            zfile.z.next_in = nullptr;
+            zfile.z.avail_in = 0;
+            zfile.compressed_off = 0;
+            zfile.out_off = 0;
+
+            if (point) {
+                if (point->bits) {
+                    u8 byte;
+                    if (R_FAILED(this->source->Read2(&byte, file->data_off + point->in - 1, sizeof(byte)))) {
+                        return -ENOENT;
+                    }
+
+                    inflatePrime(&zfile.z, point->bits, byte >> (8 - point->bits));
+                }
+
+                if (Z_OK != inflateSetDictionary(&zfile.z, point->window.data(), point->window.size())) {
+                    return -EIO;
+                }
+
+                zfile.compressed_off = point->in;
+                zfile.out_off = point->out;
+            }
+        }
+    } else if (target < zfile.out_off) {
+        // zstd entries have no access points, so restart from the beginning.
+        ZSTD_DCtx_reset(zfile.zstd, ZSTD_reset_session_only);
+        zfile.zstd_in = {};
+        zfile.compressed_off = 0;
+        zfile.out_off = 0;
+    }
+
+    if (zfile.out_off == target) {
+        return 0;
+    }
+
+    auto skip = utils::pool::Acquire(SEEK_SKIP_SIZE);
+    if (!skip) {
+        return -ENOMEM;
+    }
+
+    while (zfile.out_off < target) {
+        const auto ret = decompress_read(file, skip.data(), std::min<u64>(skip.size(), target - zfile.out_off));
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (!ret) {
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
-    const auto entry = find_file_entry(this->root, path);
+    const auto entry = find_file_entry(this->table, path);
     if (!entry) {
         return -ENOENT;
     }
@@ -225,7 +769,7 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         return -ENOENT;
     }
 
-    if (entry->compression_type != mmz_Compression_None && entry->compression_type != mmz_Compression_Deflate) {
+    if (entry->compression_type != mmz_Compression_None && entry->compression_type != mmz_Compression_Deflate && entry->compression_type != mmz_Compression_Zstd) {
         log_write("[ZIP] unsuported compression type: %u\n", entry->compression_type);
         return -ENOENT;
     }
@@ -256,7 +800,7 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         offset += sizeof(data_desc);
     }
 
-    if (entry->compression_type == mmz_Compression_Deflate) {
+    if (entry->compression_type != mmz_Compression_None) {
         auto& zfile = file->zfile;
         zfile.buffer_size = 1024 * 64;
         zfile.buffer = (Bytef*)std::calloc(1, zfile.buffer_size);
@@ -264,11 +808,22 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
             return -ENOENT;
         }
 
-        // skip zlib header.
-        if (Z_OK != inflateInit2(&zfile.z, -MAX_WBITS)) {
-            std::free(zfile.buffer);
-            zfile.buffer = nullptr;
-            return -ENOENT;
+        if (entry->compression_type == mmz_Compression_Zstd) {
+            zfile.zstd = ZSTD_createDCtx();
+            if (!zfile.zstd) {
+                std::free(zfile.buffer);
+                zfile.buffer = nullptr;
+                return -ENOENT;
+            }
+        } else {
+            // skip zlib header.
+            if (Z_OK != inflateInit2(&zfile.z, -MAX_WBITS)) {
+                std::free(zfile.buffer);
+                zfile.buffer = nullptr;
+                return -ENOENT;
+            }
+
+            file->index = GetSeekIndex(entry);
         }
     }
 
@@ -280,8 +835,14 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
-     if (file->entry->compression_type == mmz_Compression_Deflate) {
-        inflateEnd(&file->zfile.z);
+    if (file->entry->compression_type != mmz_Compression_None) {
+        if (file->entry->compression_type == mmz_Compression_Zstd) {
+            ZSTD_freeDCtx(file->zfile.zstd);
+        } else {
+            inflateEnd(&file->zfile.z);
+            file->index->open_count--;
+            EvictSeekIndexes();
+        }
 
         if (file->zfile.buffer) {
             std::free(file->zfile.buffer);
@@ -303,35 +864,20 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
         if (R_FAILED(this->source->Read2(ptr, file->data_off + file->off, len))) {
             return -ENOENT;
         }
-    } else if (file->entry->compression_type == mmz_Compression_Deflate) {
-        auto& zfile = file->zfile;
-        zfile.z.next_out = (Bytef*)ptr;
-        zfile.z.avail_out = len;
-
-        // run until we have inflated enough data.
-        while (zfile.z.avail_out) {
-            // check if we need to fetch more data.
-            if (!zfile.z.next_in || !zfile.z.avail_in) {
-                const auto clen = std::min(zfile.buffer_size, file->entry->compressed_size - zfile.compressed_off);
-                if (R_FAILED(this->source->Read2(zfile.buffer, file->data_off + zfile.compressed_off, clen))) {
-                    return -ENOENT;
-                }
-
-                zfile.compressed_off += clen;
-                zfile.z.next_in = zfile.buffer;
-                zfile.z.avail_in = clen;
+    } else {
+        // the file was seeked since the last read.
+        if (file->zfile.out_off != file->off) {
+            if (const auto ret = decompress_seek(file); ret < 0) {
+                return ret;
             }
+        }
 
-            const auto rc = inflate(&zfile.z, Z_SYNC_FLUSH);
-            if (Z_OK != rc) {
-                if (Z_STREAM_END == rc) {
-                    len -= zfile.z.avail_out;
-                } else {
-                    log_write("[ZLIB] failed to inflate: %d %s\n", rc, zfile.z.msg);
-                    return -ENOENT;
-                }
-            }
+        const auto ret = decompress_read(file, ptr, len);
+        if (ret < 0) {
+            return ret;
         }
+
+        len = ret;
     }
 
     file->off += len;
@@ -341,32 +887,11 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
     auto file = static_cast<File*>(fd);
 
-    // seek like normal.
-    if (file->entry->compression_type == mmz_Compression_None) {
-        if (dir == SEEK_CUR) {
-            pos += file->off;
-        } else if (dir == SEEK_END) {
-            pos = file->entry->uncompressed_size;
-        }
-    } else if (file->entry->compression_type == mmz_Compression_Deflate) {
-        // limited seek options.
-        // todo: support seeking to end and then back to orig position.
-        if (dir == SEEK_SET) {
-            if (pos == 0) {
-                inflateReset(&file->zfile.z);
-            } else if (pos != file->off) {
-                // seeking to the end is fine as it may be used to calc size.
-                if (pos != file->entry->uncompressed_size) {
-                    // random access seek is not supported.
-                    pos = file->off;
-                }
-            }
-        } else if (dir == SEEK_CUR) {
-            // random access seek is not supported.
-            pos = file->off;
-        } else if (dir == SEEK_END) {
-            pos = file->entry->uncompressed_size;
-        }
+    // compressed files are moved to the new offset on the next read.
+    if (dir == SEEK_CUR) {
+        pos += file->off;
+    } else if (dir == SEEK_END) {
+        pos = file->entry->uncompressed_size;
     }
 
     return file->off = std::clamp<u64>(pos, 0, file->entry->uncompressed_size);
@@ -382,7 +907,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 int Device::devoptab_diropen(void* fd, const char *path) {
     auto dir = static_cast<Dir*>(fd);
 
-    const auto entry = find_dir_entry(this->root, path);
+    const auto entry = find_dir_entry(this->table, path);
     if (!entry) {
         return -ENOENT;
     }
@@ -408,7 +933,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
         if (index >= dir->entry->file_child.size()) {
             return -ENOENT;
         } else {
-            const auto& entry = dir->entry->file_child[index];
+            const auto& entry = this->table.files[dir->entry->file_child[index]];
             const auto rel_path = entry.path.substr(entry.path.find_last_of('/') + 1);
 
             set_stat_file(&entry, filestat);
@@ -416,7 +941,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
         }
 
     } else {
-        const auto& entry = dir->entry->dir_child[index];
+        const auto& entry = this->table.dirs[dir->entry->dir_child[index]];
         const auto rel_path = entry.path.substr(entry.path.find_last_of('/') + 1);
 
         filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
@@ -437,9 +962,9 @@ int Device::devoptab_dirclose(void* fd) {
 int Device::devoptab_lstat(const char *path, struct stat *st) {
     st->st_nlink = 1;
 
-    if (find_dir_entry(this->root, path)) {
+    if (find_dir_entry(this->table, path)) {
         st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else if (auto entry = find_file_entry(this->root, path)) {
+    } else if (auto entry = find_file_entry(this->table, path)) {
         set_stat_file(entry, st);
     } else {
         log_write("[ZIP] didn't find in lstat\n");
@@ -449,58 +974,92 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
     return 0;
 }
 
-auto BuildPath(const std::string& path) -> std::string {
-    if (path.starts_with('/')) {
-        return path;
+auto GetParentPath(std::string_view path) -> std::string_view {
+    const auto idx = path.find_last_of('/');
+    if (!idx || idx == path.npos) {
+        return "/";
     }
-    return "/" + path;
+    return path.substr(0, idx);
 }
 
-void Parse(const FileTableEntries& entries, u32& index, DirectoryEntry& out) {
-    for (; index < entries.size(); index++) {
-        const auto path = BuildPath(entries[index].path);
+// builds the sorted tables, entries can be in any order.
+void BuildIndex(FileTableEntries&& entries, ZipIndex& out) {
+    std::vector<std::string> dir_paths{"/"};
+    std::string_view last_parent{};
 
-        // check if this path belongs to this dir.
-        if (!path.starts_with(out.path)) {
-            return;
+    for (auto& entry : entries) {
+        if (!entry.path.starts_with('/')) {
+            entry.path.insert(entry.path.begin(), '/');
         }
 
+        std::string_view path = entry.path;
         if (path.ends_with('/')) {
-            auto& new_entry = out.dir_child.emplace_back();
-            new_entry.path = path.substr(0, path.length() - 1);
+            path.remove_suffix(1);
+            if (!path.empty()) {
+                dir_paths.emplace_back(path);
+            }
+        }
 
-            u32 new_index = index + 1;
-            Parse(entries, new_index, new_entry);
-            index = new_index - 1;
-        } else {
-            // check if this file actually belongs to this folder.
-            const auto idx = path.find_first_of('/', out.path.length() + 1);
-            const auto sub = path.substr(0, idx);
-
-            if (idx != path.npos && out.path != sub) {
-                auto& new_entry = out.dir_child.emplace_back();
-                new_entry.path = sub;
-                Parse(entries, index, new_entry);
-            } else {
-                auto& new_entry = out.file_child.emplace_back(entries[index]);
-                new_entry.path = path;
+        // zips don't need an entry for every parent dir, so add them here.
+        // entries are usually grouped by dir, so skip if the parent is the same as the last entry.
+        const auto parent = GetParentPath(path);
+        if (parent != last_parent) {
+            for (auto dir = parent; dir != "/"; dir = GetParentPath(dir)) {
+                dir_paths.emplace_back(dir);
             }
+            last_parent = parent;
         }
     }
-}
 
-void Parse(const FileTableEntries& entries, DirectoryEntry& out) {
-    u32 index = 0;
-    out.path = "/"; // add root folder.
-    Parse(entries, index, out);
+    std::sort(dir_paths.begin(), dir_paths.end());
+    dir_paths.erase(std::unique(dir_paths.begin(), dir_paths.end()), dir_paths.end());
+
+    out.dirs.resize(dir_paths.size());
+    for (size_t i = 0; i < dir_paths.size(); i++) {
+        out.dirs[i].path = std::move(dir_paths[i]);
+    }
+
+    // dirs are in their own table, the first entry is kept if there's a duplicate.
+    std::erase_if(entries, [](const FileEntry& e) {
+        return e.path.ends_with('/');
+    });
+
+    const auto path_less = [](const FileEntry& a, const FileEntry& b) {
+        return a.path < b.path;
+    };
+
+    // most zips are already sorted.
+    if (!std::is_sorted(entries.begin(), entries.end(), path_less)) {
+        std::stable_sort(entries.begin(), entries.end(), path_less);
+    }
+
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const FileEntry& a, const FileEntry& b) {
+        return a.path == b.path;
+    }), entries.end());
+
+    out.files = std::move(entries);
+
+    // children are added in sorted order, so that dirnext is sorted.
+    for (u32 i = 1; i < out.dirs.size(); i++) {
+        if (auto parent = find_entry(out.dirs, GetParentPath(out.dirs[i].path))) {
+            parent->dir_child.emplace_back(i);
+        }
+    }
+
+    for (u32 i = 0; i < out.files.size(); i++) {
+        if (auto parent = find_entry(out.dirs, GetParentPath(out.files[i].path))) {
+            parent->file_child.emplace_back(i);
+        }
+    }
 }
 
-Result find_central_dir_offset(common::LruBufferedData* source, s64 size, mmz_EndRecord* record) {
+Result find_central_dir_offset(common::LruBufferedData* source, s64 size, mmz_EndRecord* record, s64* record_off) {
     // check if the record is at the end (no extra header).
     auto offset = size - sizeof(*record);
     R_TRY(source->Read2(record, offset, sizeof(*record)));
 
     if (record->sig == END_RECORD_SIG) {
+        *record_off = offset;
         R_SUCCEED();
     }
 
@@ -516,6 +1075,7 @@ Result find_central_dir_offset(common::LruBufferedData* source, s64 size, mmz_En
         std::memcpy(&sig, data.data() + i, sizeof(sig));
         if (sig == END_RECORD_SIG) {
             std::memcpy(record, data.data() + i, sizeof(*record));
+            *record_off = offset + i;
             R_SUCCEED();
         }
     }
@@ -523,40 +1083,127 @@ Result find_central_dir_offset(common::LruBufferedData* source, s64 size, mmz_En
     R_THROW(0x1);
 }
 
+// sizes and offsets that don't fit are set to UINT32_MAX, with the real value in the extra field.
+Result ParseZip64Extra(const u8* extra, u16 extra_len, const mmz_FileHeader& file_hdr, FileEntry& entry) {
+    for (u32 off = 0; off + sizeof(u16) * 2 <= extra_len;) {
+        u16 id, size;
+        std::memcpy(&id, extra + off, sizeof(id));
+        std::memcpy(&size, extra + off + sizeof(id), sizeof(size));
+        off += sizeof(id) + sizeof(size);
+
+        if (off + size > extra_len) {
+            log_write("[ZIP] invalid extra field\n");
+            R_THROW(0x1);
+        }
+
+        if (id == ZIP64_EXTRA_ID) {
+            // only the fields that overflowed are present, in this order.
+            u32 field_off = 0;
+            const auto read_field = [&](u64& value) -> Result {
+                if (field_off + sizeof(value) > size) {
+                    log_write("[ZIP] invalid zip64 extra field\n");
+                    R_THROW(0x1);
+                }
+
+                std::memcpy(&value, extra + off + field_off, sizeof(value));
+                field_off += sizeof(value);
+                R_SUCCEED();
+            };
+
+            if (file_hdr.uncompressed_size == UINT32_MAX) {
+                R_TRY(read_field(entry.uncompressed_size));
+            }
+            if (file_hdr.compressed_size == UINT32_MAX) {
+                R_TRY(read_field(entry.compressed_size));
+            }
+            if (file_hdr.local_hdr_off == UINT32_MAX) {
+                R_TRY(read_field(entry.local_file_header_off));
+            }
+
+            R_SUCCEED();
+        }
+
+        off += size;
+    }
+
+    R_SUCCEED();
+}
+
 Result ParseZip(common::LruBufferedData* source, s64 size, FileTableEntries& out) {
     mmz_EndRecord end_rec;
-    R_TRY(find_central_dir_offset(source, size, &end_rec));
+    s64 end_rec_off;
+    R_TRY(find_central_dir_offset(source, size, &end_rec, &end_rec_off));
 
-    out.reserve(end_rec.total_entries);
-    auto file_header_off = end_rec.file_hdr_off;
+    u64 total_entries = end_rec.total_entries;
+    u64 central_directory_size = end_rec.central_directory_size;
+    u64 file_header_off = end_rec.file_hdr_off;
 
-    for (u16 i = 0; i < end_rec.total_entries; i++) {
-        // read the file header.
-        mmz_FileHeader file_hdr{};
-        R_TRY(source->Read2(&file_hdr, file_header_off, sizeof(file_hdr)));
+    // zip64 archives have a locator directly before the end record.
+    if (end_rec_off >= (s64)sizeof(mmz_Zip64EndLocator)) {
+        mmz_Zip64EndLocator locator;
+        R_TRY(source->Read2(&locator, end_rec_off - sizeof(locator), sizeof(locator)));
 
-        if (file_hdr.sig != FILE_HEADER_SIG) {
+        if (locator.sig == ZIP64_END_LOCATOR_SIG) {
+            mmz_Zip64EndRecord end_rec64;
+            R_TRY(source->Read2(&end_rec64, locator.end_record_off, sizeof(end_rec64)));
+
+            if (end_rec64.sig != ZIP64_END_RECORD_SIG) {
+                log_write("[ZIP] invalid zip64 end record\n");
+                R_THROW(0x1);
+            }
+
+            total_entries = end_rec64.total_entries;
+            central_directory_size = end_rec64.central_directory_size;
+            file_header_off = end_rec64.file_hdr_off;
+        }
+    }
+
+    // checked separately, as the sum could wrap with a malformed zip64 record.
+    if (central_directory_size > (u64)size || file_header_off > (u64)size - central_directory_size) {
+        log_write("[ZIP] invalid central directory\n");
+        R_THROW(0x1);
+    }
+
+    // read the whole central directory at once, rather than a read per header.
+    std::vector<u8> data(central_directory_size);
+    R_TRY(source->Read2(data.data(), file_header_off, data.size()));
+
+    // the entry count isn't trusted, each entry needs at least a header.
+    out.reserve(std::min<u64>(total_entries, central_directory_size / sizeof(mmz_FileHeader)));
+    u64 off = 0;
+
+    for (u64 i = 0; i < total_entries; i++) {
+        mmz_FileHeader file_hdr;
+        if (off + sizeof(file_hdr) > data.size()) {
+            log_write("[ZIP] invalid file record\n");
+            R_THROW(0x1);
+        }
+
+        std::memcpy(&file_hdr, data.data() + off, sizeof(file_hdr));
+        const auto filename_off = off + sizeof(file_hdr);
+        const auto extra_off = filename_off + file_hdr.filename_len;
+        const auto next_off = extra_off + file_hdr.extrafield_len + file_hdr.filecomment_len;
+
+        if (file_hdr.sig != FILE_HEADER_SIG || next_off > data.size()) {
             log_write("[ZIP] invalid file record\n");
             R_THROW(0x1);
         }
 
         // save all the data hat we care about.
         auto& new_entry = out.emplace_back();
+        new_entry.path.assign((const char*)data.data() + filename_off, file_hdr.filename_len);
         new_entry.flags = file_hdr.flags;
         new_entry.compression_type = file_hdr.compression;
         new_entry.modtime = file_hdr.modtime;
         new_entry.moddate = file_hdr.moddate;
+        new_entry.crc32 = file_hdr.crc32;
         new_entry.compressed_size = file_hdr.compressed_size;
         new_entry.uncompressed_size = file_hdr.uncompressed_size;
         new_entry.local_file_header_off = file_hdr.local_hdr_off;
-
-        // read the file name.
-        const auto filename_off = file_header_off + sizeof(file_hdr);
-        new_entry.path.resize(file_hdr.filename_len);
-        R_TRY(source->Read2(new_entry.path.data(), filename_off, new_entry.path.size()));
+        R_TRY(ParseZip64Extra(data.data() + extra_off, file_hdr.extrafield_len, file_hdr, new_entry));
 
         // advance the offset.
-        file_header_off += sizeof(file_hdr) + file_hdr.filename_len + file_hdr.extrafield_len + file_hdr.filecomment_len;
+        off = next_off;
     }
 
     R_SUCCEED();
@@ -575,12 +1222,18 @@ Result MountZip(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
     R_TRY(ParseZip(buffered.get(), size, table_entries));
     log_write("[ZIP] parsed zip\n");
 
-    DirectoryEntry root;
-    Parse(table_entries, root);
+    ZipIndex table;
+    BuildIndex(std::move(table_entries), table);
+
+    // seek indexes are only saved if enabled and the zip is on the sd card.
+    fs::FsPath index_path{};
+    if (fs->IsSd() && App::GetZipSeekIndexEnable()) {
+        index_path = path + ".sidx";
+    }
 
     if (!common::MountReadOnlyIndexDevice(
-        [&buffered, &root](const common::MountConfig& config) {
-            return std::make_unique<Device>(std::move(buffered), root, config);
+        [&buffered, &table, fs, &index_path](const common::MountConfig& config) {
+            return std::make_unique<Device>(std::move(buffered), std::move(table), fs, index_path, config);
         },
         sizeof(File), sizeof(Dir),
         "ZIP", out_path
@@ -0,0 +1,232 @@
+#include "utils/dir_scanner.hpp"
+#include "utils/thread.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+namespace sphaira::utils {
+
+DirScanner::DirScanner() {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_stat);
+}
+
+DirScanner::~DirScanner() {
+    Stop();
+}
+
+Result DirScanner::Start(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path, bool stat_files) {
+    Stop();
+
+    m_fs = fs;
+    m_path = path;
+    m_stat_files = stat_files;
+    m_rc = 0;
+    m_read_done = false;
+    m_quit = false;
+
+    R_TRY(utils::CreateThread(&m_read_thread, read_thread_func, this));
+    if (const auto rc = threadStart(&m_read_thread); R_FAILED(rc)) {
+        threadClose(&m_read_thread);
+        R_THROW(rc);
+    }
+    m_read_thread_started = true;
+
+    // native stat is a quick ipc call, so more workers won't help.
+    const auto worker_count = m_fs->IsNative() ? 1 : MAX_STAT_WORKERS;
+    for (u32 i = 0; i < worker_count; i++) {
+        auto& thread = m_stat_threads[m_stat_thread_count];
+        if (R_FAILED(utils::CreateThread(&thread, stat_thread_func, this, 1024*64))) {
+            log_write("[SCAN] failed to create stat thread\n");
+            break;
+        }
+
+        if (R_FAILED(threadStart(&thread))) {
+            log_write("[SCAN] failed to start stat thread\n");
+            threadClose(&thread);
+            break;
+        }
+
+        m_stat_thread_count++;
+    }
+
+    R_SUCCEED();
+}
+
+void DirScanner::Stop() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_quit = true;
+        condvarWakeAll(&m_can_stat);
+    }
+
+    if (m_read_thread_started) {
+        threadWaitForExit(&m_read_thread);
+        threadClose(&m_read_thread);
+        m_read_thread_started = false;
+    }
+
+    for (u32 i = 0; i < m_stat_thread_count; i++) {
+        threadWaitForExit(&m_stat_threads[i]);
+        threadClose(&m_stat_threads[i]);
+    }
+    m_stat_thread_count = 0;
+
+    // anything left over belongs to the old scan.
+    m_entries.clear();
+    m_entry_count = 0;
+    m_priority.clear();
+    m_queue.clear();
+    m_stat_state.clear();
+    m_stats.clear();
+    m_fs.reset();
+}
+
+void DirScanner::PushStat(u32 index, FsDirEntryType type, const char* name) {
+    SCOPED_MUTEX(&m_mutex);
+    QueueStat(index, type, name, true);
+}
+
+bool DirScanner::PopEntries(std::vector<FsDirectoryEntry>& out, u32 max_count) {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto count = std::min<size_t>(max_count, m_entries.size());
+    out.assign(m_entries.begin(), m_entries.begin() + count);
+    m_entries.erase(m_entries.begin(), m_entries.begin() + count);
+
+    return m_read_done && out.empty();
+}
+
+auto DirScanner::GetReadCount() -> u32 {
+    SCOPED_MUTEX(&m_mutex);
+    return m_entry_count;
+}
+
+void DirScanner::PopStats(std::vector<Stat>& out) {
+    SCOPED_MUTEX(&m_mutex);
+
+    out.clear();
+    std::swap(out, m_stats);
+}
+
+void DirScanner::QueueStat(u32 index, FsDirEntryType type, const char* name, bool priority) {
+    if (index >= m_stat_state.size()) {
+        m_stat_state.resize(index + 1);
+    }
+
+    auto& state = m_stat_state[index];
+    if (state == StatState::Done || (state == StatState::Queued && !priority)) {
+        return;
+    }
+
+    // if it's already in the queue, the first one to be taken wins.
+    state = StatState::Queued;
+    if (priority) {
+        m_priority.emplace_back(index, type, name);
+    } else {
+        m_queue.emplace_back(index, type, name);
+    }
+
+    condvarWakeOne(&m_can_stat);
+}
+
+void DirScanner::read_thread_func(void* arg) {
+    static_cast<DirScanner*>(arg)->ReadLoop();
+}
+
+void DirScanner::stat_thread_func(void* arg) {
+    static_cast<DirScanner*>(arg)->StatLoop();
+}
+
+void DirScanner::ReadLoop() {
+    const auto rc = [this]() -> Result {
+        fs::Dir d;
+        R_TRY(m_fs->OpenDirectory(m_path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &d));
+
+        std::vector<FsDirectoryEntry> buf(BATCH_SIZE);
+        for (;;) {
+            s64 count;
+            R_TRY(d.Read(&count, buf.size(), buf.data()));
+            if (!count) {
+                break;
+            }
+
+            SCOPED_MUTEX(&m_mutex);
+            if (m_quit) {
+                break;
+            }
+
+            for (s64 i = 0; i < count; i++) {
+                const auto& e = buf[i];
+                if (m_stat_files && e.type == FsDirEntryType_File) {
+                    QueueStat(m_entry_count, static_cast<FsDirEntryType>(e.type), e.name, false);
+                }
+
+                m_entries.emplace_back(e);
+                m_entry_count++;
+            }
+        }
+
+        R_SUCCEED();
+    }();
+
+    if (R_FAILED(rc)) {
+        log_write("[SCAN] failed to read: %s 0x%X\n", m_path.s, rc);
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+    m_rc = rc;
+    m_read_done = true;
+}
+
+void DirScanner::StatLoop() {
+    for (;;) {
+        StatRequest req;
+        {
+            SCOPED_MUTEX(&m_mutex);
+
+            for (;;) {
+                if (m_quit) {
+                    return;
+                }
+
+                if (!m_priority.empty()) {
+                    req = std::move(m_priority.back());
+                    m_priority.pop_back();
+                } else if (!m_queue.empty()) {
+                    req = std::move(m_queue.front());
+                    m_queue.pop_front();
+                } else {
+                    condvarWait(&m_can_stat, &m_mutex);
+                    continue;
+                }
+
+                // skip if the other copy was already taken.
+                if (m_stat_state[req.index] != StatState::Done) {
+                    m_stat_state[req.index] = StatState::Done;
+                    break;
+                }
+            }
+        }
+
+        Stat stat{};
+        stat.index = req.index;
+        stat.type = req.type;
+
+        const auto path = fs::AppendPath(m_path, req.name.c_str());
+        if (req.type == FsDirEntryType_Dir) {
+            stat.rc = m_fs->DirGetEntryCount(path, &stat.file_count, &stat.dir_count);
+        } else if (m_fs->IsNative()) {
+            stat.rc = m_fs->GetFileTimeStampRaw(path, &stat.time_stamp);
+        } else {
+            stat.rc = m_fs->FileGetSizeAndTimestamp(path, &stat.time_stamp, &stat.file_size);
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        m_stats.emplace_back(stat);
+    }
+}
+
+} // namespace sphaira::utils
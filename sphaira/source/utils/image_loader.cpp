@@ -0,0 +1,166 @@
+#include "utils/image_loader.hpp"
+#include "utils/thread.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+
+namespace sphaira::utils {
+
+ImageLoader::ImageLoader(u32 workers) : m_worker_count{std::clamp<u32>(workers, 1, MAX_WORKERS)} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_work);
+}
+
+ImageLoader::~ImageLoader() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_quit = true;
+        condvarWakeAll(&m_can_work);
+    }
+
+    for (u32 i = 0; i < m_thread_count; i++) {
+        threadWaitForExit(&m_threads[i]);
+        threadClose(&m_threads[i]);
+    }
+}
+
+bool ImageLoader::Touch(u64 key) {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_requests.find(key);
+    if (it == m_requests.end()) {
+        return false;
+    }
+
+    it->second = true;
+    return true;
+}
+
+void ImageLoader::Request(u64 key, LoadCallback&& func) {
+    SCOPED_MUTEX(&m_mutex);
+
+    // workers are only created once there's something to load.
+    if (!m_started) {
+        Start();
+    }
+
+    auto [it, inserted] = m_requests.insert_or_assign(key, true);
+    if (inserted) {
+        m_queue.emplace_back(key, std::move(func));
+        condvarWakeOne(&m_can_work);
+    }
+}
+
+void ImageLoader::Sweep() {
+    SCOPED_MUTEX(&m_mutex);
+
+    std::erase_if(m_queue, [this](const Job& job) {
+        const auto it = m_requests.find(job.key);
+        if (!it->second) {
+            m_requests.erase(it);
+            return true;
+        }
+        return false;
+    });
+
+    for (auto& [key, wanted] : m_requests) {
+        wanted = false;
+    }
+}
+
+void ImageLoader::Clear() {
+    SCOPED_MUTEX(&m_mutex);
+
+    m_requests.clear();
+    m_queue.clear();
+    m_loaded.clear();
+    m_generation++;
+}
+
+u32 ImageLoader::Upload(const UploadCallback& func, u64 budget_ns) {
+    const auto start = armTicksToNs(armGetSystemTick());
+    u32 count{};
+
+    for (;;) {
+        Loaded loaded;
+        {
+            SCOPED_MUTEX(&m_mutex);
+            if (m_loaded.empty()) {
+                break;
+            }
+
+            loaded = std::move(m_loaded.front());
+            m_loaded.pop_front();
+            m_requests.erase(loaded.key);
+        }
+
+        func(loaded.key, loaded.image);
+        count++;
+
+        if (armTicksToNs(armGetSystemTick()) - start >= budget_ns) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+void ImageLoader::Start() {
+    m_started = true;
+
+    for (u32 i = 0; i < m_worker_count; i++) {
+        auto& thread = m_threads[m_thread_count];
+        if (R_FAILED(utils::CreateThread(&thread, thread_func, this))) {
+            log_write("[IMAGE] failed to create thread\n");
+            break;
+        }
+
+        if (R_FAILED(threadStart(&thread))) {
+            log_write("[IMAGE] failed to start thread\n");
+            threadClose(&thread);
+            break;
+        }
+
+        m_thread_count++;
+    }
+}
+
+void ImageLoader::thread_func(void* arg) {
+    static_cast<ImageLoader*>(arg)->ThreadLoop();
+}
+
+void ImageLoader::ThreadLoop() {
+    for (;;) {
+        Job job;
+        u32 generation;
+        {
+            SCOPED_MUTEX(&m_mutex);
+
+            while (!m_quit && m_queue.empty()) {
+                condvarWait(&m_can_work, &m_mutex);
+            }
+
+            if (m_quit) {
+                return;
+            }
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            generation = m_generation;
+        }
+
+        auto image = job.func();
+        // free anything captured by the callback outside of the lock.
+        job.func = {};
+
+        SCOPED_MUTEX(&m_mutex);
+        if (generation != m_generation) {
+            continue;
+        }
+
+        m_loaded.emplace_back(job.key, std::move(image));
+    }
+}
+
+} // namespace sphaira::utils
@@ -10,6 +10,9 @@
 #include "image.hpp"
 #include "swkbd.hpp"
 #include "threaded_file_transfer.hpp"
+#include "utils/thread.hpp"
+#include "utils/ordered_worker_pool.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include "yati/nx/ncm.hpp"
 #include "yati/nx/nca.hpp"
@@ -19,6 +22,8 @@
 #include "yati/nx/crypto.hpp"
 
 #include <utility>
+#include <memory>
+#include <span>
 #include <cstring>
 #include <algorithm>
 #include <minIni.h>
@@ -27,6 +32,12 @@
 namespace sphaira::utils::nsz {
 namespace {
 
+// blocks larger than this are compressed on a single thread,
+// as otherwise every in flight block would need a very large buffer.
+constexpr u64 NSZ_BLOCK_PARALLEL_MAX_SIZE = 1024*1024*4;
+// max size of all in flight blocks.
+constexpr u64 NSZ_BLOCK_PARALLEL_MAX_INFLIGHT = 1024*1024*16;
+
 struct NszInfo {
     int threads;
     int level;
@@ -35,6 +46,60 @@ struct NszInfo {
     u8 block_exponent;
 };
 
+// a single ncz block, compressed by the block pool.
+// the buffers are leased on first use and kept for every block that reuses the slot.
+struct NszBlockJob {
+    // uncompressed block.
+    utils::pool::Lease data{};
+    // size of the data gathered so far.
+    u64 data_size{};
+    // compressed block.
+    utils::pool::Lease out{};
+    // points to either data or out, whichever is smaller.
+    std::span<const u8> output{};
+};
+
+// per-thread state for compressing ncz blocks, each thread has its own cctx.
+struct NszBlockWorker {
+    NszBlockWorker(int level, bool ldm) {
+        if (cctx) {
+            if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level)) ||
+                ZSTD_isError(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_enableLongDistanceMatching, ldm))) {
+                cctx.reset();
+            }
+        }
+    }
+
+    Result Process(NszBlockJob& job) {
+        R_UNLESS(cctx, Result_NszFailedCreateCctx);
+
+        if (job.out.size() < job.data_size) {
+            job.out = utils::pool::Acquire(job.data_size);
+            R_UNLESS(job.out, Result_PoolLeaseFailed);
+        }
+
+        const auto result = ZSTD_compress2(cctx.get(), job.out.data(), job.data_size, job.data.data(), job.data_size);
+
+        // check if we got an error, ignoring if the dst buffer was too small.
+        const auto error_code = ZSTD_getErrorCode(result);
+        R_UNLESS(error_code == ZSTD_error_no_error || error_code == ZSTD_error_dstSize_tooSmall, Result_NszFailedCompress2);
+
+        // use src buffer instead if zstd failed to compress.
+        if (error_code == ZSTD_error_dstSize_tooSmall || result >= job.data_size) {
+            job.output = std::span{job.data.data(), job.data_size};
+        } else {
+            job.output = std::span{job.out.data(), result};
+        }
+
+        R_SUCCEED();
+    }
+
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx{ZSTD_createCCtx(), ZSTD_freeCCtx};
+};
+
+// compresses independent ncz blocks on multiple threads.
+using NszBlockCompressor = OrderedWorkerPool<NszBlockJob, NszBlockWorker>;
+
 } // namespace
 
 Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64& read_offset, s64& write_offset, Collections& collections, const keys::Keys& keys, dump::BaseSource* source, dump::WriteSource* writer, const fs::FsPath& path) {
@@ -168,10 +233,30 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
             u32 ncz_block_index = 0;
 
             // buffer that zstd compresses into.
-            std::vector<u8> ncz_block_out_buffer;
+            utils::pool::Lease ncz_block_out_buffer;
             // buffer that is written into.
-            std::vector<u8> ncz_block_in_buffer;
-            ncz_block_in_buffer.reserve(blockSize);
+            utils::pool::Lease ncz_block_in_buffer;
+            u64 ncz_block_in_size{};
+
+            // only used for block mode, if set, blocks are compressed in parallel.
+            std::unique_ptr<NszBlockCompressor> block_pool{};
+            if (use_block && threads && blockSize <= NSZ_BLOCK_PARALLEL_MAX_SIZE) {
+                const auto depth = std::clamp<u64>(NSZ_BLOCK_PARALLEL_MAX_INFLIGHT / blockSize, threads, threads * 4);
+                block_pool = std::make_unique<NszBlockCompressor>([level, ldm]{ return NszBlockWorker{level, ldm}; });
+                const auto workers = block_pool->Create(threads, depth);
+                log_write("[NSZ] created %u block workers, depth: %zu\n", workers, depth);
+                if (!workers) {
+                    log_write("[NSZ] failed to create block workers, using single thread\n");
+                    block_pool.reset();
+                }
+            }
+
+            // the blocks are compressed on this thread, so it needs its own buffers.
+            if (use_block && !block_pool) {
+                ncz_block_out_buffer = utils::pool::Acquire(blockSize);
+                ncz_block_in_buffer = utils::pool::Acquire(blockSize);
+                R_UNLESS(ncz_block_out_buffer && ncz_block_in_buffer, Result_PoolLeaseFailed);
+            }
 
             const auto ncz_header_off = file_off + NCZ_NORMAL_SIZE;
             const auto ncz_header_size = sizeof(ncz_header);
@@ -238,11 +323,80 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                     [&](void* _data, s64 off, s64 size, const thread::DecompressWriteCallback& callback) -> Result {
                         auto data = (const u8*)_data;
 
-                        if (use_block) {
+                        if (use_block && block_pool) {
+                            // waits for the oldest block to compress and writes it.
+                            const auto pop_block = [&]() -> Result {
+                                NszBlockJob* job{};
+                                R_TRY(block_pool->WaitFront(std::addressof(job)));
+                                ON_SCOPE_EXIT(job->data_size = 0; block_pool->Pop());
+
+                                // write block data, advance the block index.
+                                R_UNLESS(ncz_block_index < ncz_blocks.size(), Result_NszTooManyBlocks);
+                                // the block is handed to the write thread rather than copied,
+                                // the job gets a free buffer back in exchange.
+                                const auto size = job->output.size();
+                                auto& lease = job->output.data() == job->out.data() ? job->out : job->data;
+                                R_TRY(callback.Swap(lease, size));
+                                ncz_blocks[ncz_block_index++].size = size;
+                                R_SUCCEED();
+                            };
+
+                            // submits the block, writing out any blocks that have finished.
+                            const auto push_block = [&]() -> Result {
+                                block_pool->Push();
+                                while (block_pool->IsFrontDone()) {
+                                    R_TRY(pop_block());
+                                }
+                                R_SUCCEED();
+                            };
+
+                            const auto last_chunk = off + size >= size_remaining;
+
+                            while (size) {
+                                // wait for a free slot.
+                                while (block_pool->IsFull()) {
+                                    R_TRY(pop_block());
+                                }
+
+                                auto& job = block_pool->GetBack();
+                                if (job.data.size() < blockSize) {
+                                    job.data = utils::pool::Acquire(blockSize);
+                                    R_UNLESS(job.data, Result_PoolLeaseFailed);
+                                }
+
+                                const auto rsize = std::min<s64>(size, blockSize - job.data_size);
+                                std::memcpy(job.data.data() + job.data_size, data, rsize);
+                                job.data_size += rsize;
+
+                                // check if we've filled the block.
+                                if (job.data_size == blockSize) {
+                                    R_TRY(push_block());
+                                }
+
+                                size -= rsize;
+                                off += rsize;
+                                data += rsize;
+                            }
+
+                            // flush last block and wait for all blocks to finish.
+                            if (last_chunk) {
+                                if (!block_pool->IsFull() && block_pool->GetBack().data_size) {
+                                    log_write("\t\t[NSZ] flushing block end: %zu\n", block_pool->GetBack().data_size);
+                                    R_TRY(push_block());
+                                }
+
+                                while (!block_pool->IsEmpty()) {
+                                    R_TRY(pop_block());
+                                }
+
+                                // ensure that we are at the last block.
+                                log_write("block index: %u vs %zu\n", ncz_block_index, ncz_blocks.size());
+                                R_UNLESS(ncz_block_index == ncz_blocks.size(), Result_NszMissingBlocks);
+                            }
+                        } else if (use_block) {
                             const auto flush_block = [&]() -> Result {
                                 R_UNLESS(ncz_block_index <= ncz_blocks.size(), Result_NszTooManyBlocks);
-                                ncz_block_out_buffer.resize(ncz_block_in_buffer.size());
-                                const auto result = ZSTD_compress2(cctx, ncz_block_out_buffer.data(), ncz_block_out_buffer.size(), ncz_block_in_buffer.data(), ncz_block_in_buffer.size());
+                                const auto result = ZSTD_compress2(cctx, ncz_block_out_buffer.data(), ncz_block_in_size, ncz_block_in_buffer.data(), ncz_block_in_size);
 
                                 // check if we got an error, ignoring if the dst buffer was too small.
                                 const auto error_code = ZSTD_getErrorCode(result);
@@ -250,29 +404,27 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
 
                                 // use src buffer instead if zstd failed to compress.
                                 auto output = std::span{ncz_block_out_buffer.data(), result};
-                                if (error_code == ZSTD_error_dstSize_tooSmall || result >= ncz_block_in_buffer.size()) {
-                                    output = ncz_block_in_buffer;
+                                if (error_code == ZSTD_error_dstSize_tooSmall || result >= ncz_block_in_size) {
+                                    output = std::span{ncz_block_in_buffer.data(), ncz_block_in_size};
                                 }
 
                                 // write block data, advance the block index.
                                 R_TRY(callback(output.data(), output.size()));
                                 ncz_blocks[ncz_block_index++].size = output.size();
 
-                                ncz_block_in_buffer.resize(0);
+                                ncz_block_in_size = 0;
                                 R_SUCCEED();
                             };
 
                             const auto last_chunk = off + size >= size_remaining;
 
                             while (size) {
-                                const auto block_off = ncz_block_in_buffer.size();
-                                const auto rsize = std::min<s64>(size, blockSize - block_off);
-
-                                ncz_block_in_buffer.resize(block_off + rsize);
-                                std::memcpy(ncz_block_in_buffer.data() + block_off, data, rsize);
+                                const auto rsize = std::min<s64>(size, blockSize - ncz_block_in_size);
+                                std::memcpy(ncz_block_in_buffer.data() + ncz_block_in_size, data, rsize);
+                                ncz_block_in_size += rsize;
 
                                 // check if we've filled the block.
-                                if (ncz_block_in_buffer.size() == blockSize) {
+                                if (ncz_block_in_size == blockSize) {
                                     // log_write("\t\t[NSZ] flushing block\n");
                                     R_TRY(flush_block());
                                 }
@@ -284,8 +436,8 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
 
                             // flush last block.
                             if (last_chunk) {
-                                if (!ncz_block_in_buffer.empty()) {
-                                    log_write("\t\t[NSZ] flushing block end: %zu\n", ncz_block_in_buffer.size());
+                                if (ncz_block_in_size) {
+                                    log_write("\t\t[NSZ] flushing block end: %zu\n", ncz_block_in_size);
                                     R_TRY(flush_block());
                                 }
 
@@ -0,0 +1,273 @@
+#include "utils/thumb_cache.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+namespace sphaira::utils {
+namespace {
+
+constexpr fs::FsPath CACHE_PATH{"/switch/sphaira/cache/thumbs"};
+constexpr u32 MAGIC = 0x4D485453; // STHM
+constexpr u32 VERSION = 2;
+constexpr u32 BPP = 4;
+
+constexpr u64 GetIndexOffset() {
+    return 0x20;
+}
+
+// the data is aligned so that it starts on a cluster.
+constexpr u64 GetDataOffset() {
+    return (GetIndexOffset() + ThumbCache::MAX_ENTRIES * 0x20 + 0xFFF) & ~0xFFFULL;
+}
+
+} // namespace
+
+ThumbCache::ThumbCache(const char* name) {
+    mutexInit(&m_mutex);
+    std::snprintf(m_path, sizeof(m_path), "%s/%s.bin", CACHE_PATH.s, name);
+}
+
+auto ThumbCache::Load(u64 key, u64 stamp, const LoadCallback& func) -> ImageResult {
+    ImageResult image{};
+    if (Get(key, stamp, image)) {
+        return image;
+    }
+
+    image = func();
+    if (image.data.empty()) {
+        return image;
+    }
+
+    if (image.w > THUMB_SIZE || image.h > THUMB_SIZE) {
+        // keep the aspect ratio.
+        const auto scale = std::min<float>(float(THUMB_SIZE) / image.w, float(THUMB_SIZE) / image.h);
+        const auto w = std::max(1, int(image.w * scale));
+        const auto h = std::max(1, int(image.h * scale));
+
+        auto resized = ImageResize(image.data, image.w, image.h, w, h);
+        if (resized.data.empty()) {
+            return image;
+        }
+
+        image = std::move(resized);
+    }
+
+    Put(key, stamp, image);
+    return image;
+}
+
+void ThumbCache::Remove(const char* name) {
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/%s.bin", CACHE_PATH.s, name);
+
+    fs::FsNativeSd fs;
+    if (fs.FileExists(path)) {
+        log_write("[THUMB] removing: %s\n", path.s);
+        fs.DeleteFile(path);
+    }
+}
+
+auto ThumbCache::Hash(std::span<const u8> data) -> u64 {
+    return (u64(crc32Calculate(data.data(), data.size())) << 32) | u32(data.size());
+}
+
+auto ThumbCache::Hash(std::string_view str) -> u64 {
+    return Hash(std::span{(const u8*)str.data(), str.size()});
+}
+
+bool ThumbCache::Open() {
+    if (m_tried_open) {
+        return m_open;
+    }
+    m_tried_open = true;
+
+    m_entries.resize(MAX_ENTRIES);
+
+    if (R_SUCCEEDED(m_fs.OpenFile(m_path, FsOpenMode_Read | FsOpenMode_Write | FsOpenMode_Append, &m_file))) {
+        u64 bytes_read;
+        if (R_SUCCEEDED(m_file.Read(0, &m_header, sizeof(m_header), 0, &bytes_read)) && bytes_read == sizeof(m_header) &&
+            m_header.magic == MAGIC && m_header.version == VERSION && m_header.thumb_size == THUMB_SIZE && m_header.max_entries == MAX_ENTRIES &&
+            m_header.next_slot < MAX_ENTRIES && m_header.data_end <= MAX_DATA_SIZE &&
+            R_SUCCEEDED(m_file.Read(GetIndexOffset(), m_entries.data(), m_entries.size() * sizeof(Entry), 0, &bytes_read)) && bytes_read == m_entries.size() * sizeof(Entry)) {
+
+            for (u32 i = 0; i < m_entries.size(); i++) {
+                if (!IsValidEntry(m_entries[i])) {
+                    m_entries[i] = {};
+                } else if (m_entries[i].size) {
+                    m_lookup[m_entries[i].key] = i;
+                }
+            }
+
+            log_write("[THUMB] loaded: %s entries: %zu\n", m_path.s, m_lookup.size());
+            m_open = true;
+            return true;
+        }
+
+        m_file.Close();
+    }
+
+    m_open = Create();
+    return m_open;
+}
+
+bool ThumbCache::Create() {
+    log_write("[THUMB] creating: %s\n", m_path.s);
+
+    m_lookup.clear();
+    std::ranges::fill(m_entries, Entry{});
+    m_header = {};
+    m_header.magic = MAGIC;
+    m_header.version = VERSION;
+    m_header.thumb_size = THUMB_SIZE;
+    m_header.max_entries = MAX_ENTRIES;
+
+    m_fs.CreateDirectoryRecursively(CACHE_PATH);
+    m_fs.DeleteFile(m_path);
+    if (R_FAILED(m_fs.CreateFile(m_path)) ||
+        R_FAILED(m_fs.OpenFile(m_path, FsOpenMode_Read | FsOpenMode_Write | FsOpenMode_Append, &m_file)) ||
+        R_FAILED(m_file.Write(0, &m_header, sizeof(m_header), FsWriteOption_None)) ||
+        R_FAILED(m_file.Write(GetIndexOffset(), m_entries.data(), m_entries.size() * sizeof(Entry), FsWriteOption_None))) {
+        log_write("[THUMB] failed to create: %s\n", m_path.s);
+        m_file.Close();
+        return false;
+    }
+
+    return true;
+}
+
+bool ThumbCache::Get(u64 key, u64 stamp, ImageResult& out) {
+    std::vector<u8> data;
+
+    {
+        SCOPED_MUTEX(&m_mutex);
+
+        if (!Open()) {
+            return false;
+        }
+
+        const auto it = m_lookup.find(key);
+        if (it == m_lookup.end()) {
+            return false;
+        }
+
+        const auto& e = m_entries[it->second];
+        if (e.stamp != stamp) {
+            return false;
+        }
+
+        // the read is done with the lock held so that the data can't be replaced whilst reading.
+        out.w = e.w;
+        out.h = e.h;
+        data.resize(e.size);
+
+        u64 bytes_read;
+        if (R_FAILED(m_file.Read(GetDataOffset() + e.offset, data.data(), data.size(), 0, &bytes_read)) || bytes_read != data.size()) {
+            log_write("[THUMB] failed to read slot: %u\n", it->second);
+            out = {};
+            return false;
+        }
+    }
+
+    const auto w = out.w, h = out.h;
+    out = ImageLoadFromMemory(data, ImageFlag_JPEG);
+    if (out.data.empty() || out.w != w || out.h != h) {
+        log_write("[THUMB] failed to decode: %d x %d\n", out.w, out.h);
+        out = {};
+        return false;
+    }
+
+    return true;
+}
+
+void ThumbCache::Put(u64 key, u64 stamp, const ImageResult& image) {
+    if (image.w > THUMB_SIZE || image.h > THUMB_SIZE || image.data.size() != u64(image.w) * image.h * BPP) {
+        return;
+    }
+
+    const auto data = ImageConvertToJpg(image.data, image.w, image.h).data;
+    if (data.empty() || data.size() > MAX_DATA_SIZE) {
+        return;
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+
+    if (!Open()) {
+        return;
+    }
+
+    u32 slot;
+    if (const auto it = m_lookup.find(key); it != m_lookup.end()) {
+        slot = it->second;
+    } else {
+        slot = m_header.next_slot;
+        m_header.next_slot = (m_header.next_slot + 1) % MAX_ENTRIES;
+
+        // replace the oldest entry.
+        if (m_entries[slot].size) {
+            m_lookup.erase(m_entries[slot].key);
+        }
+        m_lookup[key] = slot;
+    }
+
+    // clear the entry first, so that a partial write is never treated as valid.
+    auto& e = m_entries[slot];
+    e = {};
+
+    Result rc;
+    if (R_FAILED(rc = WriteEntry(slot))) {
+        log_write("[THUMB] failed to write entry: %u 0x%X\n", slot, rc);
+        m_lookup.erase(key);
+        return;
+    }
+
+    // start from the beginning once the end is reached.
+    if (m_header.data_end + data.size() > MAX_DATA_SIZE) {
+        m_header.data_end = 0;
+    }
+
+    const auto offset = m_header.data_end;
+    m_header.data_end += data.size();
+
+    // entries whose data is about to be written over are removed.
+    for (u32 i = 0; i < m_entries.size(); i++) {
+        auto& old = m_entries[i];
+        if (old.size && old.offset < offset + data.size() && offset < old.offset + old.size) {
+            m_lookup.erase(old.key);
+            old = {};
+            if (R_FAILED(rc = WriteEntry(i))) {
+                log_write("[THUMB] failed to write entry: %u 0x%X\n", i, rc);
+                m_lookup.erase(key);
+                return;
+            }
+        }
+    }
+
+    if (R_FAILED(rc = m_file.Write(GetDataOffset() + offset, data.data(), data.size(), FsWriteOption_None))) {
+        log_write("[THUMB] failed to write slot: %u 0x%X\n", slot, rc);
+        m_lookup.erase(key);
+        return;
+    }
+
+    e.key = key;
+    e.stamp = stamp;
+    e.w = image.w;
+    e.h = image.h;
+    e.size = data.size();
+    e.offset = offset;
+
+    if (R_FAILED(rc = WriteEntry(slot)) || R_FAILED(rc = m_file.Write(0, &m_header, sizeof(m_header), FsWriteOption_None))) {
+        log_write("[THUMB] failed to write entry: %u 0x%X\n", slot, rc);
+    }
+}
+
+Result ThumbCache::WriteEntry(u32 slot) {
+    return m_file.Write(GetIndexOffset() + slot * sizeof(Entry), &m_entries[slot], sizeof(Entry), FsWriteOption_None);
+}
+
+bool ThumbCache::IsValidEntry(const Entry& e) const {
+    return e.w <= THUMB_SIZE && e.h <= THUMB_SIZE && e.offset <= MAX_DATA_SIZE && e.size <= MAX_DATA_SIZE - e.offset;
+}
+
+} // namespace sphaira::utils
@@ -1,26 +1,40 @@
 #include "yati/nx/ncz.hpp"
 
+#include "utils/thread.hpp"
 #include "defines.hpp"
 #include "log.hpp"
 
 #include <cstring>
+#include <algorithm>
 
 namespace sphaira::ncz {
+namespace {
 
-NczBlockReader::NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source)
+// how far ahead of the reader blocks are decompressed once reads are sequential.
+constexpr u64 NCZ_READAHEAD_SIZE = 1024*1024*4;
+// number of sequential blocks read before readahead starts.
+constexpr u32 NCZ_READAHEAD_TRIGGER = 2;
+
+} // namespace
+
+NczBlockReader::NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source, u64 cache_size)
 : m_header{header}
 , m_sections{sections}
 , m_block_header{block_header}
 , m_blocks{blocks}
 , m_block_offset{offset}
 , m_source{source} {
+    mutexInit(std::addressof(m_mutex));
+    mutexInit(std::addressof(m_source_mutex));
+    condvarInit(std::addressof(m_can_read));
+    condvarInit(std::addressof(m_can_prefetch));
+
     // calculate the block size.
     m_block_size = 1UL << m_block_header.block_size_exponent;
 
     // setup lru block cache.
-    // this isn't needed in sphaira as i am usually reading in 4mb chunks.
-    const auto max_lru_total_size = 1024*1024*32;
-    const auto lru_count = std::max<s64>(1, max_lru_total_size / m_block_size);
+    cache_size = std::clamp(cache_size, NCZ_BLOCK_CACHE_SIZE_MIN, NCZ_BLOCK_CACHE_SIZE_MAX);
+    const auto lru_count = std::max<s64>(1, cache_size / m_block_size);
     m_lru_data.resize(lru_count);
     m_lru.Init(m_lru_data);
 
@@ -30,6 +44,197 @@ NczBlockReader::NczBlockReader(const Header& header, const Sections& sections, c
         m_block_infos.emplace_back(block_offset, block.size);
         block_offset += block.size;
     }
+
+    m_block_slots.resize(m_block_infos.size(), -1);
+    m_dctx = ZSTD_createDCtx();
+
+    // keep at least half of the cache for blocks that have already been read.
+    m_prefetch_max = std::min<u64>(std::max<u64>(1, NCZ_READAHEAD_SIZE / m_block_size), lru_count / 2);
+    if (m_prefetch_max) {
+        if (R_SUCCEEDED(utils::CreateThread(std::addressof(m_prefetch_thread), PrefetchFunc, this, 1024*32))) {
+            if (R_SUCCEEDED(threadStart(std::addressof(m_prefetch_thread)))) {
+                m_prefetch_running = true;
+            } else {
+                threadClose(std::addressof(m_prefetch_thread));
+            }
+        }
+    }
+
+    log_write("[NCZ] block cache: %zu blocks, readahead: %zu blocks\n", lru_count, m_prefetch_running ? m_prefetch_max : 0);
+}
+
+NczBlockReader::~NczBlockReader() {
+    if (m_prefetch_running) {
+        {
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            m_quit = true;
+            condvarWakeAll(std::addressof(m_can_prefetch));
+        }
+
+        threadWaitForExit(std::addressof(m_prefetch_thread));
+        threadClose(std::addressof(m_prefetch_thread));
+    }
+
+    // prefetched blocks that are still in the cache were never used.
+    for (const auto& e : m_lru_data) {
+        if (e.prefetched) {
+            m_stats.prefetch_wasted++;
+        }
+    }
+
+    log_write("[NCZ] block cache hits: %zu misses: %zu prefetched: %zu wasted: %zu\n", m_stats.hits, m_stats.misses, m_stats.prefetched, m_stats.prefetch_wasted);
+    ZSTD_freeDCtx(m_dctx);
+}
+
+auto NczBlockReader::GetStats() -> Stats {
+    SCOPED_MUTEX(std::addressof(m_mutex));
+    return m_stats;
+}
+
+Result NczBlockReader::LoadBlock(ZSTD_DCtx* dctx, u64 block_id, std::vector<u8>& out) {
+    const auto& block = m_block_infos[block_id];
+
+    // read entire block.
+    std::vector<u8> temp(block.size);
+    {
+        SCOPED_MUTEX(std::addressof(m_source_mutex));
+        R_TRY(m_source->Read2(temp.data(), block.offset, temp.size()));
+    }
+
+    // https://github.com/nicoboss/nsz/issues/79
+    auto decompressedBlockSize = m_block_size;
+    // special handling for the last block to check it's actually compressed
+    if (block_id == m_block_infos.size() - 1) {
+        log_write("[NCZ] last block special handling\n");
+        // https://github.com/nicoboss/nsz/issues/210
+        const auto remainder = m_block_header.decompressed_size % decompressedBlockSize;
+        if (remainder) {
+            decompressedBlockSize = remainder;
+        }
+    }
+
+    // check if this block is compressed.
+    const auto compressed = block.size < decompressedBlockSize;
+
+    if (compressed) {
+        R_UNLESS(dctx, Result_YatiInvalidNczZstdError);
+
+        // decompress block.
+        out.resize(decompressedBlockSize);
+        const auto res = ZSTD_decompressDCtx(dctx, out.data(), out.size(), temp.data(), temp.size());
+
+        // the output should be exactly the size of the block.
+        R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
+        R_UNLESS(res == decompressedBlockSize, 3);
+    } else {
+        // saves a copy by swapping the vector.
+        std::swap(out, temp);
+    }
+
+    R_SUCCEED();
+}
+
+auto NczBlockReader::AcquireSlot(u64 block_id) -> LruData* {
+    // find the oldest entry that isn't being loaded.
+    auto entry = m_lru.end();
+    while (entry && entry->data->loading) {
+        entry = entry->prev;
+    }
+
+    if (!entry) {
+        return nullptr;
+    }
+
+    m_lru.Update(entry);
+    auto lru_data = entry->data;
+
+    // evict the old block.
+    if (lru_data->block_id >= 0) {
+        m_block_slots[lru_data->block_id] = -1;
+        if (lru_data->prefetched) {
+            m_stats.prefetch_wasted++;
+        }
+    }
+
+    lru_data->block_id = block_id;
+    lru_data->loading = true;
+    lru_data->prefetched = false;
+    m_block_slots[block_id] = lru_data - m_lru_data.data();
+    return lru_data;
+}
+
+void NczBlockReader::UpdateReadahead(u64 block_id) {
+    if (!m_prefetch_running || (s64)block_id == m_last_block_id) {
+        return;
+    }
+
+    if ((s64)block_id == m_last_block_id + 1) {
+        m_sequential_count++;
+    } else {
+        m_sequential_count = 0;
+    }
+    m_last_block_id = block_id;
+
+    // wait for a couple of sequential blocks so that a single large random read doesn't trigger it.
+    if (m_sequential_count >= NCZ_READAHEAD_TRIGGER) {
+        // start after the reader, skipping what has already been queued.
+        m_prefetch_next = std::max<u64>(m_prefetch_next, block_id + 1);
+        m_prefetch_end = std::min<u64>(block_id + 1 + m_prefetch_max, m_block_infos.size());
+        if (m_prefetch_next < m_prefetch_end) {
+            condvarWakeOne(std::addressof(m_can_prefetch));
+        }
+    } else {
+        // random access, cancel any pending prefetch.
+        m_prefetch_next = m_prefetch_end = 0;
+    }
+}
+
+void NczBlockReader::PrefetchFunc(void* arg) {
+    static_cast<NczBlockReader*>(arg)->PrefetchFuncInternal();
+}
+
+void NczBlockReader::PrefetchFuncInternal() {
+    auto dctx = ZSTD_createDCtx();
+    ON_SCOPE_EXIT(ZSTD_freeDCtx(dctx));
+
+    SCOPED_MUTEX(std::addressof(m_mutex));
+
+    for (;;) {
+        while (!m_quit && m_prefetch_next >= m_prefetch_end) {
+            condvarWait(std::addressof(m_can_prefetch), std::addressof(m_mutex));
+        }
+
+        if (m_quit) {
+            break;
+        }
+
+        const auto block_id = m_prefetch_next++;
+        if (m_block_slots[block_id] >= 0) {
+            continue;
+        }
+
+        auto lru_data = AcquireSlot(block_id);
+        if (!lru_data) {
+            continue;
+        }
+
+        // decompress without holding the lock so the reader can use the cache.
+        mutexUnlock(std::addressof(m_mutex));
+        const auto rc = LoadBlock(dctx, block_id, lru_data->data);
+        mutexLock(std::addressof(m_mutex));
+
+        lru_data->loading = false;
+        if (R_FAILED(rc)) {
+            // leave it for the reader to retry and report the error.
+            m_block_slots[block_id] = -1;
+            lru_data->block_id = -1;
+        } else {
+            lru_data->prefetched = true;
+            m_stats.prefetched++;
+        }
+
+        condvarWakeAll(std::addressof(m_can_read));
+    }
 }
 
 Result NczBlockReader::Read(void *_buf, s64 off, s64 size, u64* bytes_read_out) {
@@ -40,58 +245,47 @@ Result NczBlockReader::Read(void *_buf, s64 off, s64 size, u64* bytes_read_out)
     R_UNLESS(off >= NCZ_NORMAL_SIZE, 6);
     off -= NCZ_NORMAL_SIZE;
 
+    SCOPED_MUTEX(std::addressof(m_mutex));
+
     while (size) {
-        // see if we have a cached block.
+        // get block id and ensure we are in bounds.
+        const auto block_id = off / m_block_size;
+        R_UNLESS(block_id < m_block_infos.size(), Result_YatiInvalidNczBlockTotal);
+        UpdateReadahead(block_id);
+
+        // see if we have a cached block, waiting if it's still being prefetched.
         LruData* lru_data{};
-        for (auto list = m_lru.begin(); list; list = list->next) {
-            if (list->data->InRange(off)) {
-                lru_data = list->data;
-                m_lru.Update(list);
+        while (m_block_slots[block_id] >= 0) {
+            lru_data = std::addressof(m_lru_data[m_block_slots[block_id]]);
+            if (!lru_data->loading) {
                 break;
             }
-        }
 
-        // otherwise, read new block.
-        if (!lru_data) {
-            // get block id and ensure we are in bounds.
-            const auto block_id = off / m_block_size;
-            R_UNLESS(block_id < m_block_infos.size(), Result_YatiInvalidNczBlockTotal);
-            const auto& block = m_block_infos[block_id];
-
-            // read entire block.
-            std::vector<u8> temp(block.size);
-            R_TRY(m_source->Read2(temp.data(), block.offset, temp.size()));
-
-            // https://github.com/nicoboss/nsz/issues/79
-            auto decompressedBlockSize = m_block_size;
-            // special handling for the last block to check it's actually compressed
-            if (block_id == m_block_infos.size() - 1) {
-                log_write("[NCZ] last block special handling\n");
-                // https://github.com/nicoboss/nsz/issues/210
-                const auto remainder = m_block_header.decompressed_size % decompressedBlockSize;
-                if (remainder) {
-                    decompressedBlockSize = remainder;
-                }
-            }
+            lru_data = nullptr;
+            condvarWait(std::addressof(m_can_read), std::addressof(m_mutex));
+        }
 
-            // new block.
-            lru_data = m_lru.GetNextFree();
-            lru_data->offset = block.offset;
+        if (lru_data) {
+            m_stats.hits++;
+            lru_data->prefetched = false;
+            m_lru.Update(m_lru.GetEntry(m_block_slots[block_id]));
+        } else {
+            // otherwise, read new block.
+            m_stats.misses++;
+            lru_data = AcquireSlot(block_id);
+            R_UNLESS(lru_data, Result_YatiInvalidNczBlockTotal);
 
-            // check if this block is compressed.
-            const auto compressed = block.size < decompressedBlockSize;
+            mutexUnlock(std::addressof(m_mutex));
+            const auto rc = LoadBlock(m_dctx, block_id, lru_data->data);
+            mutexLock(std::addressof(m_mutex));
 
-            if (compressed) {
-                // decompress block.
-                lru_data->data.resize(decompressedBlockSize);
-                const auto res = ZSTD_decompress(lru_data->data.data(), lru_data->data.size(), temp.data(), temp.size());
+            lru_data->loading = false;
+            condvarWakeAll(std::addressof(m_can_read));
 
-                // the output should be exactly the size of the block.
-                R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
-                R_UNLESS(res == decompressedBlockSize, 3);
-            } else {
-                // saves a copy by swapping the vector.
-                std::swap(lru_data->data, temp);
+            if (R_FAILED(rc)) {
+                m_block_slots[block_id] = -1;
+                lru_data->block_id = -1;
+                R_THROW(rc);
             }
         }
 
@@ -14,6 +14,9 @@
 
 #include "utils/utils.hpp"
 #include "utils/thread.hpp"
+#include "utils/spsc_ring.hpp"
+#include "utils/ordered_worker_pool.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include "ui/progress_box.hpp"
 #include "ui/menus/game_menu.hpp"
@@ -26,6 +29,8 @@
 #include <minIni.h>
 #include <algorithm>
 #include <atomic>
+#include <array>
+#include <optional>
 
 namespace sphaira::yati {
 namespace {
@@ -79,73 +84,125 @@ struct TikCollection {
     bool patched{};
 };
 
-struct Yati;
-
-const u64 INFLATE_BUFFER_MAX = 1024*1024*4;
-
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(INFLATE_BUFFER_MAX);
-    }
+// hash state of the data written to a placeholder, up to offset.
+struct Checkpoint {
+    s64 offset{};
+    Sha256Context sha256{};
+    // not set for ncz, as decompressing can't continue mid stream.
+    bool valid{};
+};
 
-    std::vector<u8> buf;
-    s64 off;
+// placeholder kept from a failed install, so that the install can continue
+// from the checkpoint rather than starting again.
+struct ResumeEntry {
+    NcmContentId content_id{};
+    NcmStorageId storage_id{};
+    NcmPlaceHolderId placeholder_id{};
+    s64 size{};
+    Checkpoint checkpoint{};
 };
 
-template<std::size_t Size>
-struct RingBuf {
-private:
-    ThreadBuffer buf[Size]{};
-    unsigned r_index{};
-    unsigned w_index{};
+Mutex g_resume_mutex{};
+std::vector<ResumeEntry> g_resume_entries{};
 
-    static_assert((sizeof(RingBuf::buf) & (sizeof(RingBuf::buf) - 1)) == 0, "Must be power of 2!");
+void SaveResumeEntry(const ResumeEntry& entry) {
+    SCOPED_MUTEX(&g_resume_mutex);
+    log_write("[YATI] saving resume entry: %s offset: %zd\n", utils::hexIdToStr(entry.content_id).str, entry.checkpoint.offset);
+    g_resume_entries.emplace_back(entry);
+}
 
-public:
-    void ringbuf_reset() {
-        this->r_index = this->w_index;
-    }
+// removes and returns the entry matching the nca, if any.
+auto TakeResumeEntry(const NcmContentId& content_id, NcmStorageId storage_id, s64 size) -> std::optional<ResumeEntry> {
+    SCOPED_MUTEX(&g_resume_mutex);
+    const auto it = std::ranges::find_if(g_resume_entries, [&](auto& e){
+        return !std::memcmp(&e.content_id, &content_id, sizeof(content_id)) && e.storage_id == storage_id && e.size == size;
+    });
 
-    unsigned ringbuf_capacity() const {
-        return sizeof(this->buf) / sizeof(this->buf[0]);
+    if (it == g_resume_entries.end()) {
+        return std::nullopt;
     }
 
-    unsigned ringbuf_size() const {
-        return (this->w_index - this->r_index) % (ringbuf_capacity() * 2U);
-    }
+    const auto entry = *it;
+    g_resume_entries.erase(it);
+    return entry;
+}
 
-    unsigned ringbuf_free() const {
-        return ringbuf_capacity() - ringbuf_size();
-    }
+auto HasResumeEntry(const NcmPlaceHolderId& placeholder_id) -> bool {
+    SCOPED_MUTEX(&g_resume_mutex);
+    return std::ranges::any_of(g_resume_entries, [&](auto& e){
+        return !std::memcmp(&e.placeholder_id, &placeholder_id, sizeof(placeholder_id));
+    });
+}
 
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
-        auto& value = this->buf[this->w_index % ringbuf_capacity()];
-        value.off = off_in;
-        std::swap(value.buf, buf_in);
+void RemoveResumeEntry(const NcmPlaceHolderId& placeholder_id) {
+    SCOPED_MUTEX(&g_resume_mutex);
+    std::erase_if(g_resume_entries, [&](auto& e){
+        return !std::memcmp(&e.placeholder_id, &placeholder_id, sizeof(placeholder_id));
+    });
+}
 
-        this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
-    }
+struct Yati;
 
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
-        auto& value = this->buf[this->r_index % ringbuf_capacity()];
-        off_out = value.off;
-        std::swap(value.buf, buf_out);
+const u64 INFLATE_BUFFER_MAX = 1024*1024*4;
+
+// number of buffers in the read / write ring.
+constexpr u32 RING_DEPTH = 4;
+
+// max number of worker threads used to decompress ncz blocks.
+constexpr u32 NCZ_BLOCK_THREADS = 3;
+// blocks larger than this are decompressed using the streaming path,
+// as otherwise every in flight block would need a very large buffer.
+constexpr u64 NCZ_BLOCK_PARALLEL_MAX_SIZE = 1024*1024*4;
+// max decompressed size of all in flight blocks.
+constexpr u64 NCZ_BLOCK_PARALLEL_MAX_INFLIGHT = 1024*1024*16;
+
+// a single ncz block, decompressed by the block pool.
+// the buffers are leased on first use and kept for every block that reuses the slot.
+struct NczBlockJob {
+    // compressed data, swapped with the output if the block is stored.
+    utils::pool::Lease data{};
+    // decompressed data.
+    utils::pool::Lease out{};
+    // size of the data gathered so far.
+    u64 data_size{};
+    // size of the output, set once the job has finished.
+    u64 out_size{};
+    u64 decompressed_size{};
+    bool compressed{};
+};
 
-        this->r_index = (this->r_index + 1U) % (ringbuf_capacity() * 2U);
+// per-thread state for decompressing ncz blocks.
+struct NczBlockWorker {
+    Result Process(NczBlockJob& job) {
+        R_UNLESS(dctx, Result_YatiInvalidNczZstdError);
+
+        if (job.out.size() < job.decompressed_size) {
+            job.out = utils::pool::Acquire(job.decompressed_size);
+            R_UNLESS(job.out, Result_PoolLeaseFailed);
+        }
+
+        const auto res = ZSTD_decompressDCtx(dctx.get(), job.out.data(), job.decompressed_size, job.data.data(), job.data_size);
+        if (ZSTD_isError(res)) {
+            log_write("[NCZ] ZSTD_decompressDCtx() size: %zu res: %zd msg: %s\n", job.data_size, res, ZSTD_getErrorName(res));
+            R_THROW(Result_YatiInvalidNczZstdError);
+        }
+
+        // the output should be exactly the size of the block.
+        R_UNLESS(res == job.decompressed_size, Result_YatiInvalidNczZstdError);
+        job.out_size = res;
+        R_SUCCEED();
     }
+
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx{ZSTD_createDCtx(), ZSTD_freeDCtx};
 };
 
+// decompresses independent ncz blocks on multiple threads.
+// stored blocks are pushed as skipped, so they never reach a worker.
+using NczBlockDecompressor = utils::OrderedWorkerPool<NczBlockJob, NczBlockWorker>;
+
 struct ThreadData {
     ThreadData(Yati* _yati, std::span<TikCollection> _tik, NcaCollection* _nca)
     : yati{_yati}, tik{_tik}, nca{_nca} {
-        mutexInit(std::addressof(read_mutex));
-        mutexInit(std::addressof(write_mutex));
-
-        condvarInit(std::addressof(can_read));
-        condvarInit(std::addressof(can_decompress));
-        condvarInit(std::addressof(can_decompress_write));
-        condvarInit(std::addressof(can_write));
-
         ueventCreate(&m_uevent_done, false);
         ueventCreate(&m_uevent_progres, true);
 
@@ -163,6 +220,12 @@ struct ThreadData {
         max_buffer_size = std::max(read_buffer_size, INFLATE_BUFFER_MAX);
     }
 
+    auto Create() -> Result {
+        R_TRY(read_buffers.Create(RING_DEPTH, max_buffer_size));
+        R_TRY(write_buffers.Create(RING_DEPTH, max_buffer_size));
+        R_SUCCEED();
+    }
+
     auto GetResults() volatile -> Result;
     void WakeAllThreads();
 
@@ -190,9 +253,10 @@ struct ThreadData {
         read_result = result;
 
         // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress));
+        read_buffers.Close();
 
         if (R_FAILED(result)) {
+            WakeAllThreads();
             ueventSignal(GetDoneEvent());
         }
     }
@@ -200,10 +264,12 @@ struct ThreadData {
     void SetDecompressResult(Result result) {
         decompress_result = result;
 
-        // wake up write thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_write));
+        // wake up read and write thread as they may be waiting on a buffer.
+        read_buffers.Close();
+        write_buffers.Close();
 
         if (R_FAILED(result)) {
+            WakeAllThreads();
             ueventSignal(GetDoneEvent());
         }
     }
@@ -211,81 +277,28 @@ struct ThreadData {
     void SetWriteResult(Result result) {
         write_result = result;
 
-        // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress_write));
-
-        ueventSignal(GetDoneEvent());
-    }
-
-    Result Read(void* buf, s64 size, u64* bytes_read);
-
-    Result SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
-        buf.resize(size);
+        // wake up decompress thread as it may be waiting on a buffer.
+        write_buffers.Close();
 
-        mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_free()) {
-            if (!write_running) {
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_read), std::addressof(read_mutex)));
+        if (R_FAILED(result)) {
+            WakeAllThreads();
         }
 
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-        R_TRY(GetResults());
-        read_buffers.ringbuf_push(buf, off);
-        return condvarWakeOne(std::addressof(can_decompress));
+        ueventSignal(GetDoneEvent());
     }
 
-    Result GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out) {
-        mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_size()) {
-            if (!read_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_decompress), std::addressof(read_mutex)));
-        }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-        R_TRY(GetResults());
-        read_buffers.ringbuf_pop(buf_out, off_out);
-        return condvarWakeOne(std::addressof(can_read));
-    }
+    Result Read(void* buf, s64 size, u64* bytes_read);
 
-    Result SetWriteBuf(std::vector<u8>& buf, s64 size, bool skip_verify) {
-        buf.resize(size);
+    // hashes the buffer returned by write_buffers.GetBack() and passes it to the write thread.
+    // if can_resume is set, buf->off must be the offset the buffer is written to.
+    void PushWriteBuf(utils::SpscRing::Buffer* buf, bool skip_verify, bool can_resume) {
         if (!skip_verify) {
-            sha256ContextUpdate(std::addressof(sha256), buf.data(), buf.size());
+            sha256ContextUpdate(std::addressof(sha256), buf->data, buf->size);
         }
 
-        mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_free()) {
-            if (!decompress_running) {
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_decompress_write), std::addressof(write_mutex)));
-        }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
-        R_TRY(GetResults());
-        write_buffers.ringbuf_push(buf, 0);
-        return condvarWakeOne(std::addressof(can_write));
-    }
-
-    Result GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
-        mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_size()) {
-            if (!decompress_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_write), std::addressof(write_mutex)));
-        }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
-        R_TRY(GetResults());
-        write_buffers.ringbuf_pop(buf_out, off_out);
-        return condvarWakeOne(std::addressof(can_decompress_write));
+        // checkpoints are pushed / popped in the same order as the write ring.
+        checkpoints[checkpoint_push++ % RING_DEPTH] = {buf->off + (s64)buf->size, sha256, can_resume};
+        write_buffers.Push();
     }
 
     // these need to be copied
@@ -294,19 +307,11 @@ struct ThreadData {
     NcaCollection* nca{};
 
     // these need to be created
-    Mutex read_mutex{};
-    Mutex write_mutex{};
-
-    CondVar can_read{};
-    CondVar can_decompress{};
-    CondVar can_decompress_write{};
-    CondVar can_write{};
-
     UEvent m_uevent_done{};
     UEvent m_uevent_progres{};
 
-    RingBuf<4> read_buffers{};
-    RingBuf<4> write_buffers{};
+    utils::SpscRing read_buffers{};
+    utils::SpscRing write_buffers{};
 
     ncz::BlockHeader ncz_block_header{};
     std::vector<ncz::Section> ncz_sections{};
@@ -314,6 +319,17 @@ struct ThreadData {
 
     Sha256Context sha256{};
 
+    // set if continuing a previous install, the data before this offset
+    // (other than the nca header) is not read again.
+    s64 resume_offset{};
+    // checkpoint for each buffer in the write ring.
+    std::array<Checkpoint, RING_DEPTH> checkpoints{};
+    u64 checkpoint_push{};
+    u64 checkpoint_pop{};
+    // checkpoint of the last buffer written to the placeholder, only accessed
+    // by the write thread until it has exited.
+    Checkpoint written_checkpoint{};
+
     u64 read_buffer_size{};
     u64 max_buffer_size{};
 
@@ -351,6 +367,8 @@ struct Yati {
     Result ImportTickets(std::span<TikCollection> tickets);
     Result RemoveInstalledNcas(const CnmtCollection& cnmt);
     Result RegisterNcasAndPushRecord(const CnmtCollection& cnmt, u32 latest_version_num);
+    // deletes the placeholder, unless it's being kept to resume the install.
+    void CleanupPlaceHolder(const NcaCollection& nca, bool finished);
 
 
 // private:
@@ -379,13 +397,8 @@ auto ThreadData::GetResults() volatile -> Result {
 }
 
 void ThreadData::WakeAllThreads() {
-    condvarWakeAll(std::addressof(can_read));
-    condvarWakeAll(std::addressof(can_decompress));
-    condvarWakeAll(std::addressof(can_decompress_write));
-    condvarWakeAll(std::addressof(can_write));
-
-    mutexUnlock(std::addressof(read_mutex));
-    mutexUnlock(std::addressof(write_mutex));
+    read_buffers.Close();
+    write_buffers.Close();
 }
 
 Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
@@ -435,14 +448,10 @@ Result HasRequiredTicket(const nca::Header& header, std::span<TikCollection> tik
 Result Yati::readFuncInternal(ThreadData* t) {
     ON_SCOPE_EXIT( t->read_running = false; );
 
-    // the main buffer which data is read into.
-    std::vector<u8> buf;
     // workaround ncz block reading ahead. if block isn't found, we usually
     // would seek back to the offset, however this is not possible in stream
     // mode, so we instead store the data to the temp buffer and pre-pend it.
     std::vector<u8> temp_buf;
-    buf.reserve(t->max_buffer_size);
-    temp_buf.reserve(t->max_buffer_size);
 
     while (t->read_offset < t->nca->size && R_SUCCEEDED(t->GetResults())) {
         const auto buffer_offset = t->read_offset.load();
@@ -453,17 +462,22 @@ Result Yati::readFuncInternal(ThreadData* t) {
             read_size = NCZ_SECTION_OFFSET;
         }
 
+        // read directly into the next free buffer.
+        auto buf = t->read_buffers.GetBack();
+        if (!buf) {
+            break;
+        }
+
         s64 buf_offset = 0;
         if (!temp_buf.empty()) {
-            buf = temp_buf;
+            std::memcpy(buf->data, temp_buf.data(), temp_buf.size());
             read_size -= temp_buf.size();
             buf_offset = temp_buf.size();
             temp_buf.clear();
         }
 
         u64 bytes_read{};
-        buf.resize(buf_offset + read_size);
-        R_TRY(t->Read(buf.data() + buf_offset, read_size, std::addressof(bytes_read)));
+        R_TRY(t->Read(buf->data + buf_offset, read_size, std::addressof(bytes_read)));
         auto buf_size = buf_offset + bytes_read;
         if (!bytes_read) {
             break;
@@ -473,7 +487,7 @@ Result Yati::readFuncInternal(ThreadData* t) {
         if (t->read_offset == NCZ_SECTION_OFFSET) {
             // check for ncz section header.
             ncz::Header header{};
-            std::memcpy(std::addressof(header), buf.data() + 0x4000, sizeof(header));
+            std::memcpy(std::addressof(header), buf->data + 0x4000, sizeof(header));
             if (header.magic == NCZ_SECTION_MAGIC) {
                 // validate section header.
                 R_UNLESS(header.total_sections, Result_YatiInvalidNczSectionCount);
@@ -508,7 +522,17 @@ Result Yati::readFuncInternal(ThreadData* t) {
             }
         }
 
-        R_TRY(t->SetDecompressBuf(buf, buffer_offset, buf_size));
+        buf->off = buffer_offset;
+        buf->size = buf_size;
+        t->read_buffers.Push();
+
+        // skip over the data that's already in the placeholder, the header
+        // is still read as installing depends on it.
+        if (t->read_offset < t->resume_offset) {
+            R_UNLESS(t->ncz_sections.empty(), Result_YatiInvalidResume);
+            log_write("[YATI] resuming read from: %zd\n", t->resume_offset);
+            t->read_offset = t->resume_offset;
+        }
     }
 
     log_write("read success\n");
@@ -528,32 +552,51 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
     const ncz::BlockInfo* ncz_block{};
     bool is_ncz{};
 
-    s64 inflate_offset{};
     Aes128CtrContext ctx{};
-    std::vector<u8> inflate_buf{};
-    inflate_buf.reserve(t->max_buffer_size);
+    // write buffer that ncz data is inflated into, nullptr until needed.
+    utils::SpscRing::Buffer* inflate_buf{};
 
     s64 written{};
     s64 block_offset{};
-    std::vector<u8> buf{};
-    buf.reserve(t->max_buffer_size);
 
-    // encrypts the nca and passes the buffer to the write thread.
-    const auto ncz_flush = [&](s64 size) -> Result {
-        if (!inflate_offset) {
-            R_SUCCEED();
+    // only used for block ncz files, if set, blocks are decompressed in parallel.
+    std::unique_ptr<NczBlockDecompressor> block_pool{};
+    u64 ncz_block_index{};
+
+    // returns the decompressed size of the block.
+    const auto get_block_decompressed_size = [&](const ncz::BlockInfo* block) -> u64 {
+        // https://github.com/nicoboss/nsz/issues/79
+        u64 decompressedBlockSize = 1ULL << t->ncz_block_header.block_size_exponent;
+        // special handling for the last block to check it's actually compressed
+        if (block->offset == t->ncz_blocks.back().offset) {
+            log_write("[NCZ] last block special handling\n");
+            // https://github.com/nicoboss/nsz/issues/210
+            const auto remainder = t->ncz_block_header.decompressed_size % decompressedBlockSize;
+            if (remainder) {
+                decompressedBlockSize = remainder;
+            }
+        }
+
+        return decompressedBlockSize;
+    };
+
+    // waits for a free write buffer, fails if the write thread has exited.
+    const auto get_write_buf = [&](utils::SpscRing::Buffer** out) -> Result {
+        *out = t->write_buffers.GetBack();
+        if (!*out) {
+            R_TRY(t->GetResults());
+            R_THROW(Result_TransferCancelled);
         }
+        R_SUCCEED();
+    };
 
-        // if we are not moving the whole vector, then we need to keep
-        // the remaining data.
-        // rather that copying the entire vector to the write thread,
-        // only copy (store) the remaining amount.
-        std::vector<u8> temp_vector{};
-        if (size < inflate_offset) {
-            temp_vector.resize(inflate_offset - size);
-            std::memcpy(temp_vector.data(), inflate_buf.data() + size, temp_vector.size());
+    // encrypts the nca and passes the buffer to the write thread.
+    const auto ncz_flush = [&]() -> Result {
+        if (!inflate_buf || !inflate_buf->size) {
+            R_SUCCEED();
         }
 
+        const s64 size = inflate_buf->size;
         for (s64 off = 0; off < size;) {
             if (!ncz_section || !ncz_section->InRange(written)) {
                 log_write("[NCZ] looking for new section: %zu off: %zu size: %zu\n", written, off, size);
@@ -579,36 +622,92 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
             const auto chunk_size = std::min<u64>(total_size - written, size - off);
 
             if (ncz_section->crypto_type >= nca::EncryptionType_AesCtr) {
-                aes128CtrCrypt(&ctx, inflate_buf.data() + off, inflate_buf.data() + off, chunk_size);
+                aes128CtrCrypt(&ctx, inflate_buf->data + off, inflate_buf->data + off, chunk_size);
             }
 
             written += chunk_size;
             off += chunk_size;
         }
 
-        R_TRY(t->SetWriteBuf(inflate_buf, size, config.skip_nca_hash_verify));
-        inflate_offset -= size;
+        t->PushWriteBuf(inflate_buf, config.skip_nca_hash_verify, false);
+        inflate_buf = nullptr;
+        R_SUCCEED();
+    };
 
-        // restore remaining data to the swapped buffer.
-        if (!temp_vector.empty()) {
-            log_write("[NCZ] storing data size: %zu\n", temp_vector.size());
-            inflate_buf = temp_vector;
+    // returns the free space in the inflate buffer, waiting for a buffer if needed.
+    const auto ncz_inflate_reserve = [&](std::span<u8>& out) -> Result {
+        if (!inflate_buf) {
+            R_TRY(get_write_buf(std::addressof(inflate_buf)));
         }
 
+        out = std::span{inflate_buf->data + inflate_buf->size, inflate_buf->capacity - inflate_buf->size};
         R_SUCCEED();
     };
 
+    // marks size bytes of the reserved space as used, flushing the buffer once full.
+    const auto ncz_inflate_commit = [&](u64 size) -> Result {
+        t->decompress_offset += size;
+        inflate_buf->size += size;
+        if (inflate_buf->size == inflate_buf->capacity) {
+            R_TRY(ncz_flush());
+        }
+        R_SUCCEED();
+    };
+
+    // copies data into the inflate buffer.
+    const auto ncz_inflate_copy = [&](const u8* data, u64 size) -> Result {
+        while (size) {
+            std::span<u8> out;
+            R_TRY(ncz_inflate_reserve(out));
+
+            const auto rsize = std::min<u64>(size, out.size());
+            std::memcpy(out.data(), data, rsize);
+            R_TRY(ncz_inflate_commit(rsize));
+
+            data += rsize;
+            size -= rsize;
+        }
+        R_SUCCEED();
+    };
+
+    // waits for the oldest block to decompress and passes it to the inflate buffer.
+    const auto ncz_block_pop = [&]() -> Result {
+        NczBlockJob* job{};
+        R_TRY(block_pool->WaitFront(std::addressof(job)));
+        ON_SCOPE_EXIT(block_pool->Pop());
+
+        return ncz_inflate_copy(job->out.data(), job->out_size);
+    };
+
     while (t->decompress_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
-        s64 decompress_buf_off{};
-        R_TRY(t->GetDecompressBuf(buf, decompress_buf_off));
-        if (buf.empty()) {
+        auto buf = t->read_buffers.GetFront();
+        if (!buf) {
             break;
         }
 
+        ON_SCOPE_EXIT(t->read_buffers.Pop());
+        s64 decompress_buf_off = buf->off;
+
         // do we have an nsz? if so, setup buffers.
         if (!is_ncz && !t->ncz_sections.empty()) {
             log_write("YES IT FOUND NCZ\n");
             is_ncz = true;
+
+            // blocks are independent, so they can be decompressed in parallel.
+            // solid ncz (or huge blocks) use the streaming path below.
+            if (!t->ncz_blocks.empty()) {
+                const auto block_size = 1ULL << t->ncz_block_header.block_size_exponent;
+                if (block_size <= NCZ_BLOCK_PARALLEL_MAX_SIZE) {
+                    const auto depth = std::clamp<u64>(NCZ_BLOCK_PARALLEL_MAX_INFLIGHT / block_size, NCZ_BLOCK_THREADS, NCZ_BLOCK_THREADS * 4);
+                    block_pool = std::make_unique<NczBlockDecompressor>();
+                    const auto workers = block_pool->Create(NCZ_BLOCK_THREADS, depth);
+                    log_write("[NCZ] created %u block workers, depth: %zu\n", workers, depth);
+                    if (!workers) {
+                        log_write("[NCZ] failed to create block workers, using streaming\n");
+                        block_pool.reset();
+                    }
+                }
+            }
         }
 
         // if we don't have a ncz or it's before the ncz header, pass buffer directly to write
@@ -619,7 +718,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
 
                 log_write("verifying nca header magic\n");
                 nca::Header header{};
-                R_TRY(nca::DecryptHeader(buf.data(), keys, header));
+                R_TRY(nca::DecryptHeader(buf->data, keys, header));
                 log_write("nca magic is ok! type: %u\n", header.content_type);
 
                 // store the unmodified header.
@@ -671,17 +770,88 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
 
                 if (t->nca->modified) {
-                    crypto::cryptoAes128Xts(std::addressof(header), buf.data(), keys.header_key, 0, 0x200, sizeof(header), true);
+                    crypto::cryptoAes128Xts(std::addressof(header), buf->data, keys.header_key, 0, 0x200, sizeof(header), true);
+                }
+
+                // the header has already been written and hashed.
+                if (t->resume_offset) {
+                    R_UNLESS(t->ncz_sections.empty(), Result_YatiInvalidResume);
+                    t->decompress_offset = t->resume_offset;
+                    continue;
                 }
             }
 
-            written += buf.size();
-            t->decompress_offset += buf.size();
-            R_TRY(t->SetWriteBuf(buf, buf.size(), config.skip_nca_hash_verify));
+            written += buf->size;
+            t->decompress_offset += buf->size;
+
+            // pass the buffer to the write thread without copying.
+            utils::SpscRing::Buffer* out;
+            R_TRY(get_write_buf(std::addressof(out)));
+            utils::SpscRing::SwapData(buf, out);
+            t->PushWriteBuf(out, config.skip_nca_hash_verify, true);
+        } else if (block_pool) {
+            u64 buf_off{};
+            while (buf_off < buf->size) {
+                R_TRY(t->GetResults());
+
+                // blocks are stored in order, so the next block is always the next index.
+                if (!ncz_block || !ncz_block->InRange(decompress_buf_off)) {
+                    R_UNLESS(ncz_block_index < t->ncz_blocks.size(), Result_YatiNczBlockNotFound);
+                    ncz_block = std::addressof(t->ncz_blocks[ncz_block_index++]);
+                    R_UNLESS(ncz_block->InRange(decompress_buf_off), Result_YatiNczBlockNotFound);
+                    block_offset = 0;
+
+                    // wait for a free slot, this passes finished blocks to the write thread.
+                    while (block_pool->IsFull()) {
+                        R_TRY(ncz_block_pop());
+                    }
+
+                    auto& job = block_pool->GetBack();
+                    job.decompressed_size = get_block_decompressed_size(ncz_block);
+                    // check if this block is compressed.
+                    job.compressed = ncz_block->size < job.decompressed_size;
+                    job.data_size = 0;
+
+                    if (job.data.size() < ncz_block->size) {
+                        job.data = utils::pool::Acquire(ncz_block->size);
+                        R_UNLESS(job.data, Result_PoolLeaseFailed);
+                    }
+                }
+
+                // gather the block as it may span multiple read buffers.
+                auto& job = block_pool->GetBack();
+                const auto size = std::min<u64>(buf->size - buf_off, ncz_block->size - block_offset);
+                std::memcpy(job.data.data() + job.data_size, buf->data + buf_off, size);
+                job.data_size += size;
+
+                buf_off += size;
+                decompress_buf_off += size;
+                block_offset += size;
+
+                if (block_offset == ncz_block->size) {
+                    // stored blocks can skip the workers entirely.
+                    if (!job.compressed) {
+                        std::swap(job.out, job.data);
+                        job.out_size = job.data_size;
+                    }
+                    block_pool->Push(!job.compressed);
+
+                    // flush everything after the last block, otherwise only what's ready.
+                    if (ncz_block_index == t->ncz_blocks.size()) {
+                        while (!block_pool->IsEmpty()) {
+                            R_TRY(ncz_block_pop());
+                        }
+                    } else {
+                        while (block_pool->IsFrontDone()) {
+                            R_TRY(ncz_block_pop());
+                        }
+                    }
+                }
+            }
         } else if (is_ncz) {
             u64 buf_off{};
-            while (buf_off < buf.size()) {
-                std::span<const u8> buffer{buf.data() + buf_off, buf.size() - buf_off};
+            while (buf_off < buf->size) {
+                std::span<const u8> buffer{buf->data + buf_off, buf->size - buf_off};
                 bool compressed = true;
 
                 // todo: blocks need to use read offset, as the offset + size is compressed range.
@@ -698,17 +868,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                         ncz_block = &(*it);
                     }
 
-                    // https://github.com/nicoboss/nsz/issues/79
-                    auto decompressedBlockSize = 1UL << t->ncz_block_header.block_size_exponent;
-                    // special handling for the last block to check it's actually compressed
-                    if (ncz_block->offset == t->ncz_blocks.back().offset) {
-                        log_write("[NCZ] last block special handling\n");
-                        // https://github.com/nicoboss/nsz/issues/210
-                        const auto remainder = t->ncz_block_header.decompressed_size % decompressedBlockSize;
-                        if (remainder) {
-                            decompressedBlockSize = remainder;
-                        }
-                    }
+                    const auto decompressedBlockSize = get_block_decompressed_size(ncz_block);
 
                     // check if this block is compressed.
                     compressed = ncz_block->size < decompressedBlockSize;
@@ -721,34 +881,25 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 if (compressed) {
                     log_write("[NCZ] COMPRESSED block\n");
                     ZSTD_inBuffer input = { buffer.data(), buffer.size(), 0 };
-                    while (input.pos < input.size) {
+                    ZSTD_outBuffer output{};
+                    // keep going whilst the output is full as zstd may have more to flush.
+                    while (input.pos < input.size || output.pos == output.size) {
                         R_TRY(t->GetResults());
 
-                        inflate_buf.resize(inflate_offset + chunk_size);
-                        ZSTD_outBuffer output = { inflate_buf.data() + inflate_offset, chunk_size, 0 };
+                        // decompress directly into the write buffer.
+                        std::span<u8> out;
+                        R_TRY(ncz_inflate_reserve(out));
+                        output = { out.data(), std::min<u64>(out.size(), chunk_size), 0 };
                         const auto res = ZSTD_decompressStream(dctx, std::addressof(output), std::addressof(input));
                         if (ZSTD_isError(res)) {
                             log_write("[NCZ] ZSTD_decompressStream() pos: %zu size: %zu res: %zd msg: %s\n", input.pos, input.size, res, ZSTD_getErrorName(res));
                         }
                         R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
 
-                        t->decompress_offset += output.pos;
-                        inflate_offset += output.pos;
-                        if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                            log_write("[NCZ] flushing compressed data: %zd vs %zd diff: %zd\n", inflate_offset, INFLATE_BUFFER_MAX, inflate_offset - INFLATE_BUFFER_MAX);
-                            R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
-                        }
+                        R_TRY(ncz_inflate_commit(output.pos));
                     }
                 } else {
-                    inflate_buf.resize(inflate_offset + buffer.size());
-                    std::memcpy(inflate_buf.data() + inflate_offset, buffer.data(), buffer.size());
-
-                    t->decompress_offset += buffer.size();
-                    inflate_offset += buffer.size();
-                    if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                        log_write("[NCZ] flushing copy data\n");
-                        R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
-                    }
+                    R_TRY(ncz_inflate_copy(buffer.data(), buffer.size()));
                 }
 
                 buf_off += buffer.size();
@@ -758,10 +909,15 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         }
     }
 
+    // flush remaining blocks.
+    while (block_pool && !block_pool->IsEmpty()) {
+        R_TRY(ncz_block_pop());
+    }
+
     // flush remaining data.
-    if (is_ncz && inflate_offset) {
+    if (is_ncz && inflate_buf) {
         log_write("flushing remaining\n");
-        R_TRY(ncz_flush(inflate_offset));
+        R_TRY(ncz_flush());
     }
 
     log_write("decompress thread done!\n");
@@ -776,21 +932,21 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
 Result Yati::writeFuncInternal(ThreadData* t) {
     ON_SCOPE_EXIT( t->write_running = false; );
 
-    std::vector<u8> buf;
-    buf.reserve(t->max_buffer_size);
     const auto is_file_based_emummc = App::IsFileBaseEmummc();
 
     while (t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
-        s64 dummy_off;
-        R_TRY(t->GetWriteBuf(buf, dummy_off));
-        if (buf.empty()) {
+        auto buf = t->write_buffers.GetFront();
+        if (!buf) {
             break;
         }
 
+        ON_SCOPE_EXIT(t->write_buffers.Pop());
+        const auto& checkpoint = t->checkpoints[t->checkpoint_pop++ % RING_DEPTH];
+
         s64 off{};
-        while (off < buf.size() && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
-            const auto wsize = std::min<s64>(t->read_buffer_size, buf.size() - off);
-            R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, buf.data() + off, wsize));
+        while (off < buf->size && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
+            const auto wsize = std::min<s64>(t->read_buffer_size, buf->size - off);
+            R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, buf->data + off, wsize));
 
             off += wsize;
             t->write_offset += wsize;
@@ -803,6 +959,10 @@ Result Yati::writeFuncInternal(ThreadData* t) {
                 svcSleepThread(2e+6); // 2ms
             }
         }
+
+        if (off == buf->size) {
+            t->written_checkpoint = checkpoint;
+        }
     }
 
     log_write("finished write thread!\n");
@@ -898,6 +1058,7 @@ Result Yati::Setup(const ConfigOverride& override) {
     config.convert_to_standard_crypto = override.convert_to_standard_crypto.value_or(App::GetApp()->m_convert_to_standard_crypto.Get());
     config.lower_master_key = override.lower_master_key.value_or(App::GetApp()->m_lower_master_key.Get());
     config.lower_system_version = override.lower_system_version.value_or(App::GetApp()->m_lower_system_version.Get());
+    config.resumable = override.resumable.value_or(false);
     storage_id = config.sd_card_install ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser;
 
     R_TRY(source->GetOpenResult());
@@ -930,13 +1091,39 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
         }
     }
 
-    log_write("generateing placeholder\n");
-    R_TRY(ncmContentStorageGeneratePlaceHolderId(std::addressof(cs), std::addressof(nca.placeholder_id)));
-    log_write("creating placeholder\n");
-    R_TRY(ncmContentStorageCreatePlaceHolder(std::addressof(cs), std::addressof(nca.content_id), std::addressof(nca.placeholder_id), nca.size));
+    std::optional<ResumeEntry> resume{};
+    if (config.resumable) {
+        resume = TakeResumeEntry(nca.content_id, storage_id, nca.size);
+    }
+
+    if (resume) {
+        log_write("resuming placeholder from: %zd\n", resume->checkpoint.offset);
+        nca.placeholder_id = resume->placeholder_id;
+    } else {
+        log_write("generateing placeholder\n");
+        R_TRY(ncmContentStorageGeneratePlaceHolderId(std::addressof(cs), std::addressof(nca.placeholder_id)));
+        log_write("creating placeholder\n");
+        R_TRY(ncmContentStorageCreatePlaceHolder(std::addressof(cs), std::addressof(nca.content_id), std::addressof(nca.placeholder_id), nca.size));
+    }
 
     log_write("opening thread\n");
     ThreadData t_data{this, tickets, std::addressof(nca)};
+    R_TRY(t_data.Create());
+
+    if (resume) {
+        t_data.resume_offset = resume->checkpoint.offset;
+        t_data.write_offset = resume->checkpoint.offset;
+        t_data.sha256 = resume->checkpoint.sha256;
+        t_data.written_checkpoint = resume->checkpoint;
+    }
+
+    // keeps the placeholder with what has been written so far, this is done on
+    // success too, in case a later nca fails to install.
+    const auto save_resume = [&]() {
+        if (config.resumable && t_data.written_checkpoint.valid) {
+            SaveResumeEntry({nca.content_id, storage_id, nca.placeholder_id, nca.size, t_data.written_checkpoint});
+        }
+    };
 
     #define READ_THREAD_CORE 1
     #define DECOMPRESS_THREAD_CORE 2
@@ -1001,10 +1188,14 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
     }
     log_write("threads closed\n");
 
+    const auto pool_stats = utils::pool::GetStats();
+    log_write("[POOL] in use: %zu high water: %zu cached: %zu allocs: %zu reuses: %zu\n", pool_stats.in_use, pool_stats.high_water, pool_stats.cached, pool_stats.allocs, pool_stats.reuses);
+
     // if any of the threads failed, wake up all threads so they can exit.
     if (R_FAILED(t_data.GetResults())) {
         log_write("some reads failed, waking threads: %s\n", nca.name.c_str());
         log_write("returning due to fail: %s\n", nca.name.c_str());
+        save_resume();
         return t_data.GetResults();
     }
     R_TRY(t_data.GetResults());
@@ -1024,6 +1215,7 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
         log_write("skipping nca sha256 verify\n");
     }
 
+    save_resume();
     R_SUCCEED();
 }
 
@@ -1373,6 +1565,16 @@ Result Yati::RegisterNcasAndPushRecord(const CnmtCollection& cnmt, u32 latest_ve
     R_SUCCEED();
 }
 
+void Yati::CleanupPlaceHolder(const NcaCollection& nca, bool finished) {
+    if (!finished && config.resumable && HasResumeEntry(nca.placeholder_id)) {
+        log_write("keeping placeholder for resume: %s\n", nca.name.c_str());
+        return;
+    }
+
+    RemoveResumeEntry(nca.placeholder_id);
+    ncmContentStorageDeletePlaceHolder(std::addressof(cs), std::addressof(nca.placeholder_id));
+}
+
 Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override) {
     auto yati = std::make_unique<Yati>(pbox, source);
     R_TRY(yati->Setup(override));
@@ -1390,10 +1592,12 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
     }
 
     for (auto& cnmt : cnmts) {
+        // set once the placeholders are no longer needed for resuming.
+        bool finished{};
         ON_SCOPE_EXIT(
-            ncmContentStorageDeletePlaceHolder(std::addressof(yati->cs), std::addressof(cnmt.placeholder_id));
+            yati->CleanupPlaceHolder(cnmt, finished);
             for (auto& nca : cnmt.ncas) {
-                ncmContentStorageDeletePlaceHolder(std::addressof(yati->cs), std::addressof(nca.placeholder_id));
+                yati->CleanupPlaceHolder(nca, finished);
             }
         );
 
@@ -1406,6 +1610,7 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
 
         if (skip) {
             log_write("skipping install!\n");
+            finished = true;
             continue;
         }
 
@@ -1417,6 +1622,7 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
         R_TRY(yati->ImportTickets(tickets));
         R_TRY(yati->RemoveInstalledNcas(cnmt));
         R_TRY(yati->RegisterNcasAndPushRecord(cnmt, latest_version_num));
+        finished = true;
     }
 
     log_write("success!\n");
@@ -1431,6 +1637,7 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
     yati->config.skip_if_already_installed = false;
     yati->config.convert_to_standard_crypto = false;
     yati->config.lower_master_key = false;
+    yati->config.resumable = false;
 
     std::vector<NcaCollection> ncas{};
     std::vector<CnmtCollection> cnmts{};
@@ -1556,4 +1763,18 @@ Result InstallFromCollections(ui::ProgressBox* pbox, source::Base* source, const
     }
 }
 
+void DiscardResumeData() {
+    SCOPED_MUTEX(&g_resume_mutex);
+
+    for (const auto& e : g_resume_entries) {
+        NcmContentStorage cs;
+        if (R_SUCCEEDED(ncmOpenContentStorage(std::addressof(cs), e.storage_id))) {
+            ncmContentStorageDeletePlaceHolder(std::addressof(cs), std::addressof(e.placeholder_id));
+            ncmContentStorageClose(std::addressof(cs));
+        }
+    }
+
+    g_resume_entries.clear();
+}
+
 } // namespace sphaira::yati
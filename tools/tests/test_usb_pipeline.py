@@ -0,0 +1,207 @@
+import sys, os
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+import unittest
+import tempfile
+import shutil
+import socket
+import threading
+import time
+import crc32c
+
+from usb_common import *
+
+# Usb backed by a socket, standing in for the usb endpoints.
+class SocketUsb(Usb):
+	def __init__(self, sock, latency=0.0):
+		super().__init__()
+		self.sock = sock
+		# simulated delay before the host can handle each data request.
+		self.latency = latency
+
+	def wait_for_connect(self):
+		pass
+
+	def read(self, size, timeout=0):
+		buf = bytearray()
+		while len(buf) < size:
+			data = self.sock.recv(size - len(buf))
+			if not data:
+				raise ConnectionError("socket closed")
+			buf += data
+		return bytes(buf)
+
+	def write(self, buf, timeout=0):
+		self.sock.sendall(buf)
+		return len(buf)
+
+	def get_send_data_header(self):
+		header = super().get_send_data_header()
+		time.sleep(self.latency)
+		return header
+
+# mirrors what sphaira does (usb_installer.cpp) when reading a file.
+class FakeConsole(SocketUsb):
+	def __init__(self, sock, window, process_time=0.0):
+		super().__init__(sock)
+		self.window = window
+		# simulated time spent handling each chunk (decompress / write).
+		self.process_time = process_time
+
+	def handshake(self, caps=CAP_PIPELINE):
+		self.write(SendPacket.build(RESULT_OK, caps, self.window, HANDSHAKE_TAG).pack())
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		names = self.read(result.arg3).decode('utf-8').split('\n')
+		self.window = min(self.window, result.arg4)
+		return [name for name in names if name]
+
+	def open(self, index):
+		self.write(SendPacket.build(CMD_OPEN, index).pack())
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		return ((result.arg3 & 0xFFFF) << 32) | result.arg4
+
+	def receive(self):
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		buf = self.read(result.arg3)
+		if crc32c.crc32c(buf) != result.arg4:
+			raise ValueError("CRC32C mismatch")
+		return buf
+
+	def send_request(self, off, size):
+		self.write(SendDataPacket.build(off, size, 0).pack())
+
+	def read_file(self, file_size, chunk_size):
+		out = bytearray()
+		pending = []
+		request_off = 0
+
+		while len(out) < file_size:
+			if self.window:
+				# keep the window full.
+				while len(pending) < self.window and request_off < file_size:
+					size = min(chunk_size, file_size - request_off)
+					self.send_request(request_off, size)
+					pending.append(size)
+					request_off += size
+				pending.pop(0)
+			else:
+				self.send_request(len(out), min(chunk_size, file_size - len(out)))
+
+			out += self.receive()
+			time.sleep(self.process_time)
+
+		return bytes(out)
+
+	def close(self):
+		self.write(SendDataPacket.build(0, 0, 0).pack())
+		ResultPacket.unpack(self.read(PACKET_SIZE)).verify()
+
+	def quit(self):
+		self.write(SendPacket.build(CMD_QUIT).pack())
+		ResultPacket.unpack(self.read(PACKET_SIZE)).verify()
+
+def new_host(usb):
+	from usb_install import send_string_table, command_loop
+	command_loop(usb, send_string_table(usb))
+
+def old_host(usb):
+	from usb_install import paths, command_loop
+	from pathlib import Path
+	# replies to the handshake without a window, as older scripts did.
+	string_table = b''.join(bytes(Path(path).name, 'utf8') + b'\n' for [_, path] in paths)
+	usb.get_send_header()
+	usb.send_result(RESULT_OK, len(string_table))
+	usb.write(string_table)
+	command_loop(usb, 0)
+
+class TestUsbPipeline(unittest.TestCase):
+	CHUNK_SIZE = 1024 * 64
+
+	def setUp(self):
+		self.tempdir = tempfile.mkdtemp()
+		self.files = [
+			("test1.nsp", os.urandom(self.CHUNK_SIZE * 40)),
+			("test2.nsz", os.urandom(self.CHUNK_SIZE * 3 + 123)),
+			("test3.xci", b""),
+		]
+
+		from usb_install import add_file_to_install_list, paths
+		paths.clear()
+
+		for fname, data in self.files:
+			fpath = os.path.join(self.tempdir, fname)
+			with open(fpath, "wb") as f:
+				f.write(data)
+			add_file_to_install_list(fpath)
+
+	def tearDown(self):
+		shutil.rmtree(self.tempdir)
+
+	def run_install(self, window, host=new_host, caps=CAP_PIPELINE, latency=0.0, process_time=0.0, files=None, chunk_size=CHUNK_SIZE):
+		host_sock, console_sock = socket.socketpair()
+		host_usb = SocketUsb(host_sock, latency)
+		console = FakeConsole(console_sock, window, process_time)
+
+		thread = threading.Thread(target=host, args=(host_usb,), daemon=True)
+		thread.start()
+
+		try:
+			names = console.handshake(caps)
+			self.assertEqual(names, [fname for fname, _ in self.files])
+
+			start = time.perf_counter()
+			total = 0
+			for idx in (files if files is not None else range(len(self.files))):
+				file_size = console.open(idx)
+				self.assertEqual(file_size, len(self.files[idx][1]))
+
+				data = console.read_file(file_size, chunk_size)
+				self.assertEqual(data, self.files[idx][1])
+				console.close()
+				total += file_size
+
+			elapsed = time.perf_counter() - start
+			console.quit()
+			thread.join(5)
+			self.assertFalse(thread.is_alive())
+			return console.window, total / elapsed
+		finally:
+			host_sock.close()
+			console_sock.close()
+
+	def test_pipelined_install(self):
+		for window in (1, 2, 4, PIPELINE_WINDOW_MAX):
+			negotiated, _ = self.run_install(window)
+			self.assertEqual(negotiated, window)
+
+	def test_window_is_clamped(self):
+		negotiated, _ = self.run_install(PIPELINE_WINDOW_MAX * 4)
+		self.assertEqual(negotiated, PIPELINE_WINDOW_MAX)
+
+	def test_old_console(self):
+		# older versions of sphaira don't send any capabilities.
+		negotiated, _ = self.run_install(4, caps=CAP_NONE)
+		self.assertEqual(negotiated, 0)
+
+	def test_old_host(self):
+		negotiated, _ = self.run_install(4, host=old_host)
+		self.assertEqual(negotiated, 0)
+
+	def test_throughput(self):
+		# host and console each spend the same amount of time per chunk,
+		# which pipelining is able to overlap.
+		# small chunks are used so that the time is dominated by the latency.
+		results = {}
+		for window in (0, 1, 2, 4, 8):
+			caps = CAP_PIPELINE if window else CAP_NONE
+			_, speed = self.run_install(window, caps=caps, latency=0.01, process_time=0.01, files=[1], chunk_size=1024 * 4)
+			results[window] = speed
+			print("window: {} speed: {:.2f} MiB/s".format(window, speed / 1024 / 1024))
+
+		self.assertGreater(results[4], results[0] * 1.3)
+
+if __name__ == "__main__":
+	unittest.main()
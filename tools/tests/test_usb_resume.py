@@ -0,0 +1,286 @@
+import sys, os
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
+
+import unittest
+import tempfile
+import shutil
+import socket
+import threading
+import queue
+import crc32c
+
+from usb_common import *
+
+# Usb backed by a socket, a new socket is used each time the switch "reconnects".
+class ReconnectingUsb(Usb):
+	def __init__(self):
+		super().__init__()
+		self.connections = queue.Queue()
+		self.sock = None
+		# number of file data bytes sent for each connection.
+		self.data_sent = []
+
+	def wait_for_connect(self):
+		self.sock = self.connections.get(timeout=5)
+		self.data_sent.append(0)
+
+	# a closed socket is reported the same as an unplugged cable.
+	def read(self, size, timeout=0):
+		buf = bytearray()
+		while len(buf) < size:
+			try:
+				data = self.sock.recv(size - len(buf))
+			except OSError as e:
+				raise ConnectionError(str(e))
+			if not data:
+				raise ConnectionError("socket closed")
+			buf += data
+		return bytes(buf)
+
+	def write(self, buf, timeout=0):
+		# counted before sending, so that the console sees it once it has the data.
+		if len(buf) != PACKET_SIZE:
+			self.data_sent[-1] += len(buf)
+		try:
+			self.sock.sendall(buf)
+		except OSError as e:
+			raise ConnectionError(str(e))
+		return len(buf)
+
+# mirrors what sphaira does when installing, resuming from the last offset written.
+class FakeConsole:
+	def __init__(self, sock):
+		self.sock = sock
+
+	def read(self, size):
+		buf = bytearray()
+		while len(buf) < size:
+			data = self.sock.recv(size - len(buf))
+			if not data:
+				raise ConnectionError("socket closed")
+			buf += data
+		return bytes(buf)
+
+	def write(self, buf):
+		self.sock.sendall(buf)
+
+	def handshake(self, caps=CAP_NONE, window=0):
+		self.write(SendPacket.build(RESULT_OK, caps, window, HANDSHAKE_TAG).pack())
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		return self.read(result.arg3).decode('utf-8').split('\n')
+
+	def open(self, index):
+		self.write(SendPacket.build(CMD_OPEN, index).pack())
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		return ((result.arg3 & 0xFFFF) << 32) | result.arg4
+
+	def read_data(self, off, size):
+		self.write(SendDataPacket.build(off, size, 0).pack())
+		result = ResultPacket.unpack(self.read(PACKET_SIZE))
+		result.verify()
+		buf = self.read(result.arg3)
+		if crc32c.crc32c(buf) != result.arg4:
+			raise ValueError("CRC32C mismatch")
+		return buf
+
+	def close(self):
+		self.write(SendDataPacket.build(0, 0, 0).pack())
+		ResultPacket.unpack(self.read(PACKET_SIZE)).verify()
+
+	def quit(self):
+		self.write(SendPacket.build(CMD_QUIT).pack())
+		ResultPacket.unpack(self.read(PACKET_SIZE)).verify()
+
+class TestUsbResume(unittest.TestCase):
+	CHUNK_SIZE = 1024 * 64
+	# sphaira always reads the nca header again when resuming.
+	HEADER_SIZE = 0x4010
+
+	def setUp(self):
+		self.tempdir = tempfile.mkdtemp()
+		self.data = os.urandom(self.CHUNK_SIZE * 32 + 123)
+
+		from usb_install import add_file_to_install_list, paths
+		paths.clear()
+
+		fpath = os.path.join(self.tempdir, "test.nsp")
+		with open(fpath, "wb") as f:
+			f.write(self.data)
+		add_file_to_install_list(fpath)
+
+	def tearDown(self):
+		shutil.rmtree(self.tempdir)
+
+	def connect(self, usb):
+		host_sock, console_sock = socket.socketpair()
+		usb.connections.put(host_sock)
+		console = FakeConsole(console_sock)
+		self.assertEqual(console.handshake(), ["test.nsp", ""])
+		# don't count the string table as file data.
+		usb.data_sent[-1] = 0
+		return console, host_sock, console_sock
+
+	def test_resume_after_disconnect(self):
+		from usb_install import serve
+
+		usb = ReconnectingUsb()
+		thread = threading.Thread(target=serve, args=(usb,), daemon=True)
+		thread.start()
+
+		# first connection, the transfer is killed halfway through.
+		console, host_sock, console_sock = self.connect(usb)
+		file_size = console.open(0)
+		self.assertEqual(file_size, len(self.data))
+
+		out = bytearray()
+		while len(out) < file_size // 2:
+			out += console.read_data(len(out), min(self.CHUNK_SIZE, file_size - len(out)))
+		console_sock.close()
+		host_sock.close()
+
+		# the host should wait for the switch to reconnect.
+		console, host_sock, console_sock = self.connect(usb)
+		try:
+			self.assertEqual(console.open(0), file_size)
+
+			# the header is read again, then the remaining data.
+			self.assertEqual(console.read_data(0, self.HEADER_SIZE), self.data[:self.HEADER_SIZE])
+			resume_off = len(out)
+			while len(out) < file_size:
+				out += console.read_data(len(out), min(self.CHUNK_SIZE, file_size - len(out)))
+
+			console.close()
+			console.quit()
+			thread.join(5)
+			self.assertFalse(thread.is_alive())
+		finally:
+			host_sock.close()
+			console_sock.close()
+
+		self.assertEqual(bytes(out), self.data)
+		self.assertEqual(len(usb.data_sent), 2)
+		self.assertEqual(usb.data_sent[0], resume_off)
+		# only the remaining bytes (and the header) were sent after reconnecting.
+		self.assertEqual(usb.data_sent[1], self.HEADER_SIZE + file_size - resume_off)
+
+	def resume_without_reconnect(self, caps, window):
+		from usb_install import serve
+
+		usb = ReconnectingUsb()
+		thread = threading.Thread(target=serve, args=(usb,), daemon=True)
+		thread.start()
+
+		host_sock, console_sock = socket.socketpair()
+		usb.connections.put(host_sock)
+		console = FakeConsole(console_sock)
+		try:
+			self.assertEqual(console.handshake(caps, window), ["test.nsp", ""])
+			file_size = console.open(0)
+
+			out = bytearray()
+			while len(out) < file_size // 2:
+				out += console.read_data(len(out), min(self.CHUNK_SIZE, file_size - len(out)))
+
+			# the transfer timed out, sphaira sends the handshake again whilst
+			# the host is still inside the file transfer loop.
+			self.assertEqual(console.handshake(caps, window), ["test.nsp", ""])
+			self.assertEqual(console.open(0), file_size)
+			self.assertEqual(console.read_data(0, self.HEADER_SIZE), self.data[:self.HEADER_SIZE])
+			while len(out) < file_size:
+				out += console.read_data(len(out), min(self.CHUNK_SIZE, file_size - len(out)))
+
+			console.close()
+			console.quit()
+			thread.join(5)
+			self.assertFalse(thread.is_alive())
+		finally:
+			host_sock.close()
+			console_sock.close()
+
+		self.assertEqual(bytes(out), self.data)
+		# the same connection was used throughout.
+		self.assertEqual(len(usb.data_sent), 1)
+
+	def test_resume_without_reconnect(self):
+		self.resume_without_reconnect(CAP_NONE, 0)
+
+	def test_resume_without_reconnect_pipelined(self):
+		self.resume_without_reconnect(CAP_PIPELINE, 4)
+
+	def test_resume_from_command_loop(self):
+		from usb_install import serve
+
+		usb = ReconnectingUsb()
+		thread = threading.Thread(target=serve, args=(usb,), daemon=True)
+		thread.start()
+
+		host_sock, console_sock = socket.socketpair()
+		usb.connections.put(host_sock)
+		console = FakeConsole(console_sock)
+		try:
+			console.handshake()
+			console.open(0)
+			console.close()
+
+			# must not be taken as CMD_QUIT, which is also 0.
+			self.assertEqual(console.handshake(), ["test.nsp", ""])
+			console.quit()
+			thread.join(5)
+			self.assertFalse(thread.is_alive())
+		finally:
+			host_sock.close()
+			console_sock.close()
+
+	def test_gives_up_after_max_resumes(self):
+		from usb_install import serve
+
+		usb = ReconnectingUsb()
+		errors = queue.Queue()
+		def run():
+			try:
+				serve(usb)
+			except ConnectionError as e:
+				errors.put(e)
+		thread = threading.Thread(target=run, daemon=True)
+		thread.start()
+
+		# every connection is dropped straight after the handshake.
+		for _ in range(MAX_RESUMES + 1):
+			console, host_sock, console_sock = self.connect(usb)
+			console_sock.close()
+
+		thread.join(5)
+		self.assertFalse(thread.is_alive())
+		self.assertEqual(errors.qsize(), 1)
+		self.assertEqual(len(usb.data_sent), MAX_RESUMES + 1)
+
+	def test_other_errors_are_not_retried(self):
+		from usb_install import serve
+
+		usb = ReconnectingUsb()
+		errors = queue.Queue()
+		def run():
+			try:
+				serve(usb)
+			except IndexError as e:
+				errors.put(e)
+		thread = threading.Thread(target=run, daemon=True)
+		thread.start()
+
+		# a file that isn't in the string table.
+		console, host_sock, console_sock = self.connect(usb)
+		try:
+			console.write(SendPacket.build(CMD_OPEN, 5).pack())
+			thread.join(5)
+			self.assertFalse(thread.is_alive())
+			self.assertEqual(errors.qsize(), 1)
+			# the host didn't wait for the switch to reconnect.
+			self.assertEqual(len(usb.data_sent), 1)
+		finally:
+			host_sock.close()
+			console_sock.close()
+
+if __name__ == "__main__":
+	unittest.main()
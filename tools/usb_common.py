@@ -21,6 +21,31 @@ RESULT_ERROR = 1
 FLAG_NONE = 0
 FLAG_STREAM = 1 << 0
 
+# capabilities sent by sphaira in the connection handshake.
+CAP_NONE = 0
+# allows for multiple data requests to be in flight, replies are sent in order.
+CAP_PIPELINE = 1 << 0
+
+# max number of data requests in flight that the script will accept.
+PIPELINE_WINDOW_MAX = 8
+
+# sent by sphaira in arg5 of the handshake, so that it can be told apart from
+# a data request when sphaira resumes an install without being reconnected.
+HANDSHAKE_TAG = 0x48534B30
+
+# raised when the cable is unplugged or a transfer times out, sphaira then
+# reconnects and resumes the install.
+TRANSPORT_ERRORS = (usb.core.USBError, ConnectionError)
+# number of times an install is resumed before the script gives up.
+MAX_RESUMES = 8
+
+# raised when sphaira sends the handshake in the middle of a transfer.
+class HandshakeReceived(Exception):
+    def __init__(self, caps: int, max_window: int):
+        super().__init__("got handshake, sphaira is resuming")
+        self.caps = caps
+        self.max_window = max_window
+
 class UsbPacket:
     STRUCT_FORMAT = "<6I"  # 6 unsigned 32-bit ints, little-endian
 
@@ -55,10 +80,13 @@ class UsbPacket:
             raise ValueError("Bad magic")
         return True
 
+    def is_handshake(self):
+        return self.arg2 == RESULT_OK and self.arg5 == HANDSHAKE_TAG
+
 class SendPacket(UsbPacket):
     @classmethod
-    def build(cls, cmd, arg3=0, arg4=0):
-        packet = cls(MAGIC, cmd, arg3, arg4)
+    def build(cls, cmd, arg3=0, arg4=0, arg5=0):
+        packet = cls(MAGIC, cmd, arg3, arg4, arg5)
         packet.generate_crc32c()
         return packet
 
@@ -141,9 +169,13 @@ class Usb:
     def write(self, buf: bytes, timeout: int = 0) -> int:
         return self.__out_ep.write(data=buf, timeout=timeout)
 
-    def get_send_header(self) -> tuple[int, int, int]:
+    def get_send_packet(self) -> SendPacket:
         packet = SendPacket.unpack(self.read(PACKET_SIZE))
         packet.verify()
+        return packet
+
+    def get_send_header(self) -> tuple[int, int, int]:
+        packet = self.get_send_packet()
         return packet.get_cmd(), packet.arg3, packet.arg4
 
     def get_send_data_header(self) -> tuple[int, int, int]:
@@ -3,6 +3,8 @@ import glob
 from io import BufferedReader
 import sys
 import os
+import queue
+import threading
 from pathlib import Path
 from usb_common import *
 
@@ -25,40 +27,117 @@ def send_file_info_result(usb: Usb, result: int, file_size: int, flags: int):
     size_msb = ((file_size >> 32) & 0xFFFF) | (flags << 16)
     usb.send_result(result, size_msb, size_lsb)
 
-def file_transfer_loop(usb: Usb, file: BufferedReader, flags: int) -> None:
+def read_chunk(file: BufferedReader, flags: int, off: int, size: int) -> bytes | None:
+    # if we cannot seek, ensure that sphaira doesn't try to seek backwards.
+    if (flags & FLAG_STREAM) and off < file.tell():
+        print("Error: tried to seek on file without random access.")
+        return None
+
+    try:
+        file.seek(off)
+        return file.read(size)
+    except BlockingIOError as e:
+        print("Error: failed to read: {} at: {} size: {} error: {}".format(e.filename, off, size, str(e)))
+        return None
+
+def send_chunk(usb: Usb, buf: bytes | None) -> int:
+    if buf is None:
+        usb.send_result(RESULT_ERROR)
+        return 0
+
+    # respond back with the length of the data and the crc32c.
+    usb.send_result(RESULT_OK, len(buf), crc32c.crc32c(buf))
+
+    # send the data.
+    usb.write(buf)
+    return len(buf)
+
+def get_data_request(usb: Usb) -> tuple[int, int]:
+    [off, size, tag] = usb.get_send_data_header()
+
+    # sphaira sends 0 in arg5 of data requests, so this can only be the handshake,
+    # which is sent again when resuming an install after a transfer error.
+    if tag == HANDSHAKE_TAG:
+        raise HandshakeReceived(off, size)
+
+    return off, size
+
+def file_transfer_loop(usb: Usb, file: BufferedReader, flags: int) -> int:
     print("inside file transfer loop now")
+    sent = 0
 
     while True:
         # get offset + size.
-        [off, size, _] = usb.get_send_data_header()
+        [off, size] = get_data_request(usb)
 
         # check if we should finish now.
         if (off == 0 and size == 0):
             usb.send_result(RESULT_OK)
             break
 
-        # if we cannot seek, ensure that sphaira doesn't try to seek backwards.
-        if (flags & FLAG_STREAM) and off < file.tell():
-            print("Error: tried to seek on file without random access.")
-            usb.send_result(RESULT_ERROR)
-            continue
+        sent += send_chunk(usb, read_chunk(file, flags, off, size))
+
+    return sent
+
+def file_transfer_loop_pipelined(usb: Usb, file: BufferedReader, flags: int, window: int) -> int:
+    print("inside pipelined file transfer loop now, window: {}".format(window))
+    sent = 0
 
-        # read file and calculate the hash.
+    # sphaira sends up to window requests before reading the replies.
+    # requests are received (and the file read) on another thread, so that the
+    # next chunk is ready by the time the current one has been sent.
+    replies = queue.Queue(maxsize=window)
+    # set once sphaira sends the handshake again, the requests still queued
+    # were abandoned so their replies must not be sent.
+    abandoned = threading.Event()
+
+    def request_loop() -> None:
         try:
-            file.seek(off)
-            buf = file.read(size)
-        except BlockingIOError as e:
-            print("Error: failed to read: {} at: {} size: {} error: {}".format(e.filename, off, size, str(e)))
-            usb.send_result(RESULT_ERROR)
+            while True:
+                [off, size] = get_data_request(usb)
+
+                # None signals the end of the file transfer.
+                if (off == 0 and size == 0):
+                    replies.put(None)
+                    break
+
+                replies.put(read_chunk(file, flags, off, size))
+        except HandshakeReceived as e:
+            abandoned.set()
+            replies.put(e)
+        except Exception as e:
+            replies.put(e)
+
+    thread = threading.Thread(target=request_loop, daemon=True)
+    thread.start()
+
+    while True:
+        reply = replies.get()
+
+        if reply is None:
+            usb.send_result(RESULT_OK)
+            break
+        elif isinstance(reply, Exception):
+            raise reply
+        elif abandoned.is_set():
             continue
 
-        # respond back with the length of the data and the crc32c.
-        usb.send_result(RESULT_OK, len(buf), crc32c.crc32c(buf))
+        sent += send_chunk(usb, reply)
+
+    thread.join()
+    return sent
+
+def transfer_file(usb: Usb, file: BufferedReader, flags: int, window: int, file_size: int) -> int:
+    if window:
+        sent = file_transfer_loop_pipelined(usb, file, flags, window)
+    else:
+        sent = file_transfer_loop(usb, file, flags)
 
-        # send the data.
-        usb.write(buf)
+    # if sphaira resumed a failed install, only the remaining data is sent.
+    print("sent {} of {} bytes".format(sent, file_size))
+    return sent
 
-def wait_for_input(usb: Usb, file_index: int) -> None:
+def wait_for_input(usb: Usb, file_index: int, window: int = 0) -> None:
     print("now waiting for intput\n")
 
     # open file / rar. (todo: learn how to make a class with inheritance)
@@ -76,14 +155,14 @@ def wait_for_input(usb: Usb, file_index: int) -> None:
 
                     print("opened file: {} flags: {}".format(internal_path, flags))
                     send_file_info_result(usb, RESULT_OK, info.file_size, flags)
-                    file_transfer_loop(usb, file, flags)
+                    transfer_file(usb, file, flags, window, info.file_size)
         else:
             with open(path, "rb") as file:
                 print("opened file {}".format(path))
                 file.seek(0, os.SEEK_END)
                 file_size = file.tell()
                 send_file_info_result(usb, RESULT_OK, file_size, flags)
-                file_transfer_loop(usb, file, flags)
+                transfer_file(usb, file, flags, window, file_size)
 
     except OSError as e:
         print("Error: failed to open: {} error: {}".format(e.filename, str(e)))
@@ -107,6 +186,82 @@ def add_file_to_install_list(path: str) -> None:
         print("Adding file: {} type: FILE".format(path))
         paths.append([path, path])
 
+def send_string_table(usb: Usb, handshake: HandshakeReceived | None = None) -> int:
+    # build string table.
+    string_table = bytes()
+    for [_, path] in paths:
+        string_table += bytes(Path(path).name.__str__(), 'utf8') + b'\n'
+
+    # this reads the send header and checks the magic, unless it was already
+    # read during a transfer that sphaira is now resuming.
+    # newer versions of sphaira also send the capabilities and max window.
+    if handshake is None:
+        [_, caps, max_window] = usb.get_send_header()
+    else:
+        [caps, max_window] = [handshake.caps, handshake.max_window]
+
+    # older versions of sphaira send 0 for both, so pipelining stays disabled.
+    window = 0
+    if caps & CAP_PIPELINE:
+        window = min(max_window, PIPELINE_WINDOW_MAX)
+
+    # send recv and string table, along with the accepted window.
+    usb.send_result(RESULT_OK, len(string_table), window)
+    usb.write(string_table)
+    return window
+
+def command_loop(usb: Usb, window: int) -> None:
+    # wait for command.
+    while True:
+        packet = usb.get_send_packet()
+        if packet.is_handshake():
+            raise HandshakeReceived(packet.arg3, packet.arg4)
+
+        [cmd, arg3] = [packet.get_cmd(), packet.arg3]
+        if cmd == CMD_QUIT:
+            usb.send_result(RESULT_OK)
+            break
+        elif cmd == CMD_OPEN:
+            wait_for_input(usb, arg3, window)
+        else:
+            usb.send_result(RESULT_ERROR)
+            break
+
+def serve(usb: Usb) -> None:
+    # if the transfer fails (ie, the cable is unplugged), sphaira waits to be
+    # reconnected and then continues the install from where it stopped.
+    # if the cable wasn't unplugged (ie, a timeout), sphaira sends the handshake
+    # again on the same connection.
+    # any other error is a bug or a problem with the files, so it isn't retried.
+    handshake = None
+    resumes = 0
+    while True:
+        try:
+            # get usb endpoints.
+            if handshake is None:
+                usb.wait_for_connect()
+
+            window = send_string_table(usb, handshake)
+            handshake = None
+            print("pipeline window: {}".format(window))
+
+            command_loop(usb, window)
+            break
+
+        except (HandshakeReceived, *TRANSPORT_ERRORS) as e:
+            resumes += 1
+            if resumes > MAX_RESUMES:
+                print("giving up after {} resumes".format(MAX_RESUMES))
+                raise
+
+            if isinstance(e, HandshakeReceived):
+                print("sphaira is resuming the install")
+                handshake = e
+            else:
+                handshake = None
+                print("transfer failed: " + str(e))
+                print("waiting for the switch to reconnect...")
+
 if __name__ == '__main__':
     print("hello world")
 
@@ -127,36 +282,4 @@ if __name__ == '__main__':
     else:
         raise ValueError('must be a file!')
 
-    usb = Usb()
-
-    try:
-        # get usb endpoints.
-        usb.wait_for_connect()
-
-        # build string table.
-        string_table = bytes()
-        for [_, path] in paths:
-            string_table += bytes(Path(path).name.__str__(), 'utf8') + b'\n'
-
-        # this reads the send header and checks the magic.
-        usb.get_send_header()
-
-        # send recv and string table.
-        usb.send_result(RESULT_OK, len(string_table))
-        usb.write(string_table)
-
-        # wait for command.
-        while True:
-            [cmd, arg3, arg4] = usb.get_send_header()
-
-            if cmd == CMD_QUIT:
-                usb.send_result(RESULT_OK)
-                break
-            elif cmd == CMD_OPEN:
-                wait_for_input(usb, arg3)
-            else:
-                usb.send_result(RESULT_ERROR)
-                break
-
-    except Exception as inst:
-        print("An exception occurred " + str(inst))
+    serve(Usb())